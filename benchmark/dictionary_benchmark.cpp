@@ -0,0 +1,102 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+// 比较编译期完美散列的Dictionary与原先基于std::unordered_map的实现
+
+#include "dictionary.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// 原先的实现, 每次查找都需要构造std::string并计算完整的散列
+class MapDictionary {
+public:
+    MapDictionary() {
+        for (const auto &name:{"=", "++", "--", "+", "-", "*", "/", "%", "~", "&", "|", "^",
+                               "<<", ">>", "!", "&&", "||", "==", "!=", "<", ">", "<=", ">=",
+                               "->", ".", ",", "(", ")", "[", "]", "{", "}", ";", "auto",
+                               "break", "case", "char", "const", "continue", "default", "do",
+                               "double", "else", "enum", "extern", "float", "for", "goto",
+                               "if", "inline", "int", "long", "register", "restrict",
+                               "return", "short", "signed", "sizeof", "static", "struct",
+                               "switch", "typedef", "union", "unsigned", "void", "volatile",
+                               "while", "_Bool", "_Complex", "_Imaginary"}) {
+            Dictionary dictionary;
+            dictionary_.insert({name, dictionary.LookUp(name)});
+        }
+    }
+
+    std::tuple<TokenType, TokenValue, std::int32_t> LookUp(const std::string &name) const {
+        if (auto iter = dictionary_.find(name);iter != dictionary_.end()) {
+            return iter->second;
+        } else {
+            return {TokenType::kIdentifier, TokenValue::kIdentifier, -1};
+        }
+    }
+private:
+    std::unordered_map<std::string, std::tuple<TokenType, TokenValue, std::int32_t>> dictionary_;
+};
+
+// 大致模拟预处理之后的代码中关键字, 标识符与运算符的比例
+std::vector<std::string_view> MakeWorkload() {
+    std::vector<std::string_view> words{
+            "int", "main", "(", "void", ")", "{", "unsigned", "long", "counter", "=", "0",
+            ";", "for", "size_t", "index", "<", "length", "++", "if", "buffer", "[", "]",
+            "==", "'\\n'", "return", "static", "const", "char", "*", "__restrict", "__stream",
+            "struct", "_IO_FILE", "->", "_flags", "&&", "extern", "typedef", "__off64_t",
+            "sizeof", "}", "very_long_identifier_name_that_defeats_sso", "<<", "while"};
+
+    std::vector<std::string_view> workload;
+    for (std::size_t i{}; i < 1 << 20; ++i) {
+        workload.push_back(words[(i * 7919) % std::size(words)]);
+    }
+    return workload;
+}
+
+template<typename F>
+double Measure(const std::vector<std::string_view> &workload, std::int32_t rounds, F &&look_up) {
+    std::uint64_t checksum{};
+    auto begin{std::chrono::steady_clock::now()};
+    for (std::int32_t round{}; round < rounds; ++round) {
+        for (const auto &word:workload) {
+            checksum += static_cast<std::uint64_t>(std::get<1>(look_up(word)));
+        }
+    }
+    auto end{std::chrono::steady_clock::now()};
+
+    volatile auto sink{checksum};
+    static_cast<void>(sink);
+
+    return std::chrono::duration<double, std::nano>(end - begin).count() /
+           (static_cast<double>(std::size(workload)) * rounds);
+}
+
+}
+
+int main() {
+    constexpr std::int32_t rounds{20};
+    auto workload{MakeWorkload()};
+
+    MapDictionary map_dictionary;
+    auto map_time{Measure(workload, rounds, [&](std::string_view word) {
+        return map_dictionary.LookUp(std::string{word});
+    })};
+
+    Dictionary dictionary;
+    auto hash_time{Measure(workload, rounds, [&](std::string_view word) {
+        return dictionary.LookUp(word);
+    })};
+
+    std::cout << "unordered_map: " << map_time << " ns/lookup\n"
+              << "perfect hash:  " << hash_time << " ns/lookup\n"
+              << "speedup:       " << map_time / hash_time << "x\n";
+}
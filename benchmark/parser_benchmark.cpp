@@ -0,0 +1,102 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+// 测量Parser的吞吐量, 记号数由单独的一遍扫描得到, 计时只包括语法分析(含其中交替进行的扫描)
+// 用法: parser_benchmark [preprocessed.i]
+
+#include "ast_statistics.h"
+#include "flat_ast.h"
+#include "parser.h"
+#include "scanner.h"
+#include "type.h"
+#include "mapped_file.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// 没有指定输入文件时, 生成以表达式为主的函数
+std::string MakeInput(std::size_t size) {
+    std::string input{"typedef unsigned long size_t;\n"
+                      "struct node { int value; struct node *next; };\n"
+                      "extern int printf(const char *format, ...);\n"};
+    input.reserve(size + 1024);
+
+    for (std::size_t i{}; std::size(input) < size; ++i) {
+        auto name{std::to_string(i)};
+        input.append("static int f" + name + "(int a, int b, struct node *n, size_t m) {\n"
+                     "    int x = a * b + (a - b) / (b | 1) % 7 << 2;\n"
+                     "    x += n->value ? n->next->value & 0xff : -a;\n"
+                     "    for (int i = 0; i < (int)m && x != 42; ++i) {\n"
+                     "        x = x * 31 + (i ^ b) - (a >> 1) * sizeof(struct node);\n"
+                     "    }\n"
+                     "    if (a <= b || !(x >= 3 && b == 2)) printf(\"%d\\n\", x, a, b);\n"
+                     "    return x > 0 ? x : ~x;\n"
+                     "}\n");
+    }
+    return input;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    MappedFile file;
+    std::string generated;
+    std::string_view input;
+
+    if (argc > 1) {
+        file = MappedFile{argv[1]};
+        if (!file.IsOpen()) {
+            std::cerr << "error: can not open " << argv[1] << '\n';
+            return EXIT_FAILURE;
+        }
+        input = file.GetBuffer();
+    } else {
+        generated = MakeInput(std::size_t{32} << 20u);
+        input = generated;
+    }
+
+    std::uint64_t tokens{};
+    Scanner counter{input, "benchmark"};
+    while (counter.GetNextToken().GetTokenType() != TokenType::kEof) {
+        ++tokens;
+    }
+
+    Scanner scanner{input, "benchmark"};
+    TypeTable types;
+    Arena arena;
+    Parser parser{scanner, types, arena};
+
+    auto begin{std::chrono::steady_clock::now()};
+    auto program{parser.Parse()};
+    auto end{std::chrono::steady_clock::now()};
+
+    for (const auto &diagnostic:parser.GetDiagnostics()) {
+        std::cerr << diagnostic << '\n';
+    }
+
+    auto seconds{std::chrono::duration<double>(end - begin).count()};
+    std::cout << std::size(program->statements_) << " declarations, " << tokens << " tokens, "
+              << seconds * 1e3 << " ms, " << arena.GetBytesUsed() / 1024 / 1024 << " MB of nodes, "
+              << static_cast<double>(tokens) / seconds / 1e6 << " M tokens/s\n";
+
+    // 静态分派的遍历
+    begin = std::chrono::steady_clock::now();
+    ASTStatistics statistics;
+    statistics.Traverse(program);
+    end = std::chrono::steady_clock::now();
+    std::cout << statistics.GetTotal() << " nodes visited, " << std::chrono::duration<double>(end - begin).count() * 1e3
+              << " ms\n";
+
+    // 转换为数据导向的语法树
+    begin = std::chrono::steady_clock::now();
+    FlatAST flat{*program};
+    end = std::chrono::steady_clock::now();
+    std::cout << flat.GetNodeCount() << " flat nodes, " << std::chrono::duration<double>(end - begin).count() * 1e3
+              << " ms, " << flat.GetBytes() / 1024 / 1024 << " MB\n";
+}
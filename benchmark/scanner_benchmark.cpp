@@ -0,0 +1,93 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+// 测量Scanner在不同字符扫描实现下的吞吐量
+// 用法: scanner_benchmark [preprocessed.i]
+
+#include "scanner.h"
+#include "char_scan.h"
+#include "mapped_file.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// 没有指定输入文件时, 生成类似预处理之后的系统头文件的输入
+std::string MakeInput(std::size_t size) {
+    std::string_view chunk{
+            "# 320 \"/usr/include/stdio.h\" 3 4\n"
+            "extern int fprintf (FILE *__restrict __stream,\n"
+            "                    const char *__restrict __format, ...);\n"
+            "\n"
+            "extern int printf (const char *__restrict __format, ...);\n"
+            "typedef struct _IO_FILE FILE;\n"
+            "static unsigned long long __bswap_64 (unsigned long long __bsx)\n"
+            "{\n"
+            "  return ((((__bsx) & 255) >> 56) | __bsx);\n"
+            "}\n"
+            "int counter = 42; double ratio = 1.5e3;\n"
+            "const char *message = \"Hello, World!\\n\" \"%d items in the current buffer\";\n"};
+
+    std::string input;
+    input.reserve(size + std::size(chunk));
+    while (std::size(input) < size) {
+        input.append(chunk);
+    }
+    return input;
+}
+
+std::string_view LevelName(CharScanLevel level) {
+    switch (level) {
+        case CharScanLevel::kScalar:return "scalar";
+        case CharScanLevel::kSse42:return "sse4.2";
+        case CharScanLevel::kAvx2:return "avx2";
+    }
+    return "unknown";
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    MappedFile file;
+    std::string generated;
+    std::string_view input;
+
+    if (argc > 1) {
+        file = MappedFile{argv[1]};
+        if (!file.IsOpen()) {
+            std::cerr << "error: can not open " << argv[1] << '\n';
+            return EXIT_FAILURE;
+        }
+        input = file.GetBuffer();
+    } else {
+        generated = MakeInput(std::size_t{64} << 20u);
+        input = generated;
+    }
+
+    auto supported{GetSupportedCharScanLevel()};
+    for (auto level:{CharScanLevel::kScalar, CharScanLevel::kSse42, CharScanLevel::kAvx2}) {
+        if (static_cast<int>(level) > static_cast<int>(supported)) {
+            continue;
+        }
+        SetCharScanLevel(level);
+
+        Scanner scanner{input, "benchmark"};
+        std::uint64_t tokens{};
+
+        auto begin{std::chrono::steady_clock::now()};
+        while (scanner.GetNextToken().GetTokenType() != TokenType::kEof) {
+            ++tokens;
+        }
+        auto end{std::chrono::steady_clock::now()};
+
+        auto seconds{std::chrono::duration<double>(end - begin).count()};
+        std::cout << LevelName(level) << ": "
+                  << static_cast<double>(std::size(input)) / seconds / 1e9 << " GB/s, "
+                  << static_cast<double>(tokens) / seconds / 1e6 << " M tokens/s\n";
+    }
+}
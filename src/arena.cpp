@@ -0,0 +1,44 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "arena.h"
+
+#include <cassert>
+
+void *Arena::Allocate(std::size_t size, std::size_t align) {
+    assert(align != 0 && (align & (align - 1)) == 0 && align <= alignof(std::max_align_t));
+
+    auto padding{(align - reinterpret_cast<std::uintptr_t>(chunk_current_) % align) % align};
+    if (size + padding > chunk_left_) {
+        // 超过一块四分之一的大对象单独分配, 不浪费当前块剩余的空间
+        auto large{size > kChunkSize / 4};
+        auto chunk_size{large ? size : kChunkSize};
+        auto chunk{std::make_unique<char[]>(chunk_size)};
+        auto data{chunk.get()};
+        reserved_ += chunk_size;
+        used_ += size;
+
+        chunks_.push_back(std::move(chunk));
+        if (large) {
+            return data;
+        }
+        chunk_current_ = data + size;
+        chunk_left_ = chunk_size - size;
+        return data;
+    }
+
+    auto data{chunk_current_ + padding};
+    chunk_current_ = data + size;
+    chunk_left_ -= size + padding;
+    used_ += size;
+    return data;
+}
+
+std::size_t Arena::GetBytesUsed() const {
+    return used_;
+}
+
+std::size_t Arena::GetBytesReserved() const {
+    return reserved_;
+}
@@ -0,0 +1,79 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_ARENA_H
+#define TINY_C_COMPILER_ARENA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 分配在Arena中的定长数组, 只是一个指针和长度, 可以直接按值保存在节点中
+template<typename T>
+class ArenaList {
+public:
+    ArenaList() = default;
+    ArenaList(T *data, std::size_t size) : data_{data}, size_{static_cast<std::uint32_t>(size)} {}
+
+    T *begin() const { return data_; }
+    T *end() const { return data_ + size_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T &operator[](std::size_t index) const { return data_[index]; }
+    T &front() const { return data_[0]; }
+    T &back() const { return data_[size_ - 1]; }
+private:
+    T *data_{nullptr};
+    std::uint32_t size_{};
+};
+
+// 只增不减的内存池, 分配只是移动指针, 所有内存在Arena析构时一起释放
+// 其中的对象不会被析构, 所以只能保存平凡析构的类型, 一个翻译单元的语法树都分配在同一个Arena中
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *Allocate(std::size_t size, std::size_t align);
+
+    template<typename T, typename... Args>
+    T *New(Args &&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "objects in arena are never destroyed");
+        return new(Allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+    }
+
+    // 元素值初始化
+    template<typename T>
+    ArenaList<T> NewList(std::size_t size) {
+        static_assert(std::is_trivially_destructible_v<T>, "objects in arena are never destroyed");
+        if (size == 0) {
+            return {};
+        }
+        auto data{static_cast<T *>(Allocate(sizeof(T) * size, alignof(T)))};
+        for (auto p{data}; p != data + size; ++p) {
+            new(p) T{};
+        }
+        return {data, size};
+    }
+
+    // 已经分配出去的字节数和向系统申请的字节数
+    std::size_t GetBytesUsed() const;
+    std::size_t GetBytesReserved() const;
+private:
+    static constexpr std::size_t kChunkSize{64 * 1024};
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *chunk_current_{nullptr};
+    std::size_t chunk_left_{};
+    std::size_t used_{};
+    std::size_t reserved_{};
+};
+
+#endif //TINY_C_COMPILER_ARENA_H
@@ -5,181 +5,454 @@
 #ifndef TINY_C_COMPILER_AST_H
 #define TINY_C_COMPILER_AST_H
 
-#include <llvm/IR/Value.h>
+#include "arena.h"
+#include "interner.h"
+#include "token.h"
+#include "type.h"
 
-#include <vector>
-#include <memory>
-#include <string>
+#include <cstddef>
 #include <cstdint>
 
-class CodeGenContext;
 class Expression;
 class Statement;
 class VariableDeclaration;
 
-using ExpressionList=std::vector<std::unique_ptr<Expression>>;
-using StatementList=std::vector<std::unique_ptr<Statement>>;
-using VariableDeclarationList=std::vector<std::unique_ptr<VariableDeclaration>>;
+// 节点和子节点的列表都分配在同一个Arena中, 节点之间只用裸指针引用, 整棵树随Arena一起释放
+using ExpressionList=ArenaList<Expression *>;
+using StatementList=ArenaList<Statement *>;
+using VariableDeclarationList=ArenaList<VariableDeclaration *>;
+
+enum class StorageClass : std::uint8_t {
+    kNone,
+    kTypedef,
+    kExtern,
+    kStatic,
+    kAuto,
+    kRegister
+};
+
+// 节点的种类, 每个具体的节点类都有一个, 遍历时按它分派而不需要dynamic_cast
+// kNull只在FlatAST中表示空的子节点
+enum class NodeKind : std::uint8_t {
+    kNull,
+
+    kDouble,
+    kInteger,
+    kString,
+    kIdentifier,
+    kFunctionCall,
+    kBinaryOp,
+    kAssignment,
+    kUnaryOp,
+    kConditional,
+    kCast,
+    kSizeof,
+    kMember,
+    kIndex,
+    kInitializerList,
+
+    kBlock,
+    kExpressionStatement,
+    kVariableDeclaration,
+    kFunctionDeclaration,
+    kIf,
+    kFor,
+    kWhile,
+    kDoWhile,
+    kSwitch,
+    kCase,
+    kLabel,
+    kGoto,
+    kBreak,
+    kContinue,
+    kReturn,
+
+    kEnd
+};
 
+// offset_是节点第一个记号在预处理输出中的偏移, 用于报告错误
+// kind_由具体的节点类在构造时设置, 与类一一对应
+// 节点不会被单独析构, 析构函数不是虚函数, 所有节点都必须是平凡析构的
 class ASTNode {
 public:
-    virtual ~ASTNode() = default;
-    virtual llvm::Value *CodeGen(CodeGenContext &context) = 0;
+    std::uint32_t offset_{};
+    NodeKind kind_;
+protected:
+    explicit ASTNode(NodeKind kind) : kind_{kind} {}
+    ~ASTNode() = default;
+};
+
+class Expression : public ASTNode {
+protected:
+    using ASTNode::ASTNode;
+};
+
+class Statement : public ASTNode {
+protected:
+    using ASTNode::ASTNode;
 };
 
-class Expression : public ASTNode {};
+// 按kind_判断的dynamic_cast, 只匹配T本身, 不匹配T的派生类
+template<typename T>
+const T *NodeCast(const ASTNode *node) {
+    return node && node->kind_ == T::kKind ? static_cast<const T *>(node) : nullptr;
+}
+
+template<typename T>
+T *NodeCast(ASTNode *node) {
+    return node && node->kind_ == T::kKind ? static_cast<T *>(node) : nullptr;
+}
 
-class Statement : public ASTNode {};
+template<typename T>
+const T *NodeCast(std::nullptr_t) {
+    return nullptr;
+}
 
+// 类型由后缀决定, float或double
 class Double : public Expression {
 public:
-    explicit Double(double value) : value_{value} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kDouble};
+
+    Double(double value, const Type *type) : Expression{kKind}, value_{value}, type_{type} {}
 
     double value_;
+    const Type *type_;
 };
 
+// 整数和字符常量, 类型由后缀和值的大小决定
 class Integer : public Expression {
 public:
-    explicit Integer(std::int32_t value) : value_{value} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kInteger};
 
-    std::int32_t value_;
+    Integer(std::uint64_t value, const Type *type) : Expression{kKind}, value_{value}, type_{type} {}
+
+    std::uint64_t value_;
+    const Type *type_;
 };
 
+// 相邻的字符串字面量已经连接在一起
 class String : public Expression {
 public:
-    explicit String(const std::string &value) : value_{value} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kString};
+
+    explicit String(SymbolId value) : Expression{kKind}, value_{value} {}
 
-    std::string value_;
+    SymbolId value_;
 };
 
 class IdentifierOrType : public Expression {
 public:
-    explicit IdentifierOrType(const std::string &name) : name_{name} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kIdentifier};
+
+    explicit IdentifierOrType(SymbolId name) : Expression{kKind}, name_{name} {}
 
-    std::string name_;
+    SymbolId name_;
     bool is_type_{false};
 };
 
 class FunctionCall : public Expression {
 public:
-    explicit FunctionCall(std::unique_ptr<IdentifierOrType> function_name,
-                          std::unique_ptr<ExpressionList> args = nullptr) :
-            function_name_{std::move(function_name)}, args_{std::move(args)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kFunctionCall};
 
-    std::unique_ptr<IdentifierOrType> function_name_;
-    std::unique_ptr<ExpressionList> args_;
+    explicit FunctionCall(Expression *function, ExpressionList args = {}) :
+            Expression{kKind}, function_{function}, args_{args} {}
+
+    Expression *function_;
+    ExpressionList args_;
 };
 
+// op_为运算符记号的值, 包括逗号运算符
 class BinaryOpExpression : public Expression {
 public:
-    BinaryOpExpression(std::unique_ptr<Expression> lhs, std::unique_ptr<Expression> rhs,
-                       char op) : lhs_{std::move(lhs)}, rhs_{std::move(lhs)}, op_{op} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kBinaryOp};
+
+    BinaryOpExpression(Expression *lhs, Expression *rhs,
+                       TokenValue op) : BinaryOpExpression{kKind, lhs, rhs, op} {}
 
-    std::unique_ptr<Expression> lhs_;
-    std::unique_ptr<Expression> rhs_;
-    char op_;
+    Expression *lhs_;
+    Expression *rhs_;
+    TokenValue op_;
+protected:
+    BinaryOpExpression(NodeKind kind, Expression *lhs, Expression *rhs, TokenValue op) :
+            Expression{kind}, lhs_{lhs}, rhs_{rhs}, op_{op} {}
 };
 
+// op_为kAssign或者复合赋值运算符
 class Assignment : public BinaryOpExpression {
 public:
-    Assignment(std::unique_ptr<Expression> lhs, std::unique_ptr<Expression> rhs) :
-            BinaryOpExpression{std::move(lhs), std::move(rhs), '='} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kAssignment};
+
+    Assignment(Expression *lhs, Expression *rhs,
+               TokenValue op = TokenValue::kAssign) :
+            BinaryOpExpression{kKind, lhs, rhs, op} {}
+};
+
+// 前缀的 ++ -- & * + - ~ !, 以及后缀的 ++ --
+class UnaryOpExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kUnaryOp};
+
+    UnaryOpExpression(Expression *operand, TokenValue op, bool postfix = false) :
+            Expression{kKind}, operand_{operand}, op_{op}, postfix_{postfix} {}
+
+    Expression *operand_;
+    TokenValue op_;
+    bool postfix_;
+};
+
+class ConditionalExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kConditional};
+
+    ConditionalExpression(Expression *condition,
+                          Expression *true_expression,
+                          Expression *false_expression) :
+            Expression{kKind}, condition_{condition}, true_expression_{true_expression},
+            false_expression_{false_expression} {}
+
+    Expression *condition_;
+    Expression *true_expression_;
+    Expression *false_expression_;
+};
+
+class CastExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kCast};
+
+    CastExpression(const Type *type, Expression *expression) :
+            Expression{kKind}, type_{type}, expression_{expression} {}
+
+    const Type *type_;
+    Expression *expression_;
+};
+
+// sizeof 类型名 或者 sizeof 表达式, 二者只有一个有效
+class SizeofExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kSizeof};
+
+    explicit SizeofExpression(const Type *type) : Expression{kKind}, type_{type} {}
+    explicit SizeofExpression(Expression *expression) :
+            Expression{kKind}, expression_{expression} {}
+
+    const Type *type_{nullptr};
+    Expression *expression_{nullptr};
+};
+
+// object.member 或者 object->member
+class MemberExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kMember};
+
+    MemberExpression(Expression *object, SymbolId member, bool arrow) :
+            Expression{kKind}, object_{object}, member_{member}, arrow_{arrow} {}
+
+    Expression *object_;
+    SymbolId member_;
+    bool arrow_;
+};
+
+class IndexExpression : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kIndex};
+
+    IndexExpression(Expression *array, Expression *index) :
+            Expression{kKind}, array_{array}, index_{index} {}
+
+    Expression *array_;
+    Expression *index_;
+};
+
+// 花括号中的初始化列表, 元素可以是嵌套的列表
+class InitializerList : public Expression {
+public:
+    static constexpr NodeKind kKind{NodeKind::kInitializerList};
+
+    explicit InitializerList(ExpressionList elements) :
+            Expression{kKind}, elements_{elements} {}
+
+    ExpressionList elements_;
 };
 
 class Block : public Statement {
 public:
-    explicit Block(std::unique_ptr<StatementList> statements) :
-            statements_{std::move(statements)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kBlock};
 
-    std::unique_ptr<StatementList> statements_;
+    explicit Block(StatementList statements) :
+            Statement{kKind}, statements_{statements} {}
+
+    StatementList statements_;
 };
 
+// 空语句的expression_为空
 class ExpressionStatement : public Statement {
 public:
-    explicit ExpressionStatement(std::unique_ptr<Expression> expression) :
-            expression_{std::move(expression)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kExpressionStatement};
+
+    explicit ExpressionStatement(Expression *expression) :
+            Statement{kKind}, expression_{expression} {}
 
-    std::unique_ptr<Expression> expression_;
+    Expression *expression_;
 };
 
+// 一个声明中的多个声明符分别成为一个VariableDeclaration
 class VariableDeclaration : public Statement {
 public:
-    VariableDeclaration(std::unique_ptr<IdentifierOrType> type,
-                        std::unique_ptr<IdentifierOrType> variable_name,
-                        std::unique_ptr<Expression> initialization_expression = nullptr) :
-            type_{std::move(type)}, variable_name_{std::move(variable_name)},
-            initialization_expression_{std::move(initialization_expression)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kVariableDeclaration};
+
+    VariableDeclaration(const Type *type, SymbolId variable_name,
+                        Expression *initialization_expression = nullptr) :
+            Statement{kKind}, type_{type}, variable_name_{variable_name},
+            initialization_expression_{initialization_expression} {}
 
-    std::unique_ptr<IdentifierOrType> type_;
-    std::unique_ptr<IdentifierOrType> variable_name_;
-    std::unique_ptr<Expression> initialization_expression_;
+    const Type *type_;
+    SymbolId variable_name_;
+    Expression *initialization_expression_;
+    StorageClass storage_{StorageClass::kNone};
 };
 
+// 只有原型时body_为空
 class FunctionDeclaration : public Statement {
 public:
-    FunctionDeclaration(std::unique_ptr<IdentifierOrType> return_type,
-                        std::unique_ptr<IdentifierOrType> function_name,
-                        std::unique_ptr<VariableDeclarationList> args,
-                        std::unique_ptr<Block> body)
-            : return_type_{std::move(return_type)}, function_name_{std::move(function_name)},
-              args_{std::move(args)}, body_{std::move(body)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
-
-    std::unique_ptr<IdentifierOrType> return_type_;
-    std::unique_ptr<IdentifierOrType> function_name_;
-    std::unique_ptr<VariableDeclarationList> args_;
-    std::unique_ptr<Block> body_;
-    bool is_extern_{false};
+    static constexpr NodeKind kKind{NodeKind::kFunctionDeclaration};
+
+    FunctionDeclaration(const Type *type,
+                        SymbolId function_name,
+                        VariableDeclarationList args,
+                        Block *body)
+            : Statement{kKind}, type_{type}, function_name_{function_name},
+              args_{args}, body_{body} {}
+
+    // 函数类型, 返回类型为type_->base_
+    const Type *type_;
+    SymbolId function_name_;
+    VariableDeclarationList args_;
+    Block *body_;
+    StorageClass storage_{StorageClass::kNone};
+    bool is_inline_{false};
 };
 
 class IfStatenment : public Statement {
 public:
-    IfStatenment(std::unique_ptr<Expression> condition_,
-                 std::unique_ptr<Block> then_block,
-                 std::unique_ptr<Block> else_block)
-            : condition_{std::move(condition_)}, then_block_{std::move(then_block)},
-              else_block_{std::move(else_block)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kIf};
+
+    IfStatenment(Expression *condition_,
+                 Statement *then_statement,
+                 Statement *else_statement)
+            : Statement{kKind}, condition_{condition_}, then_statement_{then_statement},
+              else_statement_{else_statement} {}
 
-    std::unique_ptr<Expression> condition_;
-    std::unique_ptr<Block> then_block_;
-    std::unique_ptr<Block> else_block_;
+    Expression *condition_;
+    Statement *then_statement_;
+    Statement *else_statement_;
 };
 
+// initial_是一个表达式语句或者若干个变量声明, 它们的作用域是整个循环
 class ForStatenment : public Statement {
 public:
-    ForStatenment(std::unique_ptr<Expression> initial,
-                  std::unique_ptr<Expression> condition,
-                  std::unique_ptr<Expression> increment,
-                  std::unique_ptr<Block> block) :
-            initial_{std::move(initial)},
-            condition_{std::move(condition)},
-            increment_{std::move(increment)}, block_{std::move(block)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kFor};
+
+    ForStatenment(StatementList initial,
+                  Expression *condition,
+                  Expression *increment,
+                  Statement *body) :
+            Statement{kKind}, initial_{initial},
+            condition_{condition},
+            increment_{increment}, body_{body} {}
+
+    StatementList initial_;
+    Expression *condition_, *increment_;
+    Statement *body_;
+};
+
+class WhileStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kWhile};
+
+    WhileStatement(Expression *condition, Statement *body) :
+            Statement{kKind}, condition_{condition}, body_{body} {}
+
+    Expression *condition_;
+    Statement *body_;
+};
+
+class DoWhileStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kDoWhile};
+
+    DoWhileStatement(Statement *body, Expression *condition) :
+            Statement{kKind}, body_{body}, condition_{condition} {}
 
-    std::unique_ptr<Expression> initial_, condition_, increment_;
-    std::unique_ptr<Block> block_;
+    Statement *body_;
+    Expression *condition_;
 };
 
-class ReturnStatenment : public Statement {
+class SwitchStatement : public Statement {
 public:
-    explicit ReturnStatenment(std::unique_ptr<Expression> expression) :
-            expression_{std::move(expression)} {}
-    llvm::Value *CodeGen(CodeGenContext &context) override;
+    static constexpr NodeKind kKind{NodeKind::kSwitch};
+
+    SwitchStatement(Expression *condition, Statement *body) :
+            Statement{kKind}, condition_{condition}, body_{body} {}
+
+    Expression *condition_;
+    Statement *body_;
+};
+
+// case 常量: 语句, default的value_为空
+class CaseStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kCase};
+
+    CaseStatement(Expression *value, Statement *statement) :
+            Statement{kKind}, value_{value}, statement_{statement} {}
 
-    std::unique_ptr<Expression> expression_;
+    Expression *value_;
+    Statement *statement_;
 };
 
-//TODO struct array enum以及其他内置类型
+class LabelStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kLabel};
+
+    LabelStatement(SymbolId label, Statement *statement) :
+            Statement{kKind}, label_{label}, statement_{statement} {}
+
+    SymbolId label_;
+    Statement *statement_;
+};
+
+class GotoStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kGoto};
+
+    explicit GotoStatement(SymbolId label) : Statement{kKind}, label_{label} {}
+
+    SymbolId label_;
+};
+
+class BreakStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kBreak};
+
+    BreakStatement() : Statement{kKind} {}
+};
+
+class ContinueStatement : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kContinue};
+
+    ContinueStatement() : Statement{kKind} {}
+};
+
+// return; 的expression_为空
+class ReturnStatenment : public Statement {
+public:
+    static constexpr NodeKind kKind{NodeKind::kReturn};
+
+    explicit ReturnStatenment(Expression *expression) :
+            Statement{kKind}, expression_{expression} {}
+
+    Expression *expression_;
+};
 
-#endif //TINY_C_COMPILER_AST_H
\ No newline at end of file
+#endif //TINY_C_COMPILER_AST_H
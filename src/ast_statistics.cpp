@@ -0,0 +1,56 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "ast_statistics.h"
+#include "flat_ast.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+bool ASTStatistics::Traverse(const ASTNode *node) {
+    if (!node) {
+        return true;
+    }
+    max_depth_ = std::max(max_depth_, ++depth_);
+    auto result{ASTVisitor::Traverse(node)};
+    --depth_;
+    return result;
+}
+
+bool ASTStatistics::VisitNode(const ASTNode *node) {
+    ++counts_[static_cast<std::size_t>(node->kind_)];
+    ++total_;
+    return true;
+}
+
+std::uint64_t ASTStatistics::GetCount(NodeKind kind) const {
+    return counts_[static_cast<std::size_t>(kind)];
+}
+
+std::uint64_t ASTStatistics::GetTotal() const {
+    return total_;
+}
+
+std::size_t ASTStatistics::GetMaxDepth() const {
+    return max_depth_;
+}
+
+void ASTStatistics::Print(std::ostream &os) const {
+    std::vector<NodeKind> kinds;
+    for (std::size_t i{}; i < std::size(counts_); ++i) {
+        if (counts_[i] != 0) {
+            kinds.push_back(static_cast<NodeKind>(i));
+        }
+    }
+    std::stable_sort(std::begin(kinds), std::end(kinds),
+                     [this](NodeKind lhs, NodeKind rhs) { return GetCount(lhs) > GetCount(rhs); });
+
+    for (auto kind:kinds) {
+        os << std::left << std::setw(24) << GetNodeLayout(kind).name_ << std::right << std::setw(12)
+           << GetCount(kind) << '\n';
+    }
+    os << std::left << std::setw(24) << "Total" << std::right << std::setw(12) << total_ << '\n'
+       << std::left << std::setw(24) << "Max depth" << std::right << std::setw(12) << max_depth_ << '\n';
+}
@@ -0,0 +1,34 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_AST_STATISTICS_H
+#define TINY_C_COMPILER_AST_STATISTICS_H
+
+#include "ast.h"
+#include "ast_visitor.h"
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+
+// 统计各种节点的个数和树的深度, 用来观察语法树的形状
+class ASTStatistics : public ASTVisitor<ASTStatistics> {
+public:
+    bool Traverse(const ASTNode *node);
+    bool VisitNode(const ASTNode *node);
+
+    std::uint64_t GetCount(NodeKind kind) const;
+    std::uint64_t GetTotal() const;
+    std::size_t GetMaxDepth() const;
+    // 每种出现过的节点一行, 按个数从多到少排列
+    void Print(std::ostream &os) const;
+private:
+    std::array<std::uint64_t, static_cast<std::size_t>(NodeKind::kEnd)> counts_{};
+    std::uint64_t total_{};
+    std::size_t depth_{};
+    std::size_t max_depth_{};
+};
+
+#endif //TINY_C_COMPILER_AST_STATISTICS_H
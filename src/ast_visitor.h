@@ -0,0 +1,278 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_AST_VISITOR_H
+#define TINY_C_COMPILER_AST_VISITOR_H
+
+#include "ast.h"
+
+// 静态分派的语法树遍历, 派生类通过CRTP隐藏需要的函数, 所有调用都是直接调用, 可以内联
+// Traverse按kind_分派到TraverseXxx, TraverseXxx先调用Visit钩子再按源代码顺序遍历子节点
+// 一个节点依次调用VisitNode, VisitExpression或VisitStatement, 最后是VisitXxx
+// Assignment在VisitAssignment之前还会调用VisitBinaryOpExpression
+// 任何函数返回false都会终止整个遍历, 隐藏TraverseXxx可以改变顺序或者跳过子树
+// 空的子节点不会调用任何钩子
+template<typename Derived>
+class ASTVisitor {
+public:
+    bool Traverse(const ASTNode *node) {
+        if (!node) {
+            return true;
+        }
+
+        switch (node->kind_) {
+            case NodeKind::kDouble:return GetDerived().TraverseDouble(static_cast<const Double *>(node));
+            case NodeKind::kInteger:return GetDerived().TraverseInteger(static_cast<const Integer *>(node));
+            case NodeKind::kString:return GetDerived().TraverseString(static_cast<const String *>(node));
+            case NodeKind::kIdentifier:
+                return GetDerived().TraverseIdentifierOrType(static_cast<const IdentifierOrType *>(node));
+            case NodeKind::kFunctionCall:
+                return GetDerived().TraverseFunctionCall(static_cast<const FunctionCall *>(node));
+            case NodeKind::kBinaryOp:
+                return GetDerived().TraverseBinaryOpExpression(static_cast<const BinaryOpExpression *>(node));
+            case NodeKind::kAssignment:return GetDerived().TraverseAssignment(static_cast<const Assignment *>(node));
+            case NodeKind::kUnaryOp:
+                return GetDerived().TraverseUnaryOpExpression(static_cast<const UnaryOpExpression *>(node));
+            case NodeKind::kConditional:
+                return GetDerived().TraverseConditionalExpression(static_cast<const ConditionalExpression *>(node));
+            case NodeKind::kCast:return GetDerived().TraverseCastExpression(static_cast<const CastExpression *>(node));
+            case NodeKind::kSizeof:
+                return GetDerived().TraverseSizeofExpression(static_cast<const SizeofExpression *>(node));
+            case NodeKind::kMember:
+                return GetDerived().TraverseMemberExpression(static_cast<const MemberExpression *>(node));
+            case NodeKind::kIndex:
+                return GetDerived().TraverseIndexExpression(static_cast<const IndexExpression *>(node));
+            case NodeKind::kInitializerList:
+                return GetDerived().TraverseInitializerList(static_cast<const InitializerList *>(node));
+            case NodeKind::kBlock:return GetDerived().TraverseBlock(static_cast<const Block *>(node));
+            case NodeKind::kExpressionStatement:
+                return GetDerived().TraverseExpressionStatement(static_cast<const ExpressionStatement *>(node));
+            case NodeKind::kVariableDeclaration:
+                return GetDerived().TraverseVariableDeclaration(static_cast<const VariableDeclaration *>(node));
+            case NodeKind::kFunctionDeclaration:
+                return GetDerived().TraverseFunctionDeclaration(static_cast<const FunctionDeclaration *>(node));
+            case NodeKind::kIf:return GetDerived().TraverseIfStatenment(static_cast<const IfStatenment *>(node));
+            case NodeKind::kFor:return GetDerived().TraverseForStatenment(static_cast<const ForStatenment *>(node));
+            case NodeKind::kWhile:
+                return GetDerived().TraverseWhileStatement(static_cast<const WhileStatement *>(node));
+            case NodeKind::kDoWhile:
+                return GetDerived().TraverseDoWhileStatement(static_cast<const DoWhileStatement *>(node));
+            case NodeKind::kSwitch:
+                return GetDerived().TraverseSwitchStatement(static_cast<const SwitchStatement *>(node));
+            case NodeKind::kCase:return GetDerived().TraverseCaseStatement(static_cast<const CaseStatement *>(node));
+            case NodeKind::kLabel:
+                return GetDerived().TraverseLabelStatement(static_cast<const LabelStatement *>(node));
+            case NodeKind::kGoto:return GetDerived().TraverseGotoStatement(static_cast<const GotoStatement *>(node));
+            case NodeKind::kBreak:
+                return GetDerived().TraverseBreakStatement(static_cast<const BreakStatement *>(node));
+            case NodeKind::kContinue:
+                return GetDerived().TraverseContinueStatement(static_cast<const ContinueStatement *>(node));
+            case NodeKind::kReturn:
+                return GetDerived().TraverseReturnStatenment(static_cast<const ReturnStatenment *>(node));
+            default:return true;
+        }
+    }
+
+    template<typename T>
+    bool TraverseList(const ArenaList<T *> &list) {
+        for (auto element:list) {
+            if (!GetDerived().Traverse(element)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool TraverseDouble(const Double *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitDouble(node);
+    }
+
+    bool TraverseInteger(const Integer *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitInteger(node);
+    }
+
+    bool TraverseString(const String *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitString(node);
+    }
+
+    bool TraverseIdentifierOrType(const IdentifierOrType *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitIdentifierOrType(node);
+    }
+
+    bool TraverseFunctionCall(const FunctionCall *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitFunctionCall(node) &&
+               GetDerived().Traverse(node->function_) && TraverseList(node->args_);
+    }
+
+    bool TraverseBinaryOpExpression(const BinaryOpExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitBinaryOpExpression(node) &&
+               GetDerived().Traverse(node->lhs_) && GetDerived().Traverse(node->rhs_);
+    }
+
+    bool TraverseAssignment(const Assignment *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitBinaryOpExpression(node) &&
+               GetDerived().VisitAssignment(node) &&
+               GetDerived().Traverse(node->lhs_) && GetDerived().Traverse(node->rhs_);
+    }
+
+    bool TraverseUnaryOpExpression(const UnaryOpExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitUnaryOpExpression(node) &&
+               GetDerived().Traverse(node->operand_);
+    }
+
+    bool TraverseConditionalExpression(const ConditionalExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitConditionalExpression(node) &&
+               GetDerived().Traverse(node->condition_) && GetDerived().Traverse(node->true_expression_) &&
+               GetDerived().Traverse(node->false_expression_);
+    }
+
+    bool TraverseCastExpression(const CastExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitCastExpression(node) &&
+               GetDerived().Traverse(node->expression_);
+    }
+
+    bool TraverseSizeofExpression(const SizeofExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitSizeofExpression(node) &&
+               GetDerived().Traverse(node->expression_);
+    }
+
+    bool TraverseMemberExpression(const MemberExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitMemberExpression(node) &&
+               GetDerived().Traverse(node->object_);
+    }
+
+    bool TraverseIndexExpression(const IndexExpression *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitIndexExpression(node) &&
+               GetDerived().Traverse(node->array_) && GetDerived().Traverse(node->index_);
+    }
+
+    bool TraverseInitializerList(const InitializerList *node) {
+        return WalkUpFromExpression(node) && GetDerived().VisitInitializerList(node) &&
+               TraverseList(node->elements_);
+    }
+
+    bool TraverseBlock(const Block *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitBlock(node) && TraverseList(node->statements_);
+    }
+
+    bool TraverseExpressionStatement(const ExpressionStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitExpressionStatement(node) &&
+               GetDerived().Traverse(node->expression_);
+    }
+
+    bool TraverseVariableDeclaration(const VariableDeclaration *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitVariableDeclaration(node) &&
+               GetDerived().Traverse(node->initialization_expression_);
+    }
+
+    bool TraverseFunctionDeclaration(const FunctionDeclaration *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitFunctionDeclaration(node) &&
+               TraverseList(node->args_) && GetDerived().Traverse(node->body_);
+    }
+
+    bool TraverseIfStatenment(const IfStatenment *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitIfStatenment(node) &&
+               GetDerived().Traverse(node->condition_) && GetDerived().Traverse(node->then_statement_) &&
+               GetDerived().Traverse(node->else_statement_);
+    }
+
+    bool TraverseForStatenment(const ForStatenment *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitForStatenment(node) &&
+               TraverseList(node->initial_) && GetDerived().Traverse(node->condition_) &&
+               GetDerived().Traverse(node->increment_) && GetDerived().Traverse(node->body_);
+    }
+
+    bool TraverseWhileStatement(const WhileStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitWhileStatement(node) &&
+               GetDerived().Traverse(node->condition_) && GetDerived().Traverse(node->body_);
+    }
+
+    bool TraverseDoWhileStatement(const DoWhileStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitDoWhileStatement(node) &&
+               GetDerived().Traverse(node->body_) && GetDerived().Traverse(node->condition_);
+    }
+
+    bool TraverseSwitchStatement(const SwitchStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitSwitchStatement(node) &&
+               GetDerived().Traverse(node->condition_) && GetDerived().Traverse(node->body_);
+    }
+
+    bool TraverseCaseStatement(const CaseStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitCaseStatement(node) &&
+               GetDerived().Traverse(node->value_) && GetDerived().Traverse(node->statement_);
+    }
+
+    bool TraverseLabelStatement(const LabelStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitLabelStatement(node) &&
+               GetDerived().Traverse(node->statement_);
+    }
+
+    bool TraverseGotoStatement(const GotoStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitGotoStatement(node);
+    }
+
+    bool TraverseBreakStatement(const BreakStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitBreakStatement(node);
+    }
+
+    bool TraverseContinueStatement(const ContinueStatement *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitContinueStatement(node);
+    }
+
+    bool TraverseReturnStatenment(const ReturnStatenment *node) {
+        return WalkUpFromStatement(node) && GetDerived().VisitReturnStatenment(node) &&
+               GetDerived().Traverse(node->expression_);
+    }
+
+    // 默认的钩子什么也不做, 继续遍历
+    bool VisitNode(const ASTNode *) { return true; }
+    bool VisitExpression(const Expression *) { return true; }
+    bool VisitStatement(const Statement *) { return true; }
+
+    bool VisitDouble(const Double *) { return true; }
+    bool VisitInteger(const Integer *) { return true; }
+    bool VisitString(const String *) { return true; }
+    bool VisitIdentifierOrType(const IdentifierOrType *) { return true; }
+    bool VisitFunctionCall(const FunctionCall *) { return true; }
+    bool VisitBinaryOpExpression(const BinaryOpExpression *) { return true; }
+    bool VisitAssignment(const Assignment *) { return true; }
+    bool VisitUnaryOpExpression(const UnaryOpExpression *) { return true; }
+    bool VisitConditionalExpression(const ConditionalExpression *) { return true; }
+    bool VisitCastExpression(const CastExpression *) { return true; }
+    bool VisitSizeofExpression(const SizeofExpression *) { return true; }
+    bool VisitMemberExpression(const MemberExpression *) { return true; }
+    bool VisitIndexExpression(const IndexExpression *) { return true; }
+    bool VisitInitializerList(const InitializerList *) { return true; }
+
+    bool VisitBlock(const Block *) { return true; }
+    bool VisitExpressionStatement(const ExpressionStatement *) { return true; }
+    bool VisitVariableDeclaration(const VariableDeclaration *) { return true; }
+    bool VisitFunctionDeclaration(const FunctionDeclaration *) { return true; }
+    bool VisitIfStatenment(const IfStatenment *) { return true; }
+    bool VisitForStatenment(const ForStatenment *) { return true; }
+    bool VisitWhileStatement(const WhileStatement *) { return true; }
+    bool VisitDoWhileStatement(const DoWhileStatement *) { return true; }
+    bool VisitSwitchStatement(const SwitchStatement *) { return true; }
+    bool VisitCaseStatement(const CaseStatement *) { return true; }
+    bool VisitLabelStatement(const LabelStatement *) { return true; }
+    bool VisitGotoStatement(const GotoStatement *) { return true; }
+    bool VisitBreakStatement(const BreakStatement *) { return true; }
+    bool VisitContinueStatement(const ContinueStatement *) { return true; }
+    bool VisitReturnStatenment(const ReturnStatenment *) { return true; }
+protected:
+    ASTVisitor() = default;
+    ~ASTVisitor() = default;
+private:
+    Derived &GetDerived() { return *static_cast<Derived *>(this); }
+
+    bool WalkUpFromExpression(const Expression *node) {
+        return GetDerived().VisitNode(node) && GetDerived().VisitExpression(node);
+    }
+
+    bool WalkUpFromStatement(const Statement *node) {
+        return GetDerived().VisitNode(node) && GetDerived().VisitStatement(node);
+    }
+};
+
+#endif //TINY_C_COMPILER_AST_VISITOR_H
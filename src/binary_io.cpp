@@ -0,0 +1,23 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "binary_io.h"
+
+#include <cstdio>
+#include <fstream>
+
+bool Writer::Save(const std::string &file_name, std::string_view header) const {
+    auto temp_file{file_name + ".tmp"};
+    {
+        std::ofstream ofs{temp_file, std::ios::binary | std::ios::trunc};
+        ofs.write(std::data(header), static_cast<std::streamsize>(std::size(header)));
+        ofs.write(std::data(buffer_), static_cast<std::streamsize>(std::size(buffer_)));
+        ofs.write(std::data(strings_), static_cast<std::streamsize>(std::size(strings_)));
+        if (!ofs) {
+            std::remove(temp_file.c_str());
+            return false;
+        }
+    }
+    return std::rename(temp_file.c_str(), file_name.c_str()) == 0;
+}
@@ -0,0 +1,102 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_BINARY_IO_H
+#define TINY_C_COMPILER_BINARY_IO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// 预编译头文件和序列化的语法树共用的二进制格式: 文件头, 记录, 最后是字符串表
+// 记录都没有隐含的填充字节, 按主机字节序保存, 文件只在生成它的编译器上使用
+struct StringRef {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+class Writer {
+public:
+    template<typename T>
+    void Put(const T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void PutArray(const T *values, std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buffer_.append(reinterpret_cast<const char *>(values), sizeof(T) * count);
+    }
+
+    StringRef AddString(std::string_view string) {
+        StringRef ref{static_cast<std::uint32_t>(std::size(strings_)),
+                      static_cast<std::uint32_t>(std::size(string))};
+        strings_.append(string);
+        return ref;
+    }
+
+    // 先写到临时文件再改名, 其他进程不会读到写了一半的文件
+    template<typename Header>
+    bool Save(const std::string &file_name, const Header &header) const {
+        static_assert(std::is_trivially_copyable_v<Header>);
+        return Save(file_name, {reinterpret_cast<const char *>(&header), sizeof(header)});
+    }
+
+    std::string buffer_;
+    std::string strings_;
+private:
+    bool Save(const std::string &file_name, std::string_view header) const;
+};
+
+class Reader {
+public:
+    Reader(std::string_view data, std::string_view strings) : data_{data}, strings_{strings} {}
+
+    template<typename T>
+    bool Get(T &value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (std::size(data_) - position_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, std::data(data_) + position_, sizeof(T));
+        position_ += sizeof(T);
+        return true;
+    }
+
+    template<typename T>
+    bool GetArray(T *values, std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (!HasRoom(count, sizeof(T))) {
+            return false;
+        }
+        if (count != 0) {
+            std::memcpy(values, std::data(data_) + position_, sizeof(T) * count);
+        }
+        position_ += sizeof(T) * count;
+        return true;
+    }
+
+    // 用于在分配内存之前检查文件中的计数是否可信
+    bool HasRoom(std::size_t count, std::size_t record_size) const {
+        return count <= (std::size(data_) - position_) / record_size;
+    }
+
+    bool GetString(StringRef ref, std::string_view &string) const {
+        if (ref.offset > std::size(strings_) || std::size(strings_) - ref.offset < ref.length) {
+            return false;
+        }
+        string = strings_.substr(ref.offset, ref.length);
+        return true;
+    }
+private:
+    std::string_view data_;
+    std::string_view strings_;
+    std::size_t position_{};
+};
+
+#endif //TINY_C_COMPILER_BINARY_IO_H
@@ -0,0 +1,236 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "char_scan.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TCC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct ScanFunctions {
+    CharScanLevel level;
+    const char *(*skip_whitespace)(const char *, const char *);
+    const char *(*skip_identifier)(const char *, const char *);
+    const char *(*find_string_special)(const char *, const char *);
+};
+
+const char *SkipWhitespaceScalar(const char *begin, const char *end) {
+    while (begin != end && IsSpace(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+const char *SkipIdentifierScalar(const char *begin, const char *end) {
+    while (begin != end && IsIdentifierChar(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+const char *FindStringSpecialScalar(const char *begin, const char *end) {
+    while (begin != end && *begin != '\"' && *begin != '\\' && *begin != '\n') {
+        ++begin;
+    }
+    return begin;
+}
+
+constexpr ScanFunctions kScalarFunctions{CharScanLevel::kScalar,
+                                         SkipWhitespaceScalar,
+                                         SkipIdentifierScalar,
+                                         FindStringSpecialScalar};
+
+#ifdef TCC_X86_SIMD
+
+// SSE4.2: 用pcmpestri按范围或字符集合一次比较16个字节
+// 只处理完整的16字节块, 剩余部分交给标量实现, 因此不会越界读取
+
+template<int Mode>
+__attribute__((target("sse4.2")))
+const char *ScanSse42(const char *begin, const char *end, const char *set, int set_size) {
+    auto set_vector{_mm_loadu_si128(reinterpret_cast<const __m128i *>(set))};
+    while (end - begin >= 16) {
+        auto block{_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin))};
+        auto index{_mm_cmpestri(set_vector, set_size, block, 16, Mode)};
+        if (index != 16) {
+            return begin + index;
+        }
+        begin += 16;
+    }
+    return begin;
+}
+
+constexpr int kSkipRangesMode{_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+                              _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT};
+constexpr int kFindAnyMode{_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT};
+
+// 集合需要16个字节可读
+alignas(16) constexpr char kWhitespaceRanges[16]{'\t', '\r', ' ', ' '};
+alignas(16) constexpr char kIdentifierRanges[16]{'0', '9', 'A', 'Z', '_', '_', 'a', 'z'};
+alignas(16) constexpr char kStringSpecialSet[16]{'\"', '\\', '\n'};
+
+__attribute__((target("sse4.2")))
+const char *SkipWhitespaceSse42(const char *begin, const char *end) {
+    return SkipWhitespaceScalar(ScanSse42<kSkipRangesMode>(begin, end, kWhitespaceRanges, 4), end);
+}
+
+__attribute__((target("sse4.2")))
+const char *SkipIdentifierSse42(const char *begin, const char *end) {
+    return SkipIdentifierScalar(ScanSse42<kSkipRangesMode>(begin, end, kIdentifierRanges, 8), end);
+}
+
+__attribute__((target("sse4.2")))
+const char *FindStringSpecialSse42(const char *begin, const char *end) {
+    return FindStringSpecialScalar(ScanSse42<kFindAnyMode>(begin, end, kStringSpecialSet, 3), end);
+}
+
+constexpr ScanFunctions kSse42Functions{CharScanLevel::kSse42,
+                                        SkipWhitespaceSse42,
+                                        SkipIdentifierSse42,
+                                        FindStringSpecialSse42};
+
+// AVX2: 一次分类32个字节, 得到一个32位的掩码
+// 无符号的范围判断x - low <= high - low通过min_epu8实现
+
+__attribute__((target("avx2")))
+inline __m256i InRange(__m256i block, char low, char high) {
+    auto offset{_mm256_sub_epi8(block, _mm256_set1_epi8(low))};
+    auto limit{_mm256_set1_epi8(static_cast<char>(high - low))};
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, limit), offset);
+}
+
+inline const char *FirstSet(const char *begin, std::uint32_t mask) {
+    return begin + __builtin_ctz(mask);
+}
+
+__attribute__((target("avx2")))
+const char *SkipWhitespaceAvx2(const char *begin, const char *end) {
+    while (end - begin >= 32) {
+        auto block{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin))};
+        auto space{_mm256_or_si256(InRange(block, '\t', '\r'),
+                                   _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')))};
+        auto mask{~static_cast<std::uint32_t>(_mm256_movemask_epi8(space))};
+        if (mask != 0) {
+            return FirstSet(begin, mask);
+        }
+        begin += 32;
+    }
+    return SkipWhitespaceScalar(begin, end);
+}
+
+__attribute__((target("avx2")))
+const char *SkipIdentifierAvx2(const char *begin, const char *end) {
+    while (end - begin >= 32) {
+        auto block{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin))};
+        // 置位0x20之后大写字母变为小写, 其他字符不会因此落入['a', 'z']
+        auto lower{_mm256_or_si256(block, _mm256_set1_epi8(0x20))};
+        auto identifier{_mm256_or_si256(
+                _mm256_or_si256(InRange(lower, 'a', 'z'), InRange(block, '0', '9')),
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')))};
+        auto mask{~static_cast<std::uint32_t>(_mm256_movemask_epi8(identifier))};
+        if (mask != 0) {
+            return FirstSet(begin, mask);
+        }
+        begin += 32;
+    }
+    return SkipIdentifierScalar(begin, end);
+}
+
+__attribute__((target("avx2")))
+const char *FindStringSpecialAvx2(const char *begin, const char *end) {
+    while (end - begin >= 32) {
+        auto block{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin))};
+        auto special{_mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\"')),
+                                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\'))),
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')))};
+        auto mask{static_cast<std::uint32_t>(_mm256_movemask_epi8(special))};
+        if (mask != 0) {
+            return FirstSet(begin, mask);
+        }
+        begin += 32;
+    }
+    return FindStringSpecialScalar(begin, end);
+}
+
+constexpr ScanFunctions kAvx2Functions{CharScanLevel::kAvx2,
+                                       SkipWhitespaceAvx2,
+                                       SkipIdentifierAvx2,
+                                       FindStringSpecialAvx2};
+
+#endif
+
+const ScanFunctions *GetFunctions(CharScanLevel level) {
+    switch (level) {
+#ifdef TCC_X86_SIMD
+        case CharScanLevel::kAvx2:return &kAvx2Functions;
+        case CharScanLevel::kSse42:return &kSse42Functions;
+#endif
+        default:return &kScalarFunctions;
+    }
+}
+
+std::atomic<const ScanFunctions *> current_functions{GetFunctions(GetSupportedCharScanLevel())};
+
+}
+
+const char *SkipWhitespaceBulk(const char *begin, const char *end) {
+    return current_functions.load(std::memory_order_relaxed)->skip_whitespace(begin, end);
+}
+
+const char *SkipIdentifierBulk(const char *begin, const char *end) {
+    return current_functions.load(std::memory_order_relaxed)->skip_identifier(begin, end);
+}
+
+const char *FindStringSpecialBulk(const char *begin, const char *end) {
+    return current_functions.load(std::memory_order_relaxed)->find_string_special(begin, end);
+}
+
+// glibc的memchr本身已经是向量化的
+const char *FindLineEnd(const char *begin, const char *end) {
+    auto position{std::memchr(begin, '\n', static_cast<std::size_t>(end - begin))};
+    return position ? static_cast<const char *>(position) : end;
+}
+
+const char *FindCommentEnd(const char *begin, const char *end) {
+    while (begin != end) {
+        auto star{static_cast<const char *>(std::memchr(begin, '*', static_cast<std::size_t>(end - begin)))};
+        if (!star || star + 1 == end) {
+            return end;
+        } else if (star[1] == '/') {
+            return star;
+        }
+        begin = star + 1;
+    }
+    return end;
+}
+
+CharScanLevel GetCharScanLevel() {
+    return current_functions.load(std::memory_order_relaxed)->level;
+}
+
+void SetCharScanLevel(CharScanLevel level) {
+    if (static_cast<int>(level) > static_cast<int>(GetSupportedCharScanLevel())) {
+        level = GetSupportedCharScanLevel();
+    }
+    current_functions.store(GetFunctions(level), std::memory_order_relaxed);
+}
+
+CharScanLevel GetSupportedCharScanLevel() {
+#ifdef TCC_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return CharScanLevel::kAvx2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        return CharScanLevel::kSse42;
+    }
+#endif
+    return CharScanLevel::kScalar;
+}
@@ -0,0 +1,116 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_CHAR_SCAN_H
+#define TINY_C_COMPILER_CHAR_SCAN_H
+
+#include <array>
+#include <cstdint>
+
+// 字符分类表, 代替依赖locale的std::isspace/std::isalnum等函数
+enum CharClass : std::uint8_t {
+    kSpaceClass = 1u << 0u,
+    kDigitClass = 1u << 1u,
+    kHexDigitClass = 1u << 2u,
+    kAlphaClass = 1u << 3u,
+    kUnderscoreClass = 1u << 4u
+};
+
+constexpr std::array<std::uint8_t, 256> MakeCharClassTable() {
+    std::array<std::uint8_t, 256> table{};
+    for (auto c:{' ', '\t', '\n', '\v', '\f', '\r'}) {
+        table[static_cast<unsigned char>(c)] |= kSpaceClass;
+    }
+    for (auto c{'0'}; c <= '9'; ++c) {
+        table[static_cast<unsigned char>(c)] |= kDigitClass | kHexDigitClass;
+    }
+    for (auto c{'a'}; c <= 'z'; ++c) {
+        table[static_cast<unsigned char>(c)] |= kAlphaClass;
+        table[static_cast<unsigned char>(c - 'a' + 'A')] |= kAlphaClass;
+    }
+    for (auto c{'a'}; c <= 'f'; ++c) {
+        table[static_cast<unsigned char>(c)] |= kHexDigitClass;
+        table[static_cast<unsigned char>(c - 'a' + 'A')] |= kHexDigitClass;
+    }
+    table[static_cast<unsigned char>('_')] |= kUnderscoreClass;
+    return table;
+}
+
+inline constexpr std::array<std::uint8_t, 256> kCharClassTable{MakeCharClassTable()};
+
+inline bool IsSpace(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] & kSpaceClass;
+}
+
+inline bool IsDigit(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] & kDigitClass;
+}
+
+inline bool IsHexDigit(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] & kHexDigitClass;
+}
+
+inline bool IsAlpha(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] & kAlphaClass;
+}
+
+inline bool IsIdentifierHead(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] & (kAlphaClass | kUnderscoreClass);
+}
+
+inline bool IsIdentifierChar(char c) {
+    return kCharClassTable[static_cast<unsigned char>(c)] &
+           (kAlphaClass | kDigitClass | kUnderscoreClass);
+}
+
+// 以下函数在[begin, end)中一次处理16或32个字节
+// 运行时根据CPU选择AVX2, SSE4.2或者逐字节的实现
+enum class CharScanLevel {
+    kScalar,
+    kSse42,
+    kAvx2
+};
+
+// 返回第一个不是空白字符的位置
+const char *SkipWhitespaceBulk(const char *begin, const char *end);
+// 返回第一个不能出现在标识符中的字符的位置
+const char *SkipIdentifierBulk(const char *begin, const char *end);
+// 返回第一个'"', '\\'或'\n'的位置
+const char *FindStringSpecialBulk(const char *begin, const char *end);
+// 返回第一个'\n'的位置
+const char *FindLineEnd(const char *begin, const char *end);
+// 返回第一个"*/"的位置
+const char *FindCommentEnd(const char *begin, const char *end);
+
+// 大多数空白和标识符都很短, 先逐字节检查前几个字符, 避免间接调用和向量化的固定开销
+constexpr int kShortRunLength{8};
+
+inline const char *SkipWhitespace(const char *begin, const char *end) {
+    for (int i{}; i < kShortRunLength; ++i, ++begin) {
+        if (begin == end || !IsSpace(*begin)) {
+            return begin;
+        }
+    }
+    return SkipWhitespaceBulk(begin, end);
+}
+
+inline const char *SkipIdentifier(const char *begin, const char *end) {
+    for (int i{}; i < kShortRunLength; ++i, ++begin) {
+        if (begin == end || !IsIdentifierChar(*begin)) {
+            return begin;
+        }
+    }
+    return SkipIdentifierBulk(begin, end);
+}
+
+inline const char *FindStringSpecial(const char *begin, const char *end) {
+    return FindStringSpecialBulk(begin, end);
+}
+
+CharScanLevel GetCharScanLevel();
+// 不能超过CPU实际支持的级别, 主要用于测试和性能对比
+void SetCharScanLevel(CharScanLevel level);
+CharScanLevel GetSupportedCharScanLevel();
+
+#endif //TINY_C_COMPILER_CHAR_SCAN_H
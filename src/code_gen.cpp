@@ -3,7 +3,1970 @@
 //
 
 #include "code_gen.h"
+#include "ast_statistics.h"
+#include "time_trace.h"
 
-void CodeGenContext::GenerateCode(Block &root) {
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/xxhash.h>
 
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// 自动决定分区个数时, 每个分区至少有这么多个函数定义, 太小的模块不值得单独生成
+constexpr std::uint32_t kFunctionsPerPartition{64};
+
+TokenValue GetCompoundOperator(TokenValue op) {
+    switch (op) {
+        case TokenValue::kPlusAssign:return TokenValue::kPlus;
+        case TokenValue::kMinusAssign:return TokenValue::kMinus;
+        case TokenValue::kMultiplyAssign:return TokenValue::kMultiply;
+        case TokenValue::kDivideAssign:return TokenValue::kDivide;
+        case TokenValue::kModAssign:return TokenValue::kMod;
+        case TokenValue::kAndAssign:return TokenValue::kAnd;
+        case TokenValue::kOrAssign:return TokenValue::kOr;
+        case TokenValue::kXorAssign:return TokenValue::kXor;
+        case TokenValue::kShlAssign:return TokenValue::kShl;
+        default:return TokenValue::kShr;
+    }
+}
+
+bool IsComparison(TokenValue op) {
+    return op >= TokenValue::kEqual && op <= TokenValue::kGreaterOrEqual;
+}
+
+}
+
+GlobalSymbolTable::GlobalSymbolTable(const Block &root, std::uint32_t partitions) {
+    std::unordered_set<SymbolId> not_inline;
+    std::vector<std::pair<std::uint64_t, Symbol *>> functions;
+
+    for (auto statement:root.statements_) {
+        if (auto variable{NodeCast<VariableDeclaration>(statement)}) {
+            auto &symbol{symbols_.try_emplace(variable->variable_name_, Symbol{variable->type_}).first->second};
+            symbol.internal_ = symbol.internal_ || variable->storage_ == StorageClass::kStatic;
+            if (!symbol.type_->IsComplete() && variable->type_->IsComplete()) {
+                symbol.type_ = variable->type_;
+            }
+
+            // 有初始化器的定义优先于试探性定义
+            auto previous{NodeCast<VariableDeclaration>(symbol.definition_)};
+            if ((variable->initialization_expression_ || variable->storage_ != StorageClass::kExtern) &&
+                !(previous && previous->initialization_expression_)) {
+                symbol.definition_ = variable;
+                symbol.type_ = variable->type_;
+            }
+        } else if (auto function{NodeCast<FunctionDeclaration>(statement)}) {
+            auto &symbol{symbols_.try_emplace(function->function_name_, Symbol{function->type_}).first->second};
+            symbol.internal_ = symbol.internal_ || function->storage_ == StorageClass::kStatic;
+            if (!function->is_inline_ || function->storage_ == StorageClass::kExtern) {
+                not_inline.insert(function->function_name_);
+            }
+
+            if (function->body_) {
+                symbol.definition_ = function;
+                ASTStatistics statistics;
+                statistics.Traverse(function->body_);
+                functions.emplace_back(statistics.GetTotal(), &symbol);
+            }
+            auto defined{NodeCast<FunctionDeclaration>(symbol.definition_)};
+            if (function->type_->has_prototype_ ? !(defined && defined->type_->has_prototype_) : function == defined) {
+                symbol.type_ = function->type_;
+            }
+        }
+    }
+
+    for (auto &[name, symbol]:symbols_) {
+        symbol.inline_ = symbol.definition_ && symbol.type_->IsFunction() && !symbol.internal_ &&
+                         not_inline.find(name) == std::end(not_inline);
+    }
+
+    // 从大到小依次放入当前最小的分区
+    partitions_ = std::clamp<std::uint32_t>(partitions, 1, std::max<std::uint32_t>(
+            static_cast<std::uint32_t>(std::size(functions)), 1));
+    std::stable_sort(std::begin(functions), std::end(functions),
+                     [](const auto &lhs, const auto &rhs) { return lhs.first > rhs.first; });
+    std::vector<std::uint64_t> loads(partitions_);
+    for (auto &[weight, symbol]:functions) {
+        auto smallest{std::min_element(std::begin(loads), std::end(loads))};
+        *smallest += weight + 1;
+        symbol->partition_ = static_cast<std::uint32_t>(smallest - std::begin(loads));
+    }
+}
+
+const GlobalSymbolTable::Symbol *GlobalSymbolTable::Find(SymbolId name) const {
+    auto iter{symbols_.find(name)};
+    return iter == std::end(symbols_) ? nullptr : &iter->second;
+}
+
+std::uint32_t GlobalSymbolTable::GetPartitions() const {
+    return partitions_;
+}
+
+CodeGenContext::CodeGenContext(const Scanner &scanner, TypeTable &types, const std::string &module_name,
+                               Interner &interner) :
+        builder_{the_context_}, the_module_{std::make_unique<llvm::Module>(module_name, the_context_)},
+        scanner_{scanner}, types_{types}, interner_{interner} {
+    the_module_->setSourceFileName(scanner.GetFileName());
+    the_module_->setTargetTriple(llvm::sys::getDefaultTargetTriple());
+}
+
+void CodeGenContext::GenerateCode(const Block &root) {
+    GlobalSymbolTable globals{root};
+    GenerateCode(root, globals, 0);
+}
+
+void CodeGenContext::GenerateCode(const Block &root, const GlobalSymbolTable &globals, std::uint32_t partition) {
+    globals_ = &globals;
+    // 分区时static符号改名为隐藏的外部符号, 后缀由文件的绝对路径和预处理之后的内容决定,
+    // 不同目录中的同名文件, 以及同一个文件的不同版本不会得到相同的名字
+    if (globals.GetPartitions() > 1) {
+        std::error_code error_code;
+        auto path{std::filesystem::absolute(scanner_.GetFileName(), error_code).string()};
+        auto input{scanner_.GetInput()};
+        suffix_ = llvm::utohexstr(llvm::xxHash64(path), true)
+                  + llvm::utohexstr(llvm::xxHash64(llvm::StringRef{std::data(input), std::size(input)}), true);
+    }
+
+    for (auto statement:root.statements_) {
+        if (auto variable{NodeCast<VariableDeclaration>(statement)}) {
+            auto symbol{globals.Find(variable->variable_name_)};
+            if (symbol && symbol->definition_ == variable && partition == 0) {
+                DefineVariable(variable, *symbol);
+            }
+        } else if (auto function{NodeCast<FunctionDeclaration>(statement)}) {
+            auto symbol{globals.Find(function->function_name_)};
+            if (symbol && symbol->definition_ == function && symbol->partition_ == partition) {
+                DefineFunction(function, *symbol);
+            }
+        }
+    }
+
+    if (initializer_function_) {
+        initializer_function_->eraseFromParent();
+        initializer_function_ = nullptr;
+    }
+    globals_ = nullptr;
+}
+
+const DiagnosticList &CodeGenContext::GetDiagnostics() const {
+    return diagnostics_;
+}
+
+bool CodeGenContext::HasErrors() const {
+    return std::any_of(std::begin(diagnostics_), std::end(diagnostics_),
+                       [](const Diagnostic &diagnostic) { return !diagnostic.warning_; });
+}
+
+// 结构体和联合只是一块有对齐要求的内存, 成员都按字节偏移访问, 与Type中的布局一致
+llvm::Type *CodeGenContext::GetType(const Type *type) {
+    switch (type->kind_) {
+        case TypeKind::kVoid:return builder_.getVoidTy();
+        case TypeKind::kBool:
+        case TypeKind::kChar:return builder_.getInt8Ty();
+        case TypeKind::kShort:return builder_.getInt16Ty();
+        case TypeKind::kInt:
+        case TypeKind::kEnum:return builder_.getInt32Ty();
+        case TypeKind::kLong:
+        case TypeKind::kLongLong:return builder_.getInt64Ty();
+        case TypeKind::kFloat:return builder_.getFloatTy();
+        case TypeKind::kDouble:return builder_.getDoubleTy();
+        case TypeKind::kLongDouble:return llvm::Type::getX86_FP80Ty(the_context_);
+        case TypeKind::kPointer:
+            return (type->base_->IsVoid() ? builder_.getInt8Ty() : GetType(type->base_))->getPointerTo();
+        case TypeKind::kArray:
+            return llvm::ArrayType::get(GetType(type->base_),
+                                        type->length_ < 0 ? 0 : static_cast<std::uint64_t>(type->length_));
+        case TypeKind::kFunction:return GetFunctionType(type);
+        default: {
+            auto &record{records_[type]};
+            if (!record) {
+                std::string name{type->kind_ == TypeKind::kStruct ? "struct." : "union."};
+                name += type->tag_ == kEmptySymbol ? "anon" : interner_.GetSpelling(type->tag_);
+                record = llvm::StructType::create(the_context_, name);
+            }
+            if (record->isOpaque() && type->complete_) {
+                record->setBody(llvm::ArrayType::get(builder_.getInt8Ty(), type->size_));
+            }
+            return record;
+        }
+    }
+}
+
+// 返回结构体的函数通过第一个参数指向的内存返回, 结构体参数传递地址并由被调用者复制
+llvm::FunctionType *CodeGenContext::GetFunctionType(const Type *type) {
+    std::vector<llvm::Type *> params;
+    auto return_type{GetType(type->base_)};
+    if (type->base_->IsRecord()) {
+        params.push_back(return_type->getPointerTo());
+        return_type = builder_.getVoidTy();
+    }
+    for (const auto &param:type->params_) {
+        auto param_type{GetType(param.type_)};
+        params.push_back(param.type_->IsRecord() ? param_type->getPointerTo() : param_type);
+    }
+    return llvm::FunctionType::get(return_type, params, type->variadic_);
+}
+
+llvm::AttributeList CodeGenContext::GetAttributes(const Type *return_type, const std::vector<const Type *> &args) {
+    llvm::AttributeList attributes;
+    unsigned index{};
+    if (return_type->IsRecord()) {
+        attributes = attributes.addParamAttribute(
+                the_context_, index++, llvm::Attribute::getWithStructRetType(the_context_, GetType(return_type)));
+    }
+    for (auto arg:args) {
+        if (arg->IsRecord()) {
+            attributes = attributes.addParamAttribute(
+                    the_context_, index, llvm::Attribute::getWithByValType(the_context_, GetType(arg)));
+            attributes = attributes.addParamAttribute(
+                    the_context_, index, llvm::Attribute::getWithAlignment(the_context_, llvm::Align(arg->GetAlign())));
+        }
+        ++index;
+    }
+    return attributes;
+}
+
+std::string CodeGenContext::GetGlobalName(SymbolId name, const GlobalSymbolTable::Symbol *symbol) const {
+    std::string result{interner_.GetSpelling(name)};
+    if (symbol && symbol->internal_ && globals_->GetPartitions() > 1) {
+        result += '.' + suffix_;
+    }
+    return result;
+}
+
+// 第一次使用时在模块中声明, 符号表中没有的名字(块作用域中的外部声明)使用type
+CodeGenContext::LValue CodeGenContext::GetGlobal(SymbolId name, const Type *type) {
+    auto symbol{globals_ ? globals_->Find(name) : nullptr};
+    if (symbol) {
+        type = symbol->type_;
+    }
+
+    auto global_name{GetGlobalName(name, symbol)};
+    auto value_type{type->IsFunction() ? GetFunctionType(type) : GetType(type)};
+    auto value{the_module_->getNamedValue(global_name)};
+    if (!value) {
+        if (type->IsFunction()) {
+            auto function{llvm::Function::Create(GetFunctionType(type), llvm::GlobalValue::ExternalLinkage,
+                                                 global_name, *the_module_)};
+            std::vector<const Type *> params;
+            for (const auto &param:type->params_) {
+                params.push_back(param.type_);
+            }
+            function->setAttributes(GetAttributes(type->base_, params));
+            value = function;
+        } else {
+            auto variable{new llvm::GlobalVariable(*the_module_, value_type, false,
+                                                   llvm::GlobalValue::ExternalLinkage, nullptr, global_name)};
+            variable->setAlignment(llvm::Align(type->GetAlign()));
+            value = variable;
+        }
+        if (symbol && symbol->internal_ && globals_->GetPartitions() > 1) {
+            value->setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+    }
+
+    if (value->getValueType() != value_type) {
+        return {llvm::ConstantExpr::getBitCast(value, value_type->getPointerTo()), type};
+    }
+    return {value, type};
+}
+
+// 定义的类型与之前的声明不同时用新的全局值代替, 已有的引用改为对新值的类型转换
+llvm::GlobalValue *CodeGenContext::ReplaceGlobal(llvm::GlobalValue *old_value, llvm::GlobalValue *new_value) {
+    if (old_value) {
+        old_value->replaceAllUsesWith(llvm::ConstantExpr::getBitCast(new_value, old_value->getType()));
+        new_value->takeName(old_value);
+        old_value->eraseFromParent();
+    }
+    return new_value;
+}
+
+void CodeGenContext::SetLinkage(llvm::GlobalValue *value, const GlobalSymbolTable::Symbol &symbol) {
+    if (symbol.internal_ && globals_->GetPartitions() > 1) {
+        value->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        value->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    } else if (symbol.internal_) {
+        value->setLinkage(llvm::GlobalValue::InternalLinkage);
+    } else if (symbol.inline_ && globals_->GetPartitions() > 1) {
+        // 其他分区只声明并调用这个函数, 优化不能删除定义分区中的副本
+        value->setLinkage(llvm::GlobalValue::WeakODRLinkage);
+    } else if (symbol.inline_) {
+        value->setLinkage(llvm::GlobalValue::LinkOnceODRLinkage);
+    } else {
+        value->setLinkage(llvm::GlobalValue::ExternalLinkage);
+    }
+}
+
+void CodeGenContext::DefineVariable(const VariableDeclaration *declaration, const GlobalSymbolTable::Symbol &symbol) {
+    auto type{symbol.type_};
+    // 试探性定义的不完整数组有一个元素
+    if (type->IsArray() && type->length_ < 0) {
+        type = types_.GetArray(type->base_, 1);
+    }
+    if (!type->IsComplete()) {
+        ErrorReport(declaration, "variable has incomplete type");
+        return;
+    }
+
+    auto init{EmitConstantInitializer(type, declaration->initialization_expression_)};
+    if (!init) {
+        return;
+    }
+
+    auto name{GetGlobalName(declaration->variable_name_, &symbol)};
+    auto old_value{the_module_->getNamedValue(name)};
+    auto variable{llvm::dyn_cast_or_null<llvm::GlobalVariable>(old_value)};
+    if (!variable || variable->getValueType() != init->getType()) {
+        variable = new llvm::GlobalVariable(*the_module_, init->getType(), false,
+                                            llvm::GlobalValue::ExternalLinkage, nullptr, name);
+        ReplaceGlobal(old_value, variable);
+    }
+    variable->setInitializer(init);
+    variable->setAlignment(llvm::Align(type->GetAlign()));
+    SetLinkage(variable, symbol);
+}
+
+void CodeGenContext::DefineFunction(const FunctionDeclaration *declaration, const GlobalSymbolTable::Symbol &symbol) {
+    auto type{declaration->type_};
+    auto name{GetGlobalName(declaration->function_name_, &symbol)};
+    llvm::TimeTraceScope scope{"CodeGenFunction", name};
+    auto old_value{the_module_->getNamedValue(name)};
+    auto function{llvm::dyn_cast_or_null<llvm::Function>(old_value)};
+    if (!function || function->getFunctionType() != GetFunctionType(type)) {
+        function = llvm::Function::Create(GetFunctionType(type), llvm::GlobalValue::ExternalLinkage,
+                                          name, *the_module_);
+        ReplaceGlobal(old_value, function);
+    }
+
+    std::vector<const Type *> params;
+    for (const auto &param:type->params_) {
+        params.push_back(param.type_);
+    }
+    function->setAttributes(GetAttributes(type->base_, params));
+    SetLinkage(function, symbol);
+
+    function_ = function;
+    declaration_ = declaration;
+    builder_.SetInsertPoint(NewBlock("entry"));
+    EnterScope();
+
+    // 结构体参数已经由调用者复制, 直接使用它的地址, 其他参数复制到栈上以便取地址和修改
+    auto arg{function->arg_begin()};
+    return_address_ = type->base_->IsRecord() ? &*arg++ : nullptr;
+    for (auto param:declaration->args_) {
+        auto &value{*arg++};
+        std::string param_name{interner_.GetSpelling(param->variable_name_)};
+        value.setName(param_name);
+
+        llvm::Value *address{&value};
+        if (!param->type_->IsRecord()) {
+            address = CreateAlloca(param->type_, param_name + ".addr");
+            builder_.CreateAlignedStore(&value, address, llvm::MaybeAlign(param->type_->GetAlign()));
+        }
+        if (param->variable_name_ != kEmptySymbol) {
+            scopes_.back()[param->variable_name_] = {address, param->type_};
+        }
+    }
+
+    labels_.clear();
+    pending_labels_.clear();
+    EmitStatement(declaration->body_);
+
+    // 执行到函数末尾时返回0, 对main来说就是正常退出
+    if (!builder_.GetInsertBlock()->getTerminator()) {
+        auto return_type{type->base_};
+        if (return_type->IsVoid() || return_type->IsRecord()) {
+            builder_.CreateRetVoid();
+        } else {
+            builder_.CreateRet(llvm::Constant::getNullValue(GetType(return_type)));
+        }
+    }
+
+    for (const auto &[label, node]:pending_labels_) {
+        ErrorReport(node, "use of undeclared label '" + std::string{interner_.GetSpelling(label)} + "'");
+    }
+    // break, return等之后的代码和没有定义的标号所在的块不可达
+    for (auto &block:*function) {
+        if (!block.getTerminator()) {
+            builder_.SetInsertPoint(&block);
+            builder_.CreateUnreachable();
+        }
+    }
+
+    ExitScope();
+    function_ = nullptr;
+    declaration_ = nullptr;
+    return_address_ = nullptr;
+}
+
+// 文件作用域和static变量的初始值, 没有初始化器时为0
+// 初始化器按普通表达式生成, IRBuilder会折叠常量, 折叠之后不是常量的初始化器是错误的
+llvm::Constant *CodeGenContext::EmitConstantInitializer(const Type *type, const Expression *init) {
+    if (!init) {
+        return llvm::Constant::getNullValue(GetType(type));
+    }
+
+    std::vector<Initializer> items;
+    FlattenInitializer(type, 0, init, items);
+
+    if (!initializer_function_) {
+        initializer_function_ = llvm::Function::Create(llvm::FunctionType::get(builder_.getVoidTy(), false),
+                                                       llvm::GlobalValue::InternalLinkage, "", *the_module_);
+        llvm::BasicBlock::Create(the_context_, "", initializer_function_);
+    }
+    auto saved_point{builder_.saveIP()};
+    auto saved_function{function_};
+    function_ = initializer_function_;
+    builder_.SetInsertPoint(&initializer_function_->getEntryBlock());
+
+    // 按偏移排列的常量和它们的大小, 位域逐字节合并
+    std::map<std::uint64_t, std::pair<llvm::Constant *, std::uint64_t>> pieces;
+    std::map<std::uint64_t, std::uint8_t> bit_fields;
+    bool ok{true};
+    for (const auto &item:items) {
+        llvm::Constant *constant{nullptr};
+        if (auto string{NodeCast<String>(item.expression_)}; string && item.type_->IsArray()) {
+            std::string value{interner_.GetSpelling(string->value_)};
+            value.resize(static_cast<std::size_t>(item.type_->GetSize()));
+            constant = llvm::ConstantDataArray::getString(the_context_, value, false);
+        } else if (auto value{EmitExpression(item.expression_)}) {
+            if (!CheckAssignable(item.expression_, item.type_, value.type_, "initializing")) {
+                ok = false;
+                continue;
+            }
+            if (!item.type_->IsRecord()) {
+                constant = llvm::dyn_cast<llvm::Constant>(Convert(value, item.type_));
+            }
+        } else {
+            ok = false;
+            continue;
+        }
+
+        if (item.bit_field_) {
+            auto bits{llvm::dyn_cast_or_null<llvm::ConstantInt>(constant)};
+            if (!bits) {
+                ErrorReport(item.expression_, "initializer element is not a compile-time constant");
+                ok = false;
+                continue;
+            }
+            auto member{item.bit_field_};
+            auto value{bits->getValue().zextOrTrunc(64).getZExtValue()};
+            value = (value & (~std::uint64_t{} >> (64 - member->bit_width_))) << member->bit_offset_;
+            for (std::uint64_t i{}; i < item.type_->GetSize(); ++i) {
+                if (auto byte{static_cast<std::uint8_t>(value >> (i * 8))}) {
+                    bit_fields[item.offset_ + i] |= byte;
+                }
+            }
+        } else if (constant) {
+            pieces[item.offset_] = {constant, item.type_->GetSize()};
+        } else {
+            ErrorReport(item.expression_, "initializer element is not a compile-time constant");
+            ok = false;
+        }
+    }
+
+    builder_.restoreIP(saved_point);
+    function_ = saved_function;
+    if (!ok) {
+        return nullptr;
+    }
+
+    for (auto [offset, byte]:bit_fields) {
+        pieces[offset] = {builder_.getInt8(byte), 1};
+    }
+    // 单个标量直接使用它的类型, 否则用紧凑的结构体按偏移放置各个常量, 中间补0
+    auto llvm_type{GetType(type)};
+    if (std::size(pieces) == 1 && std::begin(pieces)->first == 0 &&
+        std::begin(pieces)->second.first->getType() == llvm_type) {
+        return std::begin(pieces)->second.first;
+    }
+
+    std::vector<llvm::Constant *> elements;
+    std::uint64_t offset{};
+    auto pad{[&](std::uint64_t end) {
+        if (end > offset) {
+            elements.push_back(llvm::ConstantAggregateZero::get(
+                    llvm::ArrayType::get(builder_.getInt8Ty(), end - offset)));
+        }
+    }};
+    for (const auto &[piece_offset, piece]:pieces) {
+        pad(piece_offset);
+        elements.push_back(piece.first);
+        offset = piece_offset + piece.second;
+    }
+    pad(type->GetSize());
+    return llvm::ConstantStruct::getAnon(the_context_, elements, true);
+}
+
+// 把初始化器展开为对各个标量的赋值, 字符数组和结构体也可以整体赋值
+void CodeGenContext::FlattenInitializer(const Type *type, std::uint64_t offset, const Expression *init,
+                                        std::vector<Initializer> &result) {
+    auto list{NodeCast<InitializerList>(init)};
+    // 用字符串初始化字符数组时, 字符串外面可以有一层花括号
+    if (type->IsArray() && type->base_->kind_ == TypeKind::kChar) {
+        auto string{list && std::size(list->elements_) == 1 ? NodeCast<String>(list->elements_[0])
+                                                            : NodeCast<String>(init)};
+        if (string) {
+            result.push_back({offset, type, nullptr, string});
+            return;
+        }
+    }
+
+    if (!list) {
+        if (type->IsArray()) {
+            ErrorReport(init, "array initializer must be an initializer list");
+        } else {
+            result.push_back({offset, type, nullptr, init});
+        }
+        return;
+    }
+
+    if (type->IsScalar()) {
+        if (std::empty(list->elements_)) {
+            ErrorReport(init, "scalar initializer cannot be empty");
+            return;
+        }
+        if (std::size(list->elements_) > 1) {
+            WarningReport(list->elements_[1], "excess elements in scalar initializer");
+        }
+        FlattenInitializer(type, offset, list->elements_[0], result);
+    } else if (type->IsArray() || type->IsRecord()) {
+        std::size_t index{};
+        FlattenAggregate(type, offset, list, index, result);
+        if (index < std::size(list->elements_)) {
+            WarningReport(list->elements_[index], "excess elements in initializer");
+        }
+    } else {
+        ErrorReport(init, "illegal initializer");
+    }
+}
+
+// 从list的第index个元素开始初始化一个数组或者结构体, 省略了花括号的子对象从同一个列表中继续取元素
+void CodeGenContext::FlattenAggregate(const Type *type, std::uint64_t offset, const InitializerList *list,
+                                      std::size_t &index, std::vector<Initializer> &result) {
+    auto initialize{[&](const Type *sub_type, std::uint64_t sub_offset, const Member *bit_field) {
+        auto element{list->elements_[index]};
+        if (bit_field) {
+            while (auto inner{NodeCast<InitializerList>(element)}) {
+                if (std::empty(inner->elements_)) {
+                    ErrorReport(element, "scalar initializer cannot be empty");
+                    ++index;
+                    return;
+                }
+                element = inner->elements_[0];
+            }
+            result.push_back({sub_offset, sub_type, bit_field, element});
+            ++index;
+            return;
+        }
+
+        if ((sub_type->IsArray() || sub_type->IsRecord()) && !NodeCast<InitializerList>(element)) {
+            auto whole{sub_type->IsArray() ? sub_type->base_->kind_ == TypeKind::kChar && NodeCast<String>(element)
+                                           : TypeOf(element) == sub_type};
+            if (!whole) {
+                FlattenAggregate(sub_type, sub_offset, list, index, result);
+                return;
+            }
+        }
+        FlattenInitializer(sub_type, sub_offset, element, result);
+        ++index;
+    }};
+
+    if (type->IsArray()) {
+        auto size{type->base_->GetSize()};
+        for (std::int64_t i{}; i < type->length_ && index < std::size(list->elements_); ++i) {
+            initialize(type->base_, offset + static_cast<std::uint64_t>(i) * size, nullptr);
+        }
+        return;
+    }
+
+    for (const auto &member:type->members_) {
+        if (index >= std::size(list->elements_)) {
+            break;
+        }
+        if (member.bit_field_ && member.name_ == kEmptySymbol) {
+            continue;
+        }
+        initialize(member.type_, offset + member.offset_, member.bit_field_ ? &member : nullptr);
+        // 联合只初始化第一个成员
+        if (type->kind_ == TypeKind::kUnion) {
+            break;
+        }
+    }
+}
+
+// 标量和结构体直接赋值, 其他的先全部清零再逐项赋值
+void CodeGenContext::EmitLocalInitializer(llvm::Value *address, const Type *type, const Expression *init) {
+    if (!type->IsArray() && !NodeCast<InitializerList>(init)) {
+        if (auto value{EmitExpression(init)}; value && CheckAssignable(init, type, value.type_, "initializing")) {
+            Store({address, type}, value);
+        }
+        return;
+    }
+
+    std::vector<Initializer> items;
+    FlattenInitializer(type, 0, init, items);
+    builder_.CreateMemSet(address, builder_.getInt8(0), type->GetSize(), llvm::MaybeAlign(type->GetAlign()));
+
+    for (const auto &item:items) {
+        auto item_address{EmitAddress(address, item.offset_, item.type_)};
+        if (auto string{NodeCast<String>(item.expression_)}; string && item.type_->IsArray()) {
+            auto size{std::min<std::uint64_t>(item.type_->GetSize(),
+                                               std::size(interner_.GetSpelling(string->value_)) + 1)};
+            builder_.CreateMemCpy(item_address, llvm::MaybeAlign(1), EmitString(string).address_,
+                                  llvm::MaybeAlign(1), size);
+        } else if (auto value{EmitExpression(item.expression_)};
+                value && CheckAssignable(item.expression_, item.type_, value.type_, "initializing")) {
+            Store({item_address, item.type_, item.bit_field_}, value);
+        }
+    }
+}
+
+const Type *CodeGenContext::TypeOf(const Expression *expression) {
+    if (!expression) {
+        return nullptr;
+    }
+
+    switch (expression->kind_) {
+        case NodeKind::kDouble:return static_cast<const Double *>(expression)->type_;
+        case NodeKind::kInteger:return static_cast<const Integer *>(expression)->type_;
+        case NodeKind::kString:return GetStringType(static_cast<const String *>(expression));
+        case NodeKind::kIdentifier: {
+            auto name{static_cast<const IdentifierOrType *>(expression)->name_};
+            for (auto iter{std::rbegin(scopes_)}; iter != std::rend(scopes_); ++iter) {
+                if (auto entry{iter->find(name)}; entry != std::end(*iter)) {
+                    return entry->second.type_;
+                }
+            }
+            auto symbol{globals_ ? globals_->Find(name) : nullptr};
+            return symbol ? symbol->type_ : nullptr;
+        }
+        case NodeKind::kFunctionCall: {
+            auto call{static_cast<const FunctionCall *>(expression)};
+            auto type{TypeOf(call->function_)};
+            if (!type) {
+                auto identifier{NodeCast<IdentifierOrType>(call->function_)};
+                if (!identifier) {
+                    return nullptr;
+                }
+                // __builtin_va_arg的第二个实参是sizeof(类型名), 其他内置函数没有返回值
+                auto spelling{interner_.GetSpelling(identifier->name_)};
+                if (spelling == "__builtin_va_arg" && std::size(call->args_) == 2) {
+                    return static_cast<const SizeofExpression *>(call->args_[1])->type_;
+                }
+                return spelling.substr(0, 10) == "__builtin_" ? types_.GetVoid() : types_.GetInt();
+            }
+            type = Decay(type);
+            return type->IsPointer() && type->base_->IsFunction() ? type->base_->base_ : nullptr;
+        }
+        case NodeKind::kBinaryOp: {
+            auto binary{static_cast<const BinaryOpExpression *>(expression)};
+            if (binary->op_ == TokenValue::kComma) {
+                auto type{TypeOf(binary->rhs_)};
+                return type ? Decay(type) : nullptr;
+            }
+            if (binary->op_ == TokenValue::kLogicAnd || binary->op_ == TokenValue::kLogicOr ||
+                IsComparison(binary->op_)) {
+                return types_.GetInt();
+            }
+
+            auto lhs{TypeOf(binary->lhs_)}, rhs{TypeOf(binary->rhs_)};
+            if (!lhs || !rhs) {
+                return nullptr;
+            }
+            lhs = Decay(lhs);
+            rhs = Decay(rhs);
+            if (binary->op_ == TokenValue::kShl || binary->op_ == TokenValue::kShr) {
+                return Promote(lhs);
+            }
+            if (lhs->IsPointer() && rhs->IsPointer()) {
+                return binary->op_ == TokenValue::kMinus ? types_.GetBasic(TypeKind::kLong) : nullptr;
+            }
+            if (lhs->IsPointer() || rhs->IsPointer()) {
+                return lhs->IsPointer() ? lhs : rhs;
+            }
+            return lhs->IsArithmetic() && rhs->IsArithmetic() ? GetArithmeticType(lhs, rhs) : nullptr;
+        }
+        case NodeKind::kAssignment:return TypeOf(static_cast<const Assignment *>(expression)->lhs_);
+        case NodeKind::kUnaryOp: {
+            auto unary{static_cast<const UnaryOpExpression *>(expression)};
+            auto type{TypeOf(unary->operand_)};
+            if (!type) {
+                return nullptr;
+            }
+            switch (unary->op_) {
+                case TokenValue::kAnd:return types_.GetPointer(type);
+                case TokenValue::kMultiply:type = Decay(type);
+                    return type->IsPointer() ? type->base_ : nullptr;
+                case TokenValue::kLogicNeg:return types_.GetInt();
+                case TokenValue::kPlusPlus:
+                case TokenValue::kMinusMinus:return type;
+                default:return Promote(type);
+            }
+        }
+        case NodeKind::kConditional:return GetConditionalType(static_cast<const ConditionalExpression *>(expression));
+        case NodeKind::kCast:return static_cast<const CastExpression *>(expression)->type_;
+        case NodeKind::kSizeof:return types_.GetBasic(TypeKind::kLong, true);
+        case NodeKind::kMember: {
+            auto member{static_cast<const MemberExpression *>(expression)};
+            auto type{TypeOf(member->object_)};
+            if (type && member->arrow_) {
+                type = Decay(type);
+                type = type->IsPointer() ? type->base_ : nullptr;
+            }
+            std::uint64_t offset{};
+            auto found{type && type->IsRecord() ? type->FindMember(member->member_, offset) : nullptr};
+            return found ? found->type_ : nullptr;
+        }
+        case NodeKind::kIndex: {
+            auto index{static_cast<const IndexExpression *>(expression)};
+            auto array{TypeOf(index->array_)}, subscript{TypeOf(index->index_)};
+            if (!array || !subscript) {
+                return nullptr;
+            }
+            array = Decay(array);
+            subscript = Decay(subscript);
+            auto pointer{array->IsPointer() ? array : subscript};
+            return pointer->IsPointer() ? pointer->base_ : nullptr;
+        }
+        default:return nullptr;
+    }
+}
+
+const Type *CodeGenContext::Decay(const Type *type) {
+    if (type->IsArray()) {
+        return types_.GetPointer(type->base_);
+    } else if (type->IsFunction()) {
+        return types_.GetPointer(type);
+    }
+    return type;
+}
+
+// 比int小的整数和枚举都可以用int表示, 提升为int
+const Type *CodeGenContext::Promote(const Type *type) const {
+    if (type->IsInteger() && (type->kind_ < TypeKind::kInt || type->kind_ == TypeKind::kEnum)) {
+        return types_.GetInt();
+    }
+    return type;
+}
+
+// 一般算术转换
+const Type *CodeGenContext::GetArithmeticType(const Type *lhs, const Type *rhs) const {
+    if (lhs->IsFloating() || rhs->IsFloating()) {
+        return types_.GetBasic(std::max(lhs->IsFloating() ? lhs->kind_ : TypeKind::kFloat,
+                                        rhs->IsFloating() ? rhs->kind_ : TypeKind::kFloat));
+    }
+
+    lhs = Promote(lhs);
+    rhs = Promote(rhs);
+    if (lhs == rhs) {
+        return lhs;
+    } else if (lhs->unsigned_ == rhs->unsigned_) {
+        return lhs->kind_ > rhs->kind_ ? lhs : rhs;
+    }
+
+    auto [unsigned_type, signed_type]{lhs->unsigned_ ? std::pair{lhs, rhs} : std::pair{rhs, lhs}};
+    if (unsigned_type->kind_ >= signed_type->kind_) {
+        return unsigned_type;
+    } else if (signed_type->GetSize() > unsigned_type->GetSize()) {
+        return signed_type;
+    }
+    return types_.GetBasic(signed_type->kind_, true);
+}
+
+const Type *CodeGenContext::GetConditionalType(const ConditionalExpression *expression) {
+    auto lhs{TypeOf(expression->true_expression_)}, rhs{TypeOf(expression->false_expression_)};
+    if (!lhs || !rhs) {
+        return nullptr;
+    }
+    lhs = Decay(lhs);
+    rhs = Decay(rhs);
+
+    if (lhs->IsArithmetic() && rhs->IsArithmetic()) {
+        return GetArithmeticType(lhs, rhs);
+    } else if (lhs->IsVoid() || rhs->IsVoid()) {
+        return types_.GetVoid();
+    } else if (lhs->IsPointer() && rhs->IsPointer()) {
+        return rhs->base_->IsVoid() ? rhs : lhs;
+    } else if (lhs->IsPointer() && rhs->IsInteger()) {
+        return lhs;
+    } else if (lhs->IsInteger() && rhs->IsPointer()) {
+        return rhs;
+    }
+    return lhs == rhs ? lhs : nullptr;
+}
+
+const Type *CodeGenContext::GetStringType(const String *string) {
+    auto &type{string_types_[string->value_]};
+    if (!type) {
+        type = types_.GetArray(types_.GetBasic(TypeKind::kChar),
+                               static_cast<std::int64_t>(std::size(interner_.GetSpelling(string->value_))) + 1);
+    }
+    return type;
+}
+
+CodeGenContext::Value CodeGenContext::EmitExpression(const Expression *expression) {
+    if (!expression) {
+        return {};
+    }
+
+    switch (expression->kind_) {
+        case NodeKind::kDouble: {
+            auto node{static_cast<const Double *>(expression)};
+            return {llvm::ConstantFP::get(GetType(node->type_), node->value_), node->type_};
+        }
+        case NodeKind::kInteger: {
+            auto node{static_cast<const Integer *>(expression)};
+            return {llvm::ConstantInt::get(GetType(node->type_), node->value_), node->type_};
+        }
+        case NodeKind::kString:
+        case NodeKind::kIdentifier:
+        case NodeKind::kMember:
+        case NodeKind::kIndex:return Load(EmitLValue(expression));
+        case NodeKind::kFunctionCall:return EmitFunctionCall(static_cast<const FunctionCall *>(expression));
+        case NodeKind::kBinaryOp:return EmitBinary(static_cast<const BinaryOpExpression *>(expression));
+        case NodeKind::kAssignment:return EmitAssignment(static_cast<const Assignment *>(expression));
+        case NodeKind::kUnaryOp:return EmitUnary(static_cast<const UnaryOpExpression *>(expression));
+        case NodeKind::kConditional:return EmitConditional(static_cast<const ConditionalExpression *>(expression));
+        case NodeKind::kCast: {
+            auto node{static_cast<const CastExpression *>(expression)};
+            auto value{EmitExpression(node->expression_)};
+            if (!value) {
+                return {};
+            } else if (node->type_->IsVoid()) {
+                return {nullptr, node->type_};
+            } else if (!node->type_->IsScalar() || !value.type_->IsScalar()) {
+                ErrorReport(expression, "invalid cast");
+                return {};
+            }
+            return {Convert(value, node->type_), node->type_};
+        }
+        case NodeKind::kSizeof: {
+            auto node{static_cast<const SizeofExpression *>(expression)};
+            auto type{node->type_ ? node->type_ : TypeOf(node->expression_)};
+            if (!type) {
+                ErrorReport(expression, "invalid application of 'sizeof'");
+                return {};
+            } else if (!type->IsComplete()) {
+                ErrorReport(expression, "invalid application of 'sizeof' to an incomplete type");
+                return {};
+            }
+            return {builder_.getInt64(type->GetSize()), types_.GetBasic(TypeKind::kLong, true)};
+        }
+        default:ErrorReport(expression, "initializer list is not allowed here");
+            return {};
+    }
+}
+
+CodeGenContext::LValue CodeGenContext::EmitLValue(const Expression *expression) {
+    switch (expression->kind_) {
+        case NodeKind::kIdentifier: {
+            auto name{static_cast<const IdentifierOrType *>(expression)->name_};
+            auto variable{FindVariable(name)};
+            if (!variable) {
+                ErrorReport(expression, "use of undeclared identifier '" +
+                                        std::string{interner_.GetSpelling(name)} + "'");
+            }
+            return variable;
+        }
+        case NodeKind::kString:return EmitString(static_cast<const String *>(expression));
+        case NodeKind::kMember:return EmitMember(static_cast<const MemberExpression *>(expression));
+        case NodeKind::kIndex:return EmitIndex(static_cast<const IndexExpression *>(expression));
+        case NodeKind::kUnaryOp: {
+            auto unary{static_cast<const UnaryOpExpression *>(expression)};
+            if (unary->op_ != TokenValue::kMultiply) {
+                break;
+            }
+            auto pointer{EmitExpression(unary->operand_)};
+            if (!pointer) {
+                return {};
+            } else if (!pointer.type_->IsPointer()) {
+                ErrorReport(expression, "indirection requires pointer operand");
+                return {};
+            }
+            return {pointer.value_, pointer.type_->base_};
+        }
+        default:break;
+    }
+    ErrorReport(expression, "expression is not an lvalue");
+    return {};
+}
+
+// 数组转换为指向第一个元素的指针, 函数转换为函数指针, 结构体的值就是它的地址
+CodeGenContext::Value CodeGenContext::Load(const LValue &lvalue) {
+    auto type{lvalue.type_};
+    if (!lvalue) {
+        return {};
+    } else if (type->IsArray()) {
+        auto zero{builder_.getInt64(0)};
+        return {builder_.CreateInBoundsGEP(GetType(type), lvalue.address_, {zero, zero}), Decay(type)};
+    } else if (type->IsFunction() || type->IsRecord()) {
+        return {lvalue.address_, Decay(type)};
+    } else if (type->IsVoid()) {
+        return {nullptr, type};
+    }
+
+    auto value{builder_.CreateAlignedLoad(GetType(type), lvalue.address_, llvm::MaybeAlign(type->GetAlign()))};
+    if (!lvalue.bit_field_) {
+        return {value, type};
+    }
+
+    // 先左移去掉高位, 再右移去掉低位, 有符号的位域用算术右移扩展符号
+    auto member{lvalue.bit_field_};
+    auto width{value->getType()->getIntegerBitWidth()};
+    auto shifted{builder_.CreateShl(value, width - member->bit_offset_ - member->bit_width_)};
+    if (type->unsigned_ || type->kind_ == TypeKind::kBool) {
+        return {builder_.CreateLShr(shifted, width - member->bit_width_), type};
+    }
+    return {builder_.CreateAShr(shifted, width - member->bit_width_), type};
+}
+
+void CodeGenContext::Store(const LValue &lvalue, Value value) {
+    auto type{lvalue.type_};
+    auto align{llvm::MaybeAlign(type->GetAlign())};
+    if (type->IsRecord()) {
+        builder_.CreateMemCpy(lvalue.address_, align, value.value_, align, type->GetSize());
+        return;
+    }
+
+    auto converted{Convert(value, type)};
+    if (!lvalue.bit_field_) {
+        builder_.CreateAlignedStore(converted, lvalue.address_, align);
+        return;
+    }
+
+    // 读出整个存储单元, 替换其中的几位再写回
+    auto member{lvalue.bit_field_};
+    auto unit_type{GetType(type)};
+    auto mask{llvm::APInt::getBitsSet(unit_type->getIntegerBitWidth(), member->bit_offset_,
+                                      member->bit_offset_ + member->bit_width_)};
+    auto unit{builder_.CreateAlignedLoad(unit_type, lvalue.address_, align)};
+    auto bits{builder_.CreateAnd(builder_.CreateShl(converted, member->bit_offset_), mask)};
+    builder_.CreateAlignedStore(builder_.CreateOr(builder_.CreateAnd(unit, ~mask), bits), lvalue.address_, align);
+}
+
+// 标量之间的转换, 以及转换为void, 调用者保证转换是合法的
+llvm::Value *CodeGenContext::Convert(Value value, const Type *type) {
+    auto from{value.type_};
+    if (from == type || type->IsVoid() || type->IsRecord()) {
+        return value.value_;
+    }
+
+    auto target{GetType(type)};
+    if (type->kind_ == TypeKind::kBool) {
+        return builder_.CreateZExt(EmitNonZero(value), target);
+    } else if (type->IsPointer()) {
+        if (from->IsPointer()) {
+            return builder_.CreatePointerCast(value.value_, target);
+        }
+        auto integer{builder_.CreateIntCast(value.value_, builder_.getInt64Ty(), !from->unsigned_)};
+        return builder_.CreateIntToPtr(integer, target);
+    } else if (from->IsPointer()) {
+        return builder_.CreatePtrToInt(value.value_, target);
+    } else if (type->IsFloating()) {
+        if (from->IsFloating()) {
+            return builder_.CreateFPCast(value.value_, target);
+        }
+        return from->unsigned_ ? builder_.CreateUIToFP(value.value_, target)
+                               : builder_.CreateSIToFP(value.value_, target);
+    } else if (from->IsFloating()) {
+        return type->unsigned_ ? builder_.CreateFPToUI(value.value_, target)
+                               : builder_.CreateFPToSI(value.value_, target);
+    }
+    return builder_.CreateIntCast(value.value_, target, !from->unsigned_);
+}
+
+// 赋值, 初始化, 传递实参和返回时, 标量之间可以隐式转换, 结构体只能是同一个类型
+bool CodeGenContext::CheckAssignable(const ASTNode *node, const Type *to, const Type *from,
+                                     const std::string &what) {
+    if ((to->IsScalar() && from->IsScalar()) || (to->IsRecord() && to == from)) {
+        return true;
+    }
+    ErrorReport(node, "incompatible types when " + what);
+    return false;
+}
+
+llvm::Value *CodeGenContext::EmitNonZero(Value value) {
+    if (value.type_->IsFloating()) {
+        return builder_.CreateFCmpUNE(value.value_, llvm::ConstantFP::get(value.value_->getType(), 0.0));
+    } else if (value.type_->IsPointer()) {
+        return builder_.CreateIsNotNull(value.value_);
+    }
+    return builder_.CreateICmpNE(value.value_, llvm::ConstantInt::get(value.value_->getType(), 0));
+}
+
+llvm::Value *CodeGenContext::EmitCondition(const Expression *expression) {
+    auto value{EmitExpression(expression)};
+    if (!value) {
+        return nullptr;
+    } else if (!value.type_->IsScalar()) {
+        ErrorReport(expression, "statement requires expression of scalar type");
+        return nullptr;
+    }
+    return EmitNonZero(value);
+}
+
+// 每个模块中相同的字符串字面量只有一份
+CodeGenContext::LValue CodeGenContext::EmitString(const String *string) {
+    auto &variable{strings_[string->value_]};
+    if (!variable) {
+        auto spelling{interner_.GetSpelling(string->value_)};
+        auto init{llvm::ConstantDataArray::getString(the_context_, llvm::StringRef{std::data(spelling),
+                                                                                   std::size(spelling)})};
+        variable = new llvm::GlobalVariable(*the_module_, init->getType(), true,
+                                            llvm::GlobalValue::PrivateLinkage, init, ".str");
+        variable->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        variable->setAlignment(llvm::Align(1));
+    }
+    return {variable, GetStringType(string)};
+}
+
+CodeGenContext::Value CodeGenContext::EmitFunctionCall(const FunctionCall *call) {
+    Value callee;
+    if (auto identifier{NodeCast<IdentifierOrType>(call->function_)}) {
+        if (auto variable{FindVariable(identifier->name_)}) {
+            callee = Load(variable);
+        } else {
+            std::string spelling{interner_.GetSpelling(identifier->name_)};
+            if (spelling.compare(0, 10, "__builtin_") == 0) {
+                return EmitBuiltinCall(call, spelling);
+            }
+
+            // 隐式声明为返回int的没有原型的外部函数
+            WarningReport(call, "implicit declaration of function '" + spelling + "'");
+            auto lvalue{GetGlobal(identifier->name_, types_.GetFunction(types_.GetInt(), {}, false, false))};
+            if (!std::empty(scopes_)) {
+                scopes_.front()[identifier->name_] = lvalue;
+            }
+            callee = Load(lvalue);
+        }
+    } else {
+        callee = EmitExpression(call->function_);
+    }
+
+    if (!callee) {
+        return {};
+    } else if (!callee.type_->IsPointer() || !callee.type_->base_->IsFunction()) {
+        ErrorReport(call, "called object type is not a function or function pointer");
+        return {};
+    }
+
+    auto function_type{callee.type_->base_};
+    auto return_type{function_type->base_};
+    const auto &params{function_type->params_};
+    auto prototyped{function_type->has_prototype_};
+    if (prototyped && std::size(call->args_) < std::size(params)) {
+        ErrorReport(call, "too few arguments to function call");
+        return {};
+    } else if (prototyped && !function_type->variadic_ && std::size(call->args_) > std::size(params)) {
+        ErrorReport(call, "too many arguments to function call");
+        return {};
+    }
+
+    std::vector<llvm::Value *> args;
+    std::vector<const Type *> arg_types;
+    llvm::Value *result_address{nullptr};
+    if (return_type->IsRecord()) {
+        result_address = CreateAlloca(return_type, "tmp");
+        args.push_back(result_address);
+    }
+
+    for (auto arg:call->args_) {
+        auto value{EmitExpression(arg)};
+        if (!value) {
+            return {};
+        }
+
+        // 没有对应的形参时做默认实参提升
+        auto index{std::size(arg_types)};
+        const Type *type{value.type_};
+        if (prototyped && index < std::size(params)) {
+            type = params[index].type_;
+            if (!CheckAssignable(arg, type, value.type_, "passing argument")) {
+                return {};
+            }
+        } else if (type->IsVoid()) {
+            ErrorReport(arg, "argument type 'void' is incomplete");
+            return {};
+        } else if (type->kind_ == TypeKind::kFloat) {
+            type = types_.GetBasic(TypeKind::kDouble);
+        } else if (type->IsInteger()) {
+            type = Promote(type);
+        }
+        args.push_back(Convert(value, type));
+        arg_types.push_back(type);
+    }
+
+    // 没有原型时按实参的类型调用
+    auto llvm_function_type{GetFunctionType(function_type)};
+    auto callee_value{callee.value_};
+    if (!prototyped) {
+        std::vector<llvm::Type *> types;
+        for (auto arg:args) {
+            types.push_back(arg->getType());
+        }
+        llvm_function_type = llvm::FunctionType::get(llvm_function_type->getReturnType(), types, false);
+        callee_value = builder_.CreateBitCast(callee_value, llvm_function_type->getPointerTo());
+    }
+
+    auto result{builder_.CreateCall(llvm_function_type, callee_value, args)};
+    result->setAttributes(GetAttributes(return_type, arg_types));
+    if (return_type->IsRecord()) {
+        return {result_address, return_type};
+    }
+    return {return_type->IsVoid() ? nullptr : result, return_type};
+}
+
+// stdarg.h中的宏展开为这些内置函数, va_list是只有一个元素的数组, 作为实参时已经是指向元素的指针
+CodeGenContext::Value CodeGenContext::EmitBuiltinCall(const FunctionCall *call, std::string_view name) {
+    auto va_list{[&](std::size_t index) -> llvm::Value * {
+        auto value{EmitExpression(call->args_[index])};
+        if (!value) {
+            return nullptr;
+        } else if (!value.type_->IsPointer()) {
+            ErrorReport(call->args_[index], "expected a va_list");
+            return nullptr;
+        }
+        return builder_.CreateBitCast(value.value_, builder_.getInt8PtrTy());
+    }};
+    auto intrinsic{[&](llvm::Intrinsic::ID id, std::size_t count) -> Value {
+        std::vector<llvm::Value *> args;
+        for (std::size_t i{}; i < count; ++i) {
+            if (auto arg{va_list(i)}) {
+                args.push_back(arg);
+            } else {
+                return {};
+            }
+        }
+        builder_.CreateCall(llvm::Intrinsic::getDeclaration(the_module_.get(), id), args);
+        return {nullptr, types_.GetVoid()};
+    }};
+
+    auto count{std::size(call->args_)};
+    if (name == "__builtin_va_start" && count == 2) {
+        return intrinsic(llvm::Intrinsic::vastart, 1);
+    } else if (name == "__builtin_va_end" && count == 1) {
+        return intrinsic(llvm::Intrinsic::vaend, 1);
+    } else if (name == "__builtin_va_copy" && count == 2) {
+        return intrinsic(llvm::Intrinsic::vacopy, 2);
+    } else if (name == "__builtin_va_arg" && count == 2) {
+        auto type{static_cast<const SizeofExpression *>(call->args_[1])->type_};
+        if (!type->IsScalar() || type->kind_ == TypeKind::kLongDouble) {
+            ErrorReport(call, "unsupported type in va_arg");
+            return {};
+        }
+        if (auto ap{va_list(0)}) {
+            return {builder_.CreateVAArg(ap, GetType(type)), type};
+        }
+        return {};
+    }
+
+    ErrorReport(call, "use of unknown builtin '" + std::string{name} + "'");
+    return {};
+}
+
+CodeGenContext::Value CodeGenContext::EmitBinary(const BinaryOpExpression *expression) {
+    switch (expression->op_) {
+        case TokenValue::kComma:EmitExpression(expression->lhs_);
+            return EmitExpression(expression->rhs_);
+        case TokenValue::kLogicAnd:
+        case TokenValue::kLogicOr:return EmitLogical(expression);
+        default: {
+            auto lhs{EmitExpression(expression->lhs_)};
+            auto rhs{EmitExpression(expression->rhs_)};
+            if (!lhs || !rhs) {
+                return {};
+            }
+            return EmitArithmetic(expression, expression->op_, lhs, rhs);
+        }
+    }
+}
+
+// 两个已经求值的操作数之间的运算, 复合赋值也使用它
+CodeGenContext::Value CodeGenContext::EmitArithmetic(const ASTNode *node, TokenValue op, Value lhs, Value rhs) {
+    auto lhs_type{lhs.type_}, rhs_type{rhs.type_};
+    auto int_type{types_.GetInt()};
+
+    if (op == TokenValue::kPlus || op == TokenValue::kMinus) {
+        if (lhs_type->IsPointer() && rhs_type->IsInteger()) {
+            return {EmitPointerAdd(lhs, rhs, op == TokenValue::kMinus), lhs_type};
+        } else if (op == TokenValue::kPlus && lhs_type->IsInteger() && rhs_type->IsPointer()) {
+            return {EmitPointerAdd(rhs, lhs, false), rhs_type};
+        } else if (op == TokenValue::kMinus && lhs_type->IsPointer() && rhs_type->IsPointer()) {
+            // 两个指针的差除以元素的大小
+            auto diff{builder_.CreateSub(builder_.CreatePtrToInt(lhs.value_, builder_.getInt64Ty()),
+                                         builder_.CreatePtrToInt(rhs.value_, builder_.getInt64Ty()))};
+            auto size{std::max<std::uint64_t>(lhs_type->base_->GetSize(), 1)};
+            return {builder_.CreateExactSDiv(diff, builder_.getInt64(size)), types_.GetBasic(TypeKind::kLong)};
+        }
+    }
+
+    if (IsComparison(op) && (lhs_type->IsPointer() || rhs_type->IsPointer())) {
+        if (!lhs_type->IsScalar() || !rhs_type->IsScalar() || lhs_type->IsFloating() || rhs_type->IsFloating()) {
+            ErrorReport(node, "invalid operands to binary expression");
+            return {};
+        }
+        // 与整数比较时整数转换为指针, 通常是空指针常量
+        auto type{lhs_type->IsPointer() ? lhs_type : rhs_type};
+        auto lhs_value{builder_.CreatePtrToInt(Convert(lhs, type), builder_.getInt64Ty())};
+        auto rhs_value{builder_.CreatePtrToInt(Convert(rhs, type), builder_.getInt64Ty())};
+        llvm::CmpInst::Predicate predicate;
+        switch (op) {
+            case TokenValue::kEqual:predicate = llvm::CmpInst::ICMP_EQ;
+                break;
+            case TokenValue::kNotEqual:predicate = llvm::CmpInst::ICMP_NE;
+                break;
+            case TokenValue::kLess:predicate = llvm::CmpInst::ICMP_ULT;
+                break;
+            case TokenValue::kGreater:predicate = llvm::CmpInst::ICMP_UGT;
+                break;
+            case TokenValue::kLessOrEqual:predicate = llvm::CmpInst::ICMP_ULE;
+                break;
+            default:predicate = llvm::CmpInst::ICMP_UGE;
+                break;
+        }
+        return {builder_.CreateZExt(builder_.CreateICmp(predicate, lhs_value, rhs_value), GetType(int_type)),
+                int_type};
+    }
+
+    auto integer_only{op == TokenValue::kMod || op == TokenValue::kAnd || op == TokenValue::kOr ||
+                      op == TokenValue::kXor || op == TokenValue::kShl || op == TokenValue::kShr};
+    if (!lhs_type->IsArithmetic() || !rhs_type->IsArithmetic() ||
+        (integer_only && (!lhs_type->IsInteger() || !rhs_type->IsInteger()))) {
+        ErrorReport(node, "invalid operands to binary expression");
+        return {};
+    }
+
+    // 移位的结果是左操作数提升后的类型, 右操作数不参与一般算术转换
+    auto type{op == TokenValue::kShl || op == TokenValue::kShr ? Promote(lhs_type)
+                                                               : GetArithmeticType(lhs_type, rhs_type)};
+    auto lhs_value{Convert(lhs, type)}, rhs_value{Convert(rhs, type)};
+
+    if (IsComparison(op)) {
+        llvm::Value *result;
+        auto is_unsigned{type->unsigned_};
+        if (type->IsFloating()) {
+            switch (op) {
+                case TokenValue::kEqual:result = builder_.CreateFCmpOEQ(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kNotEqual:result = builder_.CreateFCmpUNE(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kLess:result = builder_.CreateFCmpOLT(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kGreater:result = builder_.CreateFCmpOGT(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kLessOrEqual:result = builder_.CreateFCmpOLE(lhs_value, rhs_value);
+                    break;
+                default:result = builder_.CreateFCmpOGE(lhs_value, rhs_value);
+                    break;
+            }
+        } else {
+            switch (op) {
+                case TokenValue::kEqual:result = builder_.CreateICmpEQ(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kNotEqual:result = builder_.CreateICmpNE(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kLess:
+                    result = is_unsigned ? builder_.CreateICmpULT(lhs_value, rhs_value)
+                                         : builder_.CreateICmpSLT(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kGreater:
+                    result = is_unsigned ? builder_.CreateICmpUGT(lhs_value, rhs_value)
+                                         : builder_.CreateICmpSGT(lhs_value, rhs_value);
+                    break;
+                case TokenValue::kLessOrEqual:
+                    result = is_unsigned ? builder_.CreateICmpULE(lhs_value, rhs_value)
+                                         : builder_.CreateICmpSLE(lhs_value, rhs_value);
+                    break;
+                default:
+                    result = is_unsigned ? builder_.CreateICmpUGE(lhs_value, rhs_value)
+                                         : builder_.CreateICmpSGE(lhs_value, rhs_value);
+                    break;
+            }
+        }
+        return {builder_.CreateZExt(result, GetType(int_type)), int_type};
+    }
+
+    if (type->IsFloating()) {
+        switch (op) {
+            case TokenValue::kPlus:return {builder_.CreateFAdd(lhs_value, rhs_value), type};
+            case TokenValue::kMinus:return {builder_.CreateFSub(lhs_value, rhs_value), type};
+            case TokenValue::kMultiply:return {builder_.CreateFMul(lhs_value, rhs_value), type};
+            default:return {builder_.CreateFDiv(lhs_value, rhs_value), type};
+        }
+    }
+
+    auto is_unsigned{type->unsigned_};
+    switch (op) {
+        case TokenValue::kPlus:return {builder_.CreateAdd(lhs_value, rhs_value), type};
+        case TokenValue::kMinus:return {builder_.CreateSub(lhs_value, rhs_value), type};
+        case TokenValue::kMultiply:return {builder_.CreateMul(lhs_value, rhs_value), type};
+        case TokenValue::kDivide:
+            return {is_unsigned ? builder_.CreateUDiv(lhs_value, rhs_value)
+                                : builder_.CreateSDiv(lhs_value, rhs_value), type};
+        case TokenValue::kMod:
+            return {is_unsigned ? builder_.CreateURem(lhs_value, rhs_value)
+                                : builder_.CreateSRem(lhs_value, rhs_value), type};
+        case TokenValue::kAnd:return {builder_.CreateAnd(lhs_value, rhs_value), type};
+        case TokenValue::kOr:return {builder_.CreateOr(lhs_value, rhs_value), type};
+        case TokenValue::kXor:return {builder_.CreateXor(lhs_value, rhs_value), type};
+        case TokenValue::kShl:return {builder_.CreateShl(lhs_value, rhs_value), type};
+        default:
+            return {is_unsigned ? builder_.CreateLShr(lhs_value, rhs_value)
+                                : builder_.CreateAShr(lhs_value, rhs_value), type};
+    }
+}
+
+// 短路求值, 左边是常量时不需要分支, 例如文件作用域的初始化器中
+CodeGenContext::Value CodeGenContext::EmitLogical(const BinaryOpExpression *expression) {
+    auto is_and{expression->op_ == TokenValue::kLogicAnd};
+    auto int_type{types_.GetInt()};
+    auto lhs{EmitCondition(expression->lhs_)};
+    if (!lhs) {
+        return {};
+    }
+
+    if (auto constant{llvm::dyn_cast<llvm::ConstantInt>(lhs)}) {
+        if (constant->isOne() != is_and) {
+            return {builder_.getInt32(is_and ? 0 : 1), int_type};
+        }
+        auto rhs{EmitCondition(expression->rhs_)};
+        return rhs ? Value{builder_.CreateZExt(rhs, GetType(int_type)), int_type} : Value{};
+    }
+
+    auto lhs_block{builder_.GetInsertBlock()};
+    auto rhs_block{NewBlock(is_and ? "land.rhs" : "lor.rhs")};
+    auto end_block{NewBlock(is_and ? "land.end" : "lor.end")};
+    if (is_and) {
+        builder_.CreateCondBr(lhs, rhs_block, end_block);
+    } else {
+        builder_.CreateCondBr(lhs, end_block, rhs_block);
+    }
+
+    EmitBlock(rhs_block);
+    auto rhs{EmitCondition(expression->rhs_)};
+    if (!rhs) {
+        return {};
+    }
+    rhs_block = builder_.GetInsertBlock();
+    EmitBlock(end_block);
+
+    auto phi{builder_.CreatePHI(builder_.getInt1Ty(), 2)};
+    phi->addIncoming(builder_.getInt1(!is_and), lhs_block);
+    phi->addIncoming(rhs, rhs_block);
+    return {builder_.CreateZExt(phi, GetType(int_type)), int_type};
+}
+
+CodeGenContext::Value CodeGenContext::EmitAssignment(const Assignment *expression) {
+    auto lhs{EmitLValue(expression->lhs_)};
+    if (!lhs) {
+        return {};
+    } else if (lhs.type_->IsArray() || lhs.type_->IsFunction() || lhs.type_->IsVoid()) {
+        ErrorReport(expression, "expression is not assignable");
+        return {};
+    }
+
+    Value value;
+    if (expression->op_ == TokenValue::kAssign) {
+        value = EmitExpression(expression->rhs_);
+    } else {
+        auto old_value{Load(lhs)};
+        if (auto rhs{EmitExpression(expression->rhs_)}) {
+            value = EmitArithmetic(expression, GetCompoundOperator(expression->op_), old_value, rhs);
+        }
+    }
+    if (!value || !CheckAssignable(expression, lhs.type_, value.type_, "assigning")) {
+        return {};
+    }
+
+    Value converted{Convert(value, lhs.type_), lhs.type_};
+    Store(lhs, converted);
+    return lhs.bit_field_ ? Load(lhs) : converted;
+}
+
+CodeGenContext::Value CodeGenContext::EmitUnary(const UnaryOpExpression *expression) {
+    auto int_type{types_.GetInt()};
+    switch (expression->op_) {
+        case TokenValue::kAnd: {
+            auto lvalue{EmitLValue(expression->operand_)};
+            if (!lvalue) {
+                return {};
+            } else if (lvalue.bit_field_) {
+                ErrorReport(expression, "address of bit-field requested");
+                return {};
+            }
+            return {lvalue.address_, types_.GetPointer(lvalue.type_)};
+        }
+        case TokenValue::kMultiply:return Load(EmitLValue(expression));
+        case TokenValue::kPlusPlus:
+        case TokenValue::kMinusMinus: {
+            auto lvalue{EmitLValue(expression->operand_)};
+            if (!lvalue) {
+                return {};
+            } else if (!lvalue.type_->IsScalar()) {
+                ErrorReport(expression, "cannot increment or decrement value of this type");
+                return {};
+            }
+
+            auto old_value{Load(lvalue)};
+            auto op{expression->op_ == TokenValue::kPlusPlus ? TokenValue::kPlus : TokenValue::kMinus};
+            auto result{EmitArithmetic(expression, op, old_value, {builder_.getInt32(1), int_type})};
+            Value converted{Convert(result, lvalue.type_), lvalue.type_};
+            Store(lvalue, converted);
+            if (expression->postfix_) {
+                return old_value;
+            }
+            return lvalue.bit_field_ ? Load(lvalue) : converted;
+        }
+        case TokenValue::kLogicNeg: {
+            auto condition{EmitCondition(expression->operand_)};
+            if (!condition) {
+                return {};
+            }
+            return {builder_.CreateZExt(builder_.CreateNot(condition), GetType(int_type)), int_type};
+        }
+        default: {
+            auto value{EmitExpression(expression->operand_)};
+            if (!value) {
+                return {};
+            } else if (!value.type_->IsArithmetic() ||
+                       (expression->op_ == TokenValue::kNeg && !value.type_->IsInteger())) {
+                ErrorReport(expression, "invalid argument type to unary expression");
+                return {};
+            }
+
+            auto type{Promote(value.type_)};
+            auto operand{Convert(value, type)};
+            if (expression->op_ == TokenValue::kPlus) {
+                return {operand, type};
+            } else if (expression->op_ == TokenValue::kNeg) {
+                return {builder_.CreateNot(operand), type};
+            }
+            return {type->IsFloating() ? builder_.CreateFNeg(operand) : builder_.CreateNeg(operand), type};
+        }
+    }
+}
+
+CodeGenContext::Value CodeGenContext::EmitConditional(const ConditionalExpression *expression) {
+    auto type{GetConditionalType(expression)};
+    auto condition{EmitCondition(expression->condition_)};
+    if (!condition) {
+        return {};
+    } else if (!type) {
+        ErrorReport(expression, "incompatible operand types in conditional expression");
+        return {};
+    }
+
+    auto emit{[&](const Expression *branch) -> Value {
+        auto value{EmitExpression(branch)};
+        if (!value || type->IsVoid()) {
+            return value ? Value{nullptr, type} : Value{};
+        }
+        return {Convert(value, type), type};
+    }};
+
+    // 条件是常量时只生成选中的一边
+    if (auto constant{llvm::dyn_cast<llvm::ConstantInt>(condition)}) {
+        return emit(constant->isOne() ? expression->true_expression_ : expression->false_expression_);
+    }
+
+    auto true_block{NewBlock("cond.true")};
+    auto false_block{NewBlock("cond.false")};
+    auto end_block{NewBlock("cond.end")};
+    builder_.CreateCondBr(condition, true_block, false_block);
+
+    EmitBlock(true_block);
+    auto true_value{emit(expression->true_expression_)};
+    true_block = builder_.GetInsertBlock();
+    EmitBranch(end_block);
+    EmitBlock(false_block);
+    auto false_value{emit(expression->false_expression_)};
+    false_block = builder_.GetInsertBlock();
+    EmitBlock(end_block);
+
+    if (!true_value || !false_value) {
+        return {};
+    } else if (type->IsVoid()) {
+        return {nullptr, type};
+    }
+    auto phi{builder_.CreatePHI(true_value.value_->getType(), 2)};
+    phi->addIncoming(true_value.value_, true_block);
+    phi->addIncoming(false_value.value_, false_block);
+    return {phi, type};
+}
+
+CodeGenContext::LValue CodeGenContext::EmitMember(const MemberExpression *expression) {
+    auto object{EmitExpression(expression->object_)};
+    if (!object) {
+        return {};
+    }
+
+    auto type{object.type_};
+    if (expression->arrow_) {
+        if (!type->IsPointer()) {
+            ErrorReport(expression, "member reference type is not a pointer");
+            return {};
+        }
+        type = type->base_;
+    }
+    if (!type->IsRecord()) {
+        ErrorReport(expression, "member reference base type is not a structure or union");
+        return {};
+    } else if (!type->IsComplete()) {
+        ErrorReport(expression, "member access into incomplete type");
+        return {};
+    }
+
+    std::uint64_t offset{};
+    auto member{type->FindMember(expression->member_, offset)};
+    if (!member) {
+        ErrorReport(expression, "no member named '" + std::string{interner_.GetSpelling(expression->member_)} + "'");
+        return {};
+    }
+    return {EmitAddress(object.value_, offset, member->type_), member->type_,
+            member->bit_field_ ? member : nullptr};
+}
+
+CodeGenContext::LValue CodeGenContext::EmitIndex(const IndexExpression *expression) {
+    auto array{EmitExpression(expression->array_)};
+    auto index{EmitExpression(expression->index_)};
+    if (!array || !index) {
+        return {};
+    }
+
+    // 2[a]与a[2]相同
+    if (index.type_->IsPointer()) {
+        std::swap(array, index);
+    }
+    if (!array.type_->IsPointer() || !index.type_->IsInteger()) {
+        ErrorReport(expression, "subscripted value is not an array or pointer");
+        return {};
+    }
+    return {EmitPointerAdd(array, index, false), array.type_->base_};
+}
+
+// 按元素的大小移动, void*和函数指针按字节移动
+llvm::Value *CodeGenContext::EmitPointerAdd(Value pointer, Value offset, bool subtract) {
+    llvm::Value *index{builder_.CreateIntCast(offset.value_, builder_.getInt64Ty(), !offset.type_->unsigned_)};
+    if (subtract) {
+        index = builder_.CreateNeg(index);
+    }
+
+    auto base{pointer.type_->base_};
+    if (base->IsVoid() || base->IsFunction()) {
+        auto bytes{builder_.CreateBitCast(pointer.value_, builder_.getInt8PtrTy())};
+        return builder_.CreateBitCast(builder_.CreateGEP(builder_.getInt8Ty(), bytes, index),
+                                      pointer.value_->getType());
+    }
+    return builder_.CreateGEP(GetType(base), pointer.value_, index);
+}
+
+// base之后offset字节处类型为type的对象的地址
+llvm::Value *CodeGenContext::EmitAddress(llvm::Value *base, std::uint64_t offset, const Type *type) {
+    auto address{builder_.CreateBitCast(base, builder_.getInt8PtrTy())};
+    if (offset != 0) {
+        address = builder_.CreateConstInBoundsGEP1_64(builder_.getInt8Ty(), address, offset);
+    }
+    return builder_.CreateBitCast(address, GetType(type)->getPointerTo());
+}
+
+void CodeGenContext::EmitStatement(const Statement *statement) {
+    if (!statement) {
+        return;
+    }
+
+    switch (statement->kind_) {
+        case NodeKind::kBlock:EnterScope();
+            for (auto item:static_cast<const Block *>(statement)->statements_) {
+                EmitStatement(item);
+            }
+            ExitScope();
+            break;
+        case NodeKind::kExpressionStatement:
+            EmitExpression(static_cast<const ExpressionStatement *>(statement)->expression_);
+            break;
+        case NodeKind::kVariableDeclaration:
+            EmitLocalVariable(static_cast<const VariableDeclaration *>(statement));
+            break;
+        case NodeKind::kFunctionDeclaration: {
+            auto function{static_cast<const FunctionDeclaration *>(statement)};
+            scopes_.back()[function->function_name_] = GetGlobal(function->function_name_, function->type_);
+            break;
+        }
+        case NodeKind::kIf:EmitIf(static_cast<const IfStatenment *>(statement));
+            break;
+        case NodeKind::kFor:EmitFor(static_cast<const ForStatenment *>(statement));
+            break;
+        case NodeKind::kWhile:EmitWhile(static_cast<const WhileStatement *>(statement));
+            break;
+        case NodeKind::kDoWhile:EmitDoWhile(static_cast<const DoWhileStatement *>(statement));
+            break;
+        case NodeKind::kSwitch:EmitSwitch(static_cast<const SwitchStatement *>(statement));
+            break;
+        case NodeKind::kCase:EmitCase(static_cast<const CaseStatement *>(statement));
+            break;
+        case NodeKind::kLabel: {
+            auto label{static_cast<const LabelStatement *>(statement)};
+            auto &block{labels_[label->label_]};
+            if (!block) {
+                block = NewBlock(std::string{interner_.GetSpelling(label->label_)});
+            } else if (!pending_labels_.erase(label->label_)) {
+                ErrorReport(statement, "redefinition of label '" +
+                                       std::string{interner_.GetSpelling(label->label_)} + "'");
+            }
+            EmitBlock(block);
+            EmitStatement(label->statement_);
+            break;
+        }
+        case NodeKind::kGoto: {
+            auto label{static_cast<const GotoStatement *>(statement)->label_};
+            auto &block{labels_[label]};
+            if (!block) {
+                block = NewBlock(std::string{interner_.GetSpelling(label)});
+                pending_labels_[label] = statement;
+            }
+            builder_.CreateBr(block);
+            EmitBlock(NewBlock());
+            break;
+        }
+        case NodeKind::kBreak:
+            if (std::empty(break_targets_)) {
+                ErrorReport(statement, "'break' statement not in loop or switch statement");
+            } else {
+                builder_.CreateBr(break_targets_.back());
+                EmitBlock(NewBlock());
+            }
+            break;
+        case NodeKind::kContinue:
+            if (std::empty(continue_targets_)) {
+                ErrorReport(statement, "'continue' statement not in loop statement");
+            } else {
+                builder_.CreateBr(continue_targets_.back());
+                EmitBlock(NewBlock());
+            }
+            break;
+        case NodeKind::kReturn:EmitReturn(static_cast<const ReturnStatenment *>(statement));
+            break;
+        default:break;
+    }
+}
+
+void CodeGenContext::EmitLocalVariable(const VariableDeclaration *declaration) {
+    auto name{declaration->variable_name_};
+    auto type{declaration->type_};
+    if (declaration->storage_ == StorageClass::kExtern) {
+        scopes_.back()[name] = GetGlobal(name, type);
+        return;
+    } else if (!type->IsComplete()) {
+        ErrorReport(declaration, "variable has incomplete type");
+        return;
+    }
+
+    std::string spelling{interner_.GetSpelling(name)};
+    // 静态局部变量是只在这个函数中使用的内部全局变量
+    if (declaration->storage_ == StorageClass::kStatic) {
+        auto init{EmitConstantInitializer(type, declaration->initialization_expression_)};
+        if (!init) {
+            return;
+        }
+        auto variable{new llvm::GlobalVariable(*the_module_, init->getType(), false,
+                                               llvm::GlobalValue::InternalLinkage, init,
+                                               function_->getName() + "." + spelling)};
+        variable->setAlignment(llvm::Align(type->GetAlign()));
+        scopes_.back()[name] = {llvm::ConstantExpr::getBitCast(variable, GetType(type)->getPointerTo()), type};
+        return;
+    }
+
+    auto address{CreateAlloca(type, spelling)};
+    scopes_.back()[name] = {address, type};
+    if (declaration->initialization_expression_) {
+        EmitLocalInitializer(address, type, declaration->initialization_expression_);
+    }
+}
+
+void CodeGenContext::EmitIf(const IfStatenment *statement) {
+    auto condition{EmitCondition(statement->condition_)};
+    if (!condition) {
+        return;
+    }
+
+    auto then_block{NewBlock("if.then")};
+    auto else_block{statement->else_statement_ ? NewBlock("if.else") : nullptr};
+    auto end_block{NewBlock("if.end")};
+    builder_.CreateCondBr(condition, then_block, else_block ? else_block : end_block);
+
+    EmitBlock(then_block);
+    EmitStatement(statement->then_statement_);
+    if (else_block) {
+        EmitBranch(end_block);
+        EmitBlock(else_block);
+        EmitStatement(statement->else_statement_);
+    }
+    EmitBlock(end_block);
+}
+
+void CodeGenContext::EmitFor(const ForStatenment *statement) {
+    EnterScope();
+    for (auto initial:statement->initial_) {
+        EmitStatement(initial);
+    }
+
+    auto condition_block{NewBlock("for.cond")};
+    auto body_block{NewBlock("for.body")};
+    auto increment_block{NewBlock("for.inc")};
+    auto end_block{NewBlock("for.end")};
+
+    EmitBlock(condition_block);
+    if (statement->condition_) {
+        if (auto condition{EmitCondition(statement->condition_)}) {
+            builder_.CreateCondBr(condition, body_block, end_block);
+        }
+    }
+
+    EmitBlock(body_block);
+    break_targets_.push_back(end_block);
+    continue_targets_.push_back(increment_block);
+    EmitStatement(statement->body_);
+    break_targets_.pop_back();
+    continue_targets_.pop_back();
+
+    EmitBlock(increment_block);
+    EmitExpression(statement->increment_);
+    EmitBranch(condition_block);
+    EmitBlock(end_block);
+    ExitScope();
+}
+
+void CodeGenContext::EmitWhile(const WhileStatement *statement) {
+    auto condition_block{NewBlock("while.cond")};
+    auto body_block{NewBlock("while.body")};
+    auto end_block{NewBlock("while.end")};
+
+    EmitBlock(condition_block);
+    if (auto condition{EmitCondition(statement->condition_)}) {
+        builder_.CreateCondBr(condition, body_block, end_block);
+    }
+
+    EmitBlock(body_block);
+    break_targets_.push_back(end_block);
+    continue_targets_.push_back(condition_block);
+    EmitStatement(statement->body_);
+    break_targets_.pop_back();
+    continue_targets_.pop_back();
+
+    EmitBranch(condition_block);
+    EmitBlock(end_block);
+}
+
+void CodeGenContext::EmitDoWhile(const DoWhileStatement *statement) {
+    auto body_block{NewBlock("do.body")};
+    auto condition_block{NewBlock("do.cond")};
+    auto end_block{NewBlock("do.end")};
+
+    EmitBlock(body_block);
+    break_targets_.push_back(end_block);
+    continue_targets_.push_back(condition_block);
+    EmitStatement(statement->body_);
+    break_targets_.pop_back();
+    continue_targets_.pop_back();
+
+    EmitBlock(condition_block);
+    if (auto condition{EmitCondition(statement->condition_)}) {
+        builder_.CreateCondBr(condition, body_block, end_block);
+    }
+    EmitBlock(end_block);
+}
+
+// case和default在生成语句体时加入到switch指令中, 没有default时跳到末尾
+void CodeGenContext::EmitSwitch(const SwitchStatement *statement) {
+    auto value{EmitExpression(statement->condition_)};
+    if (!value) {
+        return;
+    } else if (!value.type_->IsInteger()) {
+        ErrorReport(statement, "statement requires expression of integer type");
+        return;
+    }
+
+    auto type{Promote(value.type_)};
+    auto end_block{NewBlock("sw.end")};
+    switches_.push_back({builder_.CreateSwitch(Convert(value, type), end_block), type});
+    break_targets_.push_back(end_block);
+
+    EmitBlock(NewBlock());
+    EmitStatement(statement->body_);
+
+    break_targets_.pop_back();
+    switches_.pop_back();
+    EmitBlock(end_block);
+}
+
+void CodeGenContext::EmitCase(const CaseStatement *statement) {
+    if (std::empty(switches_)) {
+        ErrorReport(statement, statement->value_ ? "'case' statement not in switch statement"
+                                                 : "'default' statement not in switch statement");
+        EmitStatement(statement->statement_);
+        return;
+    }
+
+    auto &context{switches_.back()};
+    auto block{NewBlock(statement->value_ ? "sw.bb" : "sw.default")};
+    EmitBlock(block);
+
+    if (!statement->value_) {
+        if (context.has_default_) {
+            ErrorReport(statement, "multiple default labels in one switch");
+        } else {
+            context.switch_->setDefaultDest(block);
+            context.has_default_ = true;
+        }
+    } else if (auto value{EmitExpression(statement->value_)}) {
+        auto constant{value.type_->IsInteger() ? llvm::dyn_cast<llvm::ConstantInt>(Convert(value, context.type_))
+                                               : nullptr};
+        if (!constant) {
+            ErrorReport(statement->value_, "expression is not an integer constant expression");
+        } else if (context.switch_->findCaseValue(constant) != context.switch_->case_default()) {
+            ErrorReport(statement->value_, "duplicate case value");
+        } else {
+            context.switch_->addCase(constant, block);
+        }
+    }
+
+    EmitStatement(statement->statement_);
+}
+
+void CodeGenContext::EmitReturn(const ReturnStatenment *statement) {
+    auto return_type{declaration_->type_->base_};
+    if (!statement->expression_) {
+        if (!return_type->IsVoid()) {
+            WarningReport(statement, "non-void function should return a value");
+        }
+        if (return_type->IsVoid() || return_type->IsRecord()) {
+            builder_.CreateRetVoid();
+        } else {
+            builder_.CreateRet(llvm::Constant::getNullValue(GetType(return_type)));
+        }
+    } else if (auto value{EmitExpression(statement->expression_)}) {
+        if (return_type->IsVoid()) {
+            if (!value.type_->IsVoid()) {
+                WarningReport(statement, "void function should not return a value");
+            }
+            builder_.CreateRetVoid();
+        } else if (!CheckAssignable(statement, return_type, value.type_, "returning")) {
+            return;
+        } else if (return_type->IsRecord()) {
+            auto align{llvm::MaybeAlign(return_type->GetAlign())};
+            builder_.CreateMemCpy(return_address_, align, value.value_, align, return_type->GetSize());
+            builder_.CreateRetVoid();
+        } else {
+            builder_.CreateRet(Convert(value, return_type));
+        }
+    } else {
+        return;
+    }
+    EmitBlock(NewBlock());
+}
+
+// 当前块已经结束时不需要跳转
+void CodeGenContext::EmitBranch(llvm::BasicBlock *target) {
+    if (!builder_.GetInsertBlock()->getTerminator()) {
+        builder_.CreateBr(target);
+    }
+}
+
+// 从当前块落入block, block移到函数的末尾, 使块的顺序与源代码一致
+void CodeGenContext::EmitBlock(llvm::BasicBlock *block) {
+    EmitBranch(block);
+    block->moveAfter(&function_->back());
+    builder_.SetInsertPoint(block);
+}
+
+llvm::BasicBlock *CodeGenContext::NewBlock(const std::string &name) {
+    return llvm::BasicBlock::Create(the_context_, name, function_);
+}
+
+// 所有的局部变量都在入口块中分配
+llvm::AllocaInst *CodeGenContext::CreateAlloca(const Type *type, const std::string &name) {
+    auto &entry{function_->getEntryBlock()};
+    llvm::IRBuilder<> builder{&entry, entry.begin()};
+    auto alloca{builder.CreateAlloca(GetType(type), nullptr, name)};
+    alloca->setAlignment(llvm::Align(type->GetAlign()));
+    return alloca;
+}
+
+CodeGenContext::LValue CodeGenContext::FindVariable(SymbolId name) {
+    for (auto iter{std::rbegin(scopes_)}; iter != std::rend(scopes_); ++iter) {
+        if (auto entry{iter->find(name)}; entry != std::end(*iter)) {
+            return entry->second;
+        }
+    }
+    if (globals_ && globals_->Find(name)) {
+        return GetGlobal(name, nullptr);
+    }
+    return {};
+}
+
+void CodeGenContext::EnterScope() {
+    scopes_.emplace_back();
+}
+
+void CodeGenContext::ExitScope() {
+    scopes_.pop_back();
+}
+
+void CodeGenContext::ErrorReport(const ASTNode *node, const std::string &msg) {
+    diagnostics_.push_back(scanner_.MakeDiagnostic(node->offset_, msg));
+}
+
+void CodeGenContext::WarningReport(const ASTNode *node, const std::string &msg) {
+    diagnostics_.push_back(scanner_.MakeDiagnostic(node->offset_, msg));
+    diagnostics_.back().warning_ = true;
+}
+
+std::vector<std::unique_ptr<CodeGenContext>> GenerateCodeParallel(const Block &root, const Scanner &scanner,
+                                                                  TypeTable &types, ThreadPool &pool,
+                                                                  std::uint32_t partitions, CompileReport *report) {
+    if (partitions == 0) {
+        auto functions{std::count_if(std::begin(root.statements_), std::end(root.statements_),
+                                     [](const Statement *statement) {
+                                         auto function{NodeCast<FunctionDeclaration>(statement)};
+                                         return function && function->body_;
+                                     })};
+        partitions = std::clamp<std::uint32_t>(static_cast<std::uint32_t>(functions) / kFunctionsPerPartition, 1,
+                                               static_cast<std::uint32_t>(pool.GetSize()));
+    }
+
+    // 所有模块共享同一个只读的符号表, 语法树和类型表
+    GlobalSymbolTable globals{root, partitions};
+    std::vector<std::future<std::unique_ptr<CodeGenContext>>> futures;
+    for (std::uint32_t partition{}; partition < globals.GetPartitions(); ++partition) {
+        futures.push_back(pool.Submit([&, partition] {
+            TimeTrace::ThreadScope thread_scope;
+            CompileReport::Scope scope{report, Phase::kCodeGen};
+            auto name{scanner.GetFileName()};
+            if (partition != 0) {
+                name += '.' + std::to_string(partition);
+            }
+            llvm::TimeTraceScope trace_scope{"CodeGenModule", name};
+            auto context{std::make_unique<CodeGenContext>(scanner, types, name)};
+            context->GenerateCode(root, globals, partition);
+            return context;
+        }));
+    }
+
+    // 可能在线程池的任务中调用, 等待时也执行队列中的任务
+    std::vector<std::unique_ptr<CodeGenContext>> contexts;
+    for (auto &future:futures) {
+        contexts.push_back(pool.Wait(future));
+    }
+    return contexts;
 }
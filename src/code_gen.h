@@ -6,33 +6,206 @@
 #define TINY_C_COMPILER_CODE_GEN_H
 
 #include "ast.h"
+#include "compile_report.h"
+#include "diagnostic.h"
+#include "interner.h"
+#include "scanner.h"
+#include "thread_pool.h"
+#include "type.h"
 
-#include <llvm/IR/Value.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
 
-using SymbolTable=std::unordered_map<std::string, llvm::Value *>;
+// 文件作用域中的名字, 合并了同一个名字的所有声明, 建立之后只读, 可以被多个线程共享
+class GlobalSymbolTable {
+public:
+    class Symbol {
+    public:
+        // 优先使用定义或者有原型的声明中的类型
+        const Type *type_;
+        // 函数定义, 有初始化器的变量, 或者最后一个试探性定义, 只有声明时为空
+        const Statement *definition_{nullptr};
+        // 任何一个声明有static
+        bool internal_{false};
+        // C99的内联定义: 所有声明都有inline并且都没有extern
+        bool inline_{false};
+        // 定义所在的分区, 变量都在分区0中
+        std::uint32_t partition_{};
+    };
+
+    // 函数定义按语法树的大小分到partitions个分区中, 使各分区的总大小尽量接近
+    explicit GlobalSymbolTable(const Block &root, std::uint32_t partitions = 1);
 
-//class CodeGenBlock
+    const Symbol *Find(SymbolId name) const;
+    std::uint32_t GetPartitions() const;
+private:
+    std::unordered_map<SymbolId, Symbol> symbols_;
+    std::uint32_t partitions_;
+};
 
+// 一个LLVM模块的代码生成, 每个模块有自己的LLVMContext, 不同的模块可以在不同的线程中生成
+// 表达式的类型在生成时计算, 语法树本身不保存类型
 class CodeGenContext {
 public:
+    CodeGenContext(const Scanner &scanner, TypeTable &types, const std::string &module_name,
+                   Interner &interner = Interner::Global());
+
+    CodeGenContext(const CodeGenContext &) = delete;
+    CodeGenContext &operator=(const CodeGenContext &) = delete;
+
+    // 生成整个翻译单元
+    void GenerateCode(const Block &root);
+    // 只定义partition分区中的函数, 其他分区中的符号只声明
+    // 分区多于一个时, static的符号改名为 名字.文件的绝对路径和内容的散列值 并且只在链接单元内可见
+    void GenerateCode(const Block &root, const GlobalSymbolTable &globals, std::uint32_t partition);
+
+    const DiagnosticList &GetDiagnostics() const;
+    bool HasErrors() const;
+
     llvm::LLVMContext the_context_;
     llvm::IRBuilder<> builder_;
     std::unique_ptr<llvm::Module> the_module_;
-    SymbolTable global_vars_;
-    //TypeSystem typeSystem;
+private:
+    // 表达式的值, 结构体和联合的值用它的地址表示
+    // 数组和函数已经转换为指针
+    struct Value {
+        explicit operator bool() const { return type_ != nullptr; }
 
-    void GenerateCode(Block &root);
+        llvm::Value *value_{nullptr};
+        const Type *type_{nullptr};
+    };
 
-private:
-    //std::vector<CodeGenBlock*> blockStack;
+    // 左值的地址, 位域时地址指向所在的存储单元
+    struct LValue {
+        explicit operator bool() const { return type_ != nullptr; }
+
+        llvm::Value *address_{nullptr};
+        const Type *type_{nullptr};
+        const Member *bit_field_{nullptr};
+    };
+
+    // 初始化器展开后的一项, 给offset_处的一个标量, 位域, 结构体或者字符数组赋值
+    struct Initializer {
+        std::uint64_t offset_;
+        const Type *type_;
+        const Member *bit_field_;
+        const Expression *expression_;
+    };
+
+    struct SwitchContext {
+        llvm::SwitchInst *switch_;
+        const Type *type_;
+        bool has_default_{false};
+    };
+
+    llvm::Type *GetType(const Type *type);
+    llvm::FunctionType *GetFunctionType(const Type *type);
+    llvm::AttributeList GetAttributes(const Type *return_type, const std::vector<const Type *> &args);
+    std::string GetGlobalName(SymbolId name, const GlobalSymbolTable::Symbol *symbol) const;
+    LValue GetGlobal(SymbolId name, const Type *type);
+    llvm::GlobalValue *ReplaceGlobal(llvm::GlobalValue *old_value, llvm::GlobalValue *new_value);
+    void SetLinkage(llvm::GlobalValue *value, const GlobalSymbolTable::Symbol &symbol);
+
+    void DefineVariable(const VariableDeclaration *declaration, const GlobalSymbolTable::Symbol &symbol);
+    void DefineFunction(const FunctionDeclaration *declaration, const GlobalSymbolTable::Symbol &symbol);
+    llvm::Constant *EmitConstantInitializer(const Type *type, const Expression *init);
+
+    // 各种表达式的类型, 不生成代码, 用于sizeof和条件表达式
+    const Type *TypeOf(const Expression *expression);
+    const Type *Decay(const Type *type);
+    const Type *Promote(const Type *type) const;
+    const Type *GetArithmeticType(const Type *lhs, const Type *rhs) const;
+    const Type *GetConditionalType(const ConditionalExpression *expression);
+    const Type *GetStringType(const String *string);
+
+    Value EmitExpression(const Expression *expression);
+    LValue EmitLValue(const Expression *expression);
+    Value Load(const LValue &lvalue);
+    void Store(const LValue &lvalue, Value value);
+    llvm::Value *Convert(Value value, const Type *type);
+    bool CheckAssignable(const ASTNode *node, const Type *to, const Type *from, const std::string &what);
+    llvm::Value *EmitNonZero(Value value);
+    llvm::Value *EmitCondition(const Expression *expression);
+    LValue EmitString(const String *string);
+    Value EmitFunctionCall(const FunctionCall *call);
+    Value EmitBuiltinCall(const FunctionCall *call, std::string_view name);
+    Value EmitBinary(const BinaryOpExpression *expression);
+    Value EmitArithmetic(const ASTNode *node, TokenValue op, Value lhs, Value rhs);
+    Value EmitLogical(const BinaryOpExpression *expression);
+    Value EmitAssignment(const Assignment *expression);
+    Value EmitUnary(const UnaryOpExpression *expression);
+    Value EmitConditional(const ConditionalExpression *expression);
+    LValue EmitMember(const MemberExpression *expression);
+    LValue EmitIndex(const IndexExpression *expression);
+    llvm::Value *EmitPointerAdd(Value pointer, Value offset, bool subtract);
+    llvm::Value *EmitAddress(llvm::Value *base, std::uint64_t offset, const Type *type);
+
+    void FlattenInitializer(const Type *type, std::uint64_t offset, const Expression *init,
+                            std::vector<Initializer> &result);
+    void FlattenAggregate(const Type *type, std::uint64_t offset, const InitializerList *list,
+                          std::size_t &index, std::vector<Initializer> &result);
+    void EmitLocalInitializer(llvm::Value *address, const Type *type, const Expression *init);
+
+    void EmitStatement(const Statement *statement);
+    void EmitLocalVariable(const VariableDeclaration *declaration);
+    void EmitIf(const IfStatenment *statement);
+    void EmitFor(const ForStatenment *statement);
+    void EmitWhile(const WhileStatement *statement);
+    void EmitDoWhile(const DoWhileStatement *statement);
+    void EmitSwitch(const SwitchStatement *statement);
+    void EmitCase(const CaseStatement *statement);
+    void EmitReturn(const ReturnStatenment *statement);
+    void EmitBranch(llvm::BasicBlock *target);
+    void EmitBlock(llvm::BasicBlock *block);
+    llvm::BasicBlock *NewBlock(const std::string &name = "");
+    llvm::AllocaInst *CreateAlloca(const Type *type, const std::string &name = "");
+
+    LValue FindVariable(SymbolId name);
+    void EnterScope();
+    void ExitScope();
+
+    void ErrorReport(const ASTNode *node, const std::string &msg);
+    void WarningReport(const ASTNode *node, const std::string &msg);
+
+    const Scanner &scanner_;
+    TypeTable &types_;
+    Interner &interner_;
+    const GlobalSymbolTable *globals_{nullptr};
+    std::string suffix_;
+    DiagnosticList diagnostics_;
+
+    std::unordered_map<const Type *, llvm::StructType *> records_;
+    std::unordered_map<SymbolId, llvm::GlobalVariable *> strings_;
+    std::unordered_map<SymbolId, const Type *> string_types_;
+    // 块作用域中的变量, 以及块作用域中声明的外部名字
+    std::vector<std::unordered_map<SymbolId, LValue>> scopes_;
+
+    // 当前正在生成的函数
+    llvm::Function *function_{nullptr};
+    const FunctionDeclaration *declaration_{nullptr};
+    llvm::Value *return_address_{nullptr};
+    std::unordered_map<SymbolId, llvm::BasicBlock *> labels_;
+    std::unordered_map<SymbolId, const ASTNode *> pending_labels_;
+    std::vector<llvm::BasicBlock *> break_targets_;
+    std::vector<llvm::BasicBlock *> continue_targets_;
+    std::vector<SwitchContext> switches_;
+
+    // 文件作用域的初始化器在这个函数中生成, 常量折叠之后的结果必须是常量, 生成结束后删除
+    llvm::Function *initializer_function_{nullptr};
 };
 
-#endif //TINY_C_COMPILER_CODE_GEN_H
\ No newline at end of file
+// 把函数定义分到partitions个模块中, 在线程池中同时生成, 返回的模块按分区的顺序排列
+// partitions为0时按函数定义的个数和线程池的大小决定, 每个分区的生成时间计入report
+std::vector<std::unique_ptr<CodeGenContext>> GenerateCodeParallel(const Block &root, const Scanner &scanner,
+                                                                  TypeTable &types, ThreadPool &pool,
+                                                                  std::uint32_t partitions = 0,
+                                                                  CompileReport *report = nullptr);
+
+#endif //TINY_C_COMPILER_CODE_GEN_H
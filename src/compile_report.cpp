@@ -0,0 +1,223 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "compile_report.h"
+
+#include <sys/resource.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <string>
+
+namespace {
+
+// 没有CompileReport时operator new只检查这个计数
+std::atomic<int> active_reports{};
+thread_local std::uint64_t allocations{};
+thread_local std::uint64_t allocated_bytes{};
+thread_local CompileReport::Scope *current_scope{nullptr};
+
+double ToMilliseconds(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e6;
+}
+
+// 读取/proc/self/status中的一项, 以KiB为单位, 失败时返回0
+std::uint64_t ReadStatus(const std::string &name) {
+    std::ifstream ifs{"/proc/self/status"};
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.compare(0, std::size(name), name) == 0) {
+            return std::stoull(line.substr(std::size(name)));
+        }
+    }
+    return 0;
+}
+
+}
+
+// 替换全局的operator new, 只在存在CompileReport时累加两个线程局部的计数器
+// operator new[]和nothrow版本的默认实现都调用它
+void *operator new(std::size_t size) {
+    if (active_reports.load(std::memory_order_relaxed) != 0) {
+        ++allocations;
+        allocated_bytes += size;
+    }
+    while (true) {
+        if (auto pointer{std::malloc(size == 0 ? 1 : size)}) {
+            return pointer;
+        }
+        if (auto handler{std::get_new_handler()}) {
+            handler();
+        } else {
+            throw std::bad_alloc{};
+        }
+    }
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+CompileReport::Scope::Scope(CompileReport *report, Phase phase) : report_{report}, phase_{phase} {
+    if (report_) {
+        parent_ = current_scope;
+        current_scope = this;
+        start_ = Now();
+    }
+}
+
+CompileReport::Scope::~Scope() {
+    if (!report_) {
+        return;
+    }
+
+    auto end{Now()};
+    Usage used{end.wall_ - start_.wall_, end.cpu_ - start_.cpu_, end.allocations_ - start_.allocations_,
+               end.bytes_ - start_.bytes_};
+    current_scope = parent_;
+    if (parent_) {
+        parent_->nested_.wall_ += used.wall_;
+        parent_->nested_.cpu_ += used.cpu_;
+        parent_->nested_.allocations_ += used.allocations_;
+        parent_->nested_.bytes_ += used.bytes_;
+    }
+
+    auto &total{report_->phases_[static_cast<std::size_t>(phase_)]};
+    ++total.calls_;
+    total.wall_ += static_cast<std::uint64_t>((used.wall_ - nested_.wall_).count());
+    total.cpu_ += static_cast<std::uint64_t>((used.cpu_ - nested_.cpu_).count());
+    total.allocations_ += used.allocations_ - nested_.allocations_;
+    total.bytes_ += used.bytes_ - nested_.bytes_;
+}
+
+CompileReport::Scope::Usage CompileReport::Scope::Now() {
+    timespec cpu{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    return {std::chrono::steady_clock::now().time_since_epoch(),
+            std::chrono::seconds{cpu.tv_sec} + std::chrono::nanoseconds{cpu.tv_nsec}, allocations, allocated_bytes};
+}
+
+CompileReport::CompileReport() {
+    ++active_reports;
+    // 写入5把VmHWM重置为当前的常驻内存, 内核不支持时峰值包括之前的部分
+    std::ofstream{"/proc/self/clear_refs"} << "5";
+    start_rss_ = GetCurrentRss();
+}
+
+CompileReport::~CompileReport() {
+    --active_reports;
+}
+
+void CompileReport::AddFile() {
+    ++files_;
+}
+
+void CompileReport::AddTokens(std::uint64_t count) {
+    tokens_ += count;
+}
+
+void CompileReport::AddNodes(std::uint64_t count) {
+    nodes_ += count;
+}
+
+void CompileReport::Print(std::ostream &os, bool time, bool memory) const {
+    auto elapsed{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)};
+    auto flags{os.flags()};
+    os << std::fixed << std::setprecision(3);
+
+    if (time) {
+        os << "===-------------------------------------------------------===\n"
+           << "  tcc time report, " << ToMilliseconds(static_cast<std::uint64_t>(elapsed.count()))
+           << " ms elapsed\n"
+           << "===-------------------------------------------------------===\n"
+           << std::left << std::setw(14) << "  phase" << std::right << std::setw(8) << "calls"
+           << std::setw(14) << "wall (ms)" << std::setw(14) << "cpu (ms)" << '\n';
+        std::uint64_t wall{}, cpu{};
+        for (std::size_t i{}; i < std::size(phases_); ++i) {
+            const auto &phase{phases_[i]};
+            wall += phase.wall_;
+            cpu += phase.cpu_;
+            os << "  " << std::left << std::setw(12) << GetPhaseName(static_cast<Phase>(i)) << std::right
+               << std::setw(8) << phase.calls_ << std::setw(14) << ToMilliseconds(phase.wall_)
+               << std::setw(14) << ToMilliseconds(phase.cpu_) << '\n';
+        }
+        os << "  " << std::left << std::setw(12) << "total" << std::right << std::setw(8) << ""
+           << std::setw(14) << ToMilliseconds(wall) << std::setw(14) << ToMilliseconds(cpu) << '\n'
+           << "  files: " << files_ << ", tokens: " << tokens_ << ", AST nodes: " << nodes_ << '\n';
+    }
+
+    if (memory) {
+        os << "===-------------------------------------------------------===\n"
+           << "  tcc memory report\n"
+           << "===-------------------------------------------------------===\n"
+           << std::left << std::setw(14) << "  phase" << std::right << std::setw(14) << "allocations"
+           << std::setw(16) << "bytes" << '\n';
+        for (std::size_t i{}; i < std::size(phases_); ++i) {
+            const auto &phase{phases_[i]};
+            os << "  " << std::left << std::setw(12) << GetPhaseName(static_cast<Phase>(i)) << std::right
+               << std::setw(14) << phase.allocations_ << std::setw(16) << phase.bytes_ << '\n';
+        }
+        os << "  peak RSS: " << GetPeakRss() << " KiB, " << start_rss_ << " KiB at start\n";
+    }
+    os.flags(flags);
+}
+
+void CompileReport::PrintJson(std::ostream &os) const {
+    auto elapsed{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)};
+    auto flags{os.flags()};
+    os << std::fixed << std::setprecision(3)
+       << "{\"elapsed_ms\": " << ToMilliseconds(static_cast<std::uint64_t>(elapsed.count()))
+       << ", \"files\": " << files_ << ", \"tokens\": " << tokens_ << ", \"ast_nodes\": " << nodes_
+       << ", \"peak_rss_kib\": " << GetPeakRss() << ", \"start_rss_kib\": " << start_rss_
+       << ", \"phases\": [";
+    for (std::size_t i{}; i < std::size(phases_); ++i) {
+        const auto &phase{phases_[i]};
+        os << (i == 0 ? "" : ", ") << "{\"name\": \"" << GetPhaseName(static_cast<Phase>(i))
+           << "\", \"calls\": " << phase.calls_ << ", \"wall_ms\": " << ToMilliseconds(phase.wall_)
+           << ", \"cpu_ms\": " << ToMilliseconds(phase.cpu_) << ", \"allocations\": " << phase.allocations_
+           << ", \"allocated_bytes\": " << phase.bytes_ << '}';
+    }
+    os << "]}\n";
+    os.flags(flags);
+}
+
+std::uint64_t CompileReport::GetAllocations() {
+    return allocations;
+}
+
+std::uint64_t CompileReport::GetAllocatedBytes() {
+    return allocated_bytes;
+}
+
+std::uint64_t CompileReport::GetPeakRss() {
+    if (auto peak{ReadStatus("VmHWM:")}; peak != 0) {
+        return peak;
+    }
+    // ru_maxrss不会被重置, 是整个进程生命周期内的峰值
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+}
+
+std::uint64_t CompileReport::GetCurrentRss() {
+    return ReadStatus("VmRSS:");
+}
+
+const char *CompileReport::GetPhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::kPreprocess:return "preprocess";
+        case Phase::kParse:return "scan+parse";
+        case Phase::kCodeGen:return "codegen";
+        case Phase::kObjGen:return "objgen";
+        case Phase::kLink:return "link";
+        default:return "unknown";
+    }
+}
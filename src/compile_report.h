@@ -0,0 +1,96 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_COMPILE_REPORT_H
+#define TINY_C_COMPILER_COMPILE_REPORT_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// 编译的各个阶段, 扫描和语法分析交替进行, 算作一个阶段
+enum class Phase {
+    kPreprocess,
+    kParse,
+    kCodeGen,
+    kObjGen,
+    kLink,
+    kEnd
+};
+
+// -ftime-report和-fmem-report: 各个阶段的时间和内存分配次数, 所有文件和线程的结果累加在一起
+class CompileReport {
+public:
+    // 在作用域内计时, 同时统计当前线程分配内存的次数和字节数, report为nullptr时什么也不做
+    // 同一个线程上嵌套的作用域(例如在ThreadPool::Wait中执行的其他任务)从外层扣除, 每个阶段的时间互不重叠
+    class Scope {
+    public:
+        Scope(CompileReport *report, Phase phase);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    private:
+        class Usage {
+        public:
+            std::chrono::nanoseconds wall_{};
+            std::chrono::nanoseconds cpu_{};
+            std::uint64_t allocations_{};
+            std::uint64_t bytes_{};
+        };
+
+        static Usage Now();
+
+        CompileReport *report_;
+        Phase phase_;
+        Scope *parent_{nullptr};
+        Usage start_;
+        // 嵌套的作用域使用的部分
+        Usage nested_;
+    };
+
+    // 存在CompileReport时才统计内存分配, 同时把进程的峰值常驻内存重置为当前值,
+    // 编译服务中报告的峰值只包括这一次请求
+    CompileReport();
+    ~CompileReport();
+
+    CompileReport(const CompileReport &) = delete;
+    CompileReport &operator=(const CompileReport &) = delete;
+
+    void AddFile();
+    void AddTokens(std::uint64_t count);
+    void AddNodes(std::uint64_t count);
+
+    void Print(std::ostream &os, bool time, bool memory) const;
+    void PrintJson(std::ostream &os) const;
+
+    // 当前线程在存在CompileReport时通过operator new分配的次数和字节数
+    static std::uint64_t GetAllocations();
+    static std::uint64_t GetAllocatedBytes();
+    // 进程的峰值和当前的常驻内存, 以KiB为单位, 峰值从上次重置开始计算
+    static std::uint64_t GetPeakRss();
+    static std::uint64_t GetCurrentRss();
+    static const char *GetPhaseName(Phase phase);
+private:
+    class PhaseTotal {
+    public:
+        std::atomic<std::uint64_t> calls_{};
+        std::atomic<std::uint64_t> wall_{};
+        std::atomic<std::uint64_t> cpu_{};
+        std::atomic<std::uint64_t> allocations_{};
+        std::atomic<std::uint64_t> bytes_{};
+    };
+
+    std::array<PhaseTotal, static_cast<std::size_t>(Phase::kEnd)> phases_;
+    std::atomic<std::uint64_t> files_{};
+    std::atomic<std::uint64_t> tokens_{};
+    std::atomic<std::uint64_t> nodes_{};
+    std::chrono::steady_clock::time_point start_{std::chrono::steady_clock::now()};
+    std::uint64_t start_rss_;
+};
+
+#endif //TINY_C_COMPILER_COMPILE_REPORT_H
@@ -0,0 +1,27 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "diagnostic.h"
+
+#include <algorithm>
+#include <iterator>
+
+Diagnostic::Diagnostic(const std::string &file_name, std::string_view input,
+                       std::uint32_t offset, const std::string &message) :
+        file_name_{file_name}, offset_{offset}, message_{message} {
+    auto end{std::begin(input) + std::min<std::size_t>(offset, std::size(input))};
+    line_ += static_cast<std::uint32_t>(std::count(std::begin(input), end, '\n'));
+
+    auto line_begin{std::find(std::make_reverse_iterator(end), std::rend(input), '\n').base()};
+    column_ += static_cast<std::uint32_t>(end - line_begin);
+}
+
+Diagnostic::Diagnostic(const std::string &file_name, std::uint32_t line, std::uint32_t column,
+                       const std::string &message) :
+        file_name_{file_name}, offset_{}, line_{line}, column_{column}, message_{message} {}
+
+std::ostream &operator<<(std::ostream &os, const Diagnostic &diagnostic) {
+    return os << diagnostic.file_name_ << ':' << diagnostic.line_ << ':' << diagnostic.column_
+              << (diagnostic.warning_ ? ": warning: " : ": error: ") << diagnostic.message_;
+}
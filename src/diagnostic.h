@@ -0,0 +1,36 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_DIAGNOSTIC_H
+#define TINY_C_COMPILER_DIAGNOSTIC_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 一条错误或警告信息, offset_是在输入缓冲区中的字节偏移
+// 行号和列号只在产生错误时计算, 不影响正常扫描的速度
+class Diagnostic {
+public:
+    Diagnostic(const std::string &file_name, std::string_view input,
+               std::uint32_t offset, const std::string &message);
+    // 位置已知时直接给出行号和列号, 例如预处理器的错误
+    Diagnostic(const std::string &file_name, std::uint32_t line, std::uint32_t column,
+               const std::string &message);
+
+    std::string file_name_;
+    std::uint32_t offset_;
+    std::uint32_t line_{1};
+    std::uint32_t column_{1};
+    std::string message_;
+    bool warning_{false};
+};
+
+using DiagnosticList = std::vector<Diagnostic>;
+
+std::ostream &operator<<(std::ostream &os, const Diagnostic &diagnostic);
+
+#endif //TINY_C_COMPILER_DIAGNOSTIC_H
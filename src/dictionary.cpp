@@ -4,99 +4,201 @@
 
 #include "dictionary.h"
 
-Dictionary::Dictionary() {
-    AddToken("=", {TokenType::kOperator, TokenValue::kAssign, 20});
-
-    AddToken("++", {TokenType::kOperator, TokenValue::kPlusPlus, 150});
-    AddToken("--", {TokenType::kOperator, TokenValue::kMinusMinus, 150});
-
-    AddToken("+", {TokenType::kOperator, TokenValue::kPlus, 120});
-    AddToken("-", {TokenType::kOperator, TokenValue::kMinus, 120});
-    AddToken("*", {TokenType::kOperator, TokenValue::kMultiply, 130});
-    AddToken("/", {TokenType::kOperator, TokenValue::kDivide, 130});
-    AddToken("%", {TokenType::kOperator, TokenValue::kMod, 130});
-    AddToken("~", {TokenType::kOperator, TokenValue::kNeg, 0});
-    AddToken("&", {TokenType::kOperator, TokenValue::kAnd, 80});
-    AddToken("|", {TokenType::kOperator, TokenValue::kOr, 60});
-    AddToken("^", {TokenType::kOperator, TokenValue::kXor, 70});
-    AddToken("<<", {TokenType::kOperator, TokenValue::kShl, 110});
-    AddToken(">>", {TokenType::kOperator, TokenValue::kShr, 110});
-
-    AddToken("!", {TokenType::kOperator, TokenValue::kLogicNeg, 140});
-    AddToken("&&", {TokenType::kOperator, TokenValue::kLogicAnd, 50});
-    AddToken("||", {TokenType::kOperator, TokenValue::kLogicOr, 40});
-
-    AddToken("==", {TokenType::kOperator, TokenValue::kEqual, 90});
-    AddToken("!=", {TokenType::kOperator, TokenValue::kNotEqual, 90});
-    AddToken("<", {TokenType::kOperator, TokenValue::kLess, 100});
-    AddToken(">", {TokenType::kOperator, TokenValue::kGreater, 100});
-    AddToken("<=", {TokenType::kOperator, TokenValue::kLessOrEqual, 100});
-    AddToken(">=", {TokenType::kOperator, TokenValue::kGreaterOrEqual, 100});
-
-    AddToken("->", {TokenType::kOperator, TokenValue::kArrow, 150});
-    AddToken(".", {TokenType::kOperator, TokenValue::kPeriod, 150});
-
-    AddToken(",", {TokenType::kOperator, TokenValue::kComma, 10});
-
-    AddToken("(", {TokenType::kDelimiter, TokenValue::kLeftParen, -1});
-    AddToken(")", {TokenType::kDelimiter, TokenValue::kRightParen, -1});
-    AddToken("[", {TokenType::kDelimiter, TokenValue::kLeftSquare, -1});
-    AddToken("]", {TokenType::kDelimiter, TokenValue::kRightSquare, -1});
-    AddToken("{", {TokenType::kDelimiter, TokenValue::kLeftCurly, -1});
-    AddToken("}", {TokenType::kDelimiter, TokenValue::kRightCurly, -1});
-    AddToken(";", {TokenType::kDelimiter, TokenValue::kSemicolon, -1});
-
-    AddToken("auto", {TokenType::kKeyword, TokenValue::kAutoKey, -1});
-    AddToken("break", {TokenType::kKeyword, TokenValue::kBreakKey, -1});
-    AddToken("case", {TokenType::kKeyword, TokenValue::kCaseKey, -1});
-    AddToken("char", {TokenType::kKeyword, TokenValue::kCharKey, -1});
-    AddToken("const", {TokenType::kKeyword, TokenValue::kConstKey, -1});
-    AddToken("continue", {TokenType::kKeyword, TokenValue::kContinueKey, -1});
-    AddToken("default", {TokenType::kKeyword, TokenValue::kDefaultKey, -1});
-    AddToken("do", {TokenType::kKeyword, TokenValue::kDoKey, -1});
-    AddToken("double", {TokenType::kKeyword, TokenValue::kDoubleKey, -1});
-    AddToken("else", {TokenType::kKeyword, TokenValue::kElseKey, -1});
-    AddToken("enum", {TokenType::kKeyword, TokenValue::kEnumKey, -1});
-    AddToken("extern", {TokenType::kKeyword, TokenValue::kExternKey, -1});
-    AddToken("float", {TokenType::kKeyword, TokenValue::kFloatKey, -1});
-    AddToken("for", {TokenType::kKeyword, TokenValue::kForKey, -1});
-    AddToken("goto", {TokenType::kKeyword, TokenValue::kGotoKey, -1});
-    AddToken("if", {TokenType::kKeyword, TokenValue::kIfKey, -1});
-    AddToken("inline", {TokenType::kKeyword, TokenValue::kInlineKey, -1});
-    AddToken("int", {TokenType::kKeyword, TokenValue::kIntKey, -1});
-    AddToken("long", {TokenType::kKeyword, TokenValue::kLongKey, -1});
-    AddToken("register", {TokenType::kKeyword, TokenValue::kRegisterKey, -1});
-    AddToken("restrict", {TokenType::kKeyword, TokenValue::kRestrictKey, -1});
-    AddToken("return", {TokenType::kKeyword, TokenValue::kReturnKey, -1});
-    AddToken("short", {TokenType::kKeyword, TokenValue::kShortKey, -1});
-    AddToken("signed", {TokenType::kKeyword, TokenValue::kSignedKey, -1});
-    AddToken("sizeof", {TokenType::kKeyword, TokenValue::kSizeofKey, -1});
-    AddToken("static", {TokenType::kKeyword, TokenValue::kStaticKey, -1});
-    AddToken("struct", {TokenType::kKeyword, TokenValue::kStructKey, -1});
-    AddToken("switch", {TokenType::kKeyword, TokenValue::kSwitchKey, -1});
-    AddToken("typedef", {TokenType::kKeyword, TokenValue::kTypedefKey, -1});
-    AddToken("union", {TokenType::kKeyword, TokenValue::kUnionKey, -1});
-    AddToken("unsigned", {TokenType::kKeyword, TokenValue::kUnsignedKey, -1});
-    AddToken("void", {TokenType::kKeyword, TokenValue::kVoidKey, -1});
-    AddToken("volatile", {TokenType::kKeyword, TokenValue::kVolatileKey, -1});
-    AddToken("while", {TokenType::kKeyword, TokenValue::kWhileKey, -1});
-    AddToken("_Bool", {TokenType::kKeyword, TokenValue::kBoolKey, -1});
-    AddToken("_Complex", {TokenType::kKeyword, TokenValue::kComplexKey, -1});
-    AddToken("_Imaginary", {TokenType::kKeyword, TokenValue::kImaginaryKey, -1});
+#include <array>
+#include <cstddef>
+
+namespace {
+
+struct Entry {
+    std::string_view name;
+    TokenType type;
+    TokenValue value;
+    std::int32_t symbol_precedence;
+};
+
+constexpr Entry kEntries[]{
+        {"=", TokenType::kOperator, TokenValue::kAssign, 20},
+        {"+=", TokenType::kOperator, TokenValue::kPlusAssign, 20},
+        {"-=", TokenType::kOperator, TokenValue::kMinusAssign, 20},
+        {"*=", TokenType::kOperator, TokenValue::kMultiplyAssign, 20},
+        {"/=", TokenType::kOperator, TokenValue::kDivideAssign, 20},
+        {"%=", TokenType::kOperator, TokenValue::kModAssign, 20},
+        {"&=", TokenType::kOperator, TokenValue::kAndAssign, 20},
+        {"|=", TokenType::kOperator, TokenValue::kOrAssign, 20},
+        {"^=", TokenType::kOperator, TokenValue::kXorAssign, 20},
+        {"<<=", TokenType::kOperator, TokenValue::kShlAssign, 20},
+        {">>=", TokenType::kOperator, TokenValue::kShrAssign, 20},
+
+        {"++", TokenType::kOperator, TokenValue::kPlusPlus, 150},
+        {"--", TokenType::kOperator, TokenValue::kMinusMinus, 150},
+
+        {"+", TokenType::kOperator, TokenValue::kPlus, 120},
+        {"-", TokenType::kOperator, TokenValue::kMinus, 120},
+        {"*", TokenType::kOperator, TokenValue::kMultiply, 130},
+        {"/", TokenType::kOperator, TokenValue::kDivide, 130},
+        {"%", TokenType::kOperator, TokenValue::kMod, 130},
+        {"~", TokenType::kOperator, TokenValue::kNeg, 0},
+        {"&", TokenType::kOperator, TokenValue::kAnd, 80},
+        {"|", TokenType::kOperator, TokenValue::kOr, 60},
+        {"^", TokenType::kOperator, TokenValue::kXor, 70},
+        {"<<", TokenType::kOperator, TokenValue::kShl, 110},
+        {">>", TokenType::kOperator, TokenValue::kShr, 110},
+
+        {"!", TokenType::kOperator, TokenValue::kLogicNeg, 140},
+        {"&&", TokenType::kOperator, TokenValue::kLogicAnd, 50},
+        {"||", TokenType::kOperator, TokenValue::kLogicOr, 40},
+
+        {"==", TokenType::kOperator, TokenValue::kEqual, 90},
+        {"!=", TokenType::kOperator, TokenValue::kNotEqual, 90},
+        {"<", TokenType::kOperator, TokenValue::kLess, 100},
+        {">", TokenType::kOperator, TokenValue::kGreater, 100},
+        {"<=", TokenType::kOperator, TokenValue::kLessOrEqual, 100},
+        {">=", TokenType::kOperator, TokenValue::kGreaterOrEqual, 100},
+
+        {"->", TokenType::kOperator, TokenValue::kArrow, 150},
+        {".", TokenType::kOperator, TokenValue::kPeriod, 150},
+
+        {",", TokenType::kOperator, TokenValue::kComma, 10},
+        {"?", TokenType::kOperator, TokenValue::kQuestion, 30},
+
+        {"(", TokenType::kDelimiter, TokenValue::kLeftParen, -1},
+        {")", TokenType::kDelimiter, TokenValue::kRightParen, -1},
+        {"[", TokenType::kDelimiter, TokenValue::kLeftSquare, -1},
+        {"]", TokenType::kDelimiter, TokenValue::kRightSquare, -1},
+        {"{", TokenType::kDelimiter, TokenValue::kLeftCurly, -1},
+        {"}", TokenType::kDelimiter, TokenValue::kRightCurly, -1},
+        {";", TokenType::kDelimiter, TokenValue::kSemicolon, -1},
+        {":", TokenType::kDelimiter, TokenValue::kColon, -1},
+        {"...", TokenType::kDelimiter, TokenValue::kEllipsis, -1},
+
+        {"auto", TokenType::kKeyword, TokenValue::kAutoKey, -1},
+        {"break", TokenType::kKeyword, TokenValue::kBreakKey, -1},
+        {"case", TokenType::kKeyword, TokenValue::kCaseKey, -1},
+        {"char", TokenType::kKeyword, TokenValue::kCharKey, -1},
+        {"const", TokenType::kKeyword, TokenValue::kConstKey, -1},
+        {"continue", TokenType::kKeyword, TokenValue::kContinueKey, -1},
+        {"default", TokenType::kKeyword, TokenValue::kDefaultKey, -1},
+        {"do", TokenType::kKeyword, TokenValue::kDoKey, -1},
+        {"double", TokenType::kKeyword, TokenValue::kDoubleKey, -1},
+        {"else", TokenType::kKeyword, TokenValue::kElseKey, -1},
+        {"enum", TokenType::kKeyword, TokenValue::kEnumKey, -1},
+        {"extern", TokenType::kKeyword, TokenValue::kExternKey, -1},
+        {"float", TokenType::kKeyword, TokenValue::kFloatKey, -1},
+        {"for", TokenType::kKeyword, TokenValue::kForKey, -1},
+        {"goto", TokenType::kKeyword, TokenValue::kGotoKey, -1},
+        {"if", TokenType::kKeyword, TokenValue::kIfKey, -1},
+        {"inline", TokenType::kKeyword, TokenValue::kInlineKey, -1},
+        {"int", TokenType::kKeyword, TokenValue::kIntKey, -1},
+        {"long", TokenType::kKeyword, TokenValue::kLongKey, -1},
+        {"register", TokenType::kKeyword, TokenValue::kRegisterKey, -1},
+        {"restrict", TokenType::kKeyword, TokenValue::kRestrictKey, -1},
+        {"return", TokenType::kKeyword, TokenValue::kReturnKey, -1},
+        {"short", TokenType::kKeyword, TokenValue::kShortKey, -1},
+        {"signed", TokenType::kKeyword, TokenValue::kSignedKey, -1},
+        {"sizeof", TokenType::kKeyword, TokenValue::kSizeofKey, -1},
+        {"static", TokenType::kKeyword, TokenValue::kStaticKey, -1},
+        {"struct", TokenType::kKeyword, TokenValue::kStructKey, -1},
+        {"switch", TokenType::kKeyword, TokenValue::kSwitchKey, -1},
+        {"typedef", TokenType::kKeyword, TokenValue::kTypedefKey, -1},
+        {"union", TokenType::kKeyword, TokenValue::kUnionKey, -1},
+        {"unsigned", TokenType::kKeyword, TokenValue::kUnsignedKey, -1},
+        {"void", TokenType::kKeyword, TokenValue::kVoidKey, -1},
+        {"volatile", TokenType::kKeyword, TokenValue::kVolatileKey, -1},
+        {"while", TokenType::kKeyword, TokenValue::kWhileKey, -1},
+        {"_Bool", TokenType::kKeyword, TokenValue::kBoolKey, -1},
+        {"_Complex", TokenType::kKeyword, TokenValue::kComplexKey, -1},
+        {"_Imaginary", TokenType::kKeyword, TokenValue::kImaginaryKey, -1},
+};
+
+constexpr std::size_t kEntryCount{std::size(kEntries)};
+constexpr std::size_t kTableSize{1024};
+constexpr std::size_t kMaxNameLength{10};
+
+static_assert(kEntryCount < kTableSize);
+
+// 只用首字符, 第二个字符, 末字符和长度计算散列, 不需要遍历整个字符串
+// 这四项对表中所有条目都各不相同
+constexpr std::size_t Hash(std::string_view name, std::uint32_t seed) {
+    auto size{static_cast<std::uint32_t>(std::size(name))};
+    auto first{static_cast<std::uint32_t>(static_cast<unsigned char>(name.front()))};
+    auto second{size > 1 ? static_cast<std::uint32_t>(static_cast<unsigned char>(name[1])) : 0};
+    auto last{static_cast<std::uint32_t>(static_cast<unsigned char>(name.back()))};
+
+    auto hash{first | second << 8 | last << 16 | size << 24};
+    hash ^= hash >> 15;
+    hash *= seed;
+    hash ^= hash >> 13;
+    return hash & (kTableSize - 1);
 }
 
-std::tuple<TokenType, TokenValue, std::int32_t> Dictionary::LookUp(const std::string &name) const {
-    if (auto iter = dictionary_.find(name);iter != dictionary_.end()) {
-        return {std::get<0>(iter->second), std::get<1>(iter->second), std::get<2>(iter->second)};
+// slots_中保存条目下标加一, 0表示空槽
+struct PerfectHashTable {
+    std::array<std::uint8_t, kTableSize> slots_{};
+    std::uint32_t seed_{};
+};
+
+// 在编译期搜索一个使所有条目都不冲突的种子
+constexpr PerfectHashTable BuildTable() {
+    for (std::uint32_t seed{1}; seed < 1u << 16u; seed += 2) {
+        PerfectHashTable table{};
+        table.seed_ = seed;
+
+        bool ok{true};
+        for (std::size_t i{}; i < kEntryCount; ++i) {
+            auto &slot{table.slots_[Hash(kEntries[i].name, seed)]};
+            if (slot != 0) {
+                ok = false;
+                break;
+            }
+            slot = static_cast<std::uint8_t>(i + 1);
+        }
+
+        if (ok) {
+            return table;
+        }
+    }
+    return {};
+}
+
+constexpr PerfectHashTable kTable{BuildTable()};
+
+static_assert(kTable.seed_ != 0, "No perfect hash seed found for the dictionary.");
+
+constexpr auto kSpellings{[] {
+    std::array<std::string_view, static_cast<std::size_t>(TokenValue::kUnreserved) + 1> spellings{};
+    for (const auto &entry:kEntries) {
+        spellings[static_cast<std::size_t>(entry.value)] = entry.name;
+    }
+    return spellings;
+}()};
+
+constexpr const Entry *Find(std::string_view name) {
+    if (std::empty(name) || std::size(name) > kMaxNameLength) {
+        return nullptr;
+    }
+
+    auto slot{kTable.slots_[Hash(name, kTable.seed_)]};
+    if (slot == 0 || kEntries[slot - 1].name != name) {
+        return nullptr;
+    }
+    return &kEntries[slot - 1];
+}
+
+}
+
+std::tuple<TokenType, TokenValue, std::int32_t> Dictionary::LookUp(std::string_view name) const {
+    if (auto entry{Find(name)}; entry) {
+        return {entry->type, entry->value, entry->symbol_precedence};
     } else {
         return {TokenType::kIdentifier, TokenValue::kIdentifier, -1};
     }
 }
 
-bool Dictionary::HaveToken(const std::string &name) const {
-    return dictionary_.find(name) != std::end(dictionary_);
+bool Dictionary::HaveToken(std::string_view name) const {
+    return Find(name) != nullptr;
 }
 
-void Dictionary::AddToken(const std::string &name, const std::tuple<TokenType, TokenValue, std::int32_t> &token) {
-    dictionary_.insert({name, token});
-}
\ No newline at end of file
+std::string_view Dictionary::GetSpelling(TokenValue value) const {
+    auto index{static_cast<std::size_t>(value)};
+    return index < std::size(kSpellings) ? kSpellings[index] : std::string_view{};
+}
@@ -6,18 +6,18 @@
 #define TINY_C_COMPILER_DICTIONARY_H
 
 #include "token.h"
-#include <string>
+#include <string_view>
 #include <cstdint>
-#include <unordered_map>
+#include <tuple>
 
+// 关键字, 运算符和分隔符表在编译期生成为完美散列表, 构造不需要任何开销
 class Dictionary {
 public:
-    Dictionary();
-    std::tuple<TokenType, TokenValue, std::int32_t> LookUp(const std::string &name) const;
-    bool HaveToken(const std::string &name) const;
-private:
-    void AddToken(const std::string &name, const std::tuple<TokenType, TokenValue, std::int32_t> &token);
-    std::unordered_map<std::string, std::tuple<TokenType, TokenValue, std::int32_t>> dictionary_;
+    constexpr Dictionary() = default;
+    std::tuple<TokenType, TokenValue, std::int32_t> LookUp(std::string_view name) const;
+    bool HaveToken(std::string_view name) const;
+    // 关键字和运算符的拼写, 其余的值返回空串
+    std::string_view GetSpelling(TokenValue value) const;
 };
 
 #endif //TINY_C_COMPILER_DICTIONARY_H
\ No newline at end of file
@@ -0,0 +1,826 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "flat_ast.h"
+#include "binary_io.h"
+#include "dictionary.h"
+#include "mapped_file.h"
+
+#include <cstring>
+#include <functional>
+
+namespace {
+
+constexpr char kMagic[8]{'T', 'C', 'C', '-', 'A', 'S', 'T', '\0'};
+constexpr std::uint32_t kVersion{1};
+
+constexpr auto kNone{OperandKind::kNone};
+constexpr auto kNode{OperandKind::kNode};
+constexpr auto kList{OperandKind::kList};
+constexpr auto kSymbol{OperandKind::kSymbol};
+constexpr auto kValue{OperandKind::kValue};
+
+constexpr NodeLayout kLayouts[]{
+        {"Null", {kNone, kNone, kNone}},
+
+        {"Double", {kValue, kValue, kNone}},
+        {"Integer", {kValue, kValue, kNone}},
+        {"String", {kSymbol, kNone, kNone}},
+        {"Identifier", {kSymbol, kNone, kNone}},
+        {"FunctionCall", {kNode, kList, kNone}},
+        {"BinaryOp", {kNode, kNode, kValue}},
+        {"Assignment", {kNode, kNode, kValue}},
+        {"UnaryOp", {kNode, kValue, kNone}},
+        {"Conditional", {kNode, kNode, kNode}},
+        {"Cast", {kNode, kNone, kNone}},
+        {"Sizeof", {kNode, kNone, kNone}},
+        {"Member", {kNode, kSymbol, kNone}},
+        {"Index", {kNode, kNode, kNone}},
+        {"InitializerList", {kList, kNone, kNone}},
+
+        {"Block", {kList, kNone, kNone}},
+        {"ExpressionStatement", {kNode, kNone, kNone}},
+        {"VariableDeclaration", {kSymbol, kNode, kNone}},
+        {"FunctionDeclaration", {kSymbol, kList, kNode}},
+        {"If", {kNode, kNode, kNode}},
+        {"For", {kList, kList, kNone}},
+        {"While", {kNode, kNode, kNone}},
+        {"DoWhile", {kNode, kNode, kNone}},
+        {"Switch", {kNode, kNode, kNone}},
+        {"Case", {kNode, kNode, kNone}},
+        {"Label", {kSymbol, kNode, kNone}},
+        {"Goto", {kSymbol, kNone, kNone}},
+        {"Break", {kNone, kNone, kNone}},
+        {"Continue", {kNone, kNone, kNone}},
+        {"Return", {kNode, kNone, kNone}},
+};
+
+static_assert(std::size(kLayouts) == static_cast<std::size_t>(NodeKind::kEnd));
+
+constexpr std::uint8_t kPostfixFlag{1};
+constexpr std::uint8_t kArrowFlag{1};
+constexpr std::uint8_t kIsTypeFlag{1};
+constexpr std::uint8_t kInlineFlag{8};
+
+// 文件头之后依次是类型, 符号, 节点的各列, extra_, 最后是字符串表
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t node_count;
+    std::uint32_t extra_count;
+    std::uint32_t symbol_count;
+    std::uint32_t type_count;
+    std::uint32_t root;
+    std::uint32_t strings_size;
+    std::uint32_t reserved;
+};
+
+// 类型之间用下标加一引用, 结构体/联合的成员和函数的形参紧跟在类型之后
+// 结构体/联合的布局直接保存, 读入时不再重新计算
+struct TypeRecord {
+    std::uint8_t kind;
+    std::uint8_t is_unsigned;
+    std::uint8_t variadic;
+    std::uint8_t has_prototype;
+    std::uint8_t complete;
+    std::uint8_t reserved[3];
+    std::uint32_t base;
+    std::uint32_t field_count;
+    StringRef tag;
+    std::int64_t length;
+    std::uint64_t size;
+    std::uint64_t align;
+};
+
+struct FieldRecord {
+    std::uint64_t offset;
+    std::uint32_t type;
+    std::uint32_t bit_width;
+    std::uint32_t bit_offset;
+    std::uint8_t bit_field;
+    std::uint8_t reserved[3];
+    StringRef name;
+};
+
+static_assert(sizeof(FileHeader) == 40 && sizeof(TypeRecord) == 48 && sizeof(FieldRecord) == 32);
+
+std::string TypeName(const Type *type, const Interner &interner) {
+    if (!type) {
+        return "?";
+    }
+    switch (type->kind_) {
+        case TypeKind::kVoid:return "void";
+        case TypeKind::kBool:return "_Bool";
+        case TypeKind::kChar:return type->unsigned_ ? "unsigned char" : "char";
+        case TypeKind::kShort:return type->unsigned_ ? "unsigned short" : "short";
+        case TypeKind::kInt:return type->unsigned_ ? "unsigned" : "int";
+        case TypeKind::kLong:return type->unsigned_ ? "unsigned long" : "long";
+        case TypeKind::kLongLong:return type->unsigned_ ? "unsigned long long" : "long long";
+        case TypeKind::kFloat:return "float";
+        case TypeKind::kDouble:return "double";
+        case TypeKind::kLongDouble:return "long double";
+        case TypeKind::kEnum:return "enum " + std::string{interner.GetSpelling(type->tag_)};
+        case TypeKind::kPointer:return TypeName(type->base_, interner) + "*";
+        case TypeKind::kArray:return TypeName(type->base_, interner) + "[" + std::to_string(type->length_) + "]";
+        case TypeKind::kFunction: {
+            auto name{TypeName(type->base_, interner) + "("};
+            for (std::size_t i{}; i < std::size(type->params_); ++i) {
+                name += (i == 0 ? "" : ", ") + TypeName(type->params_[i].type_, interner);
+            }
+            return name + (type->variadic_ ? ", ...)" : ")");
+        }
+        case TypeKind::kStruct:return "struct " + std::string{interner.GetSpelling(type->tag_)};
+        case TypeKind::kUnion:return "union " + std::string{interner.GetSpelling(type->tag_)};
+    }
+    return "?";
+}
+
+}
+
+const NodeLayout &GetNodeLayout(NodeKind kind) {
+    return kLayouts[static_cast<std::size_t>(kind)];
+}
+
+FlatAST::FlatAST() {
+    AddNode(NodeKind::kNull, 0);
+}
+
+FlatAST::FlatAST(const Block &root) : FlatAST{} {
+    root_ = Flatten(&root);
+    symbol_index_.clear();
+    type_index_.clear();
+}
+
+NodeIndex FlatAST::GetRoot() const {
+    return root_;
+}
+
+std::size_t FlatAST::GetNodeCount() const {
+    return std::size(kinds_);
+}
+
+std::size_t FlatAST::GetBytes() const {
+    return std::size(kinds_) * (sizeof(NodeKind) + sizeof(std::uint8_t) + sizeof(std::uint32_t) * 5) +
+           std::size(extra_) * sizeof(std::uint32_t) + std::size(symbols_) * sizeof(SymbolId) +
+           std::size(type_list_) * sizeof(const Type *);
+}
+
+NodeKind FlatAST::GetKind(NodeIndex node) const {
+    return kinds_[node];
+}
+
+std::uint8_t FlatAST::GetFlags(NodeIndex node) const {
+    return flags_[node];
+}
+
+std::uint32_t FlatAST::GetOffset(NodeIndex node) const {
+    return offsets_[node];
+}
+
+const Type *FlatAST::GetType(NodeIndex node) const {
+    auto type{types_[node]};
+    return type == 0 ? nullptr : type_list_[type - 1];
+}
+
+std::uint32_t FlatAST::GetOperand(NodeIndex node, std::size_t index) const {
+    return operands_[index][node];
+}
+
+SymbolId FlatAST::GetSymbol(NodeIndex node, std::size_t index) const {
+    return symbols_[operands_[index][node]];
+}
+
+std::uint64_t FlatAST::GetInteger(NodeIndex node) const {
+    return static_cast<std::uint64_t>(operands_[1][node]) << 32u | operands_[0][node];
+}
+
+double FlatAST::GetDouble(NodeIndex node) const {
+    auto bits{GetInteger(node)};
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const NodeIndex *FlatAST::ListBegin(NodeIndex node, std::size_t index) const {
+    return std::data(extra_) + operands_[index][node] + 1;
+}
+
+const NodeIndex *FlatAST::ListEnd(NodeIndex node, std::size_t index) const {
+    auto list{operands_[index][node]};
+    return std::data(extra_) + list + 1 + extra_[list];
+}
+
+NodeIndex FlatAST::AddNode(NodeKind kind, std::uint32_t offset, const Type *type, std::uint8_t flags) {
+    auto node{static_cast<NodeIndex>(std::size(kinds_))};
+    kinds_.push_back(kind);
+    flags_.push_back(flags);
+    offsets_.push_back(offset);
+    types_.push_back(AddType(type));
+    for (auto &operand:operands_) {
+        operand.push_back(0);
+    }
+    return node;
+}
+
+void FlatAST::SetOperand(NodeIndex node, std::size_t index, std::uint32_t value) {
+    operands_[index][node] = value;
+}
+
+std::uint32_t FlatAST::AddList(const std::vector<NodeIndex> &elements) {
+    auto list{static_cast<std::uint32_t>(std::size(extra_))};
+    extra_.push_back(static_cast<std::uint32_t>(std::size(elements)));
+    extra_.insert(std::end(extra_), std::begin(elements), std::end(elements));
+    return list;
+}
+
+std::uint32_t FlatAST::AddSymbol(SymbolId symbol) {
+    auto [iter, inserted]{symbol_index_.emplace(symbol, static_cast<std::uint32_t>(std::size(symbols_)))};
+    if (inserted) {
+        symbols_.push_back(symbol);
+    }
+    return iter->second;
+}
+
+// 基类型在前, 这样读入时可以按顺序重新创建
+// 结构体和联合先占位再处理成员, 成员可以通过指针引用它自己
+std::uint32_t FlatAST::AddType(const Type *type) {
+    if (!type) {
+        return 0;
+    }
+    if (auto iter{type_index_.find(type)}; iter != std::end(type_index_)) {
+        return iter->second;
+    }
+
+    auto add{[this, type] {
+        type_list_.push_back(type);
+        auto index{static_cast<std::uint32_t>(std::size(type_list_))};
+        type_index_[type] = index;
+        return index;
+    }};
+
+    if (type->IsRecord()) {
+        auto index{add()};
+        for (const auto &member:type->members_) {
+            AddType(member.type_);
+        }
+        return index;
+    }
+
+    AddType(type->base_);
+    for (const auto &param:type->params_) {
+        AddType(param.type_);
+    }
+    return add();
+}
+
+template<typename T>
+std::uint32_t FlatAST::FlattenList(const ArenaList<T *> &list) {
+    std::vector<NodeIndex> elements;
+    elements.reserve(std::size(list));
+    for (auto element:list) {
+        elements.push_back(Flatten(element));
+    }
+    return AddList(elements);
+}
+
+// 按kind_分派, 先分配父节点, 再转换子节点, 所以父节点的下标总是小于子节点
+NodeIndex FlatAST::Flatten(const ASTNode *ast_node) {
+    if (!ast_node) {
+        return kNullNode;
+    }
+
+    auto kind{ast_node->kind_};
+    auto offset{ast_node->offset_};
+    switch (kind) {
+        case NodeKind::kDouble: {
+            auto floating{static_cast<const Double *>(ast_node)};
+            auto node{AddNode(kind, offset, floating->type_)};
+            std::uint64_t bits;
+            std::memcpy(&bits, &floating->value_, sizeof(bits));
+            SetOperand(node, 0, static_cast<std::uint32_t>(bits));
+            SetOperand(node, 1, static_cast<std::uint32_t>(bits >> 32u));
+            return node;
+        }
+        case NodeKind::kInteger: {
+            auto integer{static_cast<const Integer *>(ast_node)};
+            auto node{AddNode(kind, offset, integer->type_)};
+            SetOperand(node, 0, static_cast<std::uint32_t>(integer->value_));
+            SetOperand(node, 1, static_cast<std::uint32_t>(integer->value_ >> 32u));
+            return node;
+        }
+        case NodeKind::kString: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, AddSymbol(static_cast<const String *>(ast_node)->value_));
+            return node;
+        }
+        case NodeKind::kIdentifier: {
+            auto identifier{static_cast<const IdentifierOrType *>(ast_node)};
+            auto node{AddNode(kind, offset, nullptr, identifier->is_type_ ? kIsTypeFlag : 0)};
+            SetOperand(node, 0, AddSymbol(identifier->name_));
+            return node;
+        }
+        case NodeKind::kFunctionCall: {
+            auto call{static_cast<const FunctionCall *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(call->function_));
+            SetOperand(node, 1, FlattenList(call->args_));
+            return node;
+        }
+        case NodeKind::kBinaryOp:
+        case NodeKind::kAssignment: {
+            auto binary{static_cast<const BinaryOpExpression *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(binary->lhs_));
+            SetOperand(node, 1, Flatten(binary->rhs_));
+            SetOperand(node, 2, static_cast<std::uint32_t>(binary->op_));
+            return node;
+        }
+        case NodeKind::kUnaryOp: {
+            auto unary{static_cast<const UnaryOpExpression *>(ast_node)};
+            auto node{AddNode(kind, offset, nullptr, unary->postfix_ ? kPostfixFlag : 0)};
+            SetOperand(node, 0, Flatten(unary->operand_));
+            SetOperand(node, 1, static_cast<std::uint32_t>(unary->op_));
+            return node;
+        }
+        case NodeKind::kConditional: {
+            auto conditional{static_cast<const ConditionalExpression *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(conditional->condition_));
+            SetOperand(node, 1, Flatten(conditional->true_expression_));
+            SetOperand(node, 2, Flatten(conditional->false_expression_));
+            return node;
+        }
+        case NodeKind::kCast: {
+            auto cast{static_cast<const CastExpression *>(ast_node)};
+            auto node{AddNode(kind, offset, cast->type_)};
+            SetOperand(node, 0, Flatten(cast->expression_));
+            return node;
+        }
+        case NodeKind::kSizeof: {
+            auto size_of{static_cast<const SizeofExpression *>(ast_node)};
+            auto node{AddNode(kind, offset, size_of->type_)};
+            SetOperand(node, 0, Flatten(size_of->expression_));
+            return node;
+        }
+        case NodeKind::kMember: {
+            auto member{static_cast<const MemberExpression *>(ast_node)};
+            auto node{AddNode(kind, offset, nullptr, member->arrow_ ? kArrowFlag : 0)};
+            SetOperand(node, 0, Flatten(member->object_));
+            SetOperand(node, 1, AddSymbol(member->member_));
+            return node;
+        }
+        case NodeKind::kIndex: {
+            auto index{static_cast<const IndexExpression *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(index->array_));
+            SetOperand(node, 1, Flatten(index->index_));
+            return node;
+        }
+        case NodeKind::kInitializerList: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, FlattenList(static_cast<const InitializerList *>(ast_node)->elements_));
+            return node;
+        }
+        case NodeKind::kBlock: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, FlattenList(static_cast<const Block *>(ast_node)->statements_));
+            return node;
+        }
+        case NodeKind::kExpressionStatement: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(static_cast<const ExpressionStatement *>(ast_node)->expression_));
+            return node;
+        }
+        case NodeKind::kVariableDeclaration: {
+            auto variable{static_cast<const VariableDeclaration *>(ast_node)};
+            auto node{AddNode(kind, offset, variable->type_, static_cast<std::uint8_t>(variable->storage_))};
+            SetOperand(node, 0, AddSymbol(variable->variable_name_));
+            SetOperand(node, 1, Flatten(variable->initialization_expression_));
+            return node;
+        }
+        case NodeKind::kFunctionDeclaration: {
+            auto function{static_cast<const FunctionDeclaration *>(ast_node)};
+            auto flags{static_cast<std::uint8_t>(static_cast<std::uint8_t>(function->storage_) |
+                                                 (function->is_inline_ ? kInlineFlag : 0))};
+            auto node{AddNode(kind, offset, function->type_, flags)};
+            SetOperand(node, 0, AddSymbol(function->function_name_));
+            SetOperand(node, 1, FlattenList(function->args_));
+            SetOperand(node, 2, Flatten(function->body_));
+            return node;
+        }
+        case NodeKind::kIf: {
+            auto if_statement{static_cast<const IfStatenment *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(if_statement->condition_));
+            SetOperand(node, 1, Flatten(if_statement->then_statement_));
+            SetOperand(node, 2, Flatten(if_statement->else_statement_));
+            return node;
+        }
+        case NodeKind::kFor: {
+            auto for_statement{static_cast<const ForStatenment *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, FlattenList(for_statement->initial_));
+            auto condition{Flatten(for_statement->condition_)};
+            auto increment{Flatten(for_statement->increment_)};
+            SetOperand(node, 1, AddList({condition, increment, Flatten(for_statement->body_)}));
+            return node;
+        }
+        case NodeKind::kWhile: {
+            auto while_statement{static_cast<const WhileStatement *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(while_statement->condition_));
+            SetOperand(node, 1, Flatten(while_statement->body_));
+            return node;
+        }
+        case NodeKind::kDoWhile: {
+            auto do_while{static_cast<const DoWhileStatement *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(do_while->body_));
+            SetOperand(node, 1, Flatten(do_while->condition_));
+            return node;
+        }
+        case NodeKind::kSwitch: {
+            auto switch_statement{static_cast<const SwitchStatement *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(switch_statement->condition_));
+            SetOperand(node, 1, Flatten(switch_statement->body_));
+            return node;
+        }
+        case NodeKind::kCase: {
+            auto case_statement{static_cast<const CaseStatement *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(case_statement->value_));
+            SetOperand(node, 1, Flatten(case_statement->statement_));
+            return node;
+        }
+        case NodeKind::kLabel: {
+            auto label{static_cast<const LabelStatement *>(ast_node)};
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, AddSymbol(label->label_));
+            SetOperand(node, 1, Flatten(label->statement_));
+            return node;
+        }
+        case NodeKind::kGoto: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, AddSymbol(static_cast<const GotoStatement *>(ast_node)->label_));
+            return node;
+        }
+        case NodeKind::kBreak:
+        case NodeKind::kContinue:return AddNode(kind, offset);
+        case NodeKind::kReturn: {
+            auto node{AddNode(kind, offset)};
+            SetOperand(node, 0, Flatten(static_cast<const ReturnStatenment *>(ast_node)->expression_));
+            return node;
+        }
+        default:return kNullNode;
+    }
+}
+
+bool FlatAST::Write(const std::string &file_name, const Interner &interner) const {
+    std::unordered_map<const Type *, std::uint32_t> type_index;
+    for (std::size_t i{}; i < std::size(type_list_); ++i) {
+        type_index[type_list_[i]] = static_cast<std::uint32_t>(i + 1);
+    }
+    auto index_of{[&type_index](const Type *type) { return type ? type_index.at(type) : 0; }};
+
+    Writer writer;
+    for (auto type:type_list_) {
+        auto is_record{type->IsRecord()};
+        TypeRecord record{};
+        record.kind = static_cast<std::uint8_t>(type->kind_);
+        record.is_unsigned = type->unsigned_;
+        record.variadic = type->variadic_;
+        record.has_prototype = type->has_prototype_;
+        record.complete = type->complete_;
+        record.base = index_of(type->base_);
+        record.field_count = static_cast<std::uint32_t>(is_record ? std::size(type->members_)
+                                                                  : std::size(type->params_));
+        record.tag = writer.AddString(interner.GetSpelling(type->tag_));
+        record.length = type->length_;
+        record.size = type->size_;
+        record.align = type->align_;
+        writer.Put(record);
+
+        if (is_record) {
+            for (const auto &member:type->members_) {
+                writer.Put(FieldRecord{member.offset_, index_of(member.type_), member.bit_width_, member.bit_offset_,
+                                       member.bit_field_, {}, writer.AddString(interner.GetSpelling(member.name_))});
+            }
+        } else {
+            for (const auto &param:type->params_) {
+                writer.Put(FieldRecord{0, index_of(param.type_), 0, 0, 0, {},
+                                       writer.AddString(interner.GetSpelling(param.name_))});
+            }
+        }
+    }
+
+    for (auto symbol:symbols_) {
+        writer.Put(writer.AddString(interner.GetSpelling(symbol)));
+    }
+
+    auto node_count{std::size(kinds_)};
+    writer.PutArray(std::data(kinds_), node_count);
+    writer.PutArray(std::data(flags_), node_count);
+    writer.PutArray(std::data(offsets_), node_count);
+    writer.PutArray(std::data(types_), node_count);
+    for (const auto &operand:operands_) {
+        writer.PutArray(std::data(operand), node_count);
+    }
+    writer.PutArray(std::data(extra_), std::size(extra_));
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.node_count = static_cast<std::uint32_t>(node_count);
+    header.extra_count = static_cast<std::uint32_t>(std::size(extra_));
+    header.symbol_count = static_cast<std::uint32_t>(std::size(symbols_));
+    header.type_count = static_cast<std::uint32_t>(std::size(type_list_));
+    header.root = root_;
+    header.strings_size = static_cast<std::uint32_t>(std::size(writer.strings_));
+
+    return writer.Save(file_name, header);
+}
+
+// 文件中的任何计数和下标都不可信, 出错时保持原来的内容不变
+bool FlatAST::Load(const std::string &file_name, TypeTable &types, Interner &interner) {
+    MappedFile file{file_name};
+    if (!file.IsOpen()) {
+        return false;
+    }
+
+    auto buffer{file.GetBuffer()};
+    FileHeader header{};
+    if (std::size(buffer) < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, std::data(buffer), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.strings_size > std::size(buffer) - sizeof(header)) {
+        return false;
+    }
+
+    auto strings{buffer.substr(std::size(buffer) - header.strings_size)};
+    Reader reader{buffer.substr(sizeof(header), std::size(buffer) - sizeof(header) - header.strings_size),
+                  strings};
+
+    if (!reader.HasRoom(header.type_count, sizeof(TypeRecord))) {
+        return false;
+    }
+    std::vector<TypeRecord> records(header.type_count);
+    std::vector<std::vector<FieldRecord>> fields(header.type_count);
+    for (std::uint32_t i{}; i < header.type_count; ++i) {
+        if (!reader.Get(records[i]) || records[i].kind > static_cast<std::uint8_t>(TypeKind::kUnion) ||
+            !reader.HasRoom(records[i].field_count, sizeof(FieldRecord))) {
+            return false;
+        }
+        fields[i].resize(records[i].field_count);
+        if (!reader.GetArray(std::data(fields[i]), records[i].field_count)) {
+            return false;
+        }
+    }
+
+    FlatAST ast;
+    if (!reader.HasRoom(header.symbol_count, sizeof(StringRef))) {
+        return false;
+    }
+    for (std::uint32_t i{}; i < header.symbol_count; ++i) {
+        StringRef ref{};
+        std::string_view spelling;
+        if (!reader.Get(ref) || !reader.GetString(ref, spelling)) {
+            return false;
+        }
+        ast.symbols_.push_back(interner.Intern(spelling));
+    }
+
+    auto node_count{header.node_count};
+    if (node_count == 0 || !reader.HasRoom(node_count, sizeof(NodeKind) + sizeof(std::uint8_t) +
+                                                       sizeof(std::uint32_t) * 5)) {
+        return false;
+    }
+    ast.kinds_.resize(node_count);
+    ast.flags_.resize(node_count);
+    ast.offsets_.resize(node_count);
+    ast.types_.resize(node_count);
+    for (auto &operand:ast.operands_) {
+        operand.resize(node_count);
+    }
+    if (!reader.GetArray(std::data(ast.kinds_), node_count) || !reader.GetArray(std::data(ast.flags_), node_count) ||
+        !reader.GetArray(std::data(ast.offsets_), node_count) || !reader.GetArray(std::data(ast.types_), node_count)) {
+        return false;
+    }
+    for (auto &operand:ast.operands_) {
+        if (!reader.GetArray(std::data(operand), node_count)) {
+            return false;
+        }
+    }
+    if (!reader.HasRoom(header.extra_count, sizeof(std::uint32_t))) {
+        return false;
+    }
+    ast.extra_.resize(header.extra_count);
+    if (!reader.GetArray(std::data(ast.extra_), header.extra_count)) {
+        return false;
+    }
+    ast.root_ = header.root;
+    ast.type_list_.resize(header.type_count);
+    if (!ast.Validate()) {
+        return false;
+    }
+
+    // 类型之间的引用也要检查, 全部通过之后才在types中创建, 避免留下一半的类型
+    // 结构体/联合和枚举可以被前面的类型引用, 其余的类型只能引用前面的类型
+    auto is_tagged{[](const TypeRecord &record) {
+        auto kind{static_cast<TypeKind>(record.kind)};
+        return kind == TypeKind::kStruct || kind == TypeKind::kUnion || kind == TypeKind::kEnum;
+    }};
+    for (std::uint32_t i{}; i < header.type_count; ++i) {
+        auto kind{static_cast<TypeKind>(records[i].kind)};
+        auto is_derived{kind == TypeKind::kPointer || kind == TypeKind::kArray || kind == TypeKind::kFunction};
+        auto reference_ok{[&](std::uint32_t type) {
+            return type != 0 && type <= header.type_count &&
+                   (type - 1 < i || is_tagged(records[type - 1]) || is_tagged(records[i]));
+        }};
+        std::string_view spelling;
+        if (is_derived != (records[i].base != 0) || (is_derived && !reference_ok(records[i].base)) ||
+            !reader.GetString(records[i].tag, spelling)) {
+            return false;
+        }
+        for (const auto &field:fields[i]) {
+            if (!reference_ok(field.type) || !reader.GetString(field.name, spelling)) {
+                return false;
+            }
+        }
+    }
+
+    auto &type_list{ast.type_list_};
+    std::vector<Type *> records_to_complete(header.type_count);
+    for (std::uint32_t i{}; i < header.type_count; ++i) {
+        if (is_tagged(records[i])) {
+            std::string_view tag;
+            reader.GetString(records[i].tag, tag);
+            auto kind{static_cast<TypeKind>(records[i].kind)};
+            auto type{kind == TypeKind::kEnum ? types.NewEnum(interner.Intern(tag))
+                                              : types.NewRecord(kind, interner.Intern(tag))};
+            type_list[i] = type;
+            records_to_complete[i] = type;
+        }
+    }
+    auto name_of{[&](StringRef ref) {
+        std::string_view name;
+        reader.GetString(ref, name);
+        return interner.Intern(name);
+    }};
+    for (std::uint32_t i{}; i < header.type_count; ++i) {
+        const auto &record{records[i]};
+        auto kind{static_cast<TypeKind>(record.kind)};
+        if (is_tagged(record)) {
+            continue;
+        }
+        if (kind == TypeKind::kPointer) {
+            type_list[i] = types.GetPointer(type_list[record.base - 1]);
+        } else if (kind == TypeKind::kArray) {
+            type_list[i] = types.GetArray(type_list[record.base - 1], record.length);
+        } else if (kind == TypeKind::kFunction) {
+            std::vector<Parameter> params;
+            for (const auto &field:fields[i]) {
+                params.push_back({type_list[field.type - 1], name_of(field.name)});
+            }
+            type_list[i] = types.GetFunction(type_list[record.base - 1], std::move(params), record.variadic,
+                                             record.has_prototype);
+        } else {
+            type_list[i] = types.GetBasic(kind, record.is_unsigned);
+        }
+    }
+    for (std::uint32_t i{}; i < header.type_count; ++i) {
+        auto type{records_to_complete[i]};
+        if (!type) {
+            continue;
+        }
+        for (const auto &field:fields[i]) {
+            Member member{type_list[field.type - 1], name_of(field.name)};
+            member.offset_ = field.offset;
+            member.bit_field_ = field.bit_field;
+            member.bit_width_ = field.bit_width;
+            member.bit_offset_ = field.bit_offset;
+            type->members_.push_back(member);
+        }
+        type->complete_ = records[i].complete;
+        type->size_ = records[i].size;
+        type->align_ = records[i].align;
+    }
+
+    *this = std::move(ast);
+    return true;
+}
+
+// 子节点的下标必须大于父节点, 这保证了树中没有环
+bool FlatAST::Validate() const {
+    auto node_count{std::size(kinds_)};
+    if (node_count == 0 || kinds_[0] != NodeKind::kNull || root_ >= node_count) {
+        return false;
+    }
+
+    for (std::size_t node{}; node < node_count; ++node) {
+        if (kinds_[node] >= NodeKind::kEnd || types_[node] > std::size(type_list_)) {
+            return false;
+        }
+        auto child_ok{[node, node_count](std::uint32_t child) {
+            return child == kNullNode || (child > node && child < node_count);
+        }};
+
+        const auto &layout{GetNodeLayout(kinds_[node])};
+        for (std::size_t i{}; i < std::size(layout.operands_); ++i) {
+            auto operand{operands_[i][node]};
+            switch (layout.operands_[i]) {
+                case OperandKind::kNode:
+                    if (!child_ok(operand)) {
+                        return false;
+                    }
+                    break;
+                case OperandKind::kList:
+                    if (operand >= std::size(extra_) || extra_[operand] > std::size(extra_) - operand - 1) {
+                        return false;
+                    }
+                    for (auto iter{ListBegin(static_cast<NodeIndex>(node), i)};
+                         iter != ListEnd(static_cast<NodeIndex>(node), i); ++iter) {
+                        if (!child_ok(*iter)) {
+                            return false;
+                        }
+                    }
+                    break;
+                case OperandKind::kSymbol:
+                    if (operand >= std::size(symbols_)) {
+                        return false;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    return true;
+}
+
+void FlatAST::Dump(std::ostream &os, const Interner &interner) const {
+    DumpNode(os, interner, root_, 0);
+}
+
+// 每个节点一行, 子节点缩进两格, 空的子节点输出为Null
+void FlatAST::DumpNode(std::ostream &os, const Interner &interner, NodeIndex node, std::size_t depth) const {
+    static constexpr std::string_view kStorage[]{"", "typedef", "extern", "static", "auto", "register"};
+
+    auto kind{kinds_[node]};
+    const auto &layout{GetNodeLayout(kind)};
+    os << std::string(depth * 2, ' ') << layout.name_;
+
+    switch (kind) {
+        case NodeKind::kInteger:os << ' ' << GetInteger(node);
+            break;
+        case NodeKind::kDouble:os << ' ' << GetDouble(node);
+            break;
+        case NodeKind::kString:os << " \"" << interner.GetSpelling(GetSymbol(node, 0)) << '"';
+            break;
+        case NodeKind::kBinaryOp:
+        case NodeKind::kAssignment:os << ' ' << Dictionary{}.GetSpelling(static_cast<TokenValue>(GetOperand(node, 2)));
+            break;
+        case NodeKind::kUnaryOp:os << ' ' << Dictionary{}.GetSpelling(static_cast<TokenValue>(GetOperand(node, 1)))
+                                   << (GetFlags(node) & kPostfixFlag ? " postfix" : "");
+            break;
+        case NodeKind::kMember:os << (GetFlags(node) & kArrowFlag ? " ->" : " .");
+            break;
+        case NodeKind::kVariableDeclaration:
+        case NodeKind::kFunctionDeclaration: {
+            auto storage{GetFlags(node) & 7u};
+            if (storage != 0 && storage < std::size(kStorage)) {
+                os << ' ' << kStorage[storage];
+            }
+            if (GetFlags(node) & kInlineFlag) {
+                os << " inline";
+            }
+            break;
+        }
+        default:break;
+    }
+
+    if (kind != NodeKind::kString) {
+        for (std::size_t i{}; i < std::size(layout.operands_); ++i) {
+            if (layout.operands_[i] == OperandKind::kSymbol) {
+                os << ' ' << interner.GetSpelling(GetSymbol(node, i));
+            }
+        }
+    }
+    if (auto type{GetType(node)}) {
+        os << " : " << TypeName(type, interner);
+    }
+    os << '\n';
+
+    for (std::size_t i{}; i < std::size(layout.operands_); ++i) {
+        if (layout.operands_[i] == OperandKind::kNode) {
+            DumpNode(os, interner, GetOperand(node, i), depth + 1);
+        } else if (layout.operands_[i] == OperandKind::kList) {
+            for (auto iter{ListBegin(node, i)}; iter != ListEnd(node, i); ++iter) {
+                DumpNode(os, interner, *iter, depth + 1);
+            }
+        }
+    }
+}
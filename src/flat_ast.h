@@ -0,0 +1,114 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_FLAT_AST_H
+#define TINY_C_COMPILER_FLAT_AST_H
+
+#include "ast.h"
+#include "interner.h"
+#include "type.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 节点在表中的下标, 0号节点是kNull, 表示空的子节点
+using NodeIndex = std::uint32_t;
+inline constexpr NodeIndex kNullNode{0};
+
+// 每个节点有三个32位的操作数, 它们的含义由节点的种类决定
+enum class OperandKind : std::uint8_t {
+    kNone,
+    // 子节点的下标
+    kNode,
+    // 列表在extra_中的位置, extra_[i]是元素个数, 之后是各个元素的下标
+    kList,
+    // 符号在symbols_中的下标
+    kSymbol,
+    // 整数值, 运算符或者浮点数的一半
+    kValue
+};
+
+struct NodeLayout {
+    std::string_view name_;
+    OperandKind operands_[3];
+};
+
+// 各种节点的操作数, 所有按节点遍历的代码都由这张表驱动
+const NodeLayout &GetNodeLayout(NodeKind kind);
+
+// 数据导向的语法树, 与ast.h中的语法树等价, 是可选的另一种表示
+// 节点按列保存(结构体数组), 子节点用32位下标引用, 整棵树中没有指针, 可以整块写入文件再读回
+// 节点的类型是types_中的下标加一, 0表示没有类型, 标志位保存存储类, 后缀运算符等
+//   Integer/Double         类型, 值的低32位, 值的高32位
+//   FunctionCall           被调用者, 实参列表
+//   BinaryOp/Assignment    左操作数, 右操作数, 运算符
+//   UnaryOp                操作数, 运算符                   标志位为1时是后缀运算符
+//   For                    初始化列表, {条件, 增量, 循环体}的列表
+//   VariableDeclaration    类型, 名字, 初始化表达式          标志位为存储类
+//   FunctionDeclaration    类型, 名字, 形参列表, 函数体        标志位为存储类, 内联时加8
+class FlatAST {
+public:
+    FlatAST();
+
+    // 从指针形式的语法树转换, 节点按前序排列, 父节点总在子节点之前
+    explicit FlatAST(const Block &root);
+
+    NodeIndex GetRoot() const;
+    std::size_t GetNodeCount() const;
+    // 所有表占用的字节数
+    std::size_t GetBytes() const;
+
+    NodeKind GetKind(NodeIndex node) const;
+    std::uint8_t GetFlags(NodeIndex node) const;
+    std::uint32_t GetOffset(NodeIndex node) const;
+    const Type *GetType(NodeIndex node) const;
+    std::uint32_t GetOperand(NodeIndex node, std::size_t index) const;
+    SymbolId GetSymbol(NodeIndex node, std::size_t index) const;
+    std::uint64_t GetInteger(NodeIndex node) const;
+    double GetDouble(NodeIndex node) const;
+    // 列表操作数的元素
+    const NodeIndex *ListBegin(NodeIndex node, std::size_t index) const;
+    const NodeIndex *ListEnd(NodeIndex node, std::size_t index) const;
+
+    // 文件中的类型和符号是自包含的, 读入时在types和interner中重新创建, 节点表不需要任何修改
+    bool Write(const std::string &file_name, const Interner &interner = Interner::Global()) const;
+    bool Load(const std::string &file_name, TypeTable &types, Interner &interner = Interner::Global());
+
+    // 每个节点输出一行, 子节点缩进, 用于调试和测试
+    void Dump(std::ostream &os, const Interner &interner = Interner::Global()) const;
+private:
+    NodeIndex AddNode(NodeKind kind, std::uint32_t offset, const Type *type = nullptr, std::uint8_t flags = 0);
+    void SetOperand(NodeIndex node, std::size_t index, std::uint32_t value);
+    std::uint32_t AddList(const std::vector<NodeIndex> &elements);
+    std::uint32_t AddSymbol(SymbolId symbol);
+    std::uint32_t AddType(const Type *type);
+
+    NodeIndex Flatten(const ASTNode *ast_node);
+    template<typename T>
+    std::uint32_t FlattenList(const ArenaList<T *> &list);
+
+    bool Validate() const;
+    void DumpNode(std::ostream &os, const Interner &interner, NodeIndex node, std::size_t depth) const;
+
+    std::vector<NodeKind> kinds_;
+    std::vector<std::uint8_t> flags_;
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::uint32_t> types_;
+    std::vector<std::uint32_t> operands_[3];
+    std::vector<std::uint32_t> extra_;
+    NodeIndex root_{kNullNode};
+
+    std::vector<SymbolId> symbols_;
+    std::vector<const Type *> type_list_;
+    // 只在转换时使用, 合并相同的符号和类型
+    std::unordered_map<SymbolId, std::uint32_t> symbol_index_;
+    std::unordered_map<const Type *, std::uint32_t> type_index_;
+};
+
+#endif //TINY_C_COMPILER_FLAT_AST_H
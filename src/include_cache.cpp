@@ -0,0 +1,235 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "include_cache.h"
+
+#include <sys/stat.h>
+
+#include <filesystem>
+#include <mutex>
+
+namespace {
+
+// 删除续行, 被删除的换行补在逻辑行的末尾, 这样之后的行号保持不变
+std::string RemoveLineSplices(std::string_view input) {
+    std::string result;
+    result.reserve(std::size(input));
+    std::size_t pending_newlines{};
+
+    for (std::size_t i{}; i < std::size(input); ++i) {
+        auto c{input[i]};
+        if (c == '\\' && i + 1 < std::size(input) && input[i + 1] == '\n') {
+            ++i;
+            ++pending_newlines;
+        } else if (c == '\\' && i + 2 < std::size(input) && input[i + 1] == '\r' &&
+                   input[i + 2] == '\n') {
+            i += 2;
+            ++pending_newlines;
+        } else if (c == '\n') {
+            result.append(pending_newlines + 1, '\n');
+            pending_newlines = 0;
+        } else {
+            result.push_back(c);
+        }
+    }
+    result.append(pending_newlines, '\n');
+    return result;
+}
+
+bool HasLineSplice(std::string_view input) {
+    for (auto pos{input.find('\\')}; pos != std::string_view::npos; pos = input.find('\\', pos + 1)) {
+        if (pos + 1 < std::size(input) && (input[pos + 1] == '\n' || input[pos + 1] == '\r')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GetFileStatus(const std::string &path, std::int64_t &modify_time, std::int64_t &size) {
+    struct stat st{};
+    if (stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    modify_time = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    size = static_cast<std::int64_t>(st.st_size);
+    return true;
+}
+
+}
+
+SourceFile::SourceFile(const std::string &path, Interner &interner) : name_{path} {
+    if (!GetFileStatus(path, modify_time_, size_)) {
+        return;
+    }
+
+    file_ = MappedFile{path};
+    if (!file_.IsOpen()) {
+        return;
+    }
+    is_open_ = true;
+
+    Tokenize(file_.GetBuffer(), interner);
+}
+
+SourceFile::SourceFile(const std::string &name, std::string_view input, Interner &interner) :
+        name_{name}, is_open_{true} {
+    Tokenize(input, interner);
+}
+
+bool SourceFile::IsOpen() const {
+    return is_open_;
+}
+
+void SourceFile::Tokenize(std::string_view input, Interner &interner) {
+    if (HasLineSplice(input)) {
+        text_ = RemoveLineSplices(input);
+        input = text_;
+    } else if (!file_.IsOpen()) {
+        // 调用者的缓冲区不一定一直有效
+        text_ = input;
+        input = text_;
+    }
+
+    PPTokenize(input, interner, tokens_, &error_);
+    DetectGuard();
+}
+
+void SourceFile::DetectGuard() {
+    const auto &tokens{tokens_};
+    auto size{std::size(tokens)};
+    auto is_directive{[&tokens, size](std::size_t i) {
+        return i + 1 < size && tokens[i].begin_of_line_ && tokens[i].Is("#") && !tokens[i + 1].begin_of_line_;
+    }};
+    auto is_line_end{[&tokens, size](std::size_t i) {
+        return i == size || tokens[i].begin_of_line_;
+    }};
+
+    // 文件开头必须是 #ifndef X 或者 #if !defined X / #if !defined(X)
+    if (!is_directive(0)) {
+        return;
+    }
+
+    SymbolId guard{kEmptySymbol};
+    std::size_t i{};
+    if (tokens[1].Is("ifndef") && 2 < size && tokens[2].kind_ == PPTokenKind::kIdentifier && is_line_end(3)) {
+        guard = tokens[2].symbol_;
+        i = 3;
+    } else if (tokens[1].Is("if") && 4 < size && tokens[2].Is("!") && tokens[3].Is("defined")) {
+        bool paren{tokens[4].Is("(")};
+        auto name{4 + static_cast<std::size_t>(paren)};
+        if (name < size && tokens[name].kind_ == PPTokenKind::kIdentifier &&
+            (!paren || (name + 1 < size && tokens[name + 1].Is(")"))) && is_line_end(name + 1 + paren)) {
+            guard = tokens[name].symbol_;
+            i = name + 1 + paren;
+        }
+    }
+    if (guard == kEmptySymbol) {
+        return;
+    }
+
+    // 与开头的#if配对的#endif之后不能再有任何记号
+    std::int32_t depth{};
+    for (; i < size; ++i) {
+        if (!is_directive(i)) {
+            continue;
+        }
+
+        const auto &name{tokens[i + 1]};
+        if (name.Is("if") || name.Is("ifdef") || name.Is("ifndef")) {
+            ++depth;
+        } else if ((name.Is("else") || name.Is("elif")) && depth == 0) {
+            return;
+        } else if (name.Is("endif")) {
+            if (depth-- == 0) {
+                auto j{i + 2};
+                while (!is_line_end(j)) {
+                    ++j;
+                }
+                if (j == size) {
+                    guard_ = guard;
+                }
+                return;
+            }
+        }
+    }
+}
+
+IncludeCache::IncludeCache(Interner &interner) : interner_{interner} {}
+
+std::shared_ptr<const SourceFile> IncludeCache::Load(const std::string &path) {
+    std::int64_t modify_time, size;
+    if (!GetFileStatus(path, modify_time, size)) {
+        return nullptr;
+    }
+
+    // 相对路径按当前目录展开后作为键, 常驻的编译服务在不同的目录中编译时不会混淆
+    auto key{path};
+    if (std::filesystem::path file_path{path}; file_path.is_relative()) {
+        std::error_code error_code;
+        if (auto absolute{std::filesystem::absolute(file_path, error_code)}; !error_code) {
+            key = absolute.lexically_normal().string();
+        }
+    }
+
+    if (auto file{Find(key)}; file && file->modify_time_ == modify_time && file->size_ == size) {
+        ++hits_;
+        return file;
+    }
+
+    // 在锁外读取和切分, 两个线程同时读取同一个文件时后插入的覆盖先插入的, 结果相同
+    ++misses_;
+    auto file{std::make_shared<const SourceFile>(path, interner_)};
+    if (!file->IsOpen()) {
+        return nullptr;
+    }
+    return Insert(key, std::move(file));
+}
+
+std::shared_ptr<const SourceFile> IncludeCache::LoadBuffer(const std::string &name, std::string_view input) {
+    if (auto file{Find(name)}) {
+        ++hits_;
+        return file;
+    }
+
+    ++misses_;
+    return Insert(name, std::make_shared<const SourceFile>(name, input, interner_));
+}
+
+void IncludeCache::Clear() {
+    std::unique_lock lock{mutex_};
+    files_.clear();
+}
+
+Interner &IncludeCache::GetInterner() const {
+    return interner_;
+}
+
+std::size_t IncludeCache::GetHits() const {
+    return hits_;
+}
+
+std::size_t IncludeCache::GetMisses() const {
+    return misses_;
+}
+
+IncludeCache &IncludeCache::Global() {
+    static IncludeCache cache;
+    return cache;
+}
+
+std::shared_ptr<const SourceFile> IncludeCache::Find(const std::string &path) const {
+    std::shared_lock lock{mutex_};
+    if (auto iter{files_.find(path)}; iter != std::end(files_)) {
+        return iter->second;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const SourceFile> IncludeCache::Insert(const std::string &key,
+                                                       std::shared_ptr<const SourceFile> file) {
+    std::unique_lock lock{mutex_};
+    auto &slot{files_[key]};
+    slot = std::move(file);
+    return slot;
+}
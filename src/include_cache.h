@@ -0,0 +1,81 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_INCLUDE_CACHE_H
+#define TINY_C_COMPILER_INCLUDE_CACHE_H
+
+#include "pp_token.h"
+#include "mapped_file.h"
+#include "interner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 已经切分成预处理记号的源文件, 记号引用文件的缓冲区, 创建之后不再修改
+class SourceFile {
+public:
+    // 映射并切分磁盘上的文件, 打不开时IsOpen()返回false
+    SourceFile(const std::string &path, Interner &interner);
+    // 内存中的文本, 例如内置头文件和预定义宏
+    SourceFile(const std::string &name, std::string_view input, Interner &interner);
+
+    bool IsOpen() const;
+
+    std::string name_;
+    std::vector<PPToken> tokens_;
+    // 切分时的错误, 每次使用这个文件都要报告
+    std::string error_;
+    // 整个文件被 #ifndef X / #endif 包围时为X, 再次包含时如果X已经定义就可以直接跳过
+    SymbolId guard_{kEmptySymbol};
+    std::int64_t modify_time_{};
+    std::int64_t size_{};
+private:
+    void Tokenize(std::string_view input, Interner &interner);
+    void DetectGuard();
+
+    bool is_open_{false};
+    MappedFile file_;
+    // 去掉续行之后的文本
+    std::string text_;
+};
+
+// 整个进程共享的头文件缓存, 以路径为键, 文件的修改时间或大小改变之后重新读取
+// 多个文件一起编译时, 每个头文件只读取和切分一次
+class IncludeCache {
+public:
+    explicit IncludeCache(Interner &interner = Interner::Global());
+
+    IncludeCache(const IncludeCache &) = delete;
+    IncludeCache &operator=(const IncludeCache &) = delete;
+
+    // 文件不存在或者无法读取时返回nullptr
+    std::shared_ptr<const SourceFile> Load(const std::string &path);
+    // 内容不会改变的内存中的文件, 只在第一次使用时切分
+    std::shared_ptr<const SourceFile> LoadBuffer(const std::string &name, std::string_view input);
+    void Clear();
+
+    Interner &GetInterner() const;
+    std::size_t GetHits() const;
+    std::size_t GetMisses() const;
+
+    static IncludeCache &Global();
+private:
+    std::shared_ptr<const SourceFile> Find(const std::string &path) const;
+    std::shared_ptr<const SourceFile> Insert(const std::string &key, std::shared_ptr<const SourceFile> file);
+
+    Interner &interner_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const SourceFile>> files_;
+    std::atomic<std::size_t> hits_{};
+    std::atomic<std::size_t> misses_{};
+};
+
+#endif //TINY_C_COMPILER_INCLUDE_CACHE_H
@@ -0,0 +1,183 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "interner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr std::size_t kInitialSlotCount{1024};
+constexpr std::size_t kChunkSize{64 * 1024};
+constexpr std::size_t kCacheSize{1024};
+
+// 线程安全模式下每个线程在加锁之前先查这个直接映射的缓存
+// 已驻留的拼写和编号永远不会改变, 因此缓存的内容不会失效
+// 以每个Interner唯一的代号区分, 销毁后在同一地址上创建的Interner不会命中旧的项
+struct CacheEntry {
+    std::uint64_t generation;
+    std::string_view spelling;
+    SymbolId id;
+};
+
+thread_local CacheEntry cache[kCacheSize]{};
+
+// 代号从1开始, 0表示空的缓存项
+std::atomic<std::uint64_t> next_generation{1};
+
+}
+
+Interner::Interner(bool thread_safe) :
+        thread_safe_{thread_safe}, generation_{next_generation++}, slots_(kInitialSlotCount) {
+    Insert("", Hash(""));
+}
+
+SymbolId Interner::Intern(std::string_view spelling) {
+    auto hash{Hash(spelling)};
+
+    if (thread_safe_) {
+        auto &entry{cache[hash & (kCacheSize - 1)]};
+        if (entry.generation == generation_ && entry.spelling == spelling) {
+            return entry.id;
+        }
+
+        {
+            std::shared_lock lock{mutex_};
+            if (auto slot{FindSlot(spelling, hash)}; slot->id_ != 0) {
+                auto id{slot->id_ - 1};
+                entry = {generation_, spellings_[id], id};
+                return id;
+            }
+        }
+
+        std::unique_lock lock{mutex_};
+        auto id{Insert(spelling, hash)};
+        entry = {generation_, spellings_[id], id};
+        return id;
+    } else {
+        return Insert(spelling, hash);
+    }
+}
+
+bool Interner::Find(std::string_view spelling, SymbolId &id) const {
+    auto hash{Hash(spelling)};
+
+    std::shared_lock lock{mutex_, std::defer_lock};
+    if (thread_safe_) {
+        lock.lock();
+    }
+
+    if (auto slot{FindSlot(spelling, hash)}; slot->id_ != 0) {
+        id = slot->id_ - 1;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+std::string_view Interner::GetSpelling(SymbolId id) const {
+    std::shared_lock lock{mutex_, std::defer_lock};
+    if (thread_safe_) {
+        lock.lock();
+    }
+
+    return GetSpellingUnlocked(id);
+}
+
+std::size_t Interner::GetSize() const {
+    std::shared_lock lock{mutex_, std::defer_lock};
+    if (thread_safe_) {
+        lock.lock();
+    }
+
+    return std::size(spellings_);
+}
+
+std::string_view Interner::GetSpellingUnlocked(SymbolId id) const {
+    return id < std::size(spellings_) ? spellings_[id] : std::string_view{};
+}
+
+Interner &Interner::Global() {
+    static Interner interner{true};
+    return interner;
+}
+
+// FNV-1a
+std::uint32_t Interner::Hash(std::string_view spelling) {
+    std::uint32_t hash{2166136261u};
+    for (auto c:spelling) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 返回已有的槽或者应当插入的空槽
+const Interner::Slot *Interner::FindSlot(std::string_view spelling, std::uint32_t hash) const {
+    auto mask{std::size(slots_) - 1};
+    for (auto index{hash & mask};; index = (index + 1) & mask) {
+        const auto &slot{slots_[index]};
+        if (slot.id_ == 0 || (slot.hash_ == hash && spellings_[slot.id_ - 1] == spelling)) {
+            return &slot;
+        }
+    }
+}
+
+SymbolId Interner::Insert(std::string_view spelling, std::uint32_t hash) {
+    auto slot{const_cast<Slot *>(FindSlot(spelling, hash))};
+    if (slot->id_ != 0) {
+        return slot->id_ - 1;
+    }
+
+    auto id{static_cast<SymbolId>(std::size(spellings_))};
+    spellings_.push_back(Store(spelling));
+    *slot = {hash, id + 1};
+
+    // 装载因子不超过1/2
+    if (std::size(spellings_) * 2 > std::size(slots_)) {
+        Grow();
+    }
+    return id;
+}
+
+std::string_view Interner::Store(std::string_view spelling) {
+    auto size{std::size(spelling)};
+    if (size == 0) {
+        return {};
+    }
+
+    if (size > chunk_left_) {
+        auto chunk_size{std::max(kChunkSize, size)};
+        chunks_.push_back(std::make_unique<char[]>(chunk_size));
+        chunk_current_ = chunks_.back().get();
+        chunk_left_ = chunk_size;
+    }
+
+    std::memcpy(chunk_current_, std::data(spelling), size);
+    std::string_view stored{chunk_current_, size};
+    chunk_current_ += size;
+    chunk_left_ -= size;
+    return stored;
+}
+
+void Interner::Grow() {
+    std::vector<Slot> slots(std::size(slots_) * 2);
+    auto mask{std::size(slots) - 1};
+
+    for (const auto &slot:slots_) {
+        if (slot.id_ == 0) {
+            continue;
+        }
+        auto index{slot.hash_ & mask};
+        while (slots[index].id_ != 0) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = slot;
+    }
+
+    slots_ = std::move(slots);
+}
@@ -0,0 +1,64 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_INTERNER_H
+#define TINY_C_COMPILER_INTERNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+// 每个不同的拼写对应一个稳定的32位编号, 比较名字只需要比较编号
+using SymbolId = std::uint32_t;
+
+// 编号0总是对应空字符串
+inline constexpr SymbolId kEmptySymbol{0};
+
+// 所有拼写只在内部的内存池中保存一次, 返回的std::string_view在Interner的生命周期内一直有效
+class Interner {
+public:
+    explicit Interner(bool thread_safe = false);
+
+    Interner(const Interner &) = delete;
+    Interner &operator=(const Interner &) = delete;
+
+    SymbolId Intern(std::string_view spelling);
+    // 只查找, 不存在时返回false
+    bool Find(std::string_view spelling, SymbolId &id) const;
+    std::string_view GetSpelling(SymbolId id) const;
+    std::size_t GetSize() const;
+
+    // 整个进程共享的线程安全的实例
+    static Interner &Global();
+private:
+    struct Slot {
+        std::uint32_t hash_;
+        SymbolId id_;
+    };
+
+    static std::uint32_t Hash(std::string_view spelling);
+    std::string_view GetSpellingUnlocked(SymbolId id) const;
+    const Slot *FindSlot(std::string_view spelling, std::uint32_t hash) const;
+    SymbolId Insert(std::string_view spelling, std::uint32_t hash);
+    std::string_view Store(std::string_view spelling);
+    void Grow();
+
+    bool thread_safe_;
+    // 进程内唯一, 用作线程局部缓存的键
+    std::uint64_t generation_;
+    mutable std::shared_mutex mutex_;
+
+    // 开放定址的散列表, 槽中保存编号加一, 0表示空槽
+    std::vector<Slot> slots_;
+    std::vector<std::string_view> spellings_;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char *chunk_current_{nullptr};
+    std::size_t chunk_left_{};
+};
+
+#endif //TINY_C_COMPILER_INTERNER_H
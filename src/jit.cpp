@@ -0,0 +1,65 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "jit.h"
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+bool ReportError(llvm::Error error) {
+    std::cerr << "error: " << llvm::toString(std::move(error)) << '\n';
+    return false;
+}
+
+}
+
+bool RunObjects(const std::vector<const ObjectFile *> &objects, const std::vector<std::string> &args,
+                int &exit_code) {
+    auto jit{llvm::orc::LLJITBuilder{}.create()};
+    if (!jit) {
+        return ReportError(jit.takeError());
+    }
+
+    auto &main_dylib{(*jit)->getMainJITDylib()};
+    auto generator{llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            (*jit)->getDataLayout().getGlobalPrefix())};
+    if (!generator) {
+        return ReportError(generator.takeError());
+    }
+    main_dylib.addGenerator(std::move(*generator));
+
+    // 目标文件的内容由调用者持有, 执行结束之前不会释放
+    for (const auto &object:objects) {
+        auto buffer{llvm::MemoryBuffer::getMemBuffer({std::data(object->data_), std::size(object->data_)},
+                                                     object->name_, false)};
+        if (auto error{(*jit)->addObjectFile(std::move(buffer))}) {
+            return ReportError(std::move(error));
+        }
+    }
+
+    auto main_symbol{(*jit)->lookup("main")};
+    if (!main_symbol) {
+        return ReportError(main_symbol.takeError());
+    }
+
+    std::vector<char *> argv;
+    std::vector<std::string> arg_storage{args};
+    for (auto &arg:arg_storage) {
+        argv.push_back(std::data(arg));
+    }
+    argv.push_back(nullptr);
+
+    auto main_function{llvm::jitTargetAddressToFunction<int (*)(int, char **)>(main_symbol->getAddress())};
+    exit_code = main_function(static_cast<int>(std::size(args)), std::data(argv));
+    std::fflush(nullptr);
+    return true;
+}
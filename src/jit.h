@@ -0,0 +1,19 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_JIT_H
+#define TINY_C_COMPILER_JIT_H
+
+#include "linker.h"
+
+#include <string>
+#include <vector>
+
+// 用ORC LLJIT把内存中的目标文件加载到本进程中, 外部符号(C库)从本进程中查找, 然后直接调用main
+// 不写文件, 不调用链接器, 也不创建子进程; 程序调用exit时整个进程结束
+// args是程序的argv, 加载失败或者没有main时输出错误并返回false
+bool RunObjects(const std::vector<const ObjectFile *> &objects, const std::vector<std::string> &args,
+                int &exit_code);
+
+#endif //TINY_C_COMPILER_JIT_H
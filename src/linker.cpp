@@ -0,0 +1,145 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "linker.h"
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+extern char **environ;
+
+namespace {
+
+bool WriteAll(int fd, const ObjectFile &object) {
+    auto data{std::data(object.data_)};
+    auto size{std::size(object.data_)};
+    while (size != 0) {
+        auto written{write(fd, data, size)};
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// 传给子进程的目标文件, 析构时关闭memfd或者删除临时文件
+class ObjectInput {
+public:
+    ObjectInput() = default;
+    ObjectInput(const ObjectInput &) = delete;
+    ObjectInput &operator=(const ObjectInput &) = delete;
+
+    ~ObjectInput() {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        if (!std::empty(temp_file_)) {
+            std::error_code error_code;
+            std::filesystem::remove(temp_file_, error_code);
+        }
+    }
+
+    bool Open(const ObjectFile &object) {
+        // 没有MFD_CLOEXEC, 子进程继承这个描述符
+        fd_ = memfd_create("tcc-object", 0);
+        if (fd_ >= 0) {
+            path_ = "/proc/self/fd/" + std::to_string(fd_);
+            return WriteAll(fd_, object);
+        }
+
+        auto directory{std::filesystem::temp_directory_path()};
+        std::string pattern{(directory / "tcc-XXXXXX.o").string()};
+        fd_ = mkstemps(std::data(pattern), 2);
+        if (fd_ < 0) {
+            return false;
+        }
+        temp_file_ = path_ = pattern;
+        return WriteAll(fd_, object);
+    }
+
+    const std::string &GetPath() const {
+        return path_;
+    }
+private:
+    int fd_{-1};
+    std::string path_;
+    std::string temp_file_;
+};
+
+// 等待子进程结束, 返回它是否正常退出并且返回0
+bool Spawn(std::vector<std::string> args, std::ostream &diagnostics) {
+    std::vector<char *> argv;
+    for (auto &arg:args) {
+        argv.push_back(std::data(arg));
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    if (auto error{posix_spawnp(&pid, argv[0], nullptr, nullptr, std::data(argv), environ)}; error != 0) {
+        diagnostics << "error: unable to execute '" << args[0] << "': " << std::strerror(error) << '\n';
+        return false;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool Run(std::vector<std::string> args, const std::vector<const ObjectFile *> &objects,
+         std::ostream &diagnostics) {
+    std::vector<ObjectInput> inputs(std::size(objects));
+    for (std::size_t i{}; i < std::size(objects); ++i) {
+        if (!inputs[i].Open(*objects[i])) {
+            diagnostics << "error: unable to pass " << objects[i]->name_ << " to the linker: "
+                        << std::strerror(errno) << '\n';
+            return false;
+        }
+        args.push_back(inputs[i].GetPath());
+    }
+    return Spawn(std::move(args), diagnostics);
+}
+
+}
+
+bool WriteObject(const ObjectFile &object, const std::string &path, std::ostream &diagnostics) {
+    auto fd{open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)};
+    if (fd < 0) {
+        diagnostics << "error: unable to open output file '" << path << "': " << std::strerror(errno) << '\n';
+        return false;
+    }
+    auto ok{WriteAll(fd, object)};
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        diagnostics << "error: unable to write output file '" << path << "'\n";
+    }
+    return ok;
+}
+
+bool LinkObjects(const std::vector<const ObjectFile *> &objects, const std::string &output,
+                 std::ostream &diagnostics) {
+    return Run({"gcc", "-o", output}, objects, diagnostics);
+}
+
+bool CombineObjects(const std::vector<const ObjectFile *> &objects, const std::string &output,
+                    std::ostream &diagnostics) {
+    return Run({"ld", "-r", "-o", output}, objects, diagnostics)
+           && Spawn({"objcopy", "--localize-hidden", output}, diagnostics);
+}
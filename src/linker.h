@@ -0,0 +1,37 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_LINKER_H
+#define TINY_C_COMPILER_LINKER_H
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 内存中的一个目标文件, name_只用于错误信息
+class ObjectFile {
+public:
+    std::string name_;
+    llvm::SmallVector<char, 0> data_;
+};
+
+// 以下函数的错误信息写入diagnostics, 链接器本身的输出仍然写到标准错误
+
+// 把目标文件写到path, 只写一次, 不经过临时文件
+bool WriteObject(const ObjectFile &object, const std::string &path, std::ostream &diagnostics);
+
+// 用gcc把目标文件和C库链接为可执行文件output
+// 目标文件放在memfd中, 链接器通过/proc/self/fd读取, 不写入磁盘, memfd不可用时才使用临时文件
+// 直接创建gcc进程, 不经过shell, 链接失败时返回false
+bool LinkObjects(const std::vector<const ObjectFile *> &objects, const std::string &output,
+                 std::ostream &diagnostics);
+
+// 用ld -r把多个目标文件合并为一个可重定位的目标文件, 用于-c时合并一个文件的多个分区
+// 合并之后用objcopy把隐藏的符号改为局部符号, 分区时改名的static符号重新只在这个文件中可见
+bool CombineObjects(const std::vector<const ObjectFile *> &objects, const std::string &output,
+                    std::ostream &diagnostics);
+
+#endif //TINY_C_COMPILER_LINKER_H
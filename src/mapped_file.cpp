@@ -0,0 +1,94 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "mapped_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <utility>
+
+MappedFile::MappedFile(const std::string &file_name) {
+    auto fd{open(file_name.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return;
+    }
+
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ == 0) {
+        close(fd);
+        is_open_ = true;
+        return;
+    }
+
+    // 先保留一段比文件多至少一个字节的匿名映射, 再把文件覆盖映射到其开头
+    // 这样即使文件大小恰好是页大小的整数倍, 末尾之后也一定能读到'\0'
+    auto page_size{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))};
+    map_size_ = (size_ / page_size + 1) * page_size;
+
+    map_address_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map_address_ == MAP_FAILED) {
+        map_address_ = nullptr;
+        close(fd);
+        return;
+    }
+
+    if (mmap(map_address_, size_, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        Unmap();
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    madvise(map_address_, size_, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char *>(map_address_);
+    is_open_ = true;
+}
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        Unmap();
+        is_open_ = std::exchange(other.is_open_, false);
+        data_ = std::exchange(other.data_, "");
+        size_ = std::exchange(other.size_, 0);
+        map_address_ = std::exchange(other.map_address_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::IsOpen() const {
+    return is_open_;
+}
+
+std::string_view MappedFile::GetBuffer() const {
+    return {data_, size_};
+}
+
+void MappedFile::Unmap() {
+    if (map_address_) {
+        munmap(map_address_, map_size_);
+        map_address_ = nullptr;
+    }
+    data_ = "";
+    size_ = 0;
+    map_size_ = 0;
+}
@@ -0,0 +1,37 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_MAPPED_FILE_H
+#define TINY_C_COMPILER_MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+// 以只读方式将整个文件映射到内存, 不做任何拷贝
+// 映射区域在文件内容之后至少还有一个'\0', 可以作为哨兵使用
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &file_name);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool IsOpen() const;
+    std::string_view GetBuffer() const;
+private:
+    void Unmap();
+
+    bool is_open_{false};
+    const char *data_{""};
+    std::size_t size_{};
+    void *map_address_{nullptr};
+    std::size_t map_size_{};
+};
+
+#endif //TINY_C_COMPILER_MAPPED_FILE_H
@@ -2,73 +2,232 @@
 // Created by kaiser on 18-12-8.
 //
 
-#include "code_gen.h"
+#include "obj_gen.h"
 
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetSelect.h>
-#include <llvm/Support/TargetRegistry.h>
-#include <llvm/Target/TargetMachine.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/ADT/Optional.h>
 #include <llvm/Support/raw_ostream.h>
-#include <llvm/Support/FileSystem.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Passes/PassBuilder.h>
 
 #include <string>
-#include <iostream>
-#include <system_error>
-
-void ObjGen(CodeGenContext &context, const std::string &obj_file) {
-    // 初始化
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
-
-    // 获取当前计算机的目标三元组
-    auto target_triple{llvm::sys::getDefaultTargetTriple()};
-    context.the_module_->setTargetTriple(target_triple);
-
-    // 如果我们找不到所请求的目标,则打印错误并退出
-    std::string error;
-    auto target{llvm::TargetRegistry::lookupTarget(target_triple, error)};
-
-    if (!target) {
-        std::cerr << error << '\n';
-        std::exit(EXIT_FAILURE);
+
+namespace {
+
+// 目标的注册是整个进程的, 本机目标只初始化一次, 交叉编译时才初始化所有目标
+void InitializeTargets(const llvm::Triple &triple) {
+    static std::once_flag native;
+    std::call_once(native, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+
+    if (triple.getArch() != llvm::Triple{llvm::sys::getProcessTriple()}.getArch()) {
+        static std::once_flag all;
+        std::call_once(all, [] {
+            llvm::InitializeAllTargetInfos();
+            llvm::InitializeAllTargets();
+            llvm::InitializeAllTargetMCs();
+            llvm::InitializeAllAsmParsers();
+            llvm::InitializeAllAsmPrinters();
+        });
     }
+}
 
-    // TargetMachine类提供了对指定的计算机的完整机器描述
-    // 使用通用CPU,无任何其他功能,选项或重定位模型
-    std::string cpu("generic");
-    std::string features;
-    llvm::TargetOptions opt;
-    llvm::Optional<llvm::Reloc::Model> rm;
+}
 
-    // 配置模块,指定目标机器和数据布局
-    // 这不是必须的,但是这对优化有好处
-    auto the_target_machine{target->createTargetMachine(target_triple, cpu, features, opt, rm)};
-    context.the_module_->setDataLayout(the_target_machine->createDataLayout());
+CodeGenSession::CodeGenSession(const CodeGenOptions &options) :
+        options_{options}, triple_{std::empty(options.triple_) ? llvm::sys::getDefaultTargetTriple()
+                                                                : llvm::Triple::normalize(options.triple_)} {
+    InitializeTargets(llvm::Triple{triple_});
 
-    // 定义要将文件写入的位置
-    std::error_code error_code;
-    llvm::raw_fd_ostream dest{obj_file, error_code, llvm::sys::fs::F_None};
+    if (options_.cpu_ == "native") {
+        options_.cpu_ = llvm::sys::getHostCPUName().str();
+        std::string features;
+        llvm::StringMap<bool> host_features;
+        if (llvm::sys::getHostCPUFeatures(host_features)) {
+            for (const auto &feature:host_features) {
+                features += (feature.getValue() ? "+" : "-") + feature.getKey().str() + ',';
+            }
+        }
+        options_.features_ = features + options_.features_;
+        if (!std::empty(options_.features_) && options_.features_.back() == ',') {
+            options_.features_.pop_back();
+        }
+    }
+
+    target_ = llvm::TargetRegistry::lookupTarget(triple_, error_);
+    if (!target_) {
+        return;
+    }
+
+    // 先检查处理器的名字, 否则LLVM只输出警告并改用通用处理器
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget{target_->createMCSubtargetInfo(triple_, "", "")};
+    if (subtarget && !subtarget->isCPUStringValid(options_.cpu_)) {
+        error_ = "unknown target CPU '" + options_.cpu_ + "'";
+        target_ = nullptr;
+        return;
+    }
 
-    if (error_code) {
-        std::cerr << "Could not open file: " << error_code.message() << '\n';
-        std::exit(EXIT_FAILURE);
+    // 第一个TargetMachine同时决定数据布局
+    auto machine{CreateMachine()};
+    if (!machine) {
+        error_ = "unable to create target machine for '" + triple_ + "'";
+        target_ = nullptr;
+        return;
     }
+    data_layout_ = std::make_unique<llvm::DataLayout>(machine->createDataLayout());
+    machines_.push_back(std::move(machine));
+}
+
+bool CodeGenSession::IsValid() const {
+    return target_ != nullptr;
+}
+
+const std::string &CodeGenSession::GetError() const {
+    return error_;
+}
+
+const std::string &CodeGenSession::GetTriple() const {
+    return triple_;
+}
+
+const llvm::DataLayout &CodeGenSession::GetDataLayout() const {
+    return *data_layout_;
+}
+
+const CodeGenOptions &CodeGenSession::GetOptions() const {
+    return options_;
+}
+
+bool CodeGenSession::EmitObject(llvm::Module &module, llvm::SmallVectorImpl<char> &buffer, std::string &error) {
+    if (!IsValid()) {
+        error = error_;
+        return false;
+    }
+
+    module.setTargetTriple(triple_);
+    module.setDataLayout(*data_layout_);
 
-    // 定义一个生成目标代码的pass并运行
+    SetTargetAttributes(module);
+    auto machine{AcquireMachine()};
+    Optimize(module, *machine);
+
+    // 定义一个生成目标代码的pass并运行, 目标文件保存在内存中
+    llvm::raw_svector_ostream dest{buffer};
     llvm::legacy::PassManager pass;
-    auto file_type = llvm::TargetMachine::CGFT_ObjectFile;
+    auto file_type = llvm::CGFT_ObjectFile;
 
-    if (the_target_machine->addPassesToEmitFile(pass, dest, nullptr, file_type)) {
-        std::cerr << "TheTargetMachine can't emit a file of this type\n";
-        std::exit(EXIT_FAILURE);
+    if (machine->addPassesToEmitFile(pass, dest, nullptr, file_type)) {
+        error = "TheTargetMachine can't emit a file of this type";
+        ReleaseMachine(std::move(machine));
+        return false;
     }
 
-    pass.run(*context.the_module_);
-    dest.flush();
-}
\ No newline at end of file
+    pass.run(module);
+    ReleaseMachine(std::move(machine));
+    return true;
+}
+
+// 优化和后端按函数的属性决定可以使用的指令, 与TargetMachine一致
+void CodeGenSession::SetTargetAttributes(llvm::Module &module) const {
+    for (auto &function:module) {
+        if (function.isDeclaration()) {
+            continue;
+        }
+        function.addFnAttr("target-cpu", options_.cpu_);
+        if (!std::empty(options_.features_)) {
+            function.addFnAttr("target-features", options_.features_);
+        }
+    }
+}
+
+// 新的pass管理器的默认流水线, 与clang的-O级别相同, 分析使用TargetMachine提供的目标信息
+// -O2以上和-Os打开循环向量化和SLP向量化
+void CodeGenSession::Optimize(llvm::Module &module, llvm::TargetMachine &machine) const {
+    llvm::OptimizationLevel level;
+    switch (options_.opt_level_) {
+        case 0:level = llvm::OptimizationLevel::O0;
+            break;
+        case 1:level = llvm::OptimizationLevel::O1;
+            break;
+        case 2:level = options_.optimize_size_ ? llvm::OptimizationLevel::Os : llvm::OptimizationLevel::O2;
+            break;
+        default:level = llvm::OptimizationLevel::O3;
+            break;
+    }
+
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopUnrolling = !options_.optimize_size_;
+    tuning.LoopVectorization = options_.opt_level_ >= 2;
+    tuning.SLPVectorization = options_.opt_level_ >= 2 && !options_.optimize_size_;
+
+    llvm::LoopAnalysisManager loop_analysis;
+    llvm::FunctionAnalysisManager function_analysis;
+    llvm::CGSCCAnalysisManager cgscc_analysis;
+    llvm::ModuleAnalysisManager module_analysis;
+    llvm::PassBuilder builder{&machine, tuning};
+    builder.registerModuleAnalyses(module_analysis);
+    builder.registerCGSCCAnalyses(cgscc_analysis);
+    builder.registerFunctionAnalyses(function_analysis);
+    builder.registerLoopAnalyses(loop_analysis);
+    builder.crossRegisterProxies(loop_analysis, function_analysis, cgscc_analysis, module_analysis);
+
+    auto passes{level == llvm::OptimizationLevel::O0 ? builder.buildO0DefaultPipeline(level)
+                                                     : builder.buildPerModuleDefaultPipeline(level)};
+    passes.run(module, module_analysis);
+}
+
+// TargetMachine类提供了对指定的计算机的完整机器描述
+// 处理器和特性来自-march, -mcpu和-mattr, 生成位置无关的代码以便链接为PIE
+// 后端的优化级别与-O级别对应, -Os使用默认级别
+std::unique_ptr<llvm::TargetMachine> CodeGenSession::CreateMachine() const {
+    const auto &cpu{options_.cpu_};
+    const auto &features{options_.features_};
+    llvm::TargetOptions opt;
+    llvm::Optional<llvm::Reloc::Model> rm{llvm::Reloc::PIC_};
+
+    llvm::CodeGenOpt::Level level;
+    switch (options_.opt_level_) {
+        case 0:level = llvm::CodeGenOpt::None;
+            break;
+        case 1:level = llvm::CodeGenOpt::Less;
+            break;
+        case 2:level = llvm::CodeGenOpt::Default;
+            break;
+        default:level = llvm::CodeGenOpt::Aggressive;
+            break;
+    }
+
+    return std::unique_ptr<llvm::TargetMachine>{
+            target_->createTargetMachine(triple_, cpu, features, opt, rm, llvm::None, level)};
+}
+
+std::unique_ptr<llvm::TargetMachine> CodeGenSession::AcquireMachine() {
+    {
+        std::lock_guard lock{mutex_};
+        if (!std::empty(machines_)) {
+            auto machine{std::move(machines_.back())};
+            machines_.pop_back();
+            return machine;
+        }
+    }
+    return CreateMachine();
+}
+
+void CodeGenSession::ReleaseMachine(std::unique_ptr<llvm::TargetMachine> machine) {
+    std::lock_guard lock{mutex_};
+    machines_.push_back(std::move(machine));
+}
+
+bool ObjGen(CodeGenSession &session, CodeGenContext &context, ObjectFile &object, std::string &error) {
+    object.name_ = context.the_module_->getModuleIdentifier();
+    return session.EmitObject(*context.the_module_, object.data_, error);
+}
@@ -6,8 +6,70 @@
 #define TINY_C_COMPILER_OBJ_GEN_H
 
 #include "code_gen.h"
+#include "linker.h"
+
+#include <llvm/IR/DataLayout.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+// 由命令行参数决定的代码生成选项
+class CodeGenOptions {
+public:
+    // 空字符串表示本机
+    std::string triple_;
+    // -march=和-mcpu=, native表示本机的处理器
+    std::string cpu_{"generic"};
+    // -mattr=, 以逗号分隔的+特性和-特性, 加在处理器本身的特性之后
+    std::string features_;
+    // -O0到-O3, -Os时为2并且optimize_size_为true
+    unsigned opt_level_{0};
+    bool optimize_size_{false};
+};
+
+// 整个进程共享的目标机器信息, 创建一次之后被所有文件和线程使用
+// TargetMachine不能同时被多个线程使用, 每个线程取出一个空闲的, 用完放回, 最多创建线程数个
+class CodeGenSession {
+public:
+    // 只初始化options.triple_对应的目标, cpu_为native时替换为本机的处理器和特性
+    explicit CodeGenSession(const CodeGenOptions &options = {});
+
+    CodeGenSession(const CodeGenSession &) = delete;
+    CodeGenSession &operator=(const CodeGenSession &) = delete;
+
+    // 找不到目标时为false, 错误信息在GetError()中
+    bool IsValid() const;
+    const std::string &GetError() const;
+    const std::string &GetTriple() const;
+    const llvm::DataLayout &GetDataLayout() const;
+
+    // native已经替换为本机的处理器和特性
+    const CodeGenOptions &GetOptions() const;
+
+    // 按优化级别运行优化流水线, 然后用模块的目标三元组和数据布局生成目标文件, 写入buffer
+    // 失败时错误信息保存在error中并返回false
+    bool EmitObject(llvm::Module &module, llvm::SmallVectorImpl<char> &buffer, std::string &error);
+private:
+    void SetTargetAttributes(llvm::Module &module) const;
+    void Optimize(llvm::Module &module, llvm::TargetMachine &machine) const;
+    std::unique_ptr<llvm::TargetMachine> CreateMachine() const;
+    std::unique_ptr<llvm::TargetMachine> AcquireMachine();
+    void ReleaseMachine(std::unique_ptr<llvm::TargetMachine> machine);
+
+    CodeGenOptions options_;
+    std::string triple_;
+    std::string error_;
+    const llvm::Target *target_{nullptr};
+    std::unique_ptr<llvm::DataLayout> data_layout_;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<llvm::TargetMachine>> machines_;
+};
 
-void ObjGen(CodeGenContext &context, const std::string &obj_file);
+// 生成内存中的目标文件, 失败时错误信息保存在error中并返回false, 可以在多个线程中同时调用
+bool ObjGen(CodeGenSession &session, CodeGenContext &context, ObjectFile &object, std::string &error);
 
-#endif //TINY_C_COMPILER_OBJ_GEN_H
\ No newline at end of file
+#endif //TINY_C_COMPILER_OBJ_GEN_H
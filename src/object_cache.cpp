@@ -0,0 +1,284 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "object_cache.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/xxhash.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// 缓存文件格式改变时修改
+constexpr std::string_view kMagic{"TCCOBJ02"};
+
+void WriteSize(std::string &buffer, std::uint64_t size) {
+    for (int i{}; i < 8; ++i) {
+        buffer.push_back(static_cast<char>(size >> (i * 8)));
+    }
+}
+
+// 从缓存文件中读取, 所有的长度都先和剩余的字节数比较, 损坏的文件不会导致过大的分配
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data_{data} {}
+
+    bool ReadSize(std::uint64_t &size) {
+        if (std::size(data_) < 8) {
+            return false;
+        }
+        size = 0;
+        for (int i{}; i < 8; ++i) {
+            size |= static_cast<std::uint64_t>(static_cast<unsigned char>(data_[i])) << (i * 8);
+        }
+        data_.remove_prefix(8);
+        return true;
+    }
+
+    bool ReadBytes(std::uint64_t size, std::string_view &bytes) {
+        if (size > std::size(data_)) {
+            return false;
+        }
+        bytes = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    std::string_view GetRest() const {
+        return data_;
+    }
+private:
+    std::string_view data_;
+};
+
+std::uint64_t GetChecksum(std::string_view data) {
+    return llvm::xxHash64(llvm::StringRef{std::data(data), std::size(data)});
+}
+
+}
+
+ObjectCache::ObjectCache(std::string directory, std::uint64_t max_size) :
+        directory_{std::move(directory)}, max_size_{max_size} {
+    std::error_code error_code;
+    std::filesystem::create_directories(directory_, error_code);
+    usable_ = std::filesystem::is_directory(directory_, error_code);
+}
+
+std::string ObjectCache::MakeKey(std::initializer_list<std::string_view> parts) {
+    llvm::SHA256 hash;
+    for (auto part:parts) {
+        auto size{std::to_string(std::size(part))};
+        hash.update(llvm::StringRef{size.c_str(), std::size(size) + 1});
+        hash.update(llvm::StringRef{std::data(part), std::size(part)});
+    }
+    return llvm::toHex(hash.final(), true);
+}
+
+std::string ObjectCache::GetDefaultDirectory() {
+    if (auto directory{std::getenv("TCC_CACHE_DIR")}; directory && *directory) {
+        return directory;
+    } else if (auto cache{std::getenv("XDG_CACHE_HOME")}; cache && *cache) {
+        return (std::filesystem::path{cache} / "tcc").string();
+    } else if (auto home{std::getenv("HOME")}; home && *home) {
+        return (std::filesystem::path{home} / ".cache" / "tcc").string();
+    }
+    return (std::filesystem::temp_directory_path() / "tcc-cache").string();
+}
+
+// 可执行文件的大小和修改时间足以区分不同的构建, 不需要读取整个文件
+const std::string &ObjectCache::GetCompilerId() {
+    static const std::string id{[] {
+        std::ostringstream os;
+        os << kMagic << " LLVM " << LLVM_VERSION_STRING;
+        std::error_code error_code;
+        std::filesystem::path exe{"/proc/self/exe"};
+        auto size{std::filesystem::file_size(exe, error_code)};
+        if (!error_code) {
+            os << ' ' << size << ' '
+               << std::filesystem::last_write_time(exe, error_code).time_since_epoch().count();
+        }
+        return os.str();
+    }()};
+    return id;
+}
+
+// 魔数, 键, 其余部分的校验和, 然后是诊断信息, 目标文件的个数和每个目标文件, 长度都是8字节的小端整数
+// 文件损坏或者被截断时当作没有命中, 并删除这一项
+bool ObjectCache::Load(const std::string &key, Entry &entry) {
+    entry = {};
+    if (!usable_) {
+        ++misses_;
+        return false;
+    }
+
+    auto path{GetPath(key)};
+    std::string buffer;
+    {
+        std::ifstream ifs{path, std::ios::binary};
+        if (!ifs) {
+            ++misses_;
+            return false;
+        }
+        std::ostringstream os;
+        os << ifs.rdbuf();
+        buffer = os.str();
+    }
+
+    Reader reader{buffer};
+    std::string_view magic, stored_key, bytes;
+    std::uint64_t checksum, size, count;
+    auto ok{reader.ReadBytes(std::size(kMagic), magic) && magic == kMagic
+            && reader.ReadBytes(std::size(key), stored_key) && stored_key == key
+            && reader.ReadSize(checksum) && checksum == GetChecksum(reader.GetRest())
+            && reader.ReadSize(size) && reader.ReadBytes(size, bytes) && reader.ReadSize(count)
+            // 每个目标文件至少有8字节的长度
+            && count <= std::size(reader.GetRest()) / 8};
+    if (ok) {
+        entry.diagnostics_ = bytes;
+        entry.objects_.resize(count);
+        for (auto &object:entry.objects_) {
+            if (!(ok = reader.ReadSize(size) && reader.ReadBytes(size, bytes))) {
+                break;
+            }
+            object.name_ = key;
+            object.data_.assign(std::begin(bytes), std::end(bytes));
+        }
+        ok = ok && std::empty(reader.GetRest());
+    }
+
+    std::error_code error_code;
+    if (!ok) {
+        ++misses_;
+        entry = {};
+        std::filesystem::remove(path, error_code);
+        return false;
+    }
+
+    // 最近使用的项最后被删除
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error_code);
+    ++hits_;
+    return true;
+}
+
+void ObjectCache::Store(const std::string &key, const Entry &entry) {
+    if (!usable_) {
+        return;
+    }
+
+    // 同一个键可能同时被多个进程或线程写入, 各自写临时文件, 改名是原子的
+    std::ostringstream suffix;
+    suffix << ".tmp." << getpid() << '.' << std::this_thread::get_id();
+    auto path{GetPath(key)};
+    auto temp{path + suffix.str()};
+
+    std::string payload;
+    WriteSize(payload, std::size(entry.diagnostics_));
+    payload += entry.diagnostics_;
+    WriteSize(payload, std::size(entry.objects_));
+    for (const auto &object:entry.objects_) {
+        WriteSize(payload, std::size(object.data_));
+        payload.append(std::data(object.data_), std::size(object.data_));
+    }
+    std::string header{kMagic};
+    header += key;
+    WriteSize(header, GetChecksum(payload));
+
+    {
+        std::ofstream ofs{temp, std::ios::binary};
+        ofs.write(std::data(header), static_cast<std::streamsize>(std::size(header)));
+        ofs.write(std::data(payload), static_cast<std::streamsize>(std::size(payload)));
+        if (!ofs.flush()) {
+            std::error_code error_code;
+            std::filesystem::remove(temp, error_code);
+            return;
+        }
+    }
+
+    std::error_code error_code;
+    std::filesystem::rename(temp, path, error_code);
+    if (error_code) {
+        std::filesystem::remove(temp, error_code);
+        return;
+    }
+    ++stores_;
+    trim_pending_ = true;
+}
+
+void ObjectCache::Trim() {
+    // 扫描整个目录的代价较高, 只有写入过新的项之后才可能超过上限
+    if (!usable_ || !trim_pending_.exchange(false)) {
+        return;
+    }
+
+    std::lock_guard lock{trim_mutex_};
+    struct File {
+        std::filesystem::path path_;
+        std::filesystem::file_time_type time_;
+        std::uint64_t size_;
+    };
+    std::vector<File> files;
+    std::uint64_t total{};
+
+    std::error_code error_code;
+    for (const auto &item:std::filesystem::directory_iterator{directory_, error_code}) {
+        // 只管理缓存项, 其他进程正在写的临时文件不计算
+        if (!item.is_regular_file(error_code) || item.path().extension() != ".tcc") {
+            continue;
+        }
+        File file{item.path(), item.last_write_time(error_code), item.file_size(error_code)};
+        if (!error_code) {
+            total += file.size_;
+            files.push_back(std::move(file));
+        }
+    }
+    if (total <= max_size_) {
+        return;
+    }
+
+    std::sort(std::begin(files), std::end(files),
+              [](const File &lhs, const File &rhs) { return lhs.time_ < rhs.time_; });
+    for (const auto &file:files) {
+        if (total <= max_size_) {
+            break;
+        }
+        if (std::filesystem::remove(file.path_, error_code)) {
+            total -= file.size_;
+            ++evictions_;
+        }
+    }
+}
+
+const std::string &ObjectCache::GetDirectory() const {
+    return directory_;
+}
+
+std::size_t ObjectCache::GetHits() const {
+    return hits_;
+}
+
+std::size_t ObjectCache::GetMisses() const {
+    return misses_;
+}
+
+std::size_t ObjectCache::GetStores() const {
+    return stores_;
+}
+
+std::size_t ObjectCache::GetEvictions() const {
+    return evictions_;
+}
+
+std::string ObjectCache::GetPath(const std::string &key) const {
+    return (std::filesystem::path{directory_} / (key + ".tcc")).string();
+}
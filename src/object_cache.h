@@ -0,0 +1,68 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_OBJECT_CACHE_H
+#define TINY_C_COMPILER_OBJECT_CACHE_H
+
+#include "linker.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 以内容为键的编译缓存, 保存一个文件编译完成后的目标文件和诊断信息
+// 每一项是目录中的一个文件, 写入临时文件后改名, 多个进程可以同时使用同一个目录
+// 命中时更新文件的修改时间, 总大小超过上限时从最久没有使用的项开始删除
+class ObjectCache {
+public:
+    class Entry {
+    public:
+        // 编译时的警告, 命中时重新输出
+        std::string diagnostics_;
+        std::vector<ObjectFile> objects_;
+    };
+
+    ObjectCache(std::string directory, std::uint64_t max_size);
+
+    ObjectCache(const ObjectCache &) = delete;
+    ObjectCache &operator=(const ObjectCache &) = delete;
+
+    // 各部分带长度一起散列, 不同的划分不会得到相同的键
+    static std::string MakeKey(std::initializer_list<std::string_view> parts);
+    // 默认的缓存目录, $TCC_CACHE_DIR, $XDG_CACHE_HOME/tcc或者~/.cache/tcc
+    static std::string GetDefaultDirectory();
+    // 编译器本身的标识, 编译器重新构建之后缓存的内容全部失效
+    static const std::string &GetCompilerId();
+
+    bool Load(const std::string &key, Entry &entry);
+    void Store(const std::string &key, const Entry &entry);
+    // 删除最久没有使用的项, 直到总大小不超过上限, 上次之后没有写入时什么也不做
+    void Trim();
+
+    const std::string &GetDirectory() const;
+    std::size_t GetHits() const;
+    std::size_t GetMisses() const;
+    std::size_t GetStores() const;
+    std::size_t GetEvictions() const;
+private:
+    std::string GetPath(const std::string &key) const;
+
+    std::string directory_;
+    std::uint64_t max_size_;
+    bool usable_{false};
+
+    std::atomic<std::size_t> hits_{};
+    std::atomic<std::size_t> misses_{};
+    std::atomic<std::size_t> stores_{};
+    std::atomic<std::size_t> evictions_{};
+    std::atomic<bool> trim_pending_{false};
+    std::mutex trim_mutex_;
+};
+
+#endif //TINY_C_COMPILER_OBJECT_CACHE_H
@@ -3,3 +3,1426 @@
 //
 
 #include "parser.h"
+
+#include <llvm/Support/TimeProfiler.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// 声明说明符中每种类型关键字的计数, 各占两位, 用于判断组合是否合法
+enum TypeSpecifier : std::uint32_t {
+    kVoidSpecifier = 1u << 0u,
+    kBoolSpecifier = 1u << 2u,
+    kCharSpecifier = 1u << 4u,
+    kShortSpecifier = 1u << 6u,
+    kIntSpecifier = 1u << 8u,
+    kLongSpecifier = 1u << 10u,
+    kFloatSpecifier = 1u << 12u,
+    kDoubleSpecifier = 1u << 14u,
+    kOtherSpecifier = 1u << 16u,
+    kSignedSpecifier = 1u << 17u,
+    kUnsignedSpecifier = 1u << 18u
+};
+
+}
+
+Parser::Parser(Scanner &scanner, TypeTable &types, Arena &arena, Interner &interner) :
+        scanner_{scanner}, types_{types}, arena_{arena}, interner_{interner} {
+    EnterScope();
+
+    // x86-64的va_list是只有一个元素的结构体数组, 内置的stdarg.h通过__builtin_va_list使用它
+    auto va_list_tag{types_.NewRecord(TypeKind::kStruct, interner_.Intern("__va_list_tag"))};
+    auto void_pointer{types_.GetPointer(types_.GetVoid())};
+    auto unsigned_int{types_.GetBasic(TypeKind::kInt, true)};
+    types_.CompleteRecord(va_list_tag, {{unsigned_int, interner_.Intern("gp_offset")},
+                                        {unsigned_int, interner_.Intern("fp_offset")},
+                                        {void_pointer, interner_.Intern("overflow_arg_area")},
+                                        {void_pointer, interner_.Intern("reg_save_area")}});
+    Declare(interner_.Intern("__builtin_va_list"), {NameKind::kTypedef, types_.GetArray(va_list_tag, 1)});
+    builtin_va_arg_ = interner_.Intern("__builtin_va_arg");
+    func_ = interner_.Intern("__func__");
+}
+
+template<typename T, typename... Args>
+T *Parser::MakeNode(std::uint32_t offset, Args &&... args) {
+    auto node{arena_.New<T>(std::forward<Args>(args)...)};
+    node->offset_ = offset;
+    return node;
+}
+
+template<typename T>
+ArenaList<T *> Parser::PopList(std::size_t begin) {
+    auto list{arena_.NewList<T *>(std::size(scratch_) - begin)};
+    for (std::size_t i{}; i < std::size(list); ++i) {
+        list[i] = static_cast<T *>(scratch_[begin + i]);
+    }
+    scratch_.resize(begin);
+    return list;
+}
+
+Block *Parser::Parse() {
+    auto begin{std::size(scratch_)};
+    while (!IsEof()) {
+        // 顶层多余的分号
+        if (Try(TokenValue::kSemicolon)) {
+            continue;
+        }
+        ParseDeclaration(true);
+        if (panic_) {
+            Synchronize(true);
+        }
+    }
+    return MakeNode<Block>(0, PopList<Statement>(begin));
+}
+
+const DiagnosticList &Parser::GetDiagnostics() const {
+    return diagnostics_;
+}
+
+bool Parser::HasErrors() const {
+    return !std::empty(diagnostics_);
+}
+
+const Token &Parser::Peek(std::size_t k) {
+    return scanner_.Peek(k);
+}
+
+Token Parser::Next() {
+    return scanner_.Next();
+}
+
+bool Parser::Test(TokenValue value, std::size_t k) {
+    const auto &token{Peek(k)};
+    return token.GetTokenValue() == value && token.GetTokenType() != TokenType::kEof;
+}
+
+bool Parser::Try(TokenValue value) {
+    if (Test(value)) {
+        Next();
+        return true;
+    }
+    return false;
+}
+
+bool Parser::Expect(TokenValue value, const std::string &spelling) {
+    if (Try(value)) {
+        return true;
+    }
+    ErrorReport(Peek(), "expected " + spelling + " before '" + std::string{scanner_.GetTokenName(Peek())} + "'");
+    return false;
+}
+
+bool Parser::IsEof() {
+    return Peek().GetTokenType() == TokenType::kEof;
+}
+
+void Parser::EnterScope() {
+    scopes_.emplace_back();
+    tags_.emplace_back();
+}
+
+void Parser::ExitScope() {
+    scopes_.pop_back();
+    tags_.pop_back();
+}
+
+void Parser::Declare(SymbolId name, const Name &entry) {
+    if (name != kEmptySymbol) {
+        scopes_.back()[name] = entry;
+    }
+}
+
+const Parser::Name *Parser::FindName(SymbolId name) const {
+    for (auto iter{std::rbegin(scopes_)}; iter != std::rend(scopes_); ++iter) {
+        if (auto entry{iter->find(name)}; entry != std::end(*iter)) {
+            return &entry->second;
+        }
+    }
+    return nullptr;
+}
+
+Type *Parser::FindTag(SymbolId tag, bool current_scope_only) const {
+    for (auto iter{std::rbegin(tags_)}; iter != std::rend(tags_); ++iter) {
+        if (auto entry{iter->find(tag)}; entry != std::end(*iter)) {
+            return entry->second;
+        }
+        if (current_scope_only) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+bool Parser::IsTypedefName(const Token &token) const {
+    if (token.GetTokenType() != TokenType::kIdentifier) {
+        return false;
+    }
+    auto entry{FindName(token.GetSymbol())};
+    return entry && entry->kind_ == NameKind::kTypedef;
+}
+
+bool Parser::IsTypeStart(const Token &token) const {
+    if (token.GetTokenType() == TokenType::kIdentifier) {
+        return IsTypedefName(token);
+    }
+    if (token.GetTokenType() != TokenType::kKeyword) {
+        return false;
+    }
+
+    switch (token.GetTokenValue()) {
+        case TokenValue::kAutoKey:
+        case TokenValue::kCharKey:
+        case TokenValue::kConstKey:
+        case TokenValue::kDoubleKey:
+        case TokenValue::kEnumKey:
+        case TokenValue::kExternKey:
+        case TokenValue::kFloatKey:
+        case TokenValue::kInlineKey:
+        case TokenValue::kIntKey:
+        case TokenValue::kLongKey:
+        case TokenValue::kRegisterKey:
+        case TokenValue::kRestrictKey:
+        case TokenValue::kShortKey:
+        case TokenValue::kSignedKey:
+        case TokenValue::kStaticKey:
+        case TokenValue::kStructKey:
+        case TokenValue::kTypedefKey:
+        case TokenValue::kUnionKey:
+        case TokenValue::kUnsignedKey:
+        case TokenValue::kVoidKey:
+        case TokenValue::kVolatileKey:
+        case TokenValue::kBoolKey:
+        case TokenValue::kComplexKey:
+        case TokenValue::kImaginaryKey:return true;
+        default:return false;
+    }
+}
+
+// 声明说明符之后是以逗号分隔的声明符, 顶层的函数声明符之后可以是函数体
+// 声明产生的节点压入scratch_, 由调用者收集
+void Parser::ParseDeclaration(bool top_level) {
+    auto storage{StorageClass::kNone};
+    bool is_inline{false};
+    auto base{ParseDeclSpecifiers(&storage, &is_inline)};
+    if (!base) {
+        return;
+    }
+
+    // 只声明了结构体, 联合或者枚举
+    if (Try(TokenValue::kSemicolon)) {
+        return;
+    }
+
+    for (bool first{true};; first = false) {
+        auto declarator{ParseDeclarator(base, false)};
+        if (!declarator.type_) {
+            return;
+        }
+
+        if (storage == StorageClass::kTypedef) {
+            Declare(declarator.name_, {NameKind::kTypedef, declarator.type_});
+        } else if (declarator.type_->IsFunction()) {
+            Declare(declarator.name_, {NameKind::kObject, declarator.type_});
+
+            auto args_begin{std::size(scratch_)};
+            for (const auto &param:declarator.type_->params_) {
+                scratch_.push_back(MakeNode<VariableDeclaration>(declarator.offset_, param.type_, param.name_));
+            }
+            auto args{PopList<VariableDeclaration>(args_begin)};
+
+            Block *body{nullptr};
+            if (Test(TokenValue::kLeftCurly)) {
+                if (!top_level || !first) {
+                    ErrorReport(Peek(), "function definition is not allowed here");
+                    return;
+                }
+                llvm::TimeTraceScope scope{"ParseFunction", [&] {
+                    return std::string{interner_.GetSpelling(declarator.name_)};
+                }};
+                EnterScope();
+                for (const auto &param:declarator.type_->params_) {
+                    Declare(param.name_, {NameKind::kObject, param.type_});
+                }
+                func_used_ = false;
+                body = ParseCompoundStatement();
+                ExitScope();
+
+                // C99 6.4.2.2: 如同在函数体的开头声明了static const char __func__[] = "函数名";
+                // 只在用到时才生成这个变量
+                if (body && func_used_) {
+                    auto spelling{interner_.GetSpelling(declarator.name_)};
+                    auto type{types_.GetArray(types_.GetBasic(TypeKind::kChar),
+                                                static_cast<std::int64_t>(std::size(spelling) + 1))};
+                    auto func{MakeNode<VariableDeclaration>(body->offset_, type, func_,
+                                                            MakeNode<String>(body->offset_, declarator.name_))};
+                    func->storage_ = StorageClass::kStatic;
+
+                    auto begin{std::size(scratch_)};
+                    scratch_.push_back(func);
+                    scratch_.insert(std::end(scratch_), std::begin(body->statements_), std::end(body->statements_));
+                    body = MakeNode<Block>(body->offset_, PopList<Statement>(begin));
+                }
+            }
+
+            auto function{MakeNode<FunctionDeclaration>(declarator.offset_, declarator.type_, declarator.name_,
+                                                         args, body)};
+            function->storage_ = storage;
+            function->is_inline_ = is_inline;
+            bool is_definition{function->body_ != nullptr};
+            scratch_.push_back(function);
+            if (is_definition) {
+                return;
+            }
+        } else {
+            Declare(declarator.name_, {NameKind::kObject, declarator.type_});
+
+            Expression *init{nullptr};
+            if (Try(TokenValue::kAssign)) {
+                init = ParseInitializer();
+            }
+            // 未指定长度的数组由初始化器决定长度
+            auto type{declarator.type_};
+            if (init && type->IsArray() && type->length_ < 0) {
+                type = types_.GetArray(type->base_, GetInitializerLength(type, init));
+                Declare(declarator.name_, {NameKind::kObject, type});
+            }
+            auto variable{MakeNode<VariableDeclaration>(declarator.offset_, type, declarator.name_, init)};
+            variable->storage_ = storage;
+            scratch_.push_back(variable);
+        }
+
+        if (!Try(TokenValue::kComma)) {
+            break;
+        }
+    }
+
+    Expect(TokenValue::kSemicolon, "';'");
+}
+
+// storage和is_inline为空时不允许出现存储类说明符和inline, 例如在类型名和结构体成员中
+const Type *Parser::ParseDeclSpecifiers(StorageClass *storage, bool *is_inline) {
+    const Type *type{nullptr};
+    std::uint32_t counter{};
+    bool seen_any{false};
+
+    for (bool done{false}; !done;) {
+        const auto &token{Peek()};
+        if (token.GetTokenType() == TokenType::kIdentifier) {
+            if (counter != 0 || !IsTypedefName(token)) {
+                break;
+            }
+            type = FindName(Next().GetSymbol())->type_;
+            counter += kOtherSpecifier;
+            seen_any = true;
+            continue;
+        }
+        if (token.GetTokenType() != TokenType::kKeyword) {
+            break;
+        }
+
+        auto value{token.GetTokenValue()};
+        switch (value) {
+            case TokenValue::kTypedefKey:
+            case TokenValue::kExternKey:
+            case TokenValue::kStaticKey:
+            case TokenValue::kAutoKey:
+            case TokenValue::kRegisterKey:
+                if (!storage) {
+                    ErrorReport(token, "storage class specifier is not allowed here");
+                    return nullptr;
+                }
+                if (*storage != StorageClass::kNone) {
+                    ErrorReport(token, "multiple storage classes in declaration specifiers");
+                    return nullptr;
+                }
+                *storage = value == TokenValue::kTypedefKey ? StorageClass::kTypedef :
+                           value == TokenValue::kExternKey ? StorageClass::kExtern :
+                           value == TokenValue::kStaticKey ? StorageClass::kStatic :
+                           value == TokenValue::kAutoKey ? StorageClass::kAuto : StorageClass::kRegister;
+                Next();
+                break;
+            case TokenValue::kInlineKey:
+                if (!is_inline) {
+                    ErrorReport(token, "'inline' is not allowed here");
+                    return nullptr;
+                }
+                *is_inline = true;
+                Next();
+                break;
+            case TokenValue::kConstKey:
+            case TokenValue::kVolatileKey:
+            case TokenValue::kRestrictKey:Next();
+                break;
+            case TokenValue::kStructKey:
+            case TokenValue::kUnionKey:
+            case TokenValue::kEnumKey:
+                if (counter != 0) {
+                    ErrorReport(token, "two or more data types in declaration specifiers");
+                    return nullptr;
+                }
+                type = value == TokenValue::kEnumKey ? ParseEnumSpecifier() : ParseRecordSpecifier();
+                if (!type) {
+                    return nullptr;
+                }
+                counter += kOtherSpecifier;
+                break;
+            case TokenValue::kVoidKey:counter += kVoidSpecifier;
+                Next();
+                break;
+            case TokenValue::kBoolKey:counter += kBoolSpecifier;
+                Next();
+                break;
+            case TokenValue::kCharKey:counter += kCharSpecifier;
+                Next();
+                break;
+            case TokenValue::kShortKey:counter += kShortSpecifier;
+                Next();
+                break;
+            case TokenValue::kIntKey:counter += kIntSpecifier;
+                Next();
+                break;
+            case TokenValue::kLongKey:counter += kLongSpecifier;
+                Next();
+                break;
+            case TokenValue::kFloatKey:counter += kFloatSpecifier;
+                Next();
+                break;
+            case TokenValue::kDoubleKey:counter += kDoubleSpecifier;
+                Next();
+                break;
+            case TokenValue::kSignedKey:counter |= kSignedSpecifier;
+                Next();
+                break;
+            case TokenValue::kUnsignedKey:counter |= kUnsignedSpecifier;
+                Next();
+                break;
+            case TokenValue::kComplexKey:
+            case TokenValue::kImaginaryKey:ErrorReport(token, "complex types are not supported");
+                return nullptr;
+            default:done = true;
+                continue;
+        }
+        seen_any = true;
+    }
+
+    if (!seen_any) {
+        ErrorReport(Peek(), "expected declaration specifiers before '" +
+                            std::string{scanner_.GetTokenName(Peek())} + "'");
+        return nullptr;
+    }
+
+    auto is_unsigned{(counter & kUnsignedSpecifier) != 0};
+    if ((counter & kSignedSpecifier) && is_unsigned) {
+        ErrorReport(Peek(), "both 'signed' and 'unsigned' in declaration specifiers");
+        return nullptr;
+    }
+
+    switch (counter & ~(kSignedSpecifier | kUnsignedSpecifier)) {
+        case kOtherSpecifier:
+            if (counter != kOtherSpecifier) {
+                break;
+            }
+            return type;
+        case kVoidSpecifier:
+            if (counter == kVoidSpecifier) {
+                return types_.GetVoid();
+            }
+            break;
+        case kBoolSpecifier:
+            if (counter == kBoolSpecifier) {
+                return types_.GetBasic(TypeKind::kBool, true);
+            }
+            break;
+        case kCharSpecifier:return types_.GetBasic(TypeKind::kChar, is_unsigned);
+        case kShortSpecifier:
+        case kShortSpecifier + kIntSpecifier:return types_.GetBasic(TypeKind::kShort, is_unsigned);
+        case 0:
+            // 只有signed或unsigned时是int, 什么都没有时C99不再默认为int
+            if (counter == 0) {
+                break;
+            }
+            [[fallthrough]];
+        case kIntSpecifier:return types_.GetBasic(TypeKind::kInt, is_unsigned);
+        case kLongSpecifier:
+        case kLongSpecifier + kIntSpecifier:return types_.GetBasic(TypeKind::kLong, is_unsigned);
+        case kLongSpecifier + kLongSpecifier:
+        case kLongSpecifier + kLongSpecifier + kIntSpecifier:return types_.GetBasic(TypeKind::kLongLong, is_unsigned);
+        case kFloatSpecifier:
+            if (counter == kFloatSpecifier) {
+                return types_.GetBasic(TypeKind::kFloat);
+            }
+            break;
+        case kDoubleSpecifier:
+            if (counter == kDoubleSpecifier) {
+                return types_.GetBasic(TypeKind::kDouble);
+            }
+            break;
+        case kLongSpecifier + kDoubleSpecifier:
+            if (counter == kLongSpecifier + kDoubleSpecifier) {
+                return types_.GetBasic(TypeKind::kLongDouble);
+            }
+            break;
+        default:break;
+    }
+
+    ErrorReport(Peek(), counter == 0 ? "type specifier missing" : "invalid combination of type specifiers");
+    return nullptr;
+}
+
+const Type *Parser::ParseRecordSpecifier() {
+    auto kind{Next().GetTokenValue() == TokenValue::kStructKey ? TypeKind::kStruct : TypeKind::kUnion};
+
+    SymbolId tag{kEmptySymbol};
+    if (Peek().GetTokenType() == TokenType::kIdentifier) {
+        tag = Next().GetSymbol();
+    }
+
+    if (!Test(TokenValue::kLeftCurly)) {
+        if (tag == kEmptySymbol) {
+            ErrorReport(Peek(), "expected '{' or tag name");
+            return nullptr;
+        }
+        // struct S; 在当前作用域中声明一个新的不完整类型
+        auto record{FindTag(tag, Test(TokenValue::kSemicolon))};
+        if (!record) {
+            record = types_.NewRecord(kind, tag);
+            tags_.back()[tag] = record;
+        } else if (record->kind_ != kind) {
+            ErrorReport(Peek(), "'" + std::string{interner_.GetSpelling(tag)} +
+                                "' defined as wrong kind of tag");
+            return nullptr;
+        }
+        return record;
+    }
+
+    Type *record{nullptr};
+    if (tag != kEmptySymbol) {
+        record = FindTag(tag, true);
+        if (record && (record->kind_ != kind || record->complete_)) {
+            ErrorReport(Peek(), "redefinition of '" + std::string{interner_.GetSpelling(tag)} + "'");
+            return nullptr;
+        }
+    }
+    if (!record) {
+        record = types_.NewRecord(kind, tag);
+        if (tag != kEmptySymbol) {
+            tags_.back()[tag] = record;
+        }
+    }
+
+    Next();
+    std::vector<Member> members;
+    while (!Test(TokenValue::kRightCurly) && !IsEof()) {
+        auto base{ParseDeclSpecifiers(nullptr, nullptr)};
+        if (base && Try(TokenValue::kSemicolon)) {
+            // 没有标签的结构体或联合是匿名成员, 其余的只是声明了类型
+            if (base->IsRecord() && base->tag_ == kEmptySymbol) {
+                members.push_back({base});
+            }
+            continue;
+        }
+
+        while (base) {
+            Member member{base};
+            if (!Test(TokenValue::kColon)) {
+                auto declarator{ParseDeclarator(base, false)};
+                if (!declarator.type_) {
+                    break;
+                }
+                member.type_ = declarator.type_;
+                member.name_ = declarator.name_;
+            }
+
+            if (Test(TokenValue::kColon)) {
+                auto offset{Next().GetOffset()};
+                auto width{ParseConstantExpression()};
+                if (!member.type_->IsInteger()) {
+                    ErrorReport(offset, "bit-field has invalid type");
+                } else if (width < 0 || static_cast<std::uint64_t>(width) > member.type_->GetSize() * 8 ||
+                           (width == 0 && member.name_ != kEmptySymbol)) {
+                    ErrorReport(offset, "invalid bit-field width");
+                }
+                member.bit_field_ = true;
+                member.bit_width_ = static_cast<std::uint32_t>(width);
+            } else if (member.type_->IsFunction() || (!member.type_->IsComplete() && !member.type_->IsArray())) {
+                ErrorReport(Peek(), "field has incomplete type");
+            }
+            members.push_back(member);
+
+            if (!Try(TokenValue::kComma)) {
+                Expect(TokenValue::kSemicolon, "';'");
+                break;
+            }
+        }
+
+        if (panic_) {
+            Synchronize(false);
+        }
+    }
+    Expect(TokenValue::kRightCurly, "'}'");
+
+    types_.CompleteRecord(record, members);
+    return record;
+}
+
+const Type *Parser::ParseEnumSpecifier() {
+    Next();
+
+    SymbolId tag{kEmptySymbol};
+    if (Peek().GetTokenType() == TokenType::kIdentifier) {
+        tag = Next().GetSymbol();
+    }
+
+    if (!Test(TokenValue::kLeftCurly)) {
+        if (tag == kEmptySymbol) {
+            ErrorReport(Peek(), "expected '{' or tag name");
+            return nullptr;
+        }
+        auto type{FindTag(tag, false)};
+        if (!type) {
+            type = types_.NewEnum(tag);
+            tags_.back()[tag] = type;
+        } else if (type->kind_ != TypeKind::kEnum) {
+            ErrorReport(Peek(), "'" + std::string{interner_.GetSpelling(tag)} + "' defined as wrong kind of tag");
+            return nullptr;
+        }
+        return type;
+    }
+
+    auto type{types_.NewEnum(tag)};
+    if (tag != kEmptySymbol) {
+        tags_.back()[tag] = type;
+    }
+
+    Next();
+    std::int64_t value{};
+    while (!Test(TokenValue::kRightCurly) && !IsEof()) {
+        if (Peek().GetTokenType() != TokenType::kIdentifier) {
+            ErrorReport(Peek(), "expected identifier");
+            return nullptr;
+        }
+        auto name{Next().GetSymbol()};
+        if (Try(TokenValue::kAssign)) {
+            value = ParseConstantExpression();
+        }
+        Declare(name, {NameKind::kEnumConstant, types_.GetInt(), value++});
+
+        if (!Try(TokenValue::kComma)) {
+            break;
+        }
+    }
+    Expect(TokenValue::kRightCurly, "'}'");
+    return type;
+}
+
+Parser::Declarator Parser::ParseDeclarator(const Type *base, bool abstract) {
+    Declarator declarator;
+    declarator.offset_ = Peek().GetOffset();
+
+    std::vector<DeclaratorPart> parts;
+    ParseDeclaratorParts(parts, declarator, abstract);
+    if (panic_) {
+        return declarator;
+    }
+    if (!abstract && declarator.name_ == kEmptySymbol) {
+        ErrorReport(Peek(), "expected identifier before '" + std::string{scanner_.GetTokenName(Peek())} + "'");
+        return declarator;
+    }
+
+    auto type{base};
+    for (auto &part:parts) {
+        switch (part.kind_) {
+            case TypeKind::kPointer:type = types_.GetPointer(type);
+                break;
+            case TypeKind::kArray:
+                if (type->IsFunction()) {
+                    ErrorReport(declarator.offset_, "declaration as array of functions");
+                    return declarator;
+                }
+                type = types_.GetArray(type, part.length_);
+                break;
+            default:
+                if (type->IsFunction() || type->IsArray()) {
+                    ErrorReport(declarator.offset_, type->IsFunction() ? "function cannot return a function"
+                                                                       : "function cannot return an array");
+                    return declarator;
+                }
+                type = types_.GetFunction(type, std::move(part.params_), part.variadic_, part.has_prototype_);
+                break;
+        }
+    }
+    declarator.type_ = type;
+    return declarator;
+}
+
+// int *(*p)[3] 中, 外层的后缀先作用于基本类型, 括号中的声明符最后作用
+void Parser::ParseDeclaratorParts(std::vector<DeclaratorPart> &parts, Declarator &declarator, bool abstract) {
+    std::size_t pointers{};
+    while (Try(TokenValue::kMultiply)) {
+        ++pointers;
+        while (Try(TokenValue::kConstKey) || Try(TokenValue::kVolatileKey) || Try(TokenValue::kRestrictKey)) {}
+    }
+    parts.insert(std::end(parts), pointers, DeclaratorPart{TypeKind::kPointer});
+
+    std::vector<DeclaratorPart> inner;
+    if (Test(TokenValue::kLeftParen) &&
+        (Test(TokenValue::kMultiply, 1) || Test(TokenValue::kLeftParen, 1) ||
+         (Peek(1).GetTokenType() == TokenType::kIdentifier && !IsTypedefName(Peek(1))))) {
+        Next();
+        ParseDeclaratorParts(inner, declarator, abstract);
+        Expect(TokenValue::kRightParen, "')'");
+    } else if (Peek().GetTokenType() == TokenType::kIdentifier) {
+        declarator.offset_ = Peek().GetOffset();
+        declarator.name_ = Next().GetSymbol();
+    }
+
+    std::vector<DeclaratorPart> suffixes;
+    while (!panic_) {
+        if (Test(TokenValue::kLeftSquare)) {
+            suffixes.push_back(ParseArraySuffix());
+        } else if (Test(TokenValue::kLeftParen)) {
+            suffixes.push_back(ParseParameterList());
+        } else {
+            break;
+        }
+    }
+
+    std::move(std::rbegin(suffixes), std::rend(suffixes), std::back_inserter(parts));
+    std::move(std::begin(inner), std::end(inner), std::back_inserter(parts));
+}
+
+Parser::DeclaratorPart Parser::ParseArraySuffix() {
+    Next();
+    // 形参中的 [static 10] 和 [const] 等
+    while (Try(TokenValue::kStaticKey) || Try(TokenValue::kConstKey) || Try(TokenValue::kVolatileKey) ||
+           Try(TokenValue::kRestrictKey)) {}
+
+    DeclaratorPart part{TypeKind::kArray};
+    if (!Test(TokenValue::kRightSquare)) {
+        auto offset{Peek().GetOffset()};
+        part.length_ = ParseConstantExpression();
+        if (part.length_ < 0) {
+            ErrorReport(offset, "size of array is negative");
+        }
+    }
+    Expect(TokenValue::kRightSquare, "']'");
+    return part;
+}
+
+Parser::DeclaratorPart Parser::ParseParameterList() {
+    Next();
+
+    DeclaratorPart part{TypeKind::kFunction};
+    if (Try(TokenValue::kRightParen)) {
+        part.has_prototype_ = false;
+        return part;
+    }
+    if (Test(TokenValue::kVoidKey) && Test(TokenValue::kRightParen, 1)) {
+        Next();
+        Next();
+        return part;
+    }
+    if (Peek().GetTokenType() == TokenType::kIdentifier && !IsTypedefName(Peek())) {
+        ErrorReport(Peek(), "old-style parameter lists are not supported");
+        return part;
+    }
+
+    // 形参的名字只在原型中可见
+    EnterScope();
+    do {
+        if (Try(TokenValue::kEllipsis)) {
+            part.variadic_ = true;
+            break;
+        }
+
+        auto storage{StorageClass::kNone};
+        auto base{ParseDeclSpecifiers(&storage, nullptr)};
+        if (!base) {
+            break;
+        }
+        if (storage != StorageClass::kNone && storage != StorageClass::kRegister) {
+            ErrorReport(Peek(), "invalid storage class for parameter");
+            break;
+        }
+
+        auto declarator{ParseDeclarator(base, true)};
+        if (!declarator.type_) {
+            break;
+        }
+
+        // 数组和函数类型的形参调整为指针
+        auto type{declarator.type_};
+        if (type->IsArray()) {
+            type = types_.GetPointer(type->base_);
+        } else if (type->IsFunction()) {
+            type = types_.GetPointer(type);
+        } else if (type->IsVoid()) {
+            ErrorReport(declarator.offset_, "parameter has incomplete type 'void'");
+            break;
+        }
+        Declare(declarator.name_, {NameKind::kObject, type});
+        part.params_.push_back({type, declarator.name_});
+    } while (Try(TokenValue::kComma));
+    ExitScope();
+
+    Expect(TokenValue::kRightParen, "')'");
+    return part;
+}
+
+const Type *Parser::ParseTypeName() {
+    auto base{ParseDeclSpecifiers(nullptr, nullptr)};
+    if (!base) {
+        return nullptr;
+    }
+
+    auto declarator{ParseDeclarator(base, true)};
+    if (declarator.name_ != kEmptySymbol) {
+        ErrorReport(declarator.offset_, "unexpected identifier in type name");
+        return nullptr;
+    }
+    return declarator.type_;
+}
+
+Expression *Parser::ParseInitializer() {
+    if (!Test(TokenValue::kLeftCurly)) {
+        return ParseExpression(kAssignmentPrecedence);
+    }
+
+    auto offset{Next().GetOffset()};
+    auto begin{std::size(scratch_)};
+    while (!Test(TokenValue::kRightCurly) && !IsEof()) {
+        if (Test(TokenValue::kLeftSquare) || Test(TokenValue::kPeriod)) {
+            ErrorReport(Peek(), "designated initializers are not supported");
+            scratch_.resize(begin);
+            return nullptr;
+        }
+        if (auto element{ParseInitializer()}) {
+            scratch_.push_back(element);
+        }
+        if (!Try(TokenValue::kComma)) {
+            break;
+        }
+    }
+    Expect(TokenValue::kRightCurly, "'}'");
+    return MakeNode<InitializerList>(offset, PopList<Expression>(begin));
+}
+
+// 内层省略花括号时按标量的个数计算, 例如int a[][2] = {1, 2, 3}的长度为2
+std::int64_t Parser::GetInitializerLength(const Type *array, const Expression *init) const {
+    auto base{array->base_};
+    auto is_char{base->kind_ == TypeKind::kChar};
+    auto list{NodeCast<InitializerList>(init)};
+    if (list && std::size(list->elements_) == 1 && is_char) {
+        init = list->elements_[0];
+        list = nullptr;
+    }
+    if (auto string{NodeCast<String>(init)}; string && is_char) {
+        return static_cast<std::int64_t>(std::size(interner_.GetSpelling(string->value_))) + 1;
+    }
+    if (!list) {
+        return 1;
+    }
+
+    std::uint64_t scalars{1};
+    for (auto type{base}; type->IsArray() && type->length_ > 0; type = type->base_) {
+        scalars *= static_cast<std::uint64_t>(type->length_);
+    }
+    std::uint64_t length{}, pending{};
+    for (auto element:list->elements_) {
+        if (NodeCast<InitializerList>(element) || NodeCast<String>(element) || !base->IsArray()) {
+            length += (pending + scalars - 1) / scalars + 1;
+            pending = 0;
+        } else {
+            ++pending;
+        }
+    }
+    return static_cast<std::int64_t>(length + (pending + scalars - 1) / scalars);
+}
+
+Statement *Parser::ParseStatement() {
+    const auto &token{Peek()};
+    auto offset{token.GetOffset()};
+
+    if (token.GetTokenType() == TokenType::kIdentifier && Test(TokenValue::kColon, 1)) {
+        return ParseLabeledStatement();
+    }
+
+    switch (token.GetTokenValue()) {
+        case TokenValue::kLeftCurly:return ParseCompoundStatement();
+        case TokenValue::kIfKey:return ParseIfStatement();
+        case TokenValue::kSwitchKey:return ParseSwitchStatement();
+        case TokenValue::kWhileKey:return ParseWhileStatement();
+        case TokenValue::kDoKey:return ParseDoWhileStatement();
+        case TokenValue::kForKey:return ParseForStatement();
+        case TokenValue::kGotoKey:
+        case TokenValue::kContinueKey:
+        case TokenValue::kBreakKey:
+        case TokenValue::kReturnKey:return ParseJumpStatement();
+        case TokenValue::kCaseKey:
+        case TokenValue::kDefaultKey:return ParseLabeledStatement();
+        case TokenValue::kSemicolon:Next();
+            return MakeNode<ExpressionStatement>(offset, nullptr);
+        default:break;
+    }
+
+    auto expression{ParseExpression()};
+    Expect(TokenValue::kSemicolon, "';'");
+    return MakeNode<ExpressionStatement>(offset, expression);
+}
+
+Block *Parser::ParseCompoundStatement() {
+    auto offset{Peek().GetOffset()};
+    if (!Expect(TokenValue::kLeftCurly, "'{'")) {
+        return nullptr;
+    }
+
+    EnterScope();
+    auto begin{std::size(scratch_)};
+    while (!Test(TokenValue::kRightCurly) && !IsEof()) {
+        ParseBlockItem();
+        if (panic_) {
+            Synchronize(false);
+        }
+    }
+    ExitScope();
+
+    Expect(TokenValue::kRightCurly, "'}'");
+    return MakeNode<Block>(offset, PopList<Statement>(begin));
+}
+
+void Parser::ParseBlockItem() {
+    if (IsTypeStart(Peek()) && !Test(TokenValue::kColon, 1)) {
+        ParseDeclaration(false);
+    } else if (auto statement{ParseStatement()}) {
+        scratch_.push_back(statement);
+    }
+}
+
+Statement *Parser::ParseIfStatement() {
+    auto offset{Next().GetOffset()};
+    Expect(TokenValue::kLeftParen, "'('");
+    auto condition{ParseExpression()};
+    Expect(TokenValue::kRightParen, "')'");
+
+    auto then_statement{ParseStatement()};
+    Statement *else_statement{nullptr};
+    if (Try(TokenValue::kElseKey)) {
+        else_statement = ParseStatement();
+    }
+    return MakeNode<IfStatenment>(offset, condition, then_statement,
+                                  else_statement);
+}
+
+Statement *Parser::ParseSwitchStatement() {
+    auto offset{Next().GetOffset()};
+    Expect(TokenValue::kLeftParen, "'('");
+    auto condition{ParseExpression()};
+    Expect(TokenValue::kRightParen, "')'");
+    return MakeNode<SwitchStatement>(offset, condition, ParseStatement());
+}
+
+Statement *Parser::ParseWhileStatement() {
+    auto offset{Next().GetOffset()};
+    Expect(TokenValue::kLeftParen, "'('");
+    auto condition{ParseExpression()};
+    Expect(TokenValue::kRightParen, "')'");
+    return MakeNode<WhileStatement>(offset, condition, ParseStatement());
+}
+
+Statement *Parser::ParseDoWhileStatement() {
+    auto offset{Next().GetOffset()};
+    auto body{ParseStatement()};
+    Expect(TokenValue::kWhileKey, "'while'");
+    Expect(TokenValue::kLeftParen, "'('");
+    auto condition{ParseExpression()};
+    Expect(TokenValue::kRightParen, "')'");
+    Expect(TokenValue::kSemicolon, "';'");
+    return MakeNode<DoWhileStatement>(offset, body, condition);
+}
+
+Statement *Parser::ParseForStatement() {
+    auto offset{Next().GetOffset()};
+    Expect(TokenValue::kLeftParen, "'('");
+
+    // C99允许在for的第一个子句中声明变量, 作用域到循环结束
+    EnterScope();
+    auto begin{std::size(scratch_)};
+    if (IsTypeStart(Peek())) {
+        ParseDeclaration(false);
+    } else {
+        auto initial_offset{Peek().GetOffset()};
+        Expression *expression{nullptr};
+        if (!Test(TokenValue::kSemicolon)) {
+            expression = ParseExpression();
+        }
+        Expect(TokenValue::kSemicolon, "';'");
+        if (expression) {
+            scratch_.push_back(MakeNode<ExpressionStatement>(initial_offset, expression));
+        }
+    }
+
+    Expression *condition{nullptr};
+    if (!Test(TokenValue::kSemicolon)) {
+        condition = ParseExpression();
+    }
+    Expect(TokenValue::kSemicolon, "';'");
+
+    Expression *increment{nullptr};
+    if (!Test(TokenValue::kRightParen)) {
+        increment = ParseExpression();
+    }
+    Expect(TokenValue::kRightParen, "')'");
+
+    auto initial{PopList<Statement>(begin)};
+    auto body{ParseStatement()};
+    ExitScope();
+    return MakeNode<ForStatenment>(offset, initial, condition, increment,
+                                   body);
+}
+
+Statement *Parser::ParseJumpStatement() {
+    auto token{Next()};
+    auto offset{token.GetOffset()};
+    Statement *statement{nullptr};
+
+    switch (token.GetTokenValue()) {
+        case TokenValue::kGotoKey:
+            if (Peek().GetTokenType() != TokenType::kIdentifier) {
+                ErrorReport(Peek(), "expected identifier");
+                return nullptr;
+            }
+            statement = MakeNode<GotoStatement>(offset, Next().GetSymbol());
+            break;
+        case TokenValue::kContinueKey:statement = MakeNode<ContinueStatement>(offset);
+            break;
+        case TokenValue::kBreakKey:statement = MakeNode<BreakStatement>(offset);
+            break;
+        default: {
+            Expression *expression{nullptr};
+            if (!Test(TokenValue::kSemicolon)) {
+                expression = ParseExpression();
+            }
+            statement = MakeNode<ReturnStatenment>(offset, expression);
+            break;
+        }
+    }
+
+    Expect(TokenValue::kSemicolon, "';'");
+    return statement;
+}
+
+Statement *Parser::ParseLabeledStatement() {
+    auto token{Next()};
+    auto offset{token.GetOffset()};
+
+    if (token.GetTokenType() == TokenType::kIdentifier) {
+        Next();
+        return MakeNode<LabelStatement>(offset, token.GetSymbol(), ParseStatement());
+    }
+
+    Expression *value{nullptr};
+    if (token.GetTokenValue() == TokenValue::kCaseKey) {
+        auto value_offset{Peek().GetOffset()};
+        value = MakeNode<Integer>(value_offset, static_cast<std::uint64_t>(ParseConstantExpression()),
+                                  types_.GetInt());
+    }
+    Expect(TokenValue::kColon, "':'");
+    return MakeNode<CaseStatement>(offset, value, ParseStatement());
+}
+
+// 优先级爬升: 一个循环处理同一层的所有二元运算符, 只有遇到更高优先级的运算符时才递归
+// 赋值和条件运算符是右结合的, 其余左结合
+Expression *Parser::ParseExpression(std::int32_t min_precedence) {
+    auto lhs{ParseCastExpression()};
+
+    while (true) {
+        const auto &token{Peek()};
+        auto precedence{token.GetTokPrecedence()};
+        if (token.GetTokenType() != TokenType::kOperator || precedence < min_precedence ||
+            precedence > kMultiplicativePrecedence) {
+            break;
+        }
+
+        auto op{token.GetTokenValue()};
+        auto offset{Next().GetOffset()};
+        if (op == TokenValue::kQuestion) {
+            auto true_expression{ParseExpression()};
+            Expect(TokenValue::kColon, "':'");
+            auto false_expression{ParseExpression(kConditionalPrecedence)};
+            lhs = MakeNode<ConditionalExpression>(offset, lhs, true_expression,
+                                                  false_expression);
+        } else if (precedence == kAssignmentPrecedence) {
+            auto rhs{ParseExpression(kAssignmentPrecedence)};
+            lhs = MakeNode<Assignment>(offset, lhs, rhs, op);
+        } else {
+            auto rhs{ParseExpression(precedence + 1)};
+            lhs = MakeNode<BinaryOpExpression>(offset, lhs, rhs, op);
+        }
+    }
+
+    return lhs;
+}
+
+Expression *Parser::ParseCastExpression() {
+    if (Test(TokenValue::kLeftParen) && IsTypeStart(Peek(1))) {
+        auto offset{Next().GetOffset()};
+        auto type{ParseTypeName()};
+        Expect(TokenValue::kRightParen, "')'");
+        if (Test(TokenValue::kLeftCurly)) {
+            ErrorReport(Peek(), "compound literals are not supported");
+            return nullptr;
+        }
+        return MakeNode<CastExpression>(offset, type, ParseCastExpression());
+    }
+    return ParseUnaryExpression();
+}
+
+Expression *Parser::ParseUnaryExpression() {
+    const auto &token{Peek()};
+    auto offset{token.GetOffset()};
+    if (token.GetTokenType() != TokenType::kOperator && token.GetTokenType() != TokenType::kKeyword) {
+        return ParsePostfixExpression(ParsePrimaryExpression());
+    }
+
+    switch (auto op{token.GetTokenValue()}) {
+        case TokenValue::kPlusPlus:
+        case TokenValue::kMinusMinus:Next();
+            return MakeNode<UnaryOpExpression>(offset, ParseUnaryExpression(), op);
+        case TokenValue::kAnd:
+        case TokenValue::kMultiply:
+        case TokenValue::kPlus:
+        case TokenValue::kMinus:
+        case TokenValue::kNeg:
+        case TokenValue::kLogicNeg:Next();
+            return MakeNode<UnaryOpExpression>(offset, ParseCastExpression(), op);
+        case TokenValue::kSizeofKey:Next();
+            if (Test(TokenValue::kLeftParen) && IsTypeStart(Peek(1))) {
+                Next();
+                auto type{ParseTypeName()};
+                Expect(TokenValue::kRightParen, "')'");
+                return MakeNode<SizeofExpression>(offset, type);
+            }
+            return MakeNode<SizeofExpression>(offset, ParseUnaryExpression());
+        default:return ParsePostfixExpression(ParsePrimaryExpression());
+    }
+}
+
+Expression *Parser::ParsePostfixExpression(Expression *expression) {
+    while (!panic_) {
+        const auto &token{Peek()};
+        auto offset{token.GetOffset()};
+
+        switch (token.GetTokenValue()) {
+            case TokenValue::kLeftSquare: {
+                Next();
+                auto index{ParseExpression()};
+                Expect(TokenValue::kRightSquare, "']'");
+                expression = MakeNode<IndexExpression>(offset, expression, index);
+                break;
+            }
+            case TokenValue::kLeftParen: {
+                Next();
+                auto begin{std::size(scratch_)};
+                if (!Test(TokenValue::kRightParen)) {
+                    do {
+                        if (auto arg{ParseExpression(kAssignmentPrecedence)}) {
+                            scratch_.push_back(arg);
+                        }
+                    } while (Try(TokenValue::kComma));
+                }
+                Expect(TokenValue::kRightParen, "')'");
+                expression = MakeNode<FunctionCall>(offset, expression, PopList<Expression>(begin));
+                break;
+            }
+            case TokenValue::kPeriod:
+            case TokenValue::kArrow: {
+                auto arrow{Next().GetTokenValue() == TokenValue::kArrow};
+                if (Peek().GetTokenType() != TokenType::kIdentifier) {
+                    ErrorReport(Peek(), "expected identifier");
+                    return nullptr;
+                }
+                expression = MakeNode<MemberExpression>(offset, expression, Next().GetSymbol(), arrow);
+                break;
+            }
+            case TokenValue::kPlusPlus:
+            case TokenValue::kMinusMinus:
+                expression = MakeNode<UnaryOpExpression>(offset, expression, Next().GetTokenValue(), true);
+                break;
+            default:return expression;
+        }
+    }
+    return expression;
+}
+
+Expression *Parser::ParsePrimaryExpression() {
+    auto token{Peek()};
+    auto offset{token.GetOffset()};
+
+    switch (token.GetTokenType()) {
+        case TokenType::kIdentifier: {
+            Next();
+            auto name{token.GetSymbol()};
+            if (name == func_) {
+                func_used_ = true;
+            }
+            if (auto entry{FindName(name)}) {
+                if (entry->kind_ == NameKind::kEnumConstant) {
+                    return MakeNode<Integer>(offset, static_cast<std::uint64_t>(entry->value_), entry->type_);
+                } else if (entry->kind_ == NameKind::kTypedef) {
+                    ErrorReport(token, "unexpected type name '" + std::string{interner_.GetSpelling(name)} + "'");
+                    return nullptr;
+                }
+            }
+            // 第二个实参是类型名, 保存为sizeof(类型名), 代码生成时从中取出类型
+            if (name == builtin_va_arg_ && Try(TokenValue::kLeftParen)) {
+                auto begin{std::size(scratch_)};
+                if (auto list{ParseExpression(kAssignmentPrecedence)}) {
+                    scratch_.push_back(list);
+                }
+                Expect(TokenValue::kComma, "','");
+                auto type_offset{Peek().GetOffset()};
+                if (auto type{ParseTypeName()}) {
+                    scratch_.push_back(MakeNode<SizeofExpression>(type_offset, type));
+                }
+                Expect(TokenValue::kRightParen, "')'");
+                return MakeNode<FunctionCall>(offset, MakeNode<IdentifierOrType>(offset, name),
+                                              PopList<Expression>(begin));
+            }
+            return MakeNode<IdentifierOrType>(offset, name);
+        }
+        case TokenType::kBoolean:
+        case TokenType::kCharacter:
+        case TokenType::KUnsignedCharacter:
+        case TokenType::KSignedCharacter:
+        case TokenType::kShortInterger:
+        case TokenType::kInterger:Next();
+            return MakeNode<Integer>(offset, static_cast<std::uint64_t>(token.GetSignedValue()), types_.GetInt());
+        case TokenType::kLongInterger:Next();
+            return MakeNode<Integer>(offset, static_cast<std::uint64_t>(token.GetSignedValue()),
+                                     types_.GetBasic(TypeKind::kLong));
+        case TokenType::kLongLongInterger:Next();
+            return MakeNode<Integer>(offset, static_cast<std::uint64_t>(token.GetSignedValue()),
+                                     types_.GetBasic(TypeKind::kLongLong));
+        case TokenType::kUnsignedShortInterger:
+        case TokenType::kUnsignedInterger:Next();
+            return MakeNode<Integer>(offset, token.GetUnsignedValue(), types_.GetBasic(TypeKind::kInt, true));
+        case TokenType::kUnsignedLongInterger:Next();
+            return MakeNode<Integer>(offset, token.GetUnsignedValue(), types_.GetBasic(TypeKind::kLong, true));
+        case TokenType::kUnsignedLongLongInterger:Next();
+            return MakeNode<Integer>(offset, token.GetUnsignedValue(), types_.GetBasic(TypeKind::kLongLong, true));
+        case TokenType::kFolat:Next();
+            return MakeNode<Double>(offset, token.GetFloatingValue(), types_.GetBasic(TypeKind::kFloat));
+        case TokenType::kDouble:Next();
+            return MakeNode<Double>(offset, token.GetFloatingValue(), types_.GetBasic(TypeKind::kDouble));
+        case TokenType::kString: {
+            Next();
+            auto value{token.GetSymbol()};
+            // 相邻的字符串字面量连接成一个
+            if (Peek().GetTokenType() == TokenType::kString) {
+                std::string buffer{interner_.GetSpelling(value)};
+                while (Peek().GetTokenType() == TokenType::kString) {
+                    buffer += interner_.GetSpelling(Next().GetSymbol());
+                }
+                value = interner_.Intern(buffer);
+            }
+            return MakeNode<String>(offset, value);
+        }
+        default:break;
+    }
+
+    if (Try(TokenValue::kLeftParen)) {
+        auto expression{ParseExpression()};
+        Expect(TokenValue::kRightParen, "')'");
+        return expression;
+    }
+
+    ErrorReport(token, "expected expression before '" + std::string{scanner_.GetTokenName(token)} + "'");
+    return nullptr;
+}
+
+std::int64_t Parser::ParseConstantExpression() {
+    auto offset{Peek().GetOffset()};
+    auto expression{ParseExpression(kConditionalPrecedence)};
+
+    std::int64_t value{};
+    if (expression && !EvaluateConstant(expression, value)) {
+        ErrorReport(offset, "expression is not an integer constant expression");
+    }
+    return value;
+}
+
+// 只处理整数常量表达式, 表达式还没有类型, 统一按照int64_t计算
+bool Parser::EvaluateConstant(const Expression *expression, std::int64_t &value) const {
+    if (!expression) {
+        return false;
+    }
+
+    if (auto integer{NodeCast<Integer>(expression)}) {
+        value = static_cast<std::int64_t>(integer->value_);
+        return true;
+    }
+
+    if (auto sizeof_expression{NodeCast<SizeofExpression>(expression)}) {
+        if (!sizeof_expression->type_ || !sizeof_expression->type_->IsComplete()) {
+            return false;
+        }
+        value = static_cast<std::int64_t>(sizeof_expression->type_->GetSize());
+        return true;
+    }
+
+    if (auto cast{NodeCast<CastExpression>(expression)}) {
+        if (!cast->type_ || !cast->type_->IsInteger() || !EvaluateConstant(cast->expression_, value)) {
+            return false;
+        }
+        auto bits{cast->type_->GetSize() * 8};
+        if (bits < 64) {
+            auto mask{(std::uint64_t{1} << bits) - 1};
+            auto truncated{static_cast<std::uint64_t>(value) & mask};
+            if (!cast->type_->unsigned_ && (truncated >> (bits - 1)) != 0) {
+                truncated |= ~mask;
+            }
+            value = static_cast<std::int64_t>(truncated);
+        }
+        return true;
+    }
+
+    if (auto unary{NodeCast<UnaryOpExpression>(expression)}) {
+        std::int64_t operand{};
+        if (!EvaluateConstant(unary->operand_, operand)) {
+            return false;
+        }
+        switch (unary->op_) {
+            case TokenValue::kPlus:value = operand;
+                return true;
+            case TokenValue::kMinus:value = static_cast<std::int64_t>(0 - static_cast<std::uint64_t>(operand));
+                return true;
+            case TokenValue::kNeg:value = ~operand;
+                return true;
+            case TokenValue::kLogicNeg:value = !operand;
+                return true;
+            default:return false;
+        }
+    }
+
+    if (auto conditional{NodeCast<ConditionalExpression>(expression)}) {
+        std::int64_t condition{};
+        return EvaluateConstant(conditional->condition_, condition) &&
+               EvaluateConstant(condition ? conditional->true_expression_
+                                          : conditional->false_expression_, value);
+    }
+
+    // 不包括赋值
+    auto binary{NodeCast<BinaryOpExpression>(expression)};
+    if (!binary) {
+        return false;
+    }
+
+    std::int64_t lhs{}, rhs{};
+    if (!EvaluateConstant(binary->lhs_, lhs)) {
+        return false;
+    }
+    if (binary->op_ == TokenValue::kLogicAnd && !lhs) {
+        value = 0;
+        return true;
+    }
+    if (binary->op_ == TokenValue::kLogicOr && lhs) {
+        value = 1;
+        return true;
+    }
+    if (!EvaluateConstant(binary->rhs_, rhs)) {
+        return false;
+    }
+
+    auto unsigned_lhs{static_cast<std::uint64_t>(lhs)};
+    auto unsigned_rhs{static_cast<std::uint64_t>(rhs)};
+    switch (binary->op_) {
+        case TokenValue::kPlus:value = static_cast<std::int64_t>(unsigned_lhs + unsigned_rhs);
+            break;
+        case TokenValue::kMinus:value = static_cast<std::int64_t>(unsigned_lhs - unsigned_rhs);
+            break;
+        case TokenValue::kMultiply:value = static_cast<std::int64_t>(unsigned_lhs * unsigned_rhs);
+            break;
+        case TokenValue::kDivide:
+        case TokenValue::kMod:
+            if (rhs == 0 || (lhs == std::numeric_limits<std::int64_t>::min() && rhs == -1)) {
+                return false;
+            }
+            value = binary->op_ == TokenValue::kDivide ? lhs / rhs : lhs % rhs;
+            break;
+        case TokenValue::kAnd:value = lhs & rhs;
+            break;
+        case TokenValue::kOr:value = lhs | rhs;
+            break;
+        case TokenValue::kXor:value = lhs ^ rhs;
+            break;
+        case TokenValue::kShl:value = static_cast<std::int64_t>(unsigned_lhs << (unsigned_rhs & 63u));
+            break;
+        case TokenValue::kShr:value = lhs >> (unsigned_rhs & 63u);
+            break;
+        case TokenValue::kLogicAnd:
+        case TokenValue::kLogicOr:value = rhs != 0;
+            break;
+        case TokenValue::kEqual:value = lhs == rhs;
+            break;
+        case TokenValue::kNotEqual:value = lhs != rhs;
+            break;
+        case TokenValue::kLess:value = lhs < rhs;
+            break;
+        case TokenValue::kGreater:value = lhs > rhs;
+            break;
+        case TokenValue::kLessOrEqual:value = lhs <= rhs;
+            break;
+        case TokenValue::kGreaterOrEqual:value = lhs >= rhs;
+            break;
+        default:return false;
+    }
+    return true;
+}
+
+// 记号本身有词法错误时扫描器已经报告过了
+void Parser::ErrorReport(const Token &token, const std::string &msg) {
+    if (token.GetTokenType() == TokenType::kUnknown) {
+        panic_ = true;
+        return;
+    }
+    ErrorReport(token.GetOffset(), msg);
+}
+
+void Parser::ErrorReport(std::uint32_t offset, const std::string &msg) {
+    if (!panic_) {
+        diagnostics_.push_back(scanner_.MakeDiagnostic(offset, msg));
+    }
+    panic_ = true;
+}
+
+// 跳到当前语句或声明的结尾, 顶层时跳过整个花括号中的内容
+void Parser::Synchronize(bool top_level) {
+    panic_ = false;
+
+    std::size_t depth{};
+    while (!IsEof()) {
+        auto value{Peek().GetTokenValue()};
+        if (value == TokenValue::kLeftCurly) {
+            ++depth;
+        } else if (value == TokenValue::kRightCurly) {
+            if (depth == 0) {
+                if (top_level) {
+                    Next();
+                }
+                return;
+            }
+            if (--depth == 0 && top_level) {
+                Next();
+                return;
+            }
+        } else if (value == TokenValue::kSemicolon && depth == 0) {
+            Next();
+            return;
+        }
+        Next();
+    }
+}
@@ -5,8 +5,138 @@
 #ifndef TINY_C_COMPILER_PARSER_H
 #define TINY_C_COMPILER_PARSER_H
 
+#include "ast.h"
+#include "scanner.h"
+#include "type.h"
+#include "interner.h"
+#include "diagnostic.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// C99的递归下降语法分析器, 通过Scanner的Peek/Next按需取得记号
+// 表达式用优先级爬升法分析, 二元运算符的优先级直接来自Dictionary
+// 语法分析时只维护作用域中的typedef名和枚举常量, 类型检查留给之后的pass
 class Parser {
+public:
+    // 语法树的节点分配在arena中, 类型保存在types中, 二者的生命周期都必须覆盖语法树
+    Parser(Scanner &scanner, TypeTable &types, Arena &arena, Interner &interner = Interner::Global());
+
+    // 整个翻译单元, 顶层的函数和变量声明按出现的顺序放在一个Block中
+    Block *Parse();
+    // 出错后跳到下一个声明或语句继续分析, 同一处的连锁错误只报告一次
+    const DiagnosticList &GetDiagnostics() const;
+    bool HasErrors() const;
+private:
+    // 与Dictionary中运算符的优先级一致
+    static constexpr std::int32_t kCommaPrecedence{10};
+    static constexpr std::int32_t kAssignmentPrecedence{20};
+    static constexpr std::int32_t kConditionalPrecedence{30};
+    static constexpr std::int32_t kMultiplicativePrecedence{130};
+
+    enum class NameKind {
+        kObject,
+        kTypedef,
+        kEnumConstant
+    };
+
+    struct Name {
+        NameKind kind_;
+        const Type *type_{nullptr};
+        std::int64_t value_{};
+    };
+
+    // 声明符中的指针, 数组和函数按照作用于类型的先后顺序保存
+    struct DeclaratorPart {
+        explicit DeclaratorPart(TypeKind kind) : kind_{kind} {}
+
+        TypeKind kind_;
+        std::int64_t length_{-1};
+        std::vector<Parameter> params_;
+        bool variadic_{false};
+        bool has_prototype_{true};
+    };
+
+    struct Declarator {
+        const Type *type_{nullptr};
+        SymbolId name_{kEmptySymbol};
+        std::uint32_t offset_{};
+    };
+
+    const Token &Peek(std::size_t k = 0);
+    Token Next();
+    bool Test(TokenValue value, std::size_t k = 0);
+    bool Try(TokenValue value);
+    bool Expect(TokenValue value, const std::string &spelling);
+    bool IsEof();
+
+    void EnterScope();
+    void ExitScope();
+    void Declare(SymbolId name, const Name &entry);
+    const Name *FindName(SymbolId name) const;
+    Type *FindTag(SymbolId tag, bool current_scope_only) const;
+    bool IsTypedefName(const Token &token) const;
+    bool IsTypeStart(const Token &token) const;
+
+    template<typename T, typename... Args>
+    T *MakeNode(std::uint32_t offset, Args &&... args);
+    // 列表的元素先压入scratch_, 列表结束时复制到arena中, 嵌套的列表共用这一个栈
+    template<typename T>
+    ArenaList<T *> PopList(std::size_t begin);
+
+    void ParseDeclaration(bool top_level);
+    const Type *ParseDeclSpecifiers(StorageClass *storage, bool *is_inline);
+    const Type *ParseRecordSpecifier();
+    const Type *ParseEnumSpecifier();
+    Declarator ParseDeclarator(const Type *base, bool abstract);
+    void ParseDeclaratorParts(std::vector<DeclaratorPart> &parts, Declarator &declarator, bool abstract);
+    DeclaratorPart ParseArraySuffix();
+    DeclaratorPart ParseParameterList();
+    const Type *ParseTypeName();
+    Expression *ParseInitializer();
+    std::int64_t GetInitializerLength(const Type *array, const Expression *init) const;
+
+    Statement *ParseStatement();
+    Block *ParseCompoundStatement();
+    void ParseBlockItem();
+    Statement *ParseIfStatement();
+    Statement *ParseSwitchStatement();
+    Statement *ParseWhileStatement();
+    Statement *ParseDoWhileStatement();
+    Statement *ParseForStatement();
+    Statement *ParseJumpStatement();
+    Statement *ParseLabeledStatement();
+
+    Expression *ParseExpression(std::int32_t min_precedence = kCommaPrecedence);
+    Expression *ParseCastExpression();
+    Expression *ParseUnaryExpression();
+    Expression *ParsePostfixExpression(Expression *expression);
+    Expression *ParsePrimaryExpression();
+    std::int64_t ParseConstantExpression();
+    bool EvaluateConstant(const Expression *expression, std::int64_t &value) const;
+
+    void ErrorReport(const Token &token, const std::string &msg);
+    void ErrorReport(std::uint32_t offset, const std::string &msg);
+    void Synchronize(bool top_level);
+
+    Scanner &scanner_;
+    TypeTable &types_;
+    Arena &arena_;
+    Interner &interner_;
+    DiagnosticList diagnostics_;
+    bool panic_{false};
+    std::vector<ASTNode *> scratch_;
+    SymbolId builtin_va_arg_{};
+    SymbolId func_{};
+    // 正在分析的函数体中是否用到了__func__
+    bool func_used_{false};
 
+    // 普通标识符和结构体/联合/枚举的标签在不同的名字空间中
+    std::vector<std::unordered_map<SymbolId, Name>> scopes_;
+    std::vector<std::unordered_map<SymbolId, Type *>> tags_;
 };
 
-#endif //TINY_C_COMPILER_PARSER_H
\ No newline at end of file
+#endif //TINY_C_COMPILER_PARSER_H
@@ -0,0 +1,275 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "pch.h"
+#include "binary_io.h"
+
+#include <sys/stat.h>
+
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8]{'T', 'C', 'C', '-', 'P', 'C', 'H', '\0'};
+constexpr std::uint32_t kVersion{2};
+
+// 文件头之后依次是依赖文件, #pragma once文件, 宏定义, 记号, 最后是字符串表
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t dependency_count;
+    std::uint64_t options_hash;
+    std::uint32_t once_count;
+    std::uint32_t macro_count;
+    std::uint32_t token_count;
+    std::uint32_t strings_size;
+    StringRef text;
+};
+
+struct DependencyRecord {
+    StringRef path;
+    std::int64_t modify_time;
+    std::int64_t size;
+};
+
+struct MacroRecord {
+    StringRef name;
+    std::uint8_t function_like;
+    std::uint8_t variadic;
+    std::uint16_t reserved;
+    std::uint32_t param_count;
+    std::uint32_t body_count;
+};
+
+struct PPTokenRecord {
+    std::uint8_t kind;
+    std::uint8_t leading_space;
+    std::uint16_t reserved;
+    StringRef text;
+};
+
+// 字面量的值或者标识符/字符串在字符串表中的位置
+struct TokenRecord {
+    std::uint8_t type;
+    std::uint8_t value;
+    std::int16_t precedence;
+    std::uint32_t offset;
+    std::uint32_t length;
+    std::uint32_t reserved;
+    std::uint64_t payload;
+};
+
+static_assert(sizeof(FileHeader) == 48 && sizeof(DependencyRecord) == 24 && sizeof(MacroRecord) == 20 &&
+              sizeof(PPTokenRecord) == 12 && sizeof(TokenRecord) == 24);
+
+std::uint64_t ToPayload(StringRef ref) {
+    return static_cast<std::uint64_t>(ref.offset) << 32u | ref.length;
+}
+
+StringRef FromPayload(std::uint64_t payload) {
+    return {static_cast<std::uint32_t>(payload >> 32u), static_cast<std::uint32_t>(payload)};
+}
+
+bool IsUpToDate(const PrecompiledHeader::Dependency &dependency) {
+    struct stat st{};
+    if (stat(dependency.path_.c_str(), &st) == -1) {
+        return false;
+    }
+    auto modify_time{static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+    return modify_time == dependency.modify_time_ && st.st_size == dependency.size_;
+}
+
+}
+
+bool PrecompiledHeader::Load(const std::string &pch_file, std::uint64_t options_hash, Interner &interner) {
+    file_ = MappedFile{pch_file};
+    if (!file_.IsOpen()) {
+        return false;
+    }
+
+    auto buffer{file_.GetBuffer()};
+    FileHeader header{};
+    if (std::size(buffer) < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, std::data(buffer), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.options_hash != options_hash || header.strings_size > std::size(buffer) - sizeof(header)) {
+        return false;
+    }
+
+    auto strings{buffer.substr(std::size(buffer) - header.strings_size)};
+    Reader reader{buffer.substr(sizeof(header), std::size(buffer) - sizeof(header) - header.strings_size),
+                  strings};
+
+    for (std::uint32_t i{}; i < header.dependency_count; ++i) {
+        DependencyRecord record{};
+        std::string_view path;
+        if (!reader.Get(record) || !reader.GetString(record.path, path) ||
+            !IsUpToDate({std::string{path}, record.modify_time, record.size})) {
+            return false;
+        }
+    }
+
+    for (std::uint32_t i{}; i < header.once_count; ++i) {
+        StringRef ref{};
+        std::string_view path;
+        if (!reader.Get(ref) || !reader.GetString(ref, path)) {
+            return false;
+        }
+        once_files_.emplace_back(path);
+    }
+
+    auto read_pp_token{[&reader, &interner](PPToken &token) {
+        PPTokenRecord record{};
+        if (!reader.Get(record) || !reader.GetString(record.text, token.text_) ||
+            record.kind >= static_cast<std::uint8_t>(PPTokenKind::kEnd)) {
+            return false;
+        }
+        token.kind_ = static_cast<PPTokenKind>(record.kind);
+        token.leading_space_ = record.leading_space;
+        if (token.kind_ == PPTokenKind::kIdentifier) {
+            token.symbol_ = interner.Intern(token.text_);
+        }
+        return true;
+    }};
+
+    for (std::uint32_t i{}; i < header.macro_count; ++i) {
+        MacroRecord record{};
+        std::string_view name;
+        if (!reader.Get(record) || !reader.GetString(record.name, name)) {
+            return false;
+        }
+
+        Macro macro;
+        macro.function_like_ = record.function_like;
+        macro.variadic_ = record.variadic;
+        for (std::uint32_t j{}; j < record.param_count; ++j) {
+            StringRef ref{};
+            std::string_view param;
+            if (!reader.Get(ref) || !reader.GetString(ref, param)) {
+                return false;
+            }
+            macro.params_.push_back(interner.Intern(param));
+        }
+        if (!reader.HasRoom(record.body_count, sizeof(PPTokenRecord))) {
+            return false;
+        }
+        macro.body_.resize(record.body_count);
+        for (auto &token:macro.body_) {
+            if (!read_pp_token(token)) {
+                return false;
+            }
+        }
+        macros_[interner.Intern(name)] = std::move(macro);
+    }
+
+    if (!reader.HasRoom(header.token_count, sizeof(TokenRecord))) {
+        return false;
+    }
+    tokens_.reserve(header.token_count);
+    for (std::uint32_t i{}; i < header.token_count; ++i) {
+        TokenRecord record{};
+        if (!reader.Get(record)) {
+            return false;
+        }
+
+        auto type{static_cast<TokenType>(record.type)};
+        Token token{type, static_cast<TokenValue>(record.value), record.precedence, record.offset, record.length};
+        if (token.HasSymbol()) {
+            std::string_view spelling;
+            if (!reader.GetString(FromPayload(record.payload), spelling)) {
+                return false;
+            }
+            token = Token{type, token.GetTokenValue(), record.precedence, record.offset, record.length,
+                          interner.Intern(spelling)};
+        } else if (token.IsSigned()) {
+            token = Token{type, record.offset, record.length, static_cast<std::int64_t>(record.payload)};
+        } else if (token.IsUnsigned()) {
+            token = Token{type, record.offset, record.length, record.payload};
+        } else if (token.IsFloating()) {
+            double value;
+            std::memcpy(&value, &record.payload, sizeof(value));
+            token = Token{type, record.offset, record.length, value};
+        }
+        tokens_.push_back(token);
+    }
+
+    return reader.GetString(header.text, text_);
+}
+
+bool PrecompiledHeader::Write(const std::string &pch_file, std::uint64_t options_hash,
+                              const std::vector<Dependency> &dependencies,
+                              const std::vector<std::string> &once_files,
+                              const std::unordered_map<SymbolId, Macro> &macros,
+                              std::string_view text, const std::vector<Token> &tokens, Interner &interner) {
+    Writer writer;
+
+    for (const auto &dependency:dependencies) {
+        writer.Put(DependencyRecord{writer.AddString(dependency.path_), dependency.modify_time_, dependency.size_});
+    }
+    for (const auto &path:once_files) {
+        writer.Put(writer.AddString(path));
+    }
+
+    for (const auto &[name, macro]:macros) {
+        writer.Put(MacroRecord{writer.AddString(interner.GetSpelling(name)), macro.function_like_, macro.variadic_, 0,
+                               static_cast<std::uint32_t>(std::size(macro.params_)),
+                               static_cast<std::uint32_t>(std::size(macro.body_))});
+        for (auto param:macro.params_) {
+            writer.Put(writer.AddString(interner.GetSpelling(param)));
+        }
+        for (const auto &token:macro.body_) {
+            writer.Put(PPTokenRecord{static_cast<std::uint8_t>(token.kind_), token.leading_space_, 0,
+                                     writer.AddString(token.text_)});
+        }
+    }
+
+    for (const auto &token:tokens) {
+        TokenRecord record{static_cast<std::uint8_t>(token.GetTokenType()),
+                           static_cast<std::uint8_t>(token.GetTokenValue()),
+                           static_cast<std::int16_t>(token.GetTokPrecedence()),
+                           token.GetOffset(), token.GetLength(), 0, 0};
+        if (token.HasSymbol()) {
+            record.payload = ToPayload(writer.AddString(interner.GetSpelling(token.GetSymbol())));
+        } else if (token.IsSigned()) {
+            record.payload = static_cast<std::uint64_t>(token.GetSignedValue());
+        } else if (token.IsUnsigned()) {
+            record.payload = token.GetUnsignedValue();
+        } else if (token.IsFloating()) {
+            auto value{token.GetFloatingValue()};
+            std::memcpy(&record.payload, &value, sizeof(value));
+        }
+        writer.Put(record);
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.dependency_count = static_cast<std::uint32_t>(std::size(dependencies));
+    header.options_hash = options_hash;
+    header.once_count = static_cast<std::uint32_t>(std::size(once_files));
+    header.macro_count = static_cast<std::uint32_t>(std::size(macros));
+    header.token_count = static_cast<std::uint32_t>(std::size(tokens));
+    header.text = writer.AddString(text);
+    header.strings_size = static_cast<std::uint32_t>(std::size(writer.strings_));
+
+    return writer.Save(pch_file, header);
+}
+
+const std::unordered_map<SymbolId, Macro> &PrecompiledHeader::GetMacros() const {
+    return macros_;
+}
+
+const std::vector<std::string> &PrecompiledHeader::GetOnceFiles() const {
+    return once_files_;
+}
+
+std::string_view PrecompiledHeader::GetText() const {
+    return text_;
+}
+
+const std::vector<Token> &PrecompiledHeader::GetTokens() const {
+    return tokens_;
+}
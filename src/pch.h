@@ -0,0 +1,54 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_PCH_H
+#define TINY_C_COMPILER_PCH_H
+
+#include "pp_token.h"
+#include "token.h"
+#include "mapped_file.h"
+#include "interner.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 预编译头文件保存预处理一个头文件之后的全部状态: 宏定义, 预处理的输出和Scanner切分出的记号
+// 文件是紧凑的二进制格式, 读取时整个映射到内存, 宏定义中的拼写直接引用映射的缓冲区
+class PrecompiledHeader {
+public:
+    // 预处理结果依赖的文件, 任何一个的修改时间或大小改变, 预编译头文件就失效
+    class Dependency {
+    public:
+        std::string path_;
+        std::int64_t modify_time_;
+        std::int64_t size_;
+    };
+
+    // 格式, 版本, 编译选项或者依赖的文件任何一项不符都返回false, 调用者应该退回到正常的预处理
+    bool Load(const std::string &pch_file, std::uint64_t options_hash, Interner &interner);
+
+    static bool Write(const std::string &pch_file, std::uint64_t options_hash,
+                      const std::vector<Dependency> &dependencies,
+                      const std::vector<std::string> &once_files,
+                      const std::unordered_map<SymbolId, Macro> &macros,
+                      std::string_view text, const std::vector<Token> &tokens, Interner &interner);
+
+    const std::unordered_map<SymbolId, Macro> &GetMacros() const;
+    const std::vector<std::string> &GetOnceFiles() const;
+    // 以行标记开头, 以换行结尾
+    std::string_view GetText() const;
+    // 记号的偏移量相对于GetText()的开头
+    const std::vector<Token> &GetTokens() const;
+private:
+    MappedFile file_;
+    std::unordered_map<SymbolId, Macro> macros_;
+    std::vector<std::string> once_files_;
+    std::string_view text_;
+    std::vector<Token> tokens_;
+};
+
+#endif //TINY_C_COMPILER_PCH_H
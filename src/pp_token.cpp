@@ -0,0 +1,166 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "pp_token.h"
+#include "char_scan.h"
+
+#include <algorithm>
+
+namespace {
+
+// 3个字符和2个字符的运算符, 按最长匹配切分
+constexpr std::string_view kLongPunctuators[]{
+        "...", "<<=", ">>=", "%:%:",
+        "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+        "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##", "<:", ":>", "<%", "%>", "%:"
+};
+
+constexpr std::string_view kPunctuators{"[](){}.&*+-~!/%<>^|?:;=,#"};
+
+const char *SkipQuoted(const char *begin, const char *end, char quote) {
+    for (auto p{begin + 1}; p != end; ++p) {
+        if (*p == '\\' && p + 1 != end) {
+            ++p;
+        } else if (*p == quote) {
+            return p + 1;
+        } else if (*p == '\n') {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+const char *SkipNumber(const char *begin, const char *end) {
+    auto p{begin};
+    while (p != end) {
+        if ((*p == 'e' || *p == 'E' || *p == 'p' || *p == 'P') && p + 1 != end &&
+            (p[1] == '+' || p[1] == '-')) {
+            p += 2;
+        } else if (IsIdentifierChar(*p) || *p == '.') {
+            ++p;
+        } else {
+            break;
+        }
+    }
+    return p;
+}
+
+}
+
+
+bool PPToken::Is(std::string_view spelling) const {
+    return text_ == spelling && kind_ != PPTokenKind::kString && kind_ != PPTokenKind::kCharacter;
+}
+
+bool PPToken::IsHidden(SymbolId name) const {
+    return hide_set_ && std::binary_search(std::begin(*hide_set_), std::end(*hide_set_), name);
+}
+
+bool PPTokenize(std::string_view input, Interner &interner, std::vector<PPToken> &tokens,
+                std::string *error) {
+    auto begin{std::data(input)};
+    auto end{begin + std::size(input)};
+    auto p{begin};
+    auto line_begin{begin};
+    std::uint32_t line{1};
+    bool begin_of_line{true};
+    bool leading_space{false};
+
+    while (p != end) {
+        auto c{*p};
+        if (c == '\n') {
+            ++p;
+            ++line;
+            line_begin = p;
+            begin_of_line = true;
+            leading_space = false;
+            continue;
+        }
+        if (IsSpace(c)) {
+            ++p;
+            leading_space = true;
+            continue;
+        }
+        if (c == '/' && p + 1 != end && p[1] == '/') {
+            p = std::find(p, end, '\n');
+            leading_space = true;
+            continue;
+        }
+        if (c == '/' && p + 1 != end && p[1] == '*') {
+            auto comment_end{std::search(p + 2, end, "*/", "*/" + 2)};
+            if (comment_end == end) {
+                if (error) {
+                    *error = "unterminated comment at line " + std::to_string(line);
+                }
+                return false;
+            }
+            for (auto q{p}; q != comment_end; ++q) {
+                if (*q == '\n') {
+                    ++line;
+                    line_begin = q + 1;
+                }
+            }
+            p = comment_end + 2;
+            leading_space = true;
+            continue;
+        }
+
+        PPToken token;
+        token.begin_of_line_ = begin_of_line;
+        token.leading_space_ = leading_space;
+        token.line_ = line;
+        token.column_ = static_cast<std::uint32_t>(p - line_begin + 1);
+        begin_of_line = false;
+        leading_space = false;
+
+        auto token_end{p + 1};
+        if (IsIdentifierHead(c)) {
+            token_end = SkipIdentifier(p, end);
+            std::string_view prefix(p, token_end - p);
+            // 宽字符和Unicode字面量的前缀
+            if (token_end != end && (*token_end == '"' || *token_end == '\'') &&
+                (prefix == "L" || prefix == "u" || prefix == "U" || prefix == "u8")) {
+                if (auto quoted_end{SkipQuoted(token_end, end, *token_end)}) {
+                    token.kind_ = *token_end == '"' ? PPTokenKind::kString : PPTokenKind::kCharacter;
+                    token_end = quoted_end;
+                } else {
+                    token.kind_ = PPTokenKind::kIdentifier;
+                }
+            } else {
+                token.kind_ = PPTokenKind::kIdentifier;
+            }
+        } else if (IsDigit(c) || (c == '.' && p + 1 != end && IsDigit(p[1]))) {
+            token.kind_ = PPTokenKind::kNumber;
+            token_end = SkipNumber(p + 1, end);
+        } else if (c == '"' || c == '\'') {
+            // 不成对的引号(例如#error中的英文缩写)当作单个字符的记号
+            if (auto quoted_end{SkipQuoted(p, end, c)}) {
+                token.kind_ = c == '"' ? PPTokenKind::kString : PPTokenKind::kCharacter;
+                token_end = quoted_end;
+            } else {
+                token.kind_ = PPTokenKind::kOther;
+            }
+        } else if (kPunctuators.find(c) != std::string_view::npos) {
+            token.kind_ = PPTokenKind::kPunctuator;
+            std::string_view rest(p, end - p);
+            for (auto punctuator:kLongPunctuators) {
+                if (rest.substr(0, std::size(punctuator)) == punctuator) {
+                    token_end = p + std::size(punctuator);
+                    break;
+                }
+            }
+        } else {
+            token.kind_ = PPTokenKind::kOther;
+        }
+
+        token.text_ = std::string_view(p, token_end - p);
+        if (token.kind_ == PPTokenKind::kIdentifier) {
+            token.symbol_ = interner.Intern(token.text_);
+        }
+        tokens.push_back(std::move(token));
+        p = token_end;
+    }
+
+    return true;
+}
@@ -0,0 +1,60 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_PP_TOKEN_H
+#define TINY_C_COMPILER_PP_TOKEN_H
+
+#include "interner.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class PPTokenKind : std::uint8_t {
+    kIdentifier,
+    kNumber,
+    kCharacter,
+    kString,
+    kPunctuator,
+    kOther,
+    kEnd
+};
+
+// 展开过程中不能再展开的宏名集合, 绝大多数记号为空, 用共享的有序数组表示
+using HideSet = std::shared_ptr<const std::vector<SymbolId>>;
+
+// 预处理记号, 拼写指向文件缓冲区或者Interner, 在预处理期间一直有效
+class PPToken {
+public:
+    bool Is(std::string_view spelling) const;
+    bool IsHidden(SymbolId name) const;
+
+    PPTokenKind kind_{PPTokenKind::kEnd};
+    bool begin_of_line_{false};
+    bool leading_space_{false};
+    std::uint32_t line_{};
+    std::uint32_t column_{};
+    // 只对标识符有意义
+    SymbolId symbol_{kEmptySymbol};
+    std::string_view text_;
+    HideSet hide_set_;
+};
+
+// 宏定义, 可变参数宏的最后一个参数是__VA_ARGS__或者GNU风格的具名参数
+class Macro {
+public:
+    bool function_like_{false};
+    bool variadic_{false};
+    std::vector<SymbolId> params_;
+    std::vector<PPToken> body_;
+};
+
+// 将一段已经去掉续行的文本切分成预处理记号, 注释被当作空白
+// 遇到未闭合的注释时返回false, 已经切分出的记号保留在tokens中
+bool PPTokenize(std::string_view input, Interner &interner, std::vector<PPToken> &tokens,
+                std::string *error = nullptr);
+
+#endif //TINY_C_COMPILER_PP_TOKEN_H
@@ -0,0 +1,1623 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "preprocessor.h"
+#include "scanner.h"
+
+#include <llvm/Support/TimeProfiler.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+
+namespace {
+
+constexpr std::size_t kMaxIncludeDepth{200};
+// 内置头文件所在的"目录"在include_dirs_中用空字符串表示
+constexpr std::string_view kBuiltinDir{"<built-in>"};
+constexpr std::size_t kNotFromSearchPath{std::numeric_limits<std::size_t>::max()};
+
+struct BuiltinHeader {
+    std::string_view name;
+    std::string_view content;
+};
+
+// 编译器自己提供的头文件, glibc中没有这些头文件
+constexpr BuiltinHeader kBuiltinHeaders[]{
+        {"stddef.h", R"(
+#if !defined __need_size_t && !defined __need_ptrdiff_t && !defined __need_wchar_t && !defined __need_NULL && !defined __need_wint_t
+#define __need_size_t
+#define __need_ptrdiff_t
+#define __need_wchar_t
+#define __need_NULL
+#ifndef offsetof
+#define offsetof(type, member) ((size_t) &((type *) 0)->member)
+#endif
+#endif
+#if defined __need_size_t && !defined _SIZE_T
+#define _SIZE_T
+typedef __SIZE_TYPE__ size_t;
+#endif
+#if defined __need_ptrdiff_t && !defined _PTRDIFF_T
+#define _PTRDIFF_T
+typedef __PTRDIFF_TYPE__ ptrdiff_t;
+#endif
+#if defined __need_wchar_t && !defined _WCHAR_T
+#define _WCHAR_T
+typedef __WCHAR_TYPE__ wchar_t;
+#endif
+#if defined __need_wint_t && !defined _WINT_T
+#define _WINT_T
+typedef __WINT_TYPE__ wint_t;
+#endif
+#if defined __need_NULL
+#undef NULL
+#define NULL ((void *) 0)
+#endif
+#undef __need_size_t
+#undef __need_ptrdiff_t
+#undef __need_wchar_t
+#undef __need_wint_t
+#undef __need_NULL
+)"},
+        {"stdarg.h", R"(
+#ifndef __GNUC_VA_LIST
+#define __GNUC_VA_LIST
+typedef __builtin_va_list __gnuc_va_list;
+#endif
+#if !defined __need___va_list && !defined _STDARG_H
+#define _STDARG_H
+typedef __gnuc_va_list va_list;
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_arg(ap, type) __builtin_va_arg(ap, type)
+#define va_end(ap) __builtin_va_end(ap)
+#define va_copy(dest, src) __builtin_va_copy(dest, src)
+#endif
+#undef __need___va_list
+)"},
+        {"stdbool.h", R"(
+#ifndef _STDBOOL_H
+#define _STDBOOL_H
+#define bool _Bool
+#define true 1
+#define false 0
+#define __bool_true_false_are_defined 1
+#endif
+)"},
+        {"float.h", R"(
+#ifndef _FLOAT_H
+#define _FLOAT_H
+#define FLT_RADIX 2
+#define FLT_ROUNDS 1
+#define FLT_EVAL_METHOD 0
+#define DECIMAL_DIG 17
+#define FLT_MANT_DIG 24
+#define FLT_DIG 6
+#define FLT_EPSILON 1.19209290e-7F
+#define FLT_MIN 1.17549435e-38F
+#define FLT_MAX 3.40282347e+38F
+#define FLT_MIN_EXP (-125)
+#define FLT_MAX_EXP 128
+#define FLT_MIN_10_EXP (-37)
+#define FLT_MAX_10_EXP 38
+#define DBL_MANT_DIG 53
+#define DBL_DIG 15
+#define DBL_EPSILON 2.2204460492503131e-16
+#define DBL_MIN 2.2250738585072014e-308
+#define DBL_MAX 1.7976931348623157e+308
+#define DBL_MIN_EXP (-1021)
+#define DBL_MAX_EXP 1024
+#define DBL_MIN_10_EXP (-307)
+#define DBL_MAX_10_EXP 308
+#define LDBL_MANT_DIG DBL_MANT_DIG
+#define LDBL_DIG DBL_DIG
+#define LDBL_EPSILON DBL_EPSILON
+#define LDBL_MIN DBL_MIN
+#define LDBL_MAX DBL_MAX
+#define LDBL_MIN_EXP DBL_MIN_EXP
+#define LDBL_MAX_EXP DBL_MAX_EXP
+#define LDBL_MIN_10_EXP DBL_MIN_10_EXP
+#define LDBL_MAX_10_EXP DBL_MAX_10_EXP
+#endif
+)"}
+};
+
+// 不定义__GNUC__, 系统头文件会使用标准C的写法
+constexpr std::string_view kPredefinedMacros{R"(
+#define __STDC__ 1
+#define __STDC_VERSION__ 199901L
+#define __STDC_HOSTED__ 1
+#define __CHAR_BIT__ 8
+#define __SIZEOF_SHORT__ 2
+#define __SIZEOF_INT__ 4
+#define __SIZEOF_LONG_LONG__ 8
+#define __SIZEOF_FLOAT__ 4
+#define __SIZEOF_DOUBLE__ 8
+#define __SCHAR_MAX__ 0x7f
+#define __SHRT_MAX__ 0x7fff
+#define __INT_MAX__ 0x7fffffff
+#define __LONG_LONG_MAX__ 0x7fffffffffffffffLL
+#define __ORDER_LITTLE_ENDIAN__ 1234
+#define __ORDER_BIG_ENDIAN__ 4321
+#define __BYTE_ORDER__ __ORDER_LITTLE_ENDIAN__
+#define __WCHAR_TYPE__ int
+#define __WINT_TYPE__ unsigned int
+#define __linux__ 1
+#define __linux 1
+#define __gnu_linux__ 1
+#define __unix__ 1
+#define __unix 1
+#define __ELF__ 1
+)"
+#if defined(__x86_64__) || defined(__aarch64__)
+R"(
+#define __LP64__ 1
+#define _LP64 1
+#define __SIZEOF_POINTER__ 8
+#define __SIZEOF_LONG__ 8
+#define __LONG_MAX__ 0x7fffffffffffffffL
+#define __SIZE_TYPE__ unsigned long
+#define __PTRDIFF_TYPE__ long
+)"
+#else
+R"(
+#define __SIZEOF_POINTER__ 4
+#define __SIZEOF_LONG__ 4
+#define __LONG_MAX__ 0x7fffffffL
+#define __SIZE_TYPE__ unsigned int
+#define __PTRDIFF_TYPE__ int
+)"
+#endif
+#if defined(__x86_64__)
+R"(
+#define __x86_64__ 1
+#define __x86_64 1
+#define __amd64__ 1
+#define __amd64 1
+)"
+#elif defined(__aarch64__)
+R"(
+#define __aarch64__ 1
+)"
+#elif defined(__i386__)
+R"(
+#define __i386__ 1
+#define __i386 1
+)"
+#endif
+};
+
+std::string Spell(const std::vector<PPToken> &tokens) {
+    std::string result;
+    for (const auto &token:tokens) {
+        if (!std::empty(result) && token.leading_space_) {
+            result.push_back(' ');
+        }
+        result.append(token.text_);
+    }
+    return result;
+}
+
+// #if中的常量表达式, 所有的运算都在intmax_t或者uintmax_t上进行
+class ConditionEvaluator {
+public:
+    explicit ConditionEvaluator(const std::vector<PPToken> &tokens) : tokens_{tokens} {}
+
+    bool Evaluate(std::int64_t &result, std::string &error);
+private:
+    struct Value {
+        std::int64_t value_;
+        bool unsigned_;
+    };
+
+    Value Conditional();
+    Value Binary(std::int32_t min_precedence);
+    Value Unary();
+    Value Number(const PPToken &token);
+    Value Character(const PPToken &token);
+    Value Apply(std::string_view op, Value lhs, Value rhs);
+
+    static std::int32_t Precedence(const PPToken &token);
+
+    bool Peek(std::string_view spelling) const;
+    void Expect(std::string_view spelling);
+    void Fail(const std::string &msg);
+
+    const std::vector<PPToken> &tokens_;
+    std::size_t index_{};
+    // 短路求值的一侧不报除零错误
+    bool evaluate_{true};
+    std::string error_;
+};
+
+bool ConditionEvaluator::Evaluate(std::int64_t &result, std::string &error) {
+    if (std::empty(tokens_)) {
+        error = "#if with no expression";
+        return false;
+    }
+
+    auto value{Conditional()};
+    if (std::empty(error_) && index_ != std::size(tokens_)) {
+        Fail("missing binary operator before token \"" + std::string{tokens_[index_].text_} + "\"");
+    }
+    if (!std::empty(error_)) {
+        error = error_;
+        return false;
+    }
+    result = value.value_;
+    return true;
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Conditional() {
+    auto condition{Binary(1)};
+    if (!Peek("?")) {
+        return condition;
+    }
+    ++index_;
+
+    auto saved{evaluate_};
+    evaluate_ = saved && condition.value_ != 0;
+    auto lhs{Conditional()};
+    Expect(":");
+    evaluate_ = saved && condition.value_ == 0;
+    auto rhs{Conditional()};
+    evaluate_ = saved;
+
+    bool is_unsigned{lhs.unsigned_ || rhs.unsigned_};
+    return {condition.value_ != 0 ? lhs.value_ : rhs.value_, is_unsigned};
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Binary(std::int32_t min_precedence) {
+    auto lhs{Unary()};
+
+    while (std::empty(error_) && index_ < std::size(tokens_)) {
+        auto precedence{Precedence(tokens_[index_])};
+        if (precedence < min_precedence) {
+            break;
+        }
+        auto op{tokens_[index_++].text_};
+
+        auto saved{evaluate_};
+        if (op == "&&") {
+            evaluate_ = saved && lhs.value_ != 0;
+        } else if (op == "||") {
+            evaluate_ = saved && lhs.value_ == 0;
+        }
+        auto rhs{Binary(precedence + 1)};
+        evaluate_ = saved;
+
+        lhs = Apply(op, lhs, rhs);
+    }
+    return lhs;
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Unary() {
+    if (!std::empty(error_)) {
+        return {0, false};
+    }
+    if (index_ == std::size(tokens_)) {
+        Fail("#if with no expression");
+        return {0, false};
+    }
+
+    const auto &token{tokens_[index_++]};
+    switch (token.kind_) {
+        case PPTokenKind::kNumber:return Number(token);
+        case PPTokenKind::kCharacter:return Character(token);
+        // 宏展开之后剩下的标识符都当作0
+        case PPTokenKind::kIdentifier:return {0, false};
+        default:break;
+    }
+
+    if (token.Is("(")) {
+        auto value{Conditional()};
+        Expect(")");
+        return value;
+    }
+    if (token.Is("+")) {
+        return Unary();
+    }
+    if (token.Is("-")) {
+        auto value{Unary()};
+        return {static_cast<std::int64_t>(0 - static_cast<std::uint64_t>(value.value_)), value.unsigned_};
+    }
+    if (token.Is("~")) {
+        auto value{Unary()};
+        return {~value.value_, value.unsigned_};
+    }
+    if (token.Is("!")) {
+        return {Unary().value_ == 0, false};
+    }
+
+    Fail("token \"" + std::string{token.text_} + "\" is not valid in preprocessor expressions");
+    return {0, false};
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Number(const PPToken &token) {
+    std::string text{token.text_};
+    auto suffix{text.find_last_not_of("uUlL")};
+    bool is_unsigned{text.find_first_of("uU", suffix + 1) != std::string::npos};
+    text.erase(suffix + 1);
+
+    if (text.find_first_of(".eEpP") != std::string::npos &&
+        !(std::size(text) > 1 && (text[1] == 'x' || text[1] == 'X'))) {
+        Fail("floating constant in preprocessor expression");
+        return {0, false};
+    }
+
+    int base{10};
+    std::size_t begin{};
+    if (std::size(text) > 1 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        begin = 2;
+    } else if (std::size(text) > 1 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        base = 2;
+        begin = 2;
+    } else if (std::size(text) > 1 && text[0] == '0') {
+        base = 8;
+        begin = 1;
+    }
+
+    errno = 0;
+    char *end{};
+    auto value{std::strtoull(text.c_str() + begin, &end, base)};
+    if (end != text.c_str() + std::size(text) || (begin == std::size(text) && base != 8)) {
+        Fail("invalid integer constant \"" + std::string{token.text_} + "\" in #if");
+        return {0, false};
+    }
+    if (errno == ERANGE) {
+        Fail("integer constant is too large");
+        return {0, false};
+    }
+
+    if (value > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+        is_unsigned = true;
+    }
+    return {static_cast<std::int64_t>(value), is_unsigned};
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Character(const PPToken &token) {
+    auto text{token.text_.substr(token.text_.find('\'') + 1)};
+    text.remove_suffix(1);
+
+    if (std::empty(text)) {
+        Fail("empty character constant");
+        return {0, false};
+    }
+    if (text[0] != '\\') {
+        return {static_cast<signed char>(text[0]), false};
+    }
+
+    std::int64_t value{};
+    if (std::size(text) < 2) {
+        Fail("invalid character constant");
+        return {0, false};
+    }
+    auto c{text[1]};
+    switch (c) {
+        case 'n':value = '\n';
+            break;
+        case 't':value = '\t';
+            break;
+        case 'r':value = '\r';
+            break;
+        case 'a':value = '\a';
+            break;
+        case 'b':value = '\b';
+            break;
+        case 'f':value = '\f';
+            break;
+        case 'v':value = '\v';
+            break;
+        case 'x':value = static_cast<signed char>(std::strtol(std::string{text.substr(2)}.c_str(), nullptr, 16));
+            break;
+        default:
+            if (c >= '0' && c <= '7') {
+                value = static_cast<signed char>(std::strtol(std::string{text.substr(1)}.c_str(), nullptr, 8));
+            } else {
+                value = c;
+            }
+    }
+    return {value, false};
+}
+
+ConditionEvaluator::Value ConditionEvaluator::Apply(std::string_view op, Value lhs, Value rhs) {
+    bool is_unsigned{lhs.unsigned_ || rhs.unsigned_};
+    auto a{static_cast<std::uint64_t>(lhs.value_)};
+    auto b{static_cast<std::uint64_t>(rhs.value_)};
+
+    auto make{[is_unsigned](std::uint64_t value) {
+        return Value{static_cast<std::int64_t>(value), is_unsigned};
+    }};
+    auto compare{[&](auto cmp) {
+        return Value{is_unsigned ? cmp(a, b) : cmp(lhs.value_, rhs.value_), false};
+    }};
+
+    if (op == "*") {
+        return make(a * b);
+    } else if (op == "/" || op == "%") {
+        if (b == 0) {
+            if (evaluate_) {
+                Fail("division by zero in #if");
+            }
+            return {0, is_unsigned};
+        }
+        if (is_unsigned) {
+            return make(op == "/" ? a / b : a % b);
+        }
+        // INT64_MIN / -1 会溢出
+        if (lhs.value_ == std::numeric_limits<std::int64_t>::min() && rhs.value_ == -1) {
+            return {op == "/" ? lhs.value_ : 0, false};
+        }
+        return {op == "/" ? lhs.value_ / rhs.value_ : lhs.value_ % rhs.value_, false};
+    } else if (op == "+") {
+        return make(a + b);
+    } else if (op == "-") {
+        return make(a - b);
+    } else if (op == "<<") {
+        return make(b >= 64 ? 0 : a << b);
+    } else if (op == ">>") {
+        if (b >= 64) {
+            return make(is_unsigned || lhs.value_ >= 0 ? 0 : ~std::uint64_t{});
+        }
+        return is_unsigned ? make(a >> b) : Value{lhs.value_ >> b, false};
+    } else if (op == "<") {
+        return compare([](auto x, auto y) { return x < y; });
+    } else if (op == ">") {
+        return compare([](auto x, auto y) { return x > y; });
+    } else if (op == "<=") {
+        return compare([](auto x, auto y) { return x <= y; });
+    } else if (op == ">=") {
+        return compare([](auto x, auto y) { return x >= y; });
+    } else if (op == "==") {
+        return {a == b, false};
+    } else if (op == "!=") {
+        return {a != b, false};
+    } else if (op == "&") {
+        return make(a & b);
+    } else if (op == "^") {
+        return make(a ^ b);
+    } else if (op == "|") {
+        return make(a | b);
+    } else if (op == "&&") {
+        return {lhs.value_ != 0 && rhs.value_ != 0, false};
+    } else {
+        return {lhs.value_ != 0 || rhs.value_ != 0, false};
+    }
+}
+
+std::int32_t ConditionEvaluator::Precedence(const PPToken &token) {
+    if (token.kind_ != PPTokenKind::kPunctuator) {
+        return -1;
+    }
+
+    auto op{token.text_};
+    if (op == "*" || op == "/" || op == "%") {
+        return 10;
+    } else if (op == "+" || op == "-") {
+        return 9;
+    } else if (op == "<<" || op == ">>") {
+        return 8;
+    } else if (op == "<" || op == ">" || op == "<=" || op == ">=") {
+        return 7;
+    } else if (op == "==" || op == "!=") {
+        return 6;
+    } else if (op == "&") {
+        return 5;
+    } else if (op == "^") {
+        return 4;
+    } else if (op == "|") {
+        return 3;
+    } else if (op == "&&") {
+        return 2;
+    } else if (op == "||") {
+        return 1;
+    } else {
+        return -1;
+    }
+}
+
+bool ConditionEvaluator::Peek(std::string_view spelling) const {
+    return index_ < std::size(tokens_) && tokens_[index_].Is(spelling);
+}
+
+void ConditionEvaluator::Expect(std::string_view spelling) {
+    if (Peek(spelling)) {
+        ++index_;
+    } else {
+        Fail("expected '" + std::string{spelling} + "' in preprocessor expression");
+    }
+}
+
+void ConditionEvaluator::Fail(const std::string &msg) {
+    if (std::empty(error_)) {
+        error_ = msg;
+    }
+}
+
+}
+
+Preprocessor::Preprocessor(const PreprocessorOptions &options, IncludeCache &cache) :
+        options_{options}, cache_{cache}, interner_{cache.GetInterner()},
+        defined_{interner_.Intern("defined")}, va_args_{interner_.Intern("__VA_ARGS__")},
+        file_macro_{interner_.Intern("__FILE__")}, line_macro_{interner_.Intern("__LINE__")} {
+    include_dirs_ = options_.include_paths_;
+    include_dirs_.emplace_back();
+    include_dirs_.insert(std::end(include_dirs_), std::begin(options_.system_include_paths_),
+                         std::end(options_.system_include_paths_));
+
+    DefineBuiltins();
+}
+
+std::string Preprocessor::Preprocess(const std::string &file_name) {
+    diagnostics_.clear();
+    files_.clear();
+
+    auto file{LoadFile(file_name)};
+    if (!file) {
+        diagnostics_.emplace_back(file_name, 1, 1, "No such file or directory");
+        return {};
+    }
+    return Run(file);
+}
+
+std::string Preprocessor::PreprocessBuffer(std::string_view input, const std::string &buffer_name) {
+    diagnostics_.clear();
+    files_.clear();
+    return Run(AddFile(std::make_shared<const SourceFile>(buffer_name, input, interner_)));
+}
+
+bool Preprocessor::EmitPrecompiledHeader(const std::string &header, const std::string &pch_file) {
+    // 生成时不使用其他预编译头文件, 否则依赖的文件不完整
+    auto use_precompiled_headers{options_.use_precompiled_headers_};
+    options_.use_precompiled_headers_ = false;
+    auto text{Preprocess(header)};
+    options_.use_precompiled_headers_ = use_precompiled_headers;
+    if (HasErrors()) {
+        return false;
+    }
+
+    Scanner scanner{text, header, interner_};
+    auto tokens{scanner.GetTokenSequence()};
+    if (scanner.HasErrors()) {
+        diagnostics_.insert(std::end(diagnostics_), std::begin(scanner.GetDiagnostics()),
+                            std::end(scanner.GetDiagnostics()));
+        return false;
+    }
+
+    std::vector<PrecompiledHeader::Dependency> dependencies;
+    for (const auto &[path, file]:files_) {
+        if (path.compare(0, std::size(kBuiltinDir), kBuiltinDir) != 0) {
+            dependencies.push_back({path, file->modify_time_, file->size_});
+        }
+    }
+    std::vector<std::string> once_files;
+    for (auto file:once_files_) {
+        once_files.push_back(file->name_);
+    }
+
+    if (!PrecompiledHeader::Write(pch_file, GetOptionsHash(), dependencies, once_files, macros_, text, tokens,
+                                  interner_)) {
+        diagnostics_.emplace_back(pch_file, 1, 1, "cannot write precompiled header");
+        return false;
+    }
+    return true;
+}
+
+const PrecompiledHeader *Preprocessor::GetPrecompiledHeader() const {
+    return precompiled_header_.get();
+}
+
+const DiagnosticList &Preprocessor::GetDiagnostics() const {
+    return diagnostics_;
+}
+
+bool Preprocessor::HasErrors() const {
+    return std::any_of(std::begin(diagnostics_), std::end(diagnostics_),
+                       [](const Diagnostic &diagnostic) { return !diagnostic.warning_; });
+}
+
+void Preprocessor::DefineBuiltins() {
+    std::string source{kPredefinedMacros};
+    for (const auto &[name, value]:options_.defines_) {
+        source += "#define " + name + ' ' + value + '\n';
+    }
+    for (const auto &name:options_.undefines_) {
+        source += "#undef " + name + '\n';
+    }
+    builtin_source_ = std::make_shared<const SourceFile>(std::string{kBuiltinDir}, source, interner_);
+}
+
+const SourceFile *Preprocessor::LoadFile(const std::string &path) {
+    if (auto iter{files_.find(path)}; iter != std::end(files_)) {
+        return iter->second.get();
+    }
+
+    if (std::size(path) > std::size(kBuiltinDir) && path[std::size(kBuiltinDir)] == '/' &&
+        path.compare(0, std::size(kBuiltinDir), kBuiltinDir) == 0) {
+        auto name{std::string_view{path}.substr(std::size(kBuiltinDir) + 1)};
+        for (const auto &header:kBuiltinHeaders) {
+            if (header.name == name) {
+                return AddFile(cache_.LoadBuffer(path, header.content));
+            }
+        }
+        return nullptr;
+    }
+
+    auto file{cache_.Load(path)};
+    return file ? AddFile(std::move(file)) : nullptr;
+}
+
+const SourceFile *Preprocessor::AddFile(std::shared_ptr<const SourceFile> file) {
+    if (!std::empty(file->error_)) {
+        diagnostics_.emplace_back(file->name_, 1, 1, file->error_);
+    }
+
+    auto result{file.get()};
+    files_[file->name_] = std::move(file);
+    return result;
+}
+
+void Preprocessor::PushFile(const SourceFile *file, std::size_t include_dir) {
+    Context context;
+    context.current_ = std::data(file->tokens_);
+    context.end_ = context.current_ + std::size(file->tokens_);
+    context.file_ = file;
+    context.presumed_name_ = file->name_;
+    context.include_dir_ = include_dir;
+    context.conditional_depth_ = std::size(conditionals_);
+    contexts_.push_back(std::move(context));
+    need_line_marker_ = true;
+}
+
+void Preprocessor::ClearContexts() {
+    for (auto iter{std::rbegin(contexts_)}; iter != std::rend(contexts_); ++iter) {
+        if (iter->traced_) {
+            llvm::timeTraceProfilerEnd();
+        }
+    }
+    contexts_.clear();
+}
+
+void Preprocessor::PushTokens(ContextKind kind, std::vector<PPToken> tokens) {
+    auto &context{contexts_.emplace_back()};
+    context.kind_ = kind;
+    context.owned_ = std::move(tokens);
+    context.current_ = std::data(context.owned_);
+    context.end_ = context.current_ + std::size(context.owned_);
+}
+
+std::string Preprocessor::Run(const SourceFile *file) {
+    macros_.clear();
+    ClearContexts();
+    conditionals_.clear();
+    once_files_.clear();
+    precompiled_header_ = nullptr;
+    first_directive_ = false;
+    output_.clear();
+    output_line_ = 0;
+    last_kind_ = PPTokenKind::kEnd;
+
+    // 预定义宏在主文件之前处理, 它们不产生任何输出
+    PushFile(file, kNotFromSearchPath);
+    PushFile(builtin_source_.get(), kNotFromSearchPath);
+
+    while (!std::empty(contexts_)) {
+        if (!PeekRaw()) {
+            if (contexts_.back().kind_ == ContextKind::kFile &&
+                std::size(conditionals_) > contexts_.back().conditional_depth_) {
+                ErrorReport("unterminated conditional directive");
+                conditionals_.resize(contexts_.back().conditional_depth_);
+            }
+            // 预定义宏处理完之后就是主文件的开头
+            first_directive_ = contexts_.back().file_ == builtin_source_.get();
+            if (contexts_.back().traced_) {
+                llvm::timeTraceProfilerEnd();
+            }
+            contexts_.pop_back();
+            need_line_marker_ = true;
+            continue;
+        }
+
+        bool from_file{contexts_.back().kind_ == ContextKind::kFile};
+        auto token{NextRaw()};
+        if (from_file && token.begin_of_line_ && (token.Is("#") || token.Is("%:"))) {
+            HandleDirective(token);
+        } else if (token.kind_ != PPTokenKind::kIdentifier || !TryExpand(token)) {
+            Emit(token);
+        }
+    }
+
+    output_.push_back('\n');
+    return std::move(output_);
+}
+
+const PPToken *Preprocessor::PeekRaw() {
+    while (!std::empty(contexts_)) {
+        auto &context{contexts_.back()};
+        if (context.current_ != context.end_) {
+            return context.current_;
+        }
+        // 宏展开的结果读完之后自动弹出, 文件和参数列表的结尾需要调用者处理
+        if (context.kind_ != ContextKind::kMacro) {
+            return nullptr;
+        }
+        contexts_.pop_back();
+    }
+    return nullptr;
+}
+
+PPToken Preprocessor::NextRaw() {
+    auto token{PeekRaw()};
+    if (!token) {
+        return {};
+    }
+    ++contexts_.back().current_;
+    return *token;
+}
+
+Preprocessor::Context *Preprocessor::CurrentFile() {
+    for (auto iter{std::rbegin(contexts_)}; iter != std::rend(contexts_); ++iter) {
+        if (iter->kind_ == ContextKind::kFile) {
+            return &*iter;
+        }
+    }
+    return nullptr;
+}
+
+std::uint32_t Preprocessor::CurrentLine() {
+    auto file{CurrentFile()};
+    if (!file || file->current_ == std::data(file->file_->tokens_)) {
+        return 1;
+    }
+    return static_cast<std::uint32_t>((file->current_ - 1)->line_ + file->line_delta_);
+}
+
+std::vector<PPToken> Preprocessor::ReadLine() {
+    // 指令总是直接来自文件
+    auto &context{contexts_.back()};
+    std::vector<PPToken> line;
+    while (context.current_ != context.end_ && !context.current_->begin_of_line_) {
+        line.push_back(*context.current_++);
+    }
+    return line;
+}
+
+std::vector<PPToken> Preprocessor::ExpandList(std::vector<PPToken> tokens) {
+    std::vector<PPToken> result;
+    PushTokens(ContextKind::kList, std::move(tokens));
+
+    while (PeekRaw()) {
+        auto token{NextRaw()};
+        if (token.kind_ != PPTokenKind::kIdentifier || !TryExpand(token)) {
+            result.push_back(std::move(token));
+        }
+    }
+
+    contexts_.pop_back();
+    return result;
+}
+
+bool Preprocessor::TryExpand(const PPToken &name) {
+    if (name.symbol_ == file_macro_ || name.symbol_ == line_macro_) {
+        return ExpandBuiltin(name);
+    }
+
+    auto iter{macros_.find(name.symbol_)};
+    if (iter == std::end(macros_) || name.IsHidden(name.symbol_)) {
+        return false;
+    }
+    const auto &macro{iter->second};
+
+    HideSet hide_set;
+    std::vector<PPToken> result;
+    if (!macro.function_like_) {
+        hide_set = Add(name.hide_set_, name.symbol_);
+        result = Substitute(macro, {}, name);
+    } else {
+        // 函数式的宏名之后没有左括号时不展开
+        auto next{PeekRaw()};
+        if (!next || !next->Is("(")) {
+            return false;
+        }
+
+        std::vector<std::vector<PPToken>> args;
+        PPToken right_paren;
+        if (!CollectArgs(macro, args, right_paren)) {
+            return true;
+        }
+        hide_set = Add(Intersect(name.hide_set_, right_paren.hide_set_), name.symbol_);
+        result = Substitute(macro, args, name);
+    }
+
+    for (auto &token:result) {
+        token.hide_set_ = Union(token.hide_set_, hide_set);
+    }
+    PushTokens(ContextKind::kMacro, std::move(result));
+    return true;
+}
+
+bool Preprocessor::ExpandBuiltin(const PPToken &name) {
+    auto file{CurrentFile()};
+    auto line{name.line_ + file->line_delta_};
+
+    PPToken token;
+    if (name.symbol_ == line_macro_) {
+        token = MakeToken(PPTokenKind::kNumber, std::to_string(line));
+    } else {
+        std::string text{'"'};
+        for (auto c:file->presumed_name_) {
+            if (c == '"' || c == '\\') {
+                text.push_back('\\');
+            }
+            text.push_back(c);
+        }
+        text.push_back('"');
+        token = MakeToken(PPTokenKind::kString, text);
+    }
+
+    token.begin_of_line_ = name.begin_of_line_;
+    token.leading_space_ = name.leading_space_;
+    token.line_ = name.line_;
+    PushTokens(ContextKind::kMacro, {token});
+    return true;
+}
+
+bool Preprocessor::CollectArgs(const Macro &macro, std::vector<std::vector<PPToken>> &args,
+                               PPToken &right_paren) {
+    NextRaw();
+
+    std::vector<PPToken> current;
+    std::int32_t depth{};
+    while (true) {
+        if (!PeekRaw()) {
+            ErrorReport("unterminated argument list invoking macro");
+            return false;
+        }
+
+        auto token{NextRaw()};
+        if (token.Is("(")) {
+            ++depth;
+        } else if (token.Is(")")) {
+            if (depth == 0) {
+                args.push_back(std::move(current));
+                right_paren = std::move(token);
+                break;
+            }
+            --depth;
+        } else if (token.Is(",") && depth == 0 &&
+                   !(macro.variadic_ && std::size(args) + 1 == std::size(macro.params_))) {
+            args.push_back(std::move(current));
+            current.clear();
+            continue;
+        }
+        current.push_back(std::move(token));
+    }
+
+    auto param_count{std::size(macro.params_)};
+    if (param_count == 0 && std::size(args) == 1 && std::empty(args.front())) {
+        args.clear();
+    } else if (macro.variadic_ && std::size(args) + 1 == param_count) {
+        args.emplace_back();
+    }
+
+    if (std::size(args) != param_count) {
+        ErrorReport("macro passed " + std::to_string(std::size(args)) + " arguments, but takes " +
+                    std::to_string(param_count));
+        return false;
+    }
+    return true;
+}
+
+std::vector<PPToken> Preprocessor::Substitute(const Macro &macro,
+                                              const std::vector<std::vector<PPToken>> &args,
+                                              const PPToken &name) {
+    auto param_index{[&macro](const PPToken &token) -> std::int32_t {
+        if (token.kind_ != PPTokenKind::kIdentifier) {
+            return -1;
+        }
+        auto iter{std::find(std::begin(macro.params_), std::end(macro.params_), token.symbol_)};
+        return iter == std::end(macro.params_) ? -1 :
+               static_cast<std::int32_t>(iter - std::begin(macro.params_));
+    }};
+    auto append{[](std::vector<PPToken> &result, const std::vector<PPToken> &tokens, bool leading_space) {
+        auto first{std::size(result)};
+        result.insert(std::end(result), std::begin(tokens), std::end(tokens));
+        if (first != std::size(result)) {
+            result[first].leading_space_ = leading_space;
+        }
+    }};
+    auto paste{[this](std::vector<PPToken> &result, const PPToken &rhs) {
+        if (std::empty(result) || !Paste(result.back(), rhs)) {
+            result.push_back(rhs);
+        }
+    }};
+
+    const auto &body{macro.body_};
+    std::vector<PPToken> result;
+    for (std::size_t i{}; i < std::size(body); ++i) {
+        const auto &token{body[i]};
+
+        if (macro.function_like_ && token.Is("#") && i + 1 < std::size(body) &&
+            param_index(body[i + 1]) >= 0) {
+            result.push_back(Stringize(args[param_index(body[i + 1])]));
+            result.back().leading_space_ = token.leading_space_;
+            ++i;
+            continue;
+        }
+
+        if (token.Is("##") && i + 1 < std::size(body)) {
+            const auto &rhs{body[++i]};
+            auto index{param_index(rhs)};
+            if (index < 0) {
+                paste(result, rhs);
+                continue;
+            }
+
+            const auto &arg{args[index]};
+            // GNU扩展: ", ## __VA_ARGS__"在可变参数为空时删除逗号
+            if (rhs.symbol_ == va_args_ && macro.variadic_ && !std::empty(result) && result.back().Is(",")) {
+                if (std::empty(arg)) {
+                    result.pop_back();
+                } else {
+                    append(result, arg, false);
+                }
+                continue;
+            }
+            if (!std::empty(arg)) {
+                paste(result, arg.front());
+                result.insert(std::end(result), std::begin(arg) + 1, std::end(arg));
+            }
+            continue;
+        }
+
+        auto index{param_index(token)};
+        if (index < 0) {
+            result.push_back(token);
+            continue;
+        }
+
+        const auto &arg{args[index]};
+        if (i + 1 < std::size(body) && body[i + 1].Is("##")) {
+            // 作为##的操作数时不展开, 空的左操作数相当于不存在
+            if (!std::empty(arg)) {
+                append(result, arg, token.leading_space_);
+            } else if (i + 2 < std::size(body)) {
+                i += 2;
+                auto rhs_index{param_index(body[i])};
+                if (rhs_index < 0) {
+                    result.push_back(body[i]);
+                } else {
+                    append(result, args[rhs_index], body[i].leading_space_);
+                }
+            }
+            continue;
+        }
+        append(result, ExpandList(arg), token.leading_space_);
+    }
+
+    // 展开的结果属于宏调用所在的行
+    for (auto &item:result) {
+        item.begin_of_line_ = false;
+        item.line_ = name.line_;
+    }
+    if (!std::empty(result)) {
+        result.front().begin_of_line_ = name.begin_of_line_;
+        result.front().leading_space_ = name.leading_space_;
+    }
+    return result;
+}
+
+PPToken Preprocessor::Stringize(const std::vector<PPToken> &arg) {
+    std::string text{'"'};
+    for (const auto &token:arg) {
+        if (&token != &arg.front() && (token.leading_space_ || token.begin_of_line_)) {
+            text.push_back(' ');
+        }
+        if (token.kind_ == PPTokenKind::kString || token.kind_ == PPTokenKind::kCharacter) {
+            for (auto c:token.text_) {
+                if (c == '"' || c == '\\') {
+                    text.push_back('\\');
+                }
+                text.push_back(c);
+            }
+        } else {
+            text.append(token.text_);
+        }
+    }
+    text.push_back('"');
+    return MakeToken(PPTokenKind::kString, text);
+}
+
+bool Preprocessor::Paste(PPToken &lhs, const PPToken &rhs) {
+    auto text{interner_.GetSpelling(interner_.Intern(std::string{lhs.text_} + std::string{rhs.text_}))};
+
+    std::vector<PPToken> tokens;
+    if (!PPTokenize(text, interner_, tokens) || std::size(tokens) != 1 ||
+        std::size(tokens.front().text_) != std::size(text)) {
+        ErrorReport("pasting \"" + std::string{lhs.text_} + "\" and \"" + std::string{rhs.text_} +
+                    "\" does not give a valid preprocessing token");
+        return false;
+    }
+
+    lhs.kind_ = tokens.front().kind_;
+    lhs.symbol_ = tokens.front().symbol_;
+    lhs.text_ = text;
+    return true;
+}
+
+PPToken Preprocessor::MakeToken(PPTokenKind kind, std::string_view text) {
+    PPToken token;
+    token.kind_ = kind;
+    auto id{interner_.Intern(text)};
+    token.text_ = interner_.GetSpelling(id);
+    if (kind == PPTokenKind::kIdentifier) {
+        token.symbol_ = id;
+    }
+    return token;
+}
+
+HideSet Preprocessor::Union(const HideSet &lhs, const HideSet &rhs) {
+    if (!lhs || lhs == rhs) {
+        return rhs;
+    }
+    if (!rhs) {
+        return lhs;
+    }
+
+    auto result{std::make_shared<std::vector<SymbolId>>()};
+    std::set_union(std::begin(*lhs), std::end(*lhs), std::begin(*rhs), std::end(*rhs),
+                   std::back_inserter(*result));
+    return result;
+}
+
+HideSet Preprocessor::Intersect(const HideSet &lhs, const HideSet &rhs) {
+    if (!lhs || !rhs) {
+        return nullptr;
+    }
+    if (lhs == rhs) {
+        return lhs;
+    }
+
+    auto result{std::make_shared<std::vector<SymbolId>>()};
+    std::set_intersection(std::begin(*lhs), std::end(*lhs), std::begin(*rhs), std::end(*rhs),
+                          std::back_inserter(*result));
+    return std::empty(*result) ? nullptr : HideSet{result};
+}
+
+HideSet Preprocessor::Add(const HideSet &hide_set, SymbolId name) {
+    if (!hide_set) {
+        return std::make_shared<std::vector<SymbolId>>(1, name);
+    }
+
+    auto pos{std::lower_bound(std::begin(*hide_set), std::end(*hide_set), name)};
+    if (pos != std::end(*hide_set) && *pos == name) {
+        return hide_set;
+    }
+    auto result{std::make_shared<std::vector<SymbolId>>(*hide_set)};
+    result->insert(std::begin(*result) + (pos - std::begin(*hide_set)), name);
+    return result;
+}
+
+void Preprocessor::HandleDirective(const PPToken &hash) {
+    auto first_directive{first_directive_};
+    first_directive_ = false;
+
+    auto &context{contexts_.back()};
+    // 只有一个#的空指令
+    if (context.current_ == context.end_ || context.current_->begin_of_line_) {
+        return;
+    }
+
+    auto directive{*context.current_++};
+    auto line{ReadLine()};
+    auto name{directive.text_};
+
+    if (directive.kind_ == PPTokenKind::kNumber) {
+        // GNU风格的行标记: # 33 "file.c" 1
+        line.insert(std::begin(line), directive);
+        HandleLine(hash, std::move(line));
+    } else if (name == "define") {
+        HandleDefine(line);
+    } else if (name == "undef") {
+        HandleUndef(line);
+    } else if (name == "include") {
+        HandleInclude(line, false, first_directive);
+    } else if (name == "include_next") {
+        HandleInclude(line, true, false);
+    } else if (name == "if" || name == "ifdef" || name == "ifndef") {
+        HandleIf(line, name);
+    } else if (name == "elif") {
+        HandleElif(line);
+    } else if (name == "else") {
+        HandleElse();
+    } else if (name == "endif") {
+        HandleEndif();
+    } else if (name == "line") {
+        HandleLine(hash, std::move(line));
+    } else if (name == "error") {
+        ErrorReport("#error " + Spell(line));
+    } else if (name == "warning") {
+        WarningReport("#warning " + Spell(line));
+    } else if (name == "pragma") {
+        HandlePragma(line);
+    } else if (name != "ident" && name != "sccs") {
+        ErrorReport("invalid preprocessing directive #" + std::string{name});
+    }
+}
+
+void Preprocessor::HandleDefine(const std::vector<PPToken> &line) {
+    if (std::empty(line) || line.front().kind_ != PPTokenKind::kIdentifier) {
+        ErrorReport("macro names must be identifiers");
+        return;
+    }
+    if (line.front().symbol_ == defined_) {
+        ErrorReport("\"defined\" cannot be used as a macro name");
+        return;
+    }
+
+    Macro macro;
+    std::size_t i{1};
+    // 宏名和左括号之间没有空白时才是函数式的宏
+    if (i < std::size(line) && line[i].Is("(") && !line[i].leading_space_) {
+        macro.function_like_ = true;
+        ++i;
+        if (i < std::size(line) && line[i].Is(")")) {
+            ++i;
+        } else {
+            while (true) {
+                if (i < std::size(line) && line[i].Is("...")) {
+                    macro.variadic_ = true;
+                    macro.params_.push_back(va_args_);
+                    ++i;
+                } else if (i < std::size(line) && line[i].kind_ == PPTokenKind::kIdentifier) {
+                    macro.params_.push_back(line[i++].symbol_);
+                    // GNU扩展: 具名的可变参数 args...
+                    if (i < std::size(line) && line[i].Is("...")) {
+                        macro.variadic_ = true;
+                        ++i;
+                    }
+                } else {
+                    ErrorReport("expected parameter name in macro parameter list");
+                    return;
+                }
+
+                if (i < std::size(line) && line[i].Is(")")) {
+                    ++i;
+                    break;
+                }
+                if (macro.variadic_ || i == std::size(line) || !line[i].Is(",")) {
+                    ErrorReport("expected ',' or ')' in macro parameter list");
+                    return;
+                }
+                ++i;
+            }
+        }
+    }
+
+    macro.body_.assign(std::begin(line) + i, std::end(line));
+    if (!std::empty(macro.body_)) {
+        macro.body_.front().leading_space_ = false;
+        if (macro.body_.front().Is("##") || macro.body_.back().Is("##")) {
+            ErrorReport("'##' cannot appear at either end of a macro expansion");
+            return;
+        }
+    }
+
+    if (macro.function_like_) {
+        for (std::size_t j{}; j < std::size(macro.body_); ++j) {
+            if (macro.body_[j].Is("#") &&
+                (j + 1 == std::size(macro.body_) ||
+                 std::find(std::begin(macro.params_), std::end(macro.params_),
+                           macro.body_[j + 1].symbol_) == std::end(macro.params_) ||
+                 macro.body_[j + 1].kind_ != PPTokenKind::kIdentifier)) {
+                ErrorReport("'#' is not followed by a macro parameter");
+                return;
+            }
+        }
+    }
+
+    macros_[line.front().symbol_] = std::move(macro);
+}
+
+void Preprocessor::HandleUndef(const std::vector<PPToken> &line) {
+    if (std::empty(line) || line.front().kind_ != PPTokenKind::kIdentifier) {
+        ErrorReport("macro names must be identifiers");
+        return;
+    }
+    macros_.erase(line.front().symbol_);
+}
+
+void Preprocessor::HandleInclude(const std::vector<PPToken> &line, bool include_next, bool first_directive) {
+    auto tokens{line};
+    if (!std::empty(tokens) && tokens.front().kind_ != PPTokenKind::kString && !tokens.front().Is("<")) {
+        tokens = ExpandList(std::move(tokens));
+    }
+
+    std::string header;
+    bool quoted{false};
+    if (!std::empty(tokens) && tokens.front().kind_ == PPTokenKind::kString &&
+        tokens.front().text_.front() == '"') {
+        header = tokens.front().text_.substr(1, std::size(tokens.front().text_) - 2);
+        quoted = true;
+    } else if (!std::empty(tokens) && tokens.front().Is("<")) {
+        auto iter{std::begin(tokens) + 1};
+        for (; iter != std::end(tokens) && !iter->Is(">"); ++iter) {
+            if (iter->leading_space_ && iter != std::begin(tokens) + 1) {
+                header.push_back(' ');
+            }
+            header.append(iter->text_);
+        }
+        if (iter == std::end(tokens)) {
+            ErrorReport("missing terminating > character");
+            return;
+        }
+    } else {
+        ErrorReport("#include expects \"FILENAME\" or <FILENAME>");
+        return;
+    }
+
+    if (std::size(contexts_) >= kMaxIncludeDepth) {
+        ErrorReport("#include nested depth " + std::to_string(kMaxIncludeDepth) + " exceeds maximum");
+        return;
+    }
+
+    std::string path;
+    std::size_t include_dir{};
+    const SourceFile *file{nullptr};
+    if (FindInclude(header, quoted, include_next, path, include_dir)) {
+        if (first_directive && options_.use_precompiled_headers_ && std::empty(output_) &&
+            LoadPrecompiledHeader(path)) {
+            return;
+        }
+        file = LoadFile(path);
+    }
+    if (!file) {
+        // 与gcc一样, 找不到头文件是致命错误, 不再继续预处理
+        ErrorReport(header + ": No such file or directory");
+        ClearContexts();
+        return;
+    }
+
+    // 有#pragma once或者保护宏已经定义的文件不需要再读一遍
+    if (once_files_.find(file) != std::end(once_files_) ||
+        (file->guard_ != kEmptySymbol && IsDefined(file->guard_))) {
+        return;
+    }
+    PushFile(file, include_dir);
+    // -ftime-trace中每个头文件一个区间, 文件读完弹出时结束
+    if (llvm::getTimeTraceProfilerInstance()) {
+        llvm::timeTraceProfilerBegin("Source", file->name_);
+        contexts_.back().traced_ = true;
+    }
+}
+
+void Preprocessor::HandleIf(const std::vector<PPToken> &line, std::string_view directive) {
+    bool value;
+    if (directive == "if") {
+        value = EvaluateCondition(line);
+    } else {
+        if (std::empty(line) || line.front().kind_ != PPTokenKind::kIdentifier) {
+            ErrorReport("no macro name given in #" + std::string{directive} + " directive");
+            value = false;
+        } else {
+            value = IsDefined(line.front().symbol_) == (directive == "ifdef");
+        }
+    }
+
+    conditionals_.push_back({value, false});
+    if (!value) {
+        SkipGroup();
+    }
+}
+
+void Preprocessor::HandleElif(const std::vector<PPToken> &line) {
+    if (std::size(conditionals_) <= CurrentFile()->conditional_depth_) {
+        ErrorReport("#elif without #if");
+        return;
+    }
+
+    auto &conditional{conditionals_.back()};
+    if (conditional.seen_else_) {
+        ErrorReport("#elif after #else");
+    }
+    if (conditional.taken_) {
+        SkipGroup();
+    } else if (EvaluateCondition(line)) {
+        conditionals_.back().taken_ = true;
+    } else {
+        SkipGroup();
+    }
+}
+
+void Preprocessor::HandleElse() {
+    if (std::size(conditionals_) <= CurrentFile()->conditional_depth_) {
+        ErrorReport("#else without #if");
+        return;
+    }
+
+    auto &conditional{conditionals_.back()};
+    if (conditional.seen_else_) {
+        ErrorReport("#else after #else");
+    }
+    conditional.seen_else_ = true;
+    if (conditional.taken_) {
+        SkipGroup();
+    } else {
+        conditional.taken_ = true;
+    }
+}
+
+void Preprocessor::HandleEndif() {
+    if (std::size(conditionals_) <= CurrentFile()->conditional_depth_) {
+        ErrorReport("#endif without #if");
+        return;
+    }
+    conditionals_.pop_back();
+}
+
+void Preprocessor::HandleLine(const PPToken &hash, std::vector<PPToken> line) {
+    if (!std::empty(line) && line.front().kind_ != PPTokenKind::kNumber) {
+        line = ExpandList(std::move(line));
+    }
+
+    if (std::empty(line) || line.front().kind_ != PPTokenKind::kNumber ||
+        line.front().text_.find_first_not_of("0123456789") != std::string_view::npos) {
+        ErrorReport("#line directive requires a simple digit sequence");
+        return;
+    }
+
+    auto context{CurrentFile()};
+    auto number{std::strtoll(std::string{line.front().text_}.c_str(), nullptr, 10)};
+    // 行号指定的是下一行
+    context->line_delta_ = number - (static_cast<std::int64_t>(hash.line_) + 1);
+
+    if (std::size(line) > 1) {
+        if (line[1].kind_ != PPTokenKind::kString || line[1].text_.front() != '"') {
+            ErrorReport("invalid filename in #line directive");
+            return;
+        }
+        context->presumed_name_ = line[1].text_.substr(1, std::size(line[1].text_) - 2);
+    }
+    need_line_marker_ = true;
+}
+
+void Preprocessor::HandlePragma(const std::vector<PPToken> &line) {
+    if (std::size(line) == 1 && line.front().Is("once")) {
+        once_files_.insert(CurrentFile()->file_);
+        return;
+    }
+
+    // 原样输出, Scanner会跳过以#开头的行
+    if (!std::empty(output_) && output_.back() != '\n') {
+        output_.push_back('\n');
+    }
+    output_ += "#pragma " + Spell(line) + '\n';
+    need_line_marker_ = true;
+}
+
+void Preprocessor::SkipGroup() {
+    auto &context{contexts_.back()};
+    std::int32_t depth{};
+
+    for (; context.current_ != context.end_; ++context.current_) {
+        auto token{context.current_};
+        if (!token->begin_of_line_ || !token->Is("#") || token + 1 == context.end_ ||
+            token[1].begin_of_line_) {
+            continue;
+        }
+
+        auto name{token[1].text_};
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            ++depth;
+        } else if (name == "endif") {
+            if (depth == 0) {
+                return;
+            }
+            --depth;
+        } else if ((name == "elif" || name == "else") && depth == 0) {
+            return;
+        }
+    }
+}
+
+bool Preprocessor::IsDefined(SymbolId name) const {
+    return name == file_macro_ || name == line_macro_ || macros_.find(name) != std::end(macros_);
+}
+
+bool Preprocessor::EvaluateCondition(const std::vector<PPToken> &line) {
+    // 先处理defined, 再展开宏, 剩下的标识符在求值时当作0
+    std::vector<PPToken> tokens;
+    for (std::size_t i{}; i < std::size(line); ++i) {
+        if (line[i].kind_ != PPTokenKind::kIdentifier || line[i].symbol_ != defined_) {
+            tokens.push_back(line[i]);
+            continue;
+        }
+
+        bool paren{i + 1 < std::size(line) && line[i + 1].Is("(")};
+        auto j{i + 1 + paren};
+        if (j >= std::size(line) || line[j].kind_ != PPTokenKind::kIdentifier) {
+            ErrorReport("operator \"defined\" requires an identifier");
+            return false;
+        }
+        if (paren && (j + 1 >= std::size(line) || !line[j + 1].Is(")"))) {
+            ErrorReport("missing ')' after \"defined\"");
+            return false;
+        }
+
+        tokens.push_back(MakeToken(PPTokenKind::kNumber, IsDefined(line[j].symbol_) ? "1" : "0"));
+        i = j + paren;
+    }
+
+    tokens = ExpandList(std::move(tokens));
+
+    std::int64_t value{};
+    std::string error;
+    if (!ConditionEvaluator{tokens}.Evaluate(value, error)) {
+        ErrorReport(error);
+        return false;
+    }
+    return value != 0;
+}
+
+bool Preprocessor::FindInclude(const std::string &header, bool quoted, bool include_next,
+                               std::string &path, std::size_t &include_dir) {
+    namespace fs = std::filesystem;
+    std::error_code error_code;
+
+    if (!std::empty(header) && header.front() == '/') {
+        path = header;
+        include_dir = kNotFromSearchPath;
+        return fs::is_regular_file(path, error_code);
+    }
+
+    std::size_t begin{};
+    auto current{CurrentFile()};
+    if (include_next && current->include_dir_ != kNotFromSearchPath) {
+        begin = current->include_dir_ + 1;
+    } else if (quoted) {
+        // 引号形式先在当前文件所在的目录中查找
+        auto candidate{fs::path{current->file_->name_}.parent_path() / header};
+        if (fs::is_regular_file(candidate, error_code)) {
+            path = candidate.string();
+            include_dir = kNotFromSearchPath;
+            return true;
+        }
+    }
+
+    for (auto i{begin}; i < std::size(include_dirs_); ++i) {
+        if (std::empty(include_dirs_[i])) {
+            for (const auto &builtin:kBuiltinHeaders) {
+                if (builtin.name == header) {
+                    path = std::string{kBuiltinDir} + '/' + header;
+                    include_dir = i;
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        auto candidate{include_dirs_[i] + '/' + header};
+        if (fs::is_regular_file(candidate, error_code)) {
+            path = std::move(candidate);
+            include_dir = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Preprocessor::LoadPrecompiledHeader(const std::string &path) {
+    auto precompiled_header{std::make_shared<PrecompiledHeader>()};
+    if (!precompiled_header->Load(path + ".pch", GetOptionsHash(), interner_)) {
+        return false;
+    }
+
+    // 预编译头文件中的宏包括预定义宏, 直接替换整个宏表
+    macros_ = precompiled_header->GetMacros();
+    for (const auto &once_file:precompiled_header->GetOnceFiles()) {
+        if (auto file{LoadFile(once_file)}) {
+            once_files_.insert(file);
+        }
+    }
+
+    output_.append(precompiled_header->GetText());
+    need_line_marker_ = true;
+    precompiled_header_ = std::move(precompiled_header);
+    return true;
+}
+
+std::uint64_t Preprocessor::GetOptionsHash() const {
+    // FNV-1a, 每个字符串之后加一个分隔符
+    std::uint64_t hash{14695981039346656037ull};
+    auto add{[&hash](std::string_view string) {
+        for (auto c:string) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        hash = (hash ^ 0xffu) * 1099511628211ull;
+    }};
+
+    add(std::to_string(sizeof(Token)));
+    for (const auto &dir:include_dirs_) {
+        add(dir);
+    }
+    for (const auto &[name, value]:options_.defines_) {
+        add(name);
+        add(value);
+    }
+    for (const auto &name:options_.undefines_) {
+        add(name);
+    }
+    return hash;
+}
+
+void Preprocessor::Emit(const PPToken &token) {
+    first_directive_ = false;
+    auto line{static_cast<std::int64_t>(token.line_) + CurrentFile()->line_delta_};
+
+    if (need_line_marker_ || (token.begin_of_line_ && (line < output_line_ || line > output_line_ + 8))) {
+        EmitLineMarker(line);
+    } else if (token.begin_of_line_ && line > output_line_) {
+        output_.append(line - output_line_, '\n');
+        output_line_ = line;
+    }
+
+    if (!std::empty(output_) && output_.back() != '\n') {
+        auto last{output_.back()};
+        auto first{token.text_.front()};
+        // 宏展开的结果中相邻的记号可能会被重新扫描成一个记号, 例如 - -x
+        bool need_space{token.leading_space_};
+        if (!need_space) {
+            auto is_word{[](PPTokenKind kind) {
+                return kind == PPTokenKind::kIdentifier || kind == PPTokenKind::kNumber;
+            }};
+            if (is_word(last_kind_)) {
+                need_space = is_word(token.kind_) || token.kind_ == PPTokenKind::kString ||
+                             token.kind_ == PPTokenKind::kCharacter ||
+                             (last_kind_ == PPTokenKind::kNumber && (first == '.' || first == '+' || first == '-'));
+            } else if (last_kind_ == PPTokenKind::kPunctuator && token.kind_ == PPTokenKind::kPunctuator) {
+                need_space = std::string_view{"+-<>=!&|*/%^#:."}.find(last) != std::string_view::npos &&
+                             std::string_view{"+-<>=&|*/%#:."}.find(first) != std::string_view::npos;
+            }
+        }
+        if (need_space) {
+            output_.push_back(' ');
+        }
+    }
+
+    output_.append(token.text_);
+    last_kind_ = token.kind_;
+}
+
+void Preprocessor::EmitLineMarker(std::int64_t line) {
+    if (!std::empty(output_) && output_.back() != '\n') {
+        output_.push_back('\n');
+    }
+    output_ += "# " + std::to_string(line) + " \"" + CurrentFile()->presumed_name_ + "\"\n";
+    output_line_ = line;
+    need_line_marker_ = false;
+}
+
+void Preprocessor::ErrorReport(const std::string &msg) {
+    auto file{CurrentFile()};
+    if (!file) {
+        diagnostics_.emplace_back(std::string{kBuiltinDir}, 1, 1, msg);
+        return;
+    }
+
+    std::uint32_t column{1};
+    if (file->current_ != std::data(file->file_->tokens_)) {
+        column = (file->current_ - 1)->column_;
+    }
+    diagnostics_.emplace_back(file->presumed_name_, CurrentLine(), column, msg);
+}
+
+void Preprocessor::WarningReport(const std::string &msg) {
+    ErrorReport(msg);
+    diagnostics_.back().warning_ = true;
+}
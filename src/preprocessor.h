@@ -0,0 +1,169 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_PREPROCESSOR_H
+#define TINY_C_COMPILER_PREPROCESSOR_H
+
+#include "pp_token.h"
+#include "include_cache.h"
+#include "pch.h"
+#include "interner.h"
+#include "diagnostic.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class PreprocessorOptions {
+public:
+    // -I 指定的目录, 先于系统目录搜索
+    std::vector<std::string> include_paths_;
+    std::vector<std::string> system_include_paths_{"/usr/local/include",
+                                                   "/usr/include/x86_64-linux-gnu",
+                                                   "/usr/include"};
+    // -D name=value, 没有值时为"1"
+    std::vector<std::pair<std::string, std::string>> defines_;
+    std::vector<std::string> undefines_;
+    // 主文件的第一条指令包含的头文件旁边有有效的.pch文件时使用它
+    bool use_precompiled_headers_{true};
+};
+
+// 在进程内完成预处理, 输出带有行标记的文本, 可以直接交给Scanner扫描
+// 不依赖gcc, 编译器相关的头文件(stddef.h, stdarg.h等)内置在程序中
+class Preprocessor {
+public:
+    // 头文件通过cache读取, 多个Preprocessor可以在不同的线程中共享同一个cache
+    explicit Preprocessor(const PreprocessorOptions &options = {},
+                          IncludeCache &cache = IncludeCache::Global());
+
+    // 返回的字符串以'\0'结尾, 满足Scanner对借用缓冲区的要求
+    std::string Preprocess(const std::string &file_name);
+    // 预处理一段内存中的源代码, buffer_name用于行标记和错误信息
+    std::string PreprocessBuffer(std::string_view input, const std::string &buffer_name);
+
+    // 预处理header并把结果写入pch_file
+    bool EmitPrecompiledHeader(const std::string &header, const std::string &pch_file);
+    // 上一次预处理使用的预编译头文件, 输出的开头就是它的文本, 可以把其中的记号直接交给Scanner
+    const PrecompiledHeader *GetPrecompiledHeader() const;
+
+    const DiagnosticList &GetDiagnostics() const;
+    bool HasErrors() const;
+private:
+    enum class ContextKind {
+        kFile,
+        kMacro,
+        kList
+    };
+
+    // 输入是一个上下文栈, 宏展开的结果作为新的上下文压入栈顶
+    struct Context {
+        ContextKind kind_{ContextKind::kFile};
+        const PPToken *current_{nullptr};
+        const PPToken *end_{nullptr};
+        std::vector<PPToken> owned_;
+        // 以下只对文件上下文有意义
+        const SourceFile *file_{nullptr};
+        std::string presumed_name_;
+        std::int64_t line_delta_{};
+        std::size_t include_dir_{};
+        std::size_t conditional_depth_{};
+        // 在time trace中有一个未结束的区间
+        bool traced_{false};
+    };
+
+    struct Conditional {
+        bool taken_{false};
+        bool seen_else_{false};
+    };
+
+    void DefineBuiltins();
+    const SourceFile *LoadFile(const std::string &path);
+    const SourceFile *AddFile(std::shared_ptr<const SourceFile> file);
+    void PushFile(const SourceFile *file, std::size_t include_dir);
+    void PushTokens(ContextKind kind, std::vector<PPToken> tokens);
+    // 结束所有文件的time trace区间后清空上下文栈
+    void ClearContexts();
+    std::string Run(const SourceFile *file);
+
+    const PPToken *PeekRaw();
+    PPToken NextRaw();
+    Context *CurrentFile();
+    std::uint32_t CurrentLine();
+    std::vector<PPToken> ReadLine();
+    std::vector<PPToken> ExpandList(std::vector<PPToken> tokens);
+
+    bool TryExpand(const PPToken &name);
+    bool ExpandBuiltin(const PPToken &name);
+    bool CollectArgs(const Macro &macro, std::vector<std::vector<PPToken>> &args, PPToken &right_paren);
+    std::vector<PPToken> Substitute(const Macro &macro, const std::vector<std::vector<PPToken>> &args,
+                                    const PPToken &name);
+    PPToken Stringize(const std::vector<PPToken> &arg);
+    bool Paste(PPToken &lhs, const PPToken &rhs);
+    PPToken MakeToken(PPTokenKind kind, std::string_view text);
+    static HideSet Union(const HideSet &lhs, const HideSet &rhs);
+    static HideSet Intersect(const HideSet &lhs, const HideSet &rhs);
+    static HideSet Add(const HideSet &hide_set, SymbolId name);
+
+    void HandleDirective(const PPToken &hash);
+    void HandleDefine(const std::vector<PPToken> &line);
+    void HandleUndef(const std::vector<PPToken> &line);
+    void HandleInclude(const std::vector<PPToken> &line, bool include_next, bool first_directive);
+    void HandleIf(const std::vector<PPToken> &line, std::string_view directive);
+    void HandleElif(const std::vector<PPToken> &line);
+    void HandleElse();
+    void HandleEndif();
+    void HandleLine(const PPToken &hash, std::vector<PPToken> line);
+    void HandlePragma(const std::vector<PPToken> &line);
+    void SkipGroup();
+
+    bool IsDefined(SymbolId name) const;
+    bool EvaluateCondition(const std::vector<PPToken> &line);
+    bool FindInclude(const std::string &header, bool quoted, bool include_next,
+                     std::string &path, std::size_t &include_dir);
+    bool LoadPrecompiledHeader(const std::string &path);
+    std::uint64_t GetOptionsHash() const;
+
+    void Emit(const PPToken &token);
+    void EmitLineMarker(std::int64_t line);
+
+    void ErrorReport(const std::string &msg);
+    void WarningReport(const std::string &msg);
+
+    PreprocessorOptions options_;
+    IncludeCache &cache_;
+    Interner &interner_;
+    DiagnosticList diagnostics_;
+
+    std::unordered_map<SymbolId, Macro> macros_;
+    // 本次预处理用到的文件, 保证它们在预处理期间有效, 并且同一个路径总是对应同一个文件
+    std::unordered_map<std::string, std::shared_ptr<const SourceFile>> files_;
+    std::unordered_set<const SourceFile *> once_files_;
+    std::vector<Context> contexts_;
+    std::vector<Conditional> conditionals_;
+    // 依次为-I目录, 内置头文件(用空字符串表示)和系统目录, #include_next从找到当前文件的下一项开始
+    std::vector<std::string> include_dirs_;
+    std::shared_ptr<const SourceFile> builtin_source_;
+
+    SymbolId defined_;
+    SymbolId va_args_;
+    SymbolId file_macro_;
+    SymbolId line_macro_;
+
+    std::shared_ptr<const PrecompiledHeader> precompiled_header_;
+    // 主文件中还没有出现过任何记号和指令
+    bool first_directive_{false};
+
+    std::string output_;
+    bool need_line_marker_{true};
+    std::int64_t output_line_{};
+    PPTokenKind last_kind_{PPTokenKind::kEnd};
+};
+
+#endif //TINY_C_COMPILER_PREPROCESSOR_H
@@ -4,27 +4,96 @@
 
 //TODO 各种类型后缀
 #include "scanner.h"
-#include <fstream>
+#include "char_scan.h"
 #include <cstdlib>
 #include <iterator>
 #include <iostream>
-#include <cctype>
-#include <filesystem>
-#include <sstream>
-
-Scanner::Scanner(const std::string &file_name) {
-    std::ifstream ifs{file_name};
-    if (!ifs) {
+#include <algorithm>
+#include <limits>
+#include <cassert>
+#include <cerrno>
+
+Scanner::Scanner(const std::string &file_name, Interner &interner) :
+        file_name_{file_name}, file_{file_name}, interner_{interner} {
+    if (!file_.IsOpen()) {
         ErrorReport("When trying to open file " + file_name + ", occurred error.");
+        return;
+    }
+
+    input_ = file_.GetBuffer();
+    if (std::size(input_) > std::numeric_limits<std::uint32_t>::max()) {
+        input_ = "";
+        ErrorReport("File " + file_name + " is too large.");
+    }
+}
+
+Scanner::Scanner(std::string_view input, const std::string &buffer_name, Interner &interner) :
+        file_name_{buffer_name}, input_{input}, interner_{interner} {
+    // 扫描时依赖结尾的'\0'作为哨兵, 省去边界检查
+    assert(std::data(input) != nullptr && std::data(input)[std::size(input)] == '\0');
+    if (std::size(input_) > std::numeric_limits<std::uint32_t>::max()) {
+        input_ = "";
+        ErrorReport("Buffer " + buffer_name + " is too large.");
     }
+}
+
+const DiagnosticList &Scanner::GetDiagnostics() const {
+    return diagnostics_;
+}
+
+bool Scanner::HasErrors() const {
+    return !std::empty(diagnostics_);
+}
+
+const std::string &Scanner::GetFileName() const {
+    return file_name_;
+}
 
-    std::ostringstream ost;
-    std::string line;
-    while (std::getline(ifs, line)) {
-        ost << line << '\n';
+std::string_view Scanner::GetInput() const {
+    return input_;
+}
+
+Diagnostic Scanner::MakeDiagnostic(std::uint32_t offset, const std::string &message) const {
+    Diagnostic diagnostic{file_name_, input_, offset, message};
+
+    // 从出错的行向前找行标记, 只在报告错误时执行
+    auto line_begin{std::min<std::size_t>(offset, std::size(input_))};
+    while (line_begin > 0 && input_[line_begin - 1] != '\n') {
+        --line_begin;
     }
 
-    input_ = ost.str();
+    for (std::uint32_t lines{1}; line_begin > 0; ++lines) {
+        auto line_end{line_begin - 1};
+        auto prev{line_end == 0 ? std::string_view::npos : input_.rfind('\n', line_end - 1)};
+        line_begin = prev == std::string_view::npos ? 0 : prev + 1;
+
+        auto line{input_.substr(line_begin, line_end - line_begin)};
+        if (std::empty(line) || line.front() != '#') {
+            continue;
+        }
+
+        std::size_t i{1};
+        while (i < std::size(line) && line[i] == ' ') {
+            ++i;
+        }
+        std::uint32_t number{};
+        auto digits_begin{i};
+        while (i < std::size(line) && IsDigit(line[i])) {
+            number = number * 10 + static_cast<std::uint32_t>(line[i++] - '0');
+        }
+        if (i == digits_begin) {
+            continue;
+        }
+
+        diagnostic.line_ = number + lines - 1;
+        if (auto name_begin{line.find('"', i)}; name_begin != std::string_view::npos) {
+            if (auto name_end{line.find('"', name_begin + 1)}; name_end != std::string_view::npos) {
+                diagnostic.file_name_ = line.substr(name_begin + 1, name_end - name_begin - 1);
+            }
+        }
+        break;
+    }
+    return diagnostic;
 }
 
 std::vector<Token> Scanner::GetTokenSequence() {
@@ -38,27 +107,74 @@ std::vector<Token> Scanner::GetTokenSequence() {
     return ret;
 }
 
+const Token &Scanner::Peek(std::size_t k) {
+    assert(k < kMaxLookahead);
+
+    while (lookahead_count_ <= k) {
+        lookahead_[(lookahead_head_ + lookahead_count_) % kMaxLookahead] = GetNextToken();
+        ++lookahead_count_;
+    }
+    return lookahead_[(lookahead_head_ + k) % kMaxLookahead];
+}
+
+Token Scanner::Next() {
+    auto token{Peek()};
+    lookahead_head_ = (lookahead_head_ + 1) % kMaxLookahead;
+    --lookahead_count_;
+    return token;
+}
+
+void Scanner::UsePrecompiled(const std::vector<Token> &tokens, std::uint32_t length) {
+    precompiled_ = tokens;
+    precompiled_index_ = 0;
+    index_ = std::min<decltype(index_)>(length, std::size(input_));
+}
+
+std::string_view Scanner::GetTokenName(const Token &token) const {
+    if (token.GetTokenType() == TokenType::kEof) {
+        return "end of file";
+    }
+    return input_.substr(token.GetOffset(), token.GetLength());
+}
+
+std::string_view Scanner::GetStringValue(const Token &token) const {
+    return interner_.GetSpelling(token.GetSymbol());
+}
+
+std::uint64_t Scanner::GetTokenCount() const {
+    return token_count_;
+}
+
+// 输入之后总有一个'\0'作为哨兵, 只有读到它时才需要判断是否到达末尾
+// 到达末尾后index_停在哨兵上, 由at_end_记录, 使PutBack对EOF也是对称的
 char Scanner::GetChar() {
-    if (index_ == std::size(input_)) {
+    current_char_ = std::data(input_)[index_];
+    if (current_char_ == '\0' && index_ == std::size(input_)) {
         current_char_ = EOF;
+        at_end_ = true;
     } else {
-        current_char_ = input_[index_++];
+        ++index_;
     }
 
     return current_char_;
 }
 
 char Scanner::PeekChar() const {
-    if (index_ == std::size(input_)) {
-        return EOF;
-    } else {
-        return input_[index_];
-    }
+    return std::data(input_)[index_];
 }
 
 void Scanner::PutBack() {
-    --index_;
-    current_char_ = input_[index_ - 1];
+    if (at_end_) {
+        at_end_ = false;
+    } else {
+        --index_;
+    }
+
+    if (index_ == 0) {
+        current_char_ = EOF;
+    } else {
+        current_char_ = input_[index_ - 1];
+    }
 }
 
 void Scanner::Clear() {
@@ -67,92 +183,121 @@ void Scanner::Clear() {
 }
 
 Token Scanner::GetNextToken() {
-    bool matched = false;
+    if (precompiled_index_ < std::size(precompiled_)) {
+        token_ = precompiled_[precompiled_index_++];
+        ++token_count_;
+        return token_;
+    }
 
-    try {
-        do {
-            if (state_ != State::kNone) {
-                matched = true;
-            }
+    bool matched = false;
 
-            switch (state_) {
-                case State::kNone:GetChar();
-                    break;
+    do {
+        if (state_ != State::kNone) {
+            matched = true;
+        }
 
-                case State::kIdentifier:HandleIdentifierOrKeyword();
-                    break;
+        switch (state_) {
+            case State::kNone:GetChar();
+                break;
 
-                case State::kNumber:HandleNumber();
-                    break;
+            case State::kIdentifier:HandleIdentifierOrKeyword();
+                break;
 
-                case State::kString:HandleString();
-                    break;
+            case State::kNumber:HandleNumber();
+                break;
 
-                case State::kCharacter:HandleChar();
-                    break;
+            case State::kString:HandleString();
+                break;
 
-                case State::kOperators:HandleOperatorOrDelimiter();
-                    break;
+            case State::kCharacter:HandleChar();
+                break;
 
-                default:ErrorReport("Match token state error.");
-            }
+            case State::kOperators:HandleOperatorOrDelimiter();
+                break;
 
-            if (state_ == State::kNone) {
-                Skip();
+            default:ErrorReport("Match token state error.");
+        }
 
-                if (current_char_ == EOF) {
-                    MakeToken(TokenType::kEof, TokenValue::kUnreserved, "end of file", -1);
-                    Clear();
-                    return token_;
+        if (state_ == State::kNone) {
+            Skip();
+            token_begin_ = index_ - 1;
+
+            if (current_char_ == EOF) {
+                token_begin_ = std::size(input_);
+                MakeToken(TokenType::kEof, TokenValue::kUnreserved, -1);
+                Clear();
+                return token_;
+            } else {
+                if (IsIdentifierHead(current_char_)) {
+                    state_ = State::kIdentifier;
+                } else if (IsDigit(current_char_) || (current_char_ == '.' && IsDigit(PeekChar()))) {
+                    state_ = State::kNumber;
+                } else if (current_char_ == '\"') {
+                    state_ = State::kString;
+                } else if (current_char_ == '\'') {
+                    state_ = State::kCharacter;
                 } else {
-                    if (std::isalpha(current_char_) || current_char_ == '_') {
-                        state_ = State::kIdentifier;
-                    } else if (std::isdigit(current_char_) || (current_char_ == '.' && std::isdigit(PeekChar()))) {
-                        state_ = State::kNumber;
-                    } else if (current_char_ == '\"') {
-                        state_ = State::kString;
-                    } else if (current_char_ == '\'') {
-                        state_ = State::kCharacter;
-                    } else {
-                        state_ = State::kOperators;
-                    }
+                    state_ = State::kOperators;
                 }
             }
-        } while (!matched);
-    } catch (const std::out_of_range &err) {
-        MakeToken(TokenType::kEof, TokenValue::kUnreserved, "end of file", -1);
-        Clear();
-        return token_;
-    }
+        }
+    } while (!matched);
 
     Clear();
+    ++token_count_;
     return token_;
 }
 
+// 只记录错误并继续扫描, 由调用者决定如何处理
 void Scanner::ErrorReport(const std::string &msg) {
-    std::cerr << "Token error: " << msg << '\n';
-    exit(EXIT_FAILURE);
+    auto offset{index_ == 0 ? 0 : index_ - 1};
+    diagnostics_.push_back(MakeDiagnostic(static_cast<std::uint32_t>(offset), msg));
 }
 
 void Scanner::Skip() {
-    do {
-        while (std::isspace(current_char_)) {
-            GetChar();
+    while (true) {
+        if (IsSpace(current_char_)) {
+            SkipTo(SkipWhitespace(InputAt(index_), InputEnd()));
+        } else if (current_char_ == '#') {
+            HandleWell();
+        } else if (current_char_ == '/' && (PeekChar() == '/' || PeekChar() == '*')) {
+            HandleComment();
+        } else {
+            break;
         }
-        HandleWell();
-    } while (std::isspace(current_char_));
+    }
 }
 
 void Scanner::HandleWell() {
-    if (current_char_ == '#') {
-        while (current_char_ != '\n') {
-            if (GetChar() == EOF) {
-                throw std::out_of_range("eof");
-            }
+    SkipTo(FindLineEnd(InputAt(index_), InputEnd()));
+}
+
+void Scanner::HandleComment() {
+    if (PeekChar() == '/') {
+        SkipTo(FindLineEnd(InputAt(index_), InputEnd()));
+    } else {
+        auto comment_end{FindCommentEnd(InputAt(index_ + 1), InputEnd())};
+        if (comment_end == InputEnd()) {
+            ErrorReport("unterminated comment");
         }
+        SkipTo(comment_end + 2);
     }
 }
 
+const char *Scanner::InputAt(decltype(input_)::size_type index) const {
+    return std::data(input_) + std::min(index, std::size(input_));
+}
+
+const char *Scanner::InputEnd() const {
+    return std::data(input_) + std::size(input_);
+}
+
+void Scanner::SkipTo(const char *position) {
+    index_ = static_cast<decltype(index_)>(position - std::data(input_));
+    at_end_ = false;
+    GetChar();
+}
+
 void Scanner::HandleEscape() {
     std::string buffer;
 
@@ -184,20 +329,24 @@ void Scanner::HandleEscape() {
             if (current_char_ == 'x' || current_char_ == 'X') {
                 GetChar();
                 std::string num;
-                while (std::isdigit(current_char_)) {
+                while (IsHexDigit(current_char_)) {
                     num.push_back(current_char_);
                     if (std::size(num) == 2) {
                         break;
                     }
                     GetChar();
                 }
+                if (!IsHexDigit(current_char_)) {
+                    PutBack();
+                }
 
                 if (std::size(num) == 0) {
                     ErrorReport("miss number");
+                    return;
                 }
 
-                current_char_ = static_cast<char>(std::stoi(num, nullptr, 16));
-            } else if (std::isdigit(current_char_)) {
+                current_char_ = static_cast<char>(std::strtol(num.c_str(), nullptr, 16));
+            } else if (IsDigit(current_char_)) {
                 std::string num;
                 do {
                     num.push_back(current_char_);
@@ -205,85 +354,41 @@ void Scanner::HandleEscape() {
                         break;
                     }
                     GetChar();
-                } while (std::isdigit(current_char_));
-
-                if (std::size(num) == 0) {
-                    ErrorReport("miss number");
+                } while (IsDigit(current_char_));
+                if (!IsDigit(current_char_)) {
+                    PutBack();
                 }
 
-                current_char_ = static_cast<char>(std::stoi(num, nullptr, 8));
+                current_char_ = static_cast<char>(std::strtol(num.c_str(), nullptr, 8));
             }
             break;
     }
 }
 
 void Scanner::HandleString() {
-    GetChar();
-    bool ok{false};
-    bool escape_quotes{false};
-    bool new_line{false};
-
-    while (!new_line) {
-        if (current_char_ == EOF) {
-            throw std::out_of_range("eof");
-        } else if (current_char_ == '\"' && !escape_quotes) {
-            ok = true;
+    while (true) {
+        auto special{FindStringSpecial(InputAt(index_), InputEnd())};
+        buffer_.append(InputAt(index_), special);
+        SkipTo(special);
+
+        if (current_char_ == EOF || current_char_ == '\n') {
+            ErrorReport("missing terminating \" character");
             break;
-        }
-        buffer_.push_back(current_char_);
-        GetChar();
-        escape_quotes = false;
-        if (current_char_ == '\n') {
-            new_line = true;
         } else if (current_char_ == '\\') {
             HandleEscape();
-            if (current_char_ == '\"') {
-                escape_quotes = true;
-            }
-            if (current_char_ == '\n') {
-                new_line = false;
-            }
+            buffer_.push_back(current_char_);
+            continue;
         }
-    }
-
-    if (!ok) {
-        ErrorReport("string error");
-    }
 
-    while (std::isspace(PeekChar())) {
-        for (auto i{index_ + 1};; ++i) {
-            if (i >= std::size(input_)) {
-                MakeToken(TokenType::kString, TokenValue::kUnreserved, buffer_, buffer_);
-                return;
-            }
-            if (std::isspace(input_[i])) {
-                continue;
-            } else if (input_[i] == '\"') {
-                index_ = i;
-                GetChar();
-
-                GetChar();
-                bool ok2{false};
-
-                while (current_char_ != '\n') {
-                    if (current_char_ == EOF) {
-                        throw std::out_of_range("eof");
-                    } else if (current_char_ == '\"') {
-                        ok2 = true;
-                        break;
-                    }
-                    buffer_.push_back(current_char_);
-                    GetChar();
-                }
-
-                if (!ok2) {
-                    ErrorReport("string error");
-                }
-                break;
-            }
+        // 相邻的字符串字面量合并为一个
+        auto next{SkipWhitespace(InputAt(index_), InputEnd())};
+        if (next == InputEnd() || *next != '\"') {
+            break;
         }
+        index_ = static_cast<decltype(index_)>(next - std::data(input_)) + 1;
     }
-    MakeToken(TokenType::kString, TokenValue::kUnreserved, buffer_, buffer_);
+
+    MakeSymbolToken(TokenType::kString, TokenValue::kUnreserved, 0, buffer_);
 }
 
 void Scanner::HandleChar() {
@@ -297,309 +402,222 @@ void Scanner::HandleChar() {
     GetChar();
     if (current_char_ != '\'') {
         ErrorReport("miss \'");
-    } else {
-        MakeToken(TokenType::kCharacter, TokenValue::kUnreserved, buffer_, buffer_[0]);
+        PutBack();
     }
+    MakeToken(TokenType::kCharacter, std::int64_t{buffer_[0]});
 }
 
+// 先按pp-number确定数字的范围, 再从中解析值和后缀, 出错时整个pp-number成为一个kUnknown记号
 void Scanner::HandleNumber() {
-    if (current_char_ == '.') {
-        buffer_.push_back(current_char_);
-        GetChar();
-        while (std::isdigit(current_char_)) {
-            buffer_.push_back(current_char_);
-            GetChar();
+    auto end{token_begin_ + 1};
+    while (end < std::size(input_)) {
+        auto c{input_[end]};
+        auto prev{input_[end - 1]};
+        if (IsDigit(c) || IsAlpha(c) || c == '_' || c == '.' ||
+            ((c == '+' || c == '-') && (prev == 'e' || prev == 'E' || prev == 'p' || prev == 'P'))) {
+            ++end;
+        } else {
+            break;
         }
-        PutBack();
-        MakeToken(TokenType::kDouble, TokenValue::kUnreserved, buffer_, std::stod(buffer_));
-        return;
     }
+    SkipTo(InputAt(end));
+    PutBack();
 
-    bool is_float{false};
-    bool is_exp{false};
-    bool is_long{false};
-    bool is_sin{false};
-
-    enum class NumberState {
-        kInteger,
-        kFraction,
-        kExp,
-        kDone
-    };
-
-    NumberState number_state{NumberState::kInteger};
-
-    std::int32_t base{10};
+    auto text{input_.substr(token_begin_, end - token_begin_)};
+    auto length{std::size(text)};
+    bool is_hex{length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')};
+    auto is_digit{[is_hex](char c) { return is_hex ? IsHexDigit(c) : IsDigit(c); }};
 
-    if (current_char_ == '0') {
-        base = 8;
+    std::size_t i{is_hex ? 2u : 0u};
+    auto digits_begin{i};
+    while (i < length && is_digit(text[i])) {
+        ++i;
     }
+    auto integer_digits{i - digits_begin};
 
-    buffer_.push_back(current_char_);
-    GetChar();
-
-    if (current_char_ == 'x' || current_char_ == 'X') {
-        if (std::size(buffer_) == 1 && buffer_.front() == '0') {
-            base = 16;
-            buffer_.push_back(current_char_);
-            GetChar();
-            if (!std::isdigit(current_char_)) {
-                ErrorReport("number error");
-            }
-        } else {
-            ErrorReport("number error");
+    bool is_float{false};
+    auto error_at{std::string_view::npos};
+    if (i < length && text[i] == '.') {
+        is_float = true;
+        ++i;
+        auto fraction_begin{i};
+        while (i < length && is_digit(text[i])) {
+            ++i;
+        }
+        if (integer_digits == 0 && i == fraction_begin) {
+            error_at = i;
         }
     }
 
-    do {
-        switch (number_state) {
-            case NumberState::kInteger:is_long = HandleDigit();
-                break;
-
-            case NumberState::kFraction:is_sin = HandleFraction();
-                is_float = true;
-                break;
-            case NumberState::kExp:HandleExp();
-                is_exp = true;
-                break;
-            case NumberState::kDone:break;
+    // 十六进制浮点数的指数用p, 且不能省略
+    if (i < length && (is_hex ? (text[i] == 'p' || text[i] == 'P') : (text[i] == 'e' || text[i] == 'E'))) {
+        is_float = true;
+        ++i;
+        if (i < length && (text[i] == '+' || text[i] == '-')) {
+            ++i;
         }
-        if (is_long || is_sin) {
-            break;
+        auto exp_begin{i};
+        while (i < length && IsDigit(text[i])) {
+            ++i;
         }
-        if (current_char_ == '.') {
-            if (is_float) {
-                ErrorReport("Fraction number can not have more than one dot.");
-            }
-            number_state = NumberState::kFraction;
-        } else if (current_char_ == 'e' || current_char_ == 'E') {
-            if (is_exp) {
-                ErrorReport("number error");
-            }
-            number_state = NumberState::kExp;
-        } else if (std::isalpha(current_char_)) {
-            ErrorReport("number error");
-        } else {
-            number_state = NumberState::kDone;
+        if (i == exp_begin) {
+            error_at = std::min(error_at, i);
         }
-    } while (number_state != NumberState::kDone);
-
-    if (is_long) {
-        MakeToken(TokenType::kLongInterger, TokenValue::kUnreserved, buffer_,
-                  std::stol(buffer_, nullptr, base));
-    } else if (is_sin) {
-        MakeToken(TokenType::kFolat, TokenValue::kUnreserved, buffer_,
-                  std::stof(buffer_));
-    } else if (is_float || is_exp) {
-        MakeToken(TokenType::kDouble, TokenValue::kUnreserved, buffer_,
-                  std::stod(buffer_));
-    } else {
-        MakeToken(TokenType::kInterger, TokenValue::kUnreserved, buffer_,
-                  std::stoi(buffer_, nullptr, base));
-    }
-}
-
-bool Scanner::HandleDigit() {
-    if (!std::isdigit(current_char_)) {
-        return false;
-    }
-
-    buffer_.push_back(current_char_);
-    GetChar();
-
-    while (std::isdigit(current_char_)) {
-        buffer_.push_back(current_char_);
-        GetChar();
+    } else if (is_hex && is_float) {
+        error_at = std::min(error_at, i);
     }
-
-    if (current_char_ == 'L' || current_char_ == 'l') {
-        GetChar();
-        return true;
-    }
-    return false;
-}
-
-bool Scanner::HandleFraction() {
-    buffer_.push_back(current_char_);
-
-    if (!std::isdigit(PeekChar())) {
-        GetChar();
-        buffer_.push_back('0');
-        return false;
+    if (!is_float && integer_digits == 0) {
+        error_at = std::min(error_at, i);
     }
 
-    GetChar();
-    while (std::isdigit(current_char_)) {
-        buffer_.push_back(current_char_);
-        GetChar();
+    auto suffix{text.substr(std::min(i, length))};
+    auto number{std::string{text.substr(0, i)}};
+    bool is_unsigned{false};
+    std::int32_t longs{0};
+    bool is_single{false};
+
+    if (error_at == std::string_view::npos) {
+        if (is_float) {
+            if (suffix == "f" || suffix == "F") {
+                is_single = true;
+            } else if (!(std::empty(suffix) || suffix == "l" || suffix == "L")) {
+                error_at = i;
+            }
+        } else {
+            // u, l, ll可以任意顺序组合, ll必须大小写一致
+            auto rest{suffix};
+            if (!std::empty(rest) && (rest.front() == 'u' || rest.front() == 'U')) {
+                is_unsigned = true;
+                rest.remove_prefix(1);
+            }
+            if (rest.substr(0, 2) == "ll" || rest.substr(0, 2) == "LL") {
+                longs = 2;
+                rest.remove_prefix(2);
+            } else if (!std::empty(rest) && (rest.front() == 'l' || rest.front() == 'L')) {
+                longs = 1;
+                rest.remove_prefix(1);
+            }
+            if (!is_unsigned && !std::empty(rest) && (rest.front() == 'u' || rest.front() == 'U')) {
+                is_unsigned = true;
+                rest.remove_prefix(1);
+            }
+            if (!std::empty(rest)) {
+                error_at = i;
+            }
+            if (!is_hex && number[0] == '0') {
+                auto bad{number.find_first_of("89")};
+                if (bad != std::string::npos) {
+                    error_at = std::min(error_at, std::size_t{bad});
+                }
+            }
+        }
     }
 
-    if (current_char_ == 'f' || current_char_ == 'F') {
-        GetChar();
-        return true;
+    if (error_at != std::string_view::npos) {
+        diagnostics_.push_back(MakeDiagnostic(static_cast<std::uint32_t>(token_begin_ + error_at), "number error"));
+        MakeToken(TokenType::kUnknown, TokenValue::kUnreserved, -1);
+        return;
     }
-    return false;
-}
-
-void Scanner::HandleExp() {
-    buffer_.push_back(current_char_);
 
-    if (!std::isdigit(PeekChar())) {
-        if (PeekChar() == '+' || PeekChar() == '-') {
-            GetChar();
-            buffer_.push_back(current_char_);
+    errno = 0;
+    if (is_float) {
+        if (is_single) {
+            MakeToken(TokenType::kFolat, double{std::strtof(number.c_str(), nullptr)});
+        } else {
+            MakeToken(TokenType::kDouble, std::strtod(number.c_str(), nullptr));
+        }
+    } else {
+        auto value{std::strtoull(number.c_str(), nullptr, is_hex ? 16 : (number[0] == '0' ? 8 : 10))};
+        // 依次尝试能容纳这个值的类型, 八进制和十六进制可以是无符号类型
+        auto decimal{!is_hex && number[0] != '0'};
+        constexpr auto kIntMax{static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max())};
+        constexpr auto kUIntMax{static_cast<std::uint64_t>(std::numeric_limits<std::uint32_t>::max())};
+        constexpr auto kLongMax{static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())};
+
+        TokenType type;
+        if (longs == 0 && !is_unsigned && value <= kIntMax) {
+            type = TokenType::kInterger;
+        } else if (longs == 0 && (is_unsigned || !decimal) && value <= kUIntMax) {
+            type = TokenType::kUnsignedInterger;
+        } else if (longs <= 1 && !is_unsigned && value <= kLongMax) {
+            type = TokenType::kLongInterger;
+        } else if (longs <= 1 && (is_unsigned || !decimal)) {
+            type = TokenType::kUnsignedLongInterger;
+        } else if (!is_unsigned && value <= kLongMax) {
+            type = TokenType::kLongLongInterger;
         } else {
-            ErrorReport("number error");
+            type = TokenType::kUnsignedLongLongInterger;
+        }
+
+        switch (type) {
+            case TokenType::kInterger:
+            case TokenType::kLongInterger:
+            case TokenType::kLongLongInterger:MakeToken(type, static_cast<std::int64_t>(value));
+                break;
+            default:MakeToken(type, std::uint64_t{value});
+                break;
         }
     }
 
-    GetChar();
-    while (std::isdigit(current_char_)) {
-        buffer_.push_back(current_char_);
-        GetChar();
+    if (errno == ERANGE) {
+        ErrorReport("number is out of range");
     }
 }
 
 void Scanner::HandleIdentifierOrKeyword() {
-    buffer_.push_back(current_char_);
-    GetChar();
-
-    while (std::isalnum(current_char_) || current_char_ == '_') {
-        buffer_.push_back(current_char_);
-        GetChar();
-    }
+    SkipTo(SkipIdentifier(InputAt(index_), InputEnd()));
     PutBack();
 
-    auto token{dictionary_.LookUp(buffer_)};
-    MakeToken(std::get<0>(token), std::get<1>(token), std::get<2>(token), buffer_);
+    auto name{input_.substr(token_begin_, TokenLength())};
+    auto token{dictionary_.LookUp(name)};
+    if (std::get<0>(token) == TokenType::kIdentifier) {
+        MakeSymbolToken(std::get<0>(token), std::get<1>(token), std::get<2>(token), name);
+    } else {
+        MakeToken(std::get<0>(token), std::get<1>(token), std::get<2>(token));
+    }
 }
 
+// 最长匹配, 运算符最长为三个字符(<<=, >>=, ...)
 void Scanner::HandleOperatorOrDelimiter() {
-    buffer_.push_back(current_char_);
-    buffer_.push_back(PeekChar());
-
-    if (dictionary_.HaveToken(buffer_)) {
+    if (dictionary_.HaveToken(input_.substr(token_begin_, 3))) {
+        GetChar();
+        GetChar();
+    } else if (dictionary_.HaveToken(input_.substr(token_begin_, 2))) {
         GetChar();
-    } else {
-        buffer_.pop_back();
     }
 
-    auto token{dictionary_.LookUp(buffer_)};
-    MakeToken(std::get<0>(token), std::get<1>(token), std::get<2>(token), buffer_);
-}
-
-void Scanner::MakeToken(TokenType type, TokenValue value, const std::string &name) {
-    token_ = Token{type, value, name};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        std::int32_t symbol_precedence,
-                        const std::string &name) {
-    token_ = Token{type, value, symbol_precedence, name};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        bool bool_value) {
-    token_ = Token{type, value, name, bool_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        unsigned char unsigned_char_value) {
-    token_ = Token{type, value, name, unsigned_char_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        signed char signed_char_value) {
-    token_ = Token{type, value, name, signed_char_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        char char_value) {
-    token_ = Token{type, value, name, char_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        short short_value) {
-    token_ = Token{type, value, name, short_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        int int_value) {
-    token_ = Token{type, value, name, int_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        long long_value) {
-    token_ = Token{type, value, name, long_value};
-}
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        long long long_long_value) {
-    token_ = Token{type, value, name, long_long_value};
+    auto token{dictionary_.LookUp(input_.substr(token_begin_, TokenLength()))};
+    if (std::get<0>(token) == TokenType::kIdentifier) {
+        ErrorReport(std::string{"unknown character '"} + current_char_ + '\'');
+        MakeToken(TokenType::kUnknown, TokenValue::kUnreserved, -1);
+    } else {
+        MakeToken(std::get<0>(token), std::get<1>(token), std::get<2>(token));
+    }
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        unsigned short unsigned_short_value) {
-    token_ = Token{type, value, name, unsigned_short_value};
+std::uint32_t Scanner::TokenLength() const {
+    return static_cast<std::uint32_t>(std::min(index_, std::size(input_)) - token_begin_);
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        unsigned int unsigned_int_value) {
-    token_ = Token{type, value, name, unsigned_int_value};
+void Scanner::MakeToken(TokenType type, TokenValue value, std::int32_t symbol_precedence) {
+    token_ = Token{type, value, symbol_precedence,
+                   static_cast<std::uint32_t>(token_begin_), TokenLength()};
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        unsigned long unsigned_long_value) {
-    token_ = Token{type, value, name, unsigned_long_value};
+void Scanner::MakeToken(TokenType type, std::int64_t signed_value) {
+    token_ = Token{type, static_cast<std::uint32_t>(token_begin_), TokenLength(), signed_value};
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        unsigned long long unsigned_long_long_value) {
-    token_ = Token{type, value, name, unsigned_long_long_value};
+void Scanner::MakeToken(TokenType type, std::uint64_t unsigned_value) {
+    token_ = Token{type, static_cast<std::uint32_t>(token_begin_), TokenLength(), unsigned_value};
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        float float_value) {
-    token_ = Token{type, value, name, float_value};
+void Scanner::MakeToken(TokenType type, double floating_value) {
+    token_ = Token{type, static_cast<std::uint32_t>(token_begin_), TokenLength(), floating_value};
 }
 
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        double double_value) {
-    token_ = Token{type, value, name, double_value};
+void Scanner::MakeSymbolToken(TokenType type, TokenValue value, std::int32_t symbol_precedence,
+                              std::string_view spelling) {
+    token_ = Token{type, value, symbol_precedence, static_cast<std::uint32_t>(token_begin_),
+                   TokenLength(), interner_.Intern(spelling)};
 }
-
-void Scanner::MakeToken(TokenType type,
-                        TokenValue value,
-                        const std::string &name,
-                        const std::string &string_value) {
-    token_ = Token{type, value, name, string_value};
-}
\ No newline at end of file
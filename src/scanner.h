@@ -7,15 +7,51 @@
 
 #include "dictionary.h"
 #include "token.h"
+#include "mapped_file.h"
+#include "interner.h"
+#include "diagnostic.h"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <fstream>
+#include <array>
+#include <cstddef>
 
 class Scanner {
 public:
-    explicit Scanner(const std::string &file_name);
+    // 将文件映射到内存后直接在其上扫描
+    explicit Scanner(const std::string &file_name, Interner &interner = Interner::Global());
+    // 借用调用者提供的缓冲区, 在其生命周期内扫描, 不做拷贝
+    // input之后必须紧跟一个'\0', 例如来自std::string的缓冲区
+    Scanner(std::string_view input, const std::string &buffer_name,
+            Interner &interner = Interner::Global());
     Token GetNextToken();
+    // 词法错误不会中断扫描, 出错的地方产生TokenType::kUnknown或者尽量恢复出的记号
+    const DiagnosticList &GetDiagnostics() const;
+    bool HasErrors() const;
+    // 按输入中最近的行标记(# 行号 "文件名")把偏移换算为源文件中的位置, 语法分析器也用它报告错误
+    Diagnostic MakeDiagnostic(std::uint32_t offset, const std::string &message) const;
+    const std::string &GetFileName() const;
+    // 整个输入, 即预处理之后的文本
+    std::string_view GetInput() const;
+
+    // 一次扫描整个输入, 主要用于测试和需要全部记号的工具
     std::vector<Token> GetTokenSequence();
+
+    // 流式接口, 扫描与语法分析交替进行, 只在环形缓冲区中保留向前看的记号
+    // 不要与GetNextToken/GetTokenSequence混用
+    static constexpr std::size_t kMaxLookahead{8};
+    const Token &Peek(std::size_t k = 0);
+    Token Next();
+
+    // 输入的前length个字节已经切分过(来自预编译头文件), 先依次返回tokens, 再从length处继续扫描
+    // 必须在开始扫描之前调用
+    void UsePrecompiled(const std::vector<Token> &tokens, std::uint32_t length);
+
+    // 记号只保存位置, 拼写需要通过扫描器取得, 字符串字面量的值保存在Interner中
+    std::string_view GetTokenName(const Token &token) const;
+    std::string_view GetStringValue(const Token &token) const;
+    // 到目前为止产生的记号个数, 不包括EOF
+    std::uint64_t GetTokenCount() const;
 private:
     enum class State {
         kNone,
@@ -32,70 +68,55 @@ private:
     void Clear();
     void ErrorReport(const std::string &msg);
 
+    const char *InputAt(std::string_view::size_type index) const;
+    const char *InputEnd() const;
+    void SkipTo(const char *position);
+
     void Skip();
     void HandleWell();
+    void HandleComment();
 
     void HandleEscape();
     void HandleChar();
     void HandleString();
 
     void HandleNumber();
-    bool HandleDigit();
-    bool HandleFraction();
-    void HandleExp();
 
     void HandleIdentifierOrKeyword();
     void HandleOperatorOrDelimiter();
 
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name);
-    void MakeToken(TokenType type, TokenValue value,
-                   std::int32_t symbol_precedence, const std::string &name);
-
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, bool bool_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, unsigned char unsigned_char_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, signed char signed_char_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, char char_value);
-
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, short short_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, int int_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, long long_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, long long long_long_value);
-
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, unsigned short unsigned_short_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, unsigned int unsigned_int_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, unsigned long unsigned_long_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, unsigned long long unsigned_long_long_value);
-
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, float float_value);
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, double double_value);
-
-    void MakeToken(TokenType type, TokenValue value,
-                   const std::string &name, const std::string &string_value);
+    void MakeToken(TokenType type, TokenValue value, std::int32_t symbol_precedence);
+    void MakeToken(TokenType type, std::int64_t signed_value);
+    void MakeToken(TokenType type, std::uint64_t unsigned_value);
+    void MakeToken(TokenType type, double floating_value);
+    void MakeSymbolToken(TokenType type, TokenValue value, std::int32_t symbol_precedence,
+                         std::string_view spelling);
+    std::uint32_t TokenLength() const;
 
     char current_char_{};
-    std::string input_;
+    std::string file_name_;
+    MappedFile file_;
+    std::string_view input_{""};
     decltype(input_)::size_type index_{};
+    decltype(input_)::size_type token_begin_{};
+    bool at_end_{false};
 
     State state_{State::kNone};
 
     Dictionary dictionary_;
+    Interner &interner_;
+    DiagnosticList diagnostics_;
     Token token_;
     std::string buffer_;
+
+    std::uint64_t token_count_{};
+
+    std::vector<Token> precompiled_;
+    std::size_t precompiled_index_{};
+
+    std::array<Token, kMaxLookahead> lookahead_;
+    std::size_t lookahead_head_{};
+    std::size_t lookahead_count_{};
 };
 
 #endif //TINY_C_COMPILER_SCANNER_H
\ No newline at end of file
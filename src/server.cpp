@@ -0,0 +1,411 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "server.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+extern char **environ;
+
+namespace {
+
+// 请求的格式: 8字节的长度, 同时用SCM_RIGHTS传递客户端的标准输入, 输出, 错误,
+// 然后是以'\0'分隔的工作目录, 环境变量的个数, 各个环境变量和各个参数; 响应是4字节的退出码
+constexpr int kForwardedFds[]{STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+// 参数的总长度上限, 防止错误的请求让服务分配过多的内存
+constexpr std::uint64_t kMaxRequestSize{64 << 20};
+// 客户端在这段时间内没有发完请求就断开, 不阻塞后面的请求
+constexpr int kReceiveTimeout{10};
+
+volatile std::sig_atomic_t stop_requested{0};
+
+void RequestStop(int) {
+    stop_requested = 1;
+}
+
+bool ReadAll(int fd, char *data, std::size_t size) {
+    while (size != 0) {
+        auto count{read(fd, data, size)};
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+// 对方已经关闭时返回false, 不产生SIGPIPE
+bool SendAll(int fd, const char *data, std::size_t size) {
+    while (size != 0) {
+        auto count{send(fd, data, size, MSG_NOSIGNAL)};
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+bool MakeAddress(const std::string &socket_path, sockaddr_un &address) {
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (std::size(socket_path) >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, std::data(socket_path), std::size(socket_path));
+    return true;
+}
+
+int Connect(const std::string &socket_path) {
+    sockaddr_un address;
+    if (!MakeAddress(socket_path, address)) {
+        return -1;
+    }
+    auto fd{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (fd < 0) {
+        return -1;
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+class Request {
+public:
+    std::string directory_;
+    std::vector<std::string> environment_;
+    std::vector<std::string> args_;
+};
+
+// 读取请求, 成功时fds中是客户端的三个文件描述符
+bool ReceiveRequest(int connection, int (&fds)[std::size(kForwardedFds)], Request &request) {
+    std::uint64_t size;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+    iovec data{&size, sizeof(size)};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count;
+    do {
+        count = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return false;
+    }
+
+    auto header{CMSG_FIRSTHDR(&message)};
+    if (header == nullptr || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS
+        || header->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        // 可能收到了数量不对的描述符, 全部关闭
+        if (header != nullptr && header->cmsg_type == SCM_RIGHTS) {
+            auto received{(header->cmsg_len - CMSG_LEN(0)) / sizeof(int)};
+            for (std::size_t i{}; i < received; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                close(fd);
+            }
+        }
+        return false;
+    }
+    std::memcpy(fds, CMSG_DATA(header), sizeof(fds));
+
+    std::string buffer;
+    if (ReadAll(connection, reinterpret_cast<char *>(&size) + count, sizeof(size) - static_cast<std::size_t>(count))
+        && size <= kMaxRequestSize) {
+        buffer.resize(size);
+        if (!ReadAll(connection, std::data(buffer), size)) {
+            buffer.clear();
+        }
+    }
+
+    std::vector<std::string> parts;
+    for (std::size_t begin{}; begin < std::size(buffer);) {
+        auto end{buffer.find('\0', begin)};
+        if (end == std::string::npos) {
+            end = std::size(buffer);
+        }
+        parts.push_back(buffer.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    std::size_t environment_size{};
+    if (std::size(parts) >= 2) {
+        environment_size = std::strtoull(parts[1].c_str(), nullptr, 10);
+    }
+    if (std::size(parts) < 2 || environment_size > std::size(parts) - 2
+        || std::size(parts) - 2 - environment_size < 1) {
+        for (auto fd:fds) {
+            close(fd);
+        }
+        return false;
+    }
+    request.directory_ = std::move(parts[0]);
+    request.environment_.assign(std::begin(parts) + 2, std::begin(parts) + 2 + environment_size);
+    request.args_.assign(std::begin(parts) + 2 + environment_size, std::end(parts));
+    return true;
+}
+
+std::vector<std::string> GetEnvironment() {
+    std::vector<std::string> environment;
+    for (auto variable{environ}; *variable != nullptr; ++variable) {
+        environment.emplace_back(*variable);
+    }
+    return environment;
+}
+
+// 没有'='的项被忽略
+void SetEnvironment(const std::vector<std::string> &environment) {
+    clearenv();
+    for (const auto &variable:environment) {
+        if (auto equal{variable.find('=')}; equal != std::string::npos && equal != 0) {
+            setenv(variable.substr(0, equal).c_str(), variable.c_str() + equal + 1, 1);
+        }
+    }
+}
+
+// 在客户端的工作目录和环境变量下, 把客户端的描述符作为标准输入, 输出, 错误处理一个请求, 之后恢复
+// 工作目录, 环境变量和描述符0, 1, 2都属于整个进程, 调用者保证同一时间只处理一个请求
+int HandleRequest(const int (&fds)[std::size(kForwardedFds)], const Request &request,
+                  const RequestHandler &handler) {
+    auto saved_directory{open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    auto saved_environment{GetEnvironment()};
+    int saved_fds[std::size(kForwardedFds)];
+    for (std::size_t i{}; i < std::size(kForwardedFds); ++i) {
+        saved_fds[i] = fcntl(kForwardedFds[i], F_DUPFD_CLOEXEC, 0);
+        dup2(fds[i], kForwardedFds[i]);
+    }
+    SetEnvironment(request.environment_);
+
+    int exit_code{EXIT_FAILURE};
+    if (chdir(request.directory_.c_str()) != 0) {
+        std::cerr << "error: unable to change to directory '" << request.directory_ << "': "
+                  << std::strerror(errno) << '\n';
+    } else {
+        try {
+            exit_code = handler(request.args_);
+        } catch (const std::exception &error) {
+            std::cerr << "error: " << error.what() << '\n';
+        }
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    SetEnvironment(saved_environment);
+    for (std::size_t i{}; i < std::size(kForwardedFds); ++i) {
+        dup2(saved_fds[i], kForwardedFds[i]);
+        close(saved_fds[i]);
+    }
+    if (saved_directory >= 0) {
+        if (fchdir(saved_directory) != 0) {
+            std::cerr << "error: unable to restore the working directory: " << std::strerror(errno) << '\n';
+        }
+        close(saved_directory);
+    }
+    return exit_code;
+}
+
+}
+
+std::string GetDefaultServerSocket() {
+    if (auto runtime_directory{std::getenv("XDG_RUNTIME_DIR")}; runtime_directory && *runtime_directory) {
+        return (std::filesystem::path{runtime_directory} / "tcc.sock").string();
+    }
+    return "/tmp/tcc-" + std::to_string(getuid()) + ".sock";
+}
+
+bool RunServer(const std::string &socket_path, const RequestHandler &handler) {
+    sockaddr_un address;
+    if (!MakeAddress(socket_path, address)) {
+        std::cerr << "error: socket path '" << socket_path << "' is too long\n";
+        return false;
+    }
+
+    // 能连接上说明已经有服务在运行, 否则是上次没有正常退出留下的文件
+    if (auto fd{Connect(socket_path)}; fd >= 0) {
+        close(fd);
+        std::cerr << "error: a server is already listening on '" << socket_path << "'\n";
+        return false;
+    }
+    unlink(socket_path.c_str());
+
+    auto listener{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if (listener < 0) {
+        std::cerr << "error: unable to create socket: " << std::strerror(errno) << '\n';
+        return false;
+    }
+    // 只有同一个用户可以连接
+    auto old_mask{umask(0077)};
+    auto bound{bind(listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0};
+    umask(old_mask);
+    if (!bound || listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "error: unable to listen on '" << socket_path << "': " << std::strerror(errno) << '\n';
+        close(listener);
+        return false;
+    }
+
+    // 不使用SA_RESTART, 收到信号时accept返回EINTR
+    stop_requested = 0;
+    struct sigaction action{}, old_interrupt{}, old_terminate{}, old_pipe{};
+    action.sa_handler = RequestStop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, &old_interrupt);
+    sigaction(SIGTERM, &action, &old_terminate);
+    // 客户端提前退出时, 写它的输出不能让服务终止
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, &old_pipe);
+
+    // 每个连接由一个线程接收请求, 慢的客户端不会阻塞其他连接; 接收完的请求在handling上排队, 依次处理
+    // 处理请求的线程屏蔽SIGINT和SIGTERM, 信号总是让这个线程的accept返回
+    std::mutex handling;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t active{};
+    sigset_t blocked, old_signal_mask;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+
+    std::cerr << "tcc: listening on " << socket_path << '\n';
+    while (!stop_requested) {
+        auto connection{accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)};
+        if (connection < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                std::cerr << "error: accept failed: " << std::strerror(errno) << '\n';
+                break;
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard lock{mutex};
+            ++active;
+        }
+        pthread_sigmask(SIG_BLOCK, &blocked, &old_signal_mask);
+        std::thread{[connection, &handler, &handling, &mutex, &finished, &active] {
+            ucred credentials{};
+            socklen_t length{sizeof(credentials)};
+            timeval timeout{kReceiveTimeout, 0};
+            setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+            int fds[std::size(kForwardedFds)];
+            Request request;
+            if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0
+                && credentials.uid == getuid() && ReceiveRequest(connection, fds, request)) {
+                std::int32_t exit_code;
+                {
+                    std::lock_guard lock{handling};
+                    exit_code = HandleRequest(fds, request, handler);
+                }
+                for (auto fd:fds) {
+                    close(fd);
+                }
+                SendAll(connection, reinterpret_cast<const char *>(&exit_code), sizeof(exit_code));
+            }
+            close(connection);
+
+            std::lock_guard lock{mutex};
+            --active;
+            finished.notify_all();
+        }}.detach();
+        pthread_sigmask(SIG_SETMASK, &old_signal_mask, nullptr);
+    }
+
+    // 不再接受新的连接, 已经收到的请求处理完之后返回
+    close(listener);
+    unlink(socket_path.c_str());
+    {
+        std::unique_lock lock{mutex};
+        finished.wait(lock, [&active] { return active == 0; });
+    }
+    sigaction(SIGINT, &old_interrupt, nullptr);
+    sigaction(SIGTERM, &old_terminate, nullptr);
+    sigaction(SIGPIPE, &old_pipe, nullptr);
+    return true;
+}
+
+bool ForwardToServer(const std::string &socket_path, const std::vector<std::string> &args, int &exit_code) {
+    auto connection{Connect(socket_path)};
+    if (connection < 0) {
+        return false;
+    }
+
+    std::error_code error_code;
+    auto request{std::filesystem::current_path(error_code).string()};
+    // 服务在处理请求时使用客户端的全部环境变量, 例如TCC_CACHE_DIR, TMPDIR和PATH
+    auto environment{GetEnvironment()};
+    request += '\0';
+    request += std::to_string(std::size(environment));
+    for (const auto &variable:environment) {
+        request += '\0';
+        request += variable;
+    }
+    for (const auto &arg:args) {
+        request += '\0';
+        request += arg;
+    }
+
+    std::uint64_t size{std::size(request)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(kForwardedFds))]{};
+    iovec data{&size, sizeof(size)};
+    msghdr message{};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    auto header{CMSG_FIRSTHDR(&message)};
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(kForwardedFds));
+    std::memcpy(CMSG_DATA(header), kForwardedFds, sizeof(kForwardedFds));
+
+    ssize_t count;
+    do {
+        count = sendmsg(connection, &message, MSG_NOSIGNAL);
+    } while (count < 0 && errno == EINTR);
+
+    std::int32_t result;
+    auto ok{count == sizeof(size) && !error_code && SendAll(connection, std::data(request), std::size(request))
+            && ReadAll(connection, reinterpret_cast<char *>(&result), sizeof(result))};
+    close(connection);
+
+    if (ok) {
+        exit_code = result;
+    } else {
+        std::cerr << "error: lost connection to the compile server on '" << socket_path << "'\n";
+        exit_code = EXIT_FAILURE;
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_SERVER_H
+#define TINY_C_COMPILER_SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// 常驻的编译服务, 在Unix套接字上等待请求, 目标机器, 头文件缓存和标识符表在请求之间保留
+// 客户端发送工作目录, 环境变量, 命令行参数和自己的标准输入, 输出, 错误的文件描述符,
+// 服务在这些描述符上直接输出诊断信息(包括链接器的输出), 最后返回退出码
+// 多个客户端可以同时连接, 但请求依次处理: 处理时服务进程切换到客户端的工作目录和环境变量,
+// 并把描述符0, 1, 2换成客户端的, 这些都属于整个进程; 一个请求内部仍然并行编译
+
+// 参数与main的argv相同, 返回退出码
+using RequestHandler = std::function<int(const std::vector<std::string> &args)>;
+
+// $XDG_RUNTIME_DIR/tcc.sock, 没有设置XDG_RUNTIME_DIR时为/tmp/tcc-<uid>.sock
+std::string GetDefaultServerSocket();
+
+// 收到SIGINT或SIGTERM时删除套接字并返回, 套接字已经被另一个服务使用时返回false
+bool RunServer(const std::string &socket_path, const RequestHandler &handler);
+
+// 连接不到服务时返回false, 调用者在本进程中编译
+// 连接之后服务异常退出时输出错误, exit_code为EXIT_FAILURE
+bool ForwardToServer(const std::string &socket_path, const std::vector<std::string> &args, int &exit_code);
+
+#endif //TINY_C_COMPILER_SERVER_H
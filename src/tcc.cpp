@@ -2,52 +2,209 @@
 // Created by kaiser on 18-12-8.
 //
 
+#include "preprocessor.h"
 #include "scanner.h"
 #include "parser.h"
 #include "ast.h"
+#include "ast_statistics.h"
 #include "code_gen.h"
+#include "compile_report.h"
+#include "jit.h"
+#include "linker.h"
+#include "object_cache.h"
 #include "obj_gen.h"
+#include "server.h"
+#include "thread_pool.h"
+#include "time_trace.h"
+
+#include <llvm/Support/TimeProfiler.h>
 
 #include <iostream>
 #include <cstdlib>
 #include <filesystem>
+#include <future>
+#include <map>
 #include <algorithm>
-#include <unordered_set>
 #include <memory>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <unordered_set>
+#include <vector>
 
 void ShowHelpInfo();
 bool FileExists(const std::string &input_file);
 void ShowVersionInfo();
-std::string RemoveExtension(const std::string &file_name);
-void RunTcc(const std::string &input_file,
-            std::ostringstream &obj_files, std::vector<std::string> &files_to_delete);
+// 所有输入文件共用的编译设置
+struct CompileSettings {
+    const PreprocessorOptions &preprocessor_options_;
+    ThreadPool &pool_;
+    CodeGenSession &session_;
+    // 每个文件的代码生成分区数, 0表示自动决定
+    std::uint32_t partitions_;
+    // 没有启用缓存时为空
+    ObjectCache *cache_;
+    // 没有-ftime-report和-fmem-report时为空
+    CompileReport *report_;
+};
+
+bool RunTcc(const std::string &input_file, const CompileSettings &settings, std::ostream &diagnostics,
+            std::vector<ObjectFile> &objects);
+bool Compile(const std::string &input_file, const std::string &preprocessed,
+             const PrecompiledHeader *precompiled_header, const CompileSettings &settings,
+             std::ostream &diagnostics, std::vector<ObjectFile> &objects);
+
+// 在多次调用之间保留的状态, 编译服务的各个请求重用已经初始化的线程池, 目标机器和缓存
+class DriverState {
+public:
+    ThreadPool &GetPool(std::size_t threads);
+    // 选项无效时输出错误并返回nullptr
+    CodeGenSession *GetSession(const CodeGenOptions &options);
+    ObjectCache &GetCache(const std::string &directory, std::uint64_t max_size);
+private:
+    std::map<std::size_t, std::unique_ptr<ThreadPool>> pools_;
+    std::map<std::tuple<std::string, std::string, std::string, unsigned, bool>,
+             std::unique_ptr<CodeGenSession>> sessions_;
+    std::map<std::pair<std::string, std::uint64_t>, std::unique_ptr<ObjectCache>> caches_;
+};
+
+int RunDriver(int argc, char *argv[], DriverState &state);
+
+// 一个文件的编译结果, 诊断信息先缓存起来, 按输入文件的顺序输出
+struct CompileResult {
+    bool ok_{false};
+    std::string diagnostics_;
+    // 每个分区一个目标文件, 都在内存中
+    std::vector<ObjectFile> objects_;
+};
 
 int main(int argc, char *argv[]) {
+    // tcc --server[=<socket>] 常驻等待编译请求
+    if (std::string_view prefix{"--server"};
+            argc > 1 && std::string_view{argv[1]}.substr(0, std::size(prefix)) == prefix) {
+        std::string_view arg{argv[1]};
+        auto socket_path{std::size(arg) > std::size(prefix) && arg[std::size(prefix)] == '='
+                         ? std::string{arg.substr(std::size(prefix) + 1)} : GetDefaultServerSocket()};
+        if (argc > 2 || (std::size(arg) > std::size(prefix) && arg[std::size(prefix)] != '=')) {
+            std::cerr << "error: usage: tcc --server[=<socket>]\n";
+            return EXIT_FAILURE;
+        }
+
+        // 预先初始化默认的目标机器, 第一个请求不需要等待
+        DriverState state;
+        state.GetSession(CodeGenOptions{});
+        return RunServer(socket_path, [&state](const std::vector<std::string> &args) {
+            std::vector<char *> request_argv;
+            for (const auto &arg:args) {
+                request_argv.push_back(const_cast<char *>(arg.c_str()));
+            }
+            request_argv.push_back(nullptr);
+            return RunDriver(static_cast<int>(std::size(args)), std::data(request_argv), state);
+        }) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // 设置了TCC_SERVER时把命令行转发给这个套接字上的服务, 连接不上时在本进程中编译
+    // -run的程序可能调用exit或者崩溃, 总是在客户端进程中执行
+    if (auto socket_path{std::getenv("TCC_SERVER")};
+            socket_path && *socket_path && std::find(argv, argv + argc, std::string_view{"-run"}) == argv + argc) {
+        if (int exit_code; ForwardToServer(socket_path, {argv, argv + argc}, exit_code)) {
+            return exit_code;
+        }
+    }
+
+    DriverState state;
+    return RunDriver(argc, argv, state);
+}
+
+int RunDriver(int argc, char *argv[], DriverState &state) {
     if (argc == 1) {
         ShowHelpInfo();
-        std::exit(EXIT_SUCCESS);
+        return EXIT_SUCCESS;
     }
 
-    std::unordered_set<std::string> input_files;
+    // 按命令行中的顺序编译和链接, 重复的文件只编译一次
+    std::vector<std::string> input_files;
     std::unordered_set<std::string> args;
     std::string program_name("a.out");
+    bool has_program_name{false};
+    std::string jobs_value{"0"};
+    PreprocessorOptions preprocessor_options;
+    CodeGenOptions codegen_options;
+
+    // -run file.c 之后的参数都是程序的参数, 不再作为tcc的选项
+    std::vector<std::string> run_args;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view{argv[i]} == "-run") {
+            if (i + 1 == argc) {
+                std::cerr << "error: no input file after '-run'\n";
+                return EXIT_FAILURE;
+            }
+            run_args.assign(argv + i + 1, argv + argc);
+            argc = i + 2;
+            break;
+        }
+    }
 
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] != '-') {
             if (FileExists(argv[i])) {
-                input_files.emplace(argv[i]);
+                if (std::find(std::begin(input_files), std::end(input_files), argv[i]) == std::end(input_files)) {
+                    input_files.emplace_back(argv[i]);
+                }
             } else {
                 std::cerr << "error: " << argv[i] << ": This file does not exist.\n";
-                std::exit(EXIT_FAILURE);
+                return EXIT_FAILURE;
             }
         } else {
             if (argv[i][1] == 'o') {
-                if (argv[i + 1]) {
-                    program_name = argv[i + 1];
+                if (i + 1 < argc) {
+                    program_name = argv[++i];
+                    has_program_name = true;
                 } else {
                     std::cerr << "error: " << "No program name entered.\n";
-                    std::exit(EXIT_FAILURE);
+                    return EXIT_FAILURE;
+                }
+            } else if (argv[i][1] == 'I' || argv[i][1] == 'D' || argv[i][1] == 'U' || argv[i][1] == 'j') {
+                // 同时支持 -Idir 和 -I dir 两种写法
+                auto option{argv[i][1]};
+                std::string value{argv[i] + 2};
+                if (std::empty(value) && i + 1 < argc) {
+                    value = argv[++i];
+                }
+
+                if (option == 'j') {
+                    jobs_value = value;
+                } else if (option == 'I') {
+                    preprocessor_options.include_paths_.push_back(value);
+                } else if (option == 'U') {
+                    preprocessor_options.undefines_.push_back(value);
+                } else if (auto pos{value.find('=')}; pos != std::string::npos) {
+                    preprocessor_options.defines_.emplace_back(value.substr(0, pos), value.substr(pos + 1));
+                } else {
+                    preprocessor_options.defines_.emplace_back(value, "1");
+                }
+            } else if (std::string_view arg{argv[i]}; arg.substr(0, 7) == "-march=" || arg.substr(0, 6) == "-mcpu=") {
+                codegen_options.cpu_ = arg.substr(arg.find('=') + 1);
+            } else if (arg.substr(0, 7) == "-mattr=") {
+                // 多个-mattr=按顺序合并
+                if (!std::empty(codegen_options.features_)) {
+                    codegen_options.features_ += ',';
+                }
+                codegen_options.features_ += arg.substr(7);
+            } else if (argv[i][1] == 'O') {
+                // -O与-O1相同, 多个-O时最后一个有效
+                std::string level{argv[i] + 2};
+                if (level == "s") {
+                    codegen_options.opt_level_ = 2;
+                    codegen_options.optimize_size_ = true;
+                } else if (std::empty(level) || (std::size(level) == 1 && level[0] >= '0' && level[0] <= '3')) {
+                    codegen_options.opt_level_ = std::empty(level) ? 1 : static_cast<unsigned>(level[0] - '0');
+                    codegen_options.optimize_size_ = false;
+                } else {
+                    std::cerr << "error: invalid optimization level '" << argv[i] << "'\n";
+                    return EXIT_FAILURE;
                 }
             } else {
                 args.emplace(argv[i]);
@@ -57,39 +214,253 @@ int main(int argc, char *argv[]) {
 
     if (args.find("-v") != std::end(args)) {
         ShowVersionInfo();
-        std::exit(EXIT_SUCCESS);
+        return EXIT_SUCCESS;
     }
 
     if (std::size(input_files) == 0) {
         std::cerr << "fatal error: no input files.\n";
     }
 
-    //TODO 支持更多编译参数
+    // 只为每个输入的头文件生成header.pch, 不编译也不链接
+    if (args.find("-emit-pch") != std::end(args)) {
+        bool ok{true};
+        for (const auto &input_file:input_files) {
+            Preprocessor preprocessor{preprocessor_options};
+            ok = preprocessor.EmitPrecompiledHeader(input_file, input_file + ".pch") && ok;
+            for (const auto &diagnostic:preprocessor.GetDiagnostics()) {
+                std::cerr << diagnostic << '\n';
+            }
+        }
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // -c只编译, 每个输入文件生成一个目标文件
+    auto compile_only{args.find("-c") != std::end(args)};
+    if (compile_only && !std::empty(run_args)) {
+        std::cerr << "fatal error: cannot specify '-c' with '-run'\n";
+        return EXIT_FAILURE;
+    }
+    if (compile_only && has_program_name && std::size(input_files) > 1) {
+        std::cerr << "fatal error: cannot specify '-o' with '-c' with multiple files\n";
+        return EXIT_FAILURE;
+    }
+
+    // -fcodegen-threads=N 把每个文件的函数分到N个模块中并行生成, 0表示按函数的个数自动决定
+    std::uint32_t codegen_threads{};
+    for (const auto &arg:args) {
+        if (std::string_view prefix{"-fcodegen-threads="}; arg.compare(0, std::size(prefix), prefix) == 0) {
+            try {
+                codegen_threads = static_cast<std::uint32_t>(std::stoul(arg.substr(std::size(prefix))));
+            } catch (const std::exception &) {
+                std::cerr << "error: invalid value in '" << arg << "'\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // -jN 同时编译N个文件, 默认使用硬件线程数, 文件内的并行代码生成也使用同一个线程池
+    std::size_t jobs{};
+    try {
+        jobs = std::stoul(jobs_value);
+    } catch (const std::exception &) {
+        std::cerr << "error: invalid value in '-j" << jobs_value << "'\n";
+        return EXIT_FAILURE;
+    }
+    auto &pool{state.GetPool(jobs)};
+
+    // 目标机器只初始化一次, 所有文件和线程共享
+    auto session{state.GetSession(codegen_options)};
+    if (!session) {
+        return EXIT_FAILURE;
+    }
+
+    // -fcache或者设置了TCC_CACHE_DIR时启用编译缓存, -fcache-dir=和-fcache-size=(MiB)修改目录和大小上限
+    ObjectCache *cache{nullptr};
+    auto cache_directory{ObjectCache::GetDefaultDirectory()};
+    std::uint64_t cache_size{1024};
+    auto use_cache{args.find("-fcache") != std::end(args) || std::getenv("TCC_CACHE_DIR")};
+    for (const auto &arg:args) {
+        if (std::string_view prefix{"-fcache-dir="}; arg.compare(0, std::size(prefix), prefix) == 0) {
+            cache_directory = arg.substr(std::size(prefix));
+            use_cache = true;
+        } else if (std::string_view size_prefix{"-fcache-size="};
+                arg.compare(0, std::size(size_prefix), size_prefix) == 0) {
+            try {
+                cache_size = std::stoull(arg.substr(std::size(size_prefix)));
+            } catch (const std::exception &) {
+                std::cerr << "error: invalid value in '" << arg << "'\n";
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    if (args.find("-fno-cache") != std::end(args)) {
+        use_cache = false;
+    }
+    if (use_cache) {
+        cache = &state.GetCache(cache_directory, cache_size << 20);
+    }
+    // 编译服务中缓存在请求之间共享, 统计只包括这一次调用
+    auto hits{cache ? cache->GetHits() : 0}, misses{cache ? cache->GetMisses() : 0};
+    auto stores{cache ? cache->GetStores() : 0}, evictions{cache ? cache->GetEvictions() : 0};
+
+    // -ftime-report和-fmem-report统计各个阶段的时间和内存分配, =json时输出一个JSON对象
+    auto time_report{args.find("-ftime-report") != std::end(args)
+                     || args.find("-ftime-report=json") != std::end(args)};
+    auto memory_report{args.find("-fmem-report") != std::end(args)
+                       || args.find("-fmem-report=json") != std::end(args)};
+    auto json_report{args.find("-ftime-report=json") != std::end(args)
+                     || args.find("-fmem-report=json") != std::end(args)};
+    std::unique_ptr<CompileReport> report;
+    if (time_report || memory_report) {
+        report = std::make_unique<CompileReport>();
+    }
+    // -ftime-trace[=<file>]把各个阶段, 每个头文件, 每个函数和每个LLVM pass的区间写到<file>,
+    // 默认是输出文件改为.json扩展名, 短于-ftime-trace-granularity=<us>(默认500)的区间不记录
+    std::unique_ptr<TimeTrace> trace;
+    std::string trace_file;
+    unsigned trace_granularity{500};
     for (const auto &arg:args) {
-        switch (arg[1]) {
-            default:break;
+        if (std::string_view prefix{"-ftime-trace"}; arg == prefix || arg.compare(0, 13, "-ftime-trace=") == 0) {
+            if (std::size(arg) > std::size(prefix)) {
+                trace_file = arg.substr(std::size(prefix) + 1);
+            } else if (!has_program_name && (compile_only || !std::empty(run_args)) && !std::empty(input_files)) {
+                trace_file = std::filesystem::path{input_files.front()}.stem().string() + ".json";
+            } else {
+                trace_file = std::filesystem::path{program_name}.replace_extension(".json").string();
+            }
+        } else if (std::string_view granularity_prefix{"-ftime-trace-granularity="};
+                arg.compare(0, std::size(granularity_prefix), granularity_prefix) == 0) {
+            try {
+                trace_granularity = static_cast<unsigned>(std::stoul(arg.substr(std::size(granularity_prefix))));
+            } catch (const std::exception &) {
+                std::cerr << "error: invalid value in '" << arg << "'\n";
+                return EXIT_FAILURE;
+            }
         }
     }
+    if (!std::empty(trace_file)) {
+        trace = std::make_unique<TimeTrace>(trace_granularity);
+    }
 
-    std::vector<std::string> files_to_delete;
-    std::ostringstream obj_files;
+    // 在链接之后输出, -run时在程序开始执行之前输出
+    auto finish_reports{[&] {
+        if (report && json_report) {
+            report->PrintJson(std::cerr);
+        } else if (report) {
+            report->Print(std::cerr, time_report, memory_report);
+        }
+        if (trace) {
+            trace->Write(trace_file);
+            trace.reset();
+        }
+    }};
 
+    CompileSettings settings{preprocessor_options, pool, *session, codegen_threads, cache, report.get()};
+    std::vector<std::future<CompileResult>> results;
     for (const auto &input_file:input_files) {
-        RunTcc(input_file, obj_files, files_to_delete);
+        results.push_back(pool.Submit([&] {
+            TimeTrace::ThreadScope thread_scope;
+            llvm::TimeTraceScope trace_scope{"Compile", input_file};
+            CompileResult result;
+            std::ostringstream diagnostics;
+            result.ok_ = RunTcc(input_file, settings, diagnostics, result.objects_);
+            result.diagnostics_ = diagnostics.str();
+            return result;
+        }));
     }
 
-    std::string cmd("gcc -std=c99 -o a.out " + obj_files.str());
-    std::system(cmd.c_str());
+    // 按输入文件的顺序输出诊断信息, 前面的文件完成后立即输出, 最后一个目标文件完成后开始链接
+    // 一个文件出错时继续编译其他文件, 但不再链接
+    std::vector<CompileResult> compiled;
+    bool ok{true};
+    for (auto &future:results) {
+        compiled.push_back(pool.Wait(future));
+        std::cerr << compiled.back().diagnostics_;
+        ok = compiled.back().ok_ && ok;
+    }
+    if (cache) {
+        cache->Trim();
+        if (args.find("-fcache-stats") != std::end(args)) {
+            std::cerr << "cache directory: " << cache->GetDirectory() << "\n"
+                      << "cache hits: " << cache->GetHits() - hits << "\n"
+                      << "cache misses: " << cache->GetMisses() - misses << "\n"
+                      << "cache stores: " << cache->GetStores() - stores << "\n"
+                      << "cache evictions: " << cache->GetEvictions() - evictions << '\n';
+        }
+    }
+    if (!ok) {
+        finish_reports();
+        return EXIT_FAILURE;
+    }
 
-    for (const auto &file:files_to_delete) {
-        std::filesystem::remove(std::filesystem::path{file});
+    // -c时每个输入文件的目标文件直接从内存写到最终的位置, 否则在内存中交给链接器
+    if (compile_only) {
+        CompileReport::Scope scope{report.get(), Phase::kLink};
+        llvm::TimeTraceScope trace_scope{"WriteObjects"};
+        for (std::size_t i{}; i < std::size(input_files); ++i) {
+            auto output{has_program_name ? program_name
+                                         : std::filesystem::path{input_files[i]}.stem().string() + ".o"};
+            const auto &objects{compiled[i].objects_};
+            if (std::size(objects) == 1) {
+                ok = WriteObject(objects.front(), output, std::cerr) && ok;
+            } else {
+                std::vector<const ObjectFile *> parts;
+                for (const auto &object:objects) {
+                    parts.push_back(&object);
+                }
+                ok = CombineObjects(parts, output, std::cerr) && ok;
+            }
+        }
+    } else {
+        std::vector<const ObjectFile *> objects;
+        for (const auto &result:compiled) {
+            for (const auto &object:result.objects_) {
+                objects.push_back(&object);
+            }
+        }
+        // -run时在本进程中加载目标文件并调用main, 返回main的返回值
+        if (!std::empty(run_args)) {
+            finish_reports();
+            int exit_code;
+            return RunObjects(objects, run_args, exit_code) ? exit_code : EXIT_FAILURE;
+        }
+        CompileReport::Scope scope{report.get(), Phase::kLink};
+        llvm::TimeTraceScope trace_scope{"Link", program_name};
+        ok = LinkObjects(objects, program_name, std::cerr);
     }
+
+    finish_reports();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 void ShowHelpInfo() {
     std::cout << "Usage: tcc [options] file...\n"
                  "Options: \n"
-                 "-v\t\t\tDisplay version information.\n";
+                 "-v\t\t\tDisplay version information.\n"
+                 "-o <file>\t\tPlace the output into <file>.\n"
+                 "-c\t\t\tCompile only; write <name>.o for each input file.\n"
+                 "-run <file> [args...]\tCompile and run <file> in memory; <args> are passed to main.\n"
+                 "-I <dir>\t\tAdd directory to include search path.\n"
+                 "-D <macro>[=<val>]\tDefine <macro> to <val> (or 1 if <val> omitted).\n"
+                 "-U <macro>\t\tUndefine macro <macro>.\n"
+                 "-emit-pch\t\tWrite <file>.pch for each header instead of compiling.\n"
+                 "-O<level>\t\tOptimization level: 0, 1, 2, 3 or s (default: 0).\n"
+                 "-march=<cpu>\t\tGenerate code for <cpu>, or for this machine with 'native'.\n"
+                 "-mcpu=<cpu>\t\tSame as -march=<cpu>.\n"
+                 "-mattr=<+a,-b>\t\tEnable or disable target features.\n"
+                 "-fcache\t\t\tReuse objects from the compilation cache ($TCC_CACHE_DIR or ~/.cache/tcc).\n"
+                 "-fcache-dir=<dir>\tUse <dir> as the compilation cache.\n"
+                 "-fcache-size=<MiB>\tLimit the compilation cache to <MiB> (default: 1024).\n"
+                 "-fcache-stats\t\tPrint compilation cache statistics.\n"
+                 "-fno-cache\t\tDisable the compilation cache.\n"
+                 "-j <n>\t\t\tCompile <n> files in parallel (default: number of hardware threads).\n"
+                 "-fcodegen-threads=<n>\tGenerate the functions of each file as <n> modules in parallel.\n"
+                 "-ftime-report[=json]\tPrint the time spent in each phase, summed over files and threads.\n"
+                 "-fmem-report[=json]\tPrint allocations in each phase and the peak resident set size of this compilation.\n"
+                 "-ftime-trace[=<file>]\tWrite a Chrome trace of the phases, headers, functions and LLVM passes.\n"
+                 "-ftime-trace-granularity=<us>\tOmit trace events shorter than <us> microseconds (default: 500).\n"
+                 "--server[=<socket>]\tServe compile requests on <socket> (default: $XDG_RUNTIME_DIR/tcc.sock).\n"
+                 "\t\t\tSet TCC_SERVER=<socket> to send invocations to a running server.\n";
 }
 
 bool FileExists(const std::string &input_file) {
@@ -100,32 +471,171 @@ void ShowVersionInfo() {
     std::cout << "Tiny C Compiler by Kaiser.\n";
 }
 
-std::string RemoveExtension(const std::string &file_name) {
-    return file_name.substr(0, file_name.find('.'));
+bool RunTcc(const std::string &input_file, const CompileSettings &settings, std::ostream &diagnostics,
+            std::vector<ObjectFile> &objects) {
+    // 预处理的结果只在内存中, 直接交给Scanner扫描
+    if (settings.report_) {
+        settings.report_->AddFile();
+    }
+    Preprocessor preprocessor{settings.preprocessor_options_};
+    std::string preprocessed;
+    {
+        CompileReport::Scope scope{settings.report_, Phase::kPreprocess};
+        llvm::TimeTraceScope trace_scope{"Preprocess", input_file};
+        preprocessed = preprocessor.Preprocess(input_file);
+    }
+
+    for (const auto &diagnostic:preprocessor.GetDiagnostics()) {
+        diagnostics << diagnostic << '\n';
+    }
+    if (preprocessor.HasErrors()) {
+        return false;
+    }
+
+    if (!settings.cache_) {
+        return Compile(input_file, preprocessed, preprocessor.GetPrecompiledHeader(), settings, diagnostics,
+                       objects);
+    }
+
+    // 预处理之后的文本决定了编译的结果, 文件名出现在诊断信息和static符号的名字中
+    // 分区数只影响目标文件的划分, 不影响程序的行为, 不同大小的线程池可以共享缓存
+    const auto &session{settings.session_};
+    const auto &options{session.GetOptions()};
+    auto key{ObjectCache::MakeKey({ObjectCache::GetCompilerId(), session.GetTriple(), options.cpu_,
+                                   options.features_, std::to_string(options.opt_level_),
+                                   options.optimize_size_ ? "s" : "", input_file, preprocessed})};
+    ObjectCache::Entry entry;
+    if (settings.cache_->Load(key, entry)) {
+        diagnostics << entry.diagnostics_;
+        objects = std::move(entry.objects_);
+        return true;
+    }
+
+    std::ostringstream compile_diagnostics;
+    auto ok{Compile(input_file, preprocessed, preprocessor.GetPrecompiledHeader(), settings, compile_diagnostics,
+                    entry.objects_)};
+    entry.diagnostics_ = compile_diagnostics.str();
+    diagnostics << entry.diagnostics_;
+    if (ok) {
+        settings.cache_->Store(key, entry);
+        objects = std::move(entry.objects_);
+    }
+    return ok;
 }
 
-void RunTcc(const std::string &input_file,
-            std::ostringstream &obj_files, std::vector<std::string> &files_to_delete) {
-    std::string processed_file(RemoveExtension(input_file) + ".i");
-    files_to_delete.push_back(processed_file);
+// 从预处理的结果开始编译, 生成内存中的目标文件
+bool Compile(const std::string &input_file, const std::string &preprocessed,
+             const PrecompiledHeader *precompiled_header, const CompileSettings &settings,
+             std::ostream &diagnostics, std::vector<ObjectFile> &objects) {
+    Scanner scanner{preprocessed, input_file};
+    // 输出开头来自预编译头文件的部分不需要重新扫描
+    if (precompiled_header) {
+        scanner.UsePrecompiled(precompiled_header->GetTokens(),
+                               static_cast<std::uint32_t>(std::size(precompiled_header->GetText())));
+    }
 
-    std::string cmd("gcc -std=c99 -o " + processed_file + " -E " + input_file);
-    std::system(cmd.c_str());
+    // 扫描和语法分析交替进行, 不保存整个记号序列, 语法树在arena析构时一次释放
+    TypeTable types;
+    Arena arena;
+    Parser parser{scanner, types, arena};
+    Block *program_block;
+    {
+        CompileReport::Scope scope{settings.report_, Phase::kParse};
+        llvm::TimeTraceScope trace_scope{"Parse", input_file};
+        program_block = parser.Parse();
+    }
+    if (settings.report_) {
+        settings.report_->AddTokens(scanner.GetTokenCount());
+        ASTStatistics statistics;
+        statistics.Traverse(program_block);
+        settings.report_->AddNodes(statistics.GetTotal());
+    }
 
-    Scanner scanner{processed_file};
-    auto token_sequence{scanner.GetTokenSequence()};
+    for (const auto &diagnostic:scanner.GetDiagnostics()) {
+        diagnostics << diagnostic << '\n';
+    }
+    for (const auto &diagnostic:parser.GetDiagnostics()) {
+        diagnostics << diagnostic << '\n';
+    }
+    if (scanner.HasErrors() || parser.HasErrors()) {
+        return false;
+    }
+
+    // 每个分区是一个模块, 生成一个目标文件
+    auto &pool{settings.pool_};
+    std::vector<std::unique_ptr<CodeGenContext>> contexts;
+    {
+        CompileReport::Scope scope{settings.report_, Phase::kCodeGen};
+        llvm::TimeTraceScope trace_scope{"CodeGen", input_file};
+        contexts = GenerateCodeParallel(*program_block, scanner, types, pool, settings.partitions_,
+                                        settings.report_);
+    }
+
+    // 诊断信息按在源文件中的位置输出, 与不分区时的顺序一致
+    DiagnosticList codegen_diagnostics;
+    bool has_errors{false};
+    for (const auto &context:contexts) {
+        codegen_diagnostics.insert(std::end(codegen_diagnostics), std::begin(context->GetDiagnostics()),
+                                   std::end(context->GetDiagnostics()));
+        has_errors = context->HasErrors() || has_errors;
+    }
+    std::stable_sort(std::begin(codegen_diagnostics), std::end(codegen_diagnostics),
+                     [](const Diagnostic &lhs, const Diagnostic &rhs) { return lhs.offset_ < rhs.offset_; });
+    for (const auto &diagnostic:codegen_diagnostics) {
+        diagnostics << diagnostic << '\n';
+    }
+    if (has_errors) {
+        return false;
+    }
 
-    //Parser parse;
-    //parse.parse();
+    // 各个分区在不同的线程中生成, 错误信息先分别保存, 之后按顺序写入这个文件的诊断信息
+    objects.resize(std::size(contexts));
+    std::vector<std::string> errors(std::size(contexts));
+    std::vector<std::future<bool>> results;
+    for (std::size_t i{}; i < std::size(contexts); ++i) {
+        results.push_back(pool.Submit([&settings, &context = *contexts[i], &object = objects[i], &error = errors[i]] {
+            TimeTrace::ThreadScope thread_scope;
+            CompileReport::Scope scope{settings.report_, Phase::kObjGen};
+            llvm::TimeTraceScope trace_scope{"ObjGen", context.the_module_->getName()};
+            return ObjGen(settings.session_, context, object, error);
+        }));
+    }
 
-    std::unique_ptr<Block> program_block;
+    bool ok{true};
+    for (std::size_t i{}; i < std::size(results); ++i) {
+        if (!pool.Wait(results[i])) {
+            diagnostics << "error: " << errors[i] << '\n';
+            ok = false;
+        }
+    }
+    return ok;
+}
 
-    CodeGenContext context;
-    context.GenerateCode(*program_block);
+ThreadPool &DriverState::GetPool(std::size_t threads) {
+    auto &pool{pools_[threads]};
+    if (!pool) {
+        pool = std::make_unique<ThreadPool>(threads);
+    }
+    return *pool;
+}
 
-    std::string obj_file(RemoveExtension(input_file) + ".o");
-    files_to_delete.push_back(obj_file);
-    obj_files << obj_file << ' ';
+CodeGenSession *DriverState::GetSession(const CodeGenOptions &options) {
+    auto &session{sessions_[{options.triple_, options.cpu_, options.features_, options.opt_level_,
+                             options.optimize_size_}]};
+    if (!session) {
+        session = std::make_unique<CodeGenSession>(options);
+    }
+    if (!session->IsValid()) {
+        std::cerr << "error: " << session->GetError() << '\n';
+        return nullptr;
+    }
+    return session.get();
+}
 
-    ObjGen(context, obj_file);
-}
\ No newline at end of file
+ObjectCache &DriverState::GetCache(const std::string &directory, std::uint64_t max_size) {
+    auto &cache{caches_[{directory, max_size}]};
+    if (!cache) {
+        cache = std::make_unique<ObjectCache>(directory, max_size);
+    }
+    return *cache;
+}
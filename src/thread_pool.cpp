@@ -0,0 +1,113 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+
+// 当前线程所属的线程池和在其中的编号
+thread_local const ThreadPool *current_pool{nullptr};
+thread_local std::size_t current_index{};
+
+}
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    for (std::size_t i{}; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i{}; i < threads; ++i) {
+        workers_.emplace_back([this, i] { Run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    condition_.notify_all();
+    for (auto &worker:workers_) {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::GetSize() const {
+    return std::size(workers_);
+}
+
+void ThreadPool::Push(std::function<void()> task) {
+    auto index{GetIndex()};
+    if (index == GetSize()) {
+        index = next_++ % GetSize();
+    }
+    // 先计数再放入队列, 任务被取走时pending_不会小于0
+    {
+        std::lock_guard lock{mutex_};
+        ++pending_;
+    }
+    {
+        std::lock_guard lock{queues_[index]->mutex_};
+        queues_[index]->tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
+}
+
+bool ThreadPool::Pop(std::function<void()> &task) {
+    auto index{GetIndex()};
+    auto size{GetSize()};
+    auto take{[&](std::size_t i, bool back) {
+        std::lock_guard lock{queues_[i]->mutex_};
+        auto &tasks{queues_[i]->tasks_};
+        if (std::empty(tasks)) {
+            return false;
+        }
+        if (back) {
+            task = std::move(tasks.back());
+            tasks.pop_back();
+        } else {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        return true;
+    }};
+
+    auto found{index < size && take(index, true)};
+    for (std::size_t i{1}; !found && i <= size; ++i) {
+        found = take((index + i) % size, false);
+    }
+    if (found) {
+        std::lock_guard lock{mutex_};
+        --pending_;
+    }
+    return found;
+}
+
+void ThreadPool::Run(std::size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (Pop(task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock{mutex_};
+        condition_.wait(lock, [this] { return stop_ || pending_ != 0; });
+        if (stop_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+std::size_t ThreadPool::GetIndex() const {
+    return current_pool == this ? current_index : GetSize();
+}
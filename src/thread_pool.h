@@ -0,0 +1,89 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_THREAD_POOL_H
+#define TINY_C_COMPILER_THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 每个工作线程有自己的任务队列, 工作线程提交的任务放在自己队列的末尾并优先执行,
+// 自己的队列空了就从其他队列的开头窃取, 其他线程提交的任务轮流放入各个队列
+// 析构时执行完队列中剩余的任务再结束
+class ThreadPool {
+public:
+    // threads为0时使用硬件线程数
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // 任务抛出的异常保存在返回的future中
+    template<typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> Submit(F &&function);
+
+    // 等待的同时执行队列中的任务, 任务中等待自己提交的子任务时必须使用它,
+    // 否则所有工作线程都在等待时子任务没有线程执行
+    template<typename T>
+    T Wait(std::future<T> &future);
+
+    std::size_t GetSize() const;
+private:
+    class Queue {
+    public:
+        std::mutex mutex_;
+        std::deque<std::function<void()>> tasks_;
+    };
+
+    void Push(std::function<void()> task);
+    // 先取自己队列的末尾, 再从其他队列的开头窃取
+    bool Pop(std::function<void()> &task);
+    void Run(std::size_t index);
+    // 当前线程在这个线程池中的编号, 不是工作线程时为GetSize()
+    std::size_t GetIndex() const;
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> next_{};
+
+    // 保护pending_和stop_, 空闲的线程在condition_上等待新任务
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::size_t pending_{};
+    bool stop_{false};
+};
+
+template<typename F>
+std::future<std::invoke_result_t<std::decay_t<F>>> ThreadPool::Submit(F &&function) {
+    // std::function要求可复制, packaged_task只能移动, 所以放在shared_ptr中
+    auto task{std::make_shared<std::packaged_task<std::invoke_result_t<std::decay_t<F>>()>>(
+            std::forward<F>(function))};
+    auto result{task->get_future()};
+    Push([task] { (*task)(); });
+    return result;
+}
+
+template<typename T>
+T ThreadPool::Wait(std::future<T> &future) {
+    // 没有可以执行的任务时, future依赖的任务都已经在其他线程中执行, 可以直接等待
+    std::function<void()> task;
+    while (future.wait_for(std::chrono::seconds{0}) != std::future_status::ready && Pop(task)) {
+        task();
+        task = nullptr;
+    }
+    return future.get();
+}
+
+#endif //TINY_C_COMPILER_THREAD_POOL_H
@@ -0,0 +1,46 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "time_trace.h"
+
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TimeProfiler.h>
+
+#include <iostream>
+
+std::atomic<unsigned> TimeTrace::granularity_{};
+std::atomic<bool> TimeTrace::active_{false};
+
+TimeTrace::TimeTrace(unsigned granularity) {
+    granularity_ = granularity;
+    llvm::timeTraceProfilerInitialize(granularity, "tcc");
+    active_ = true;
+}
+
+TimeTrace::~TimeTrace() {
+    active_ = false;
+    llvm::timeTraceProfilerCleanup();
+}
+
+bool TimeTrace::Write(const std::string &path) {
+    if (auto error{llvm::timeTraceProfilerWrite(path, "tcc")}) {
+        std::cerr << "error: unable to write time trace '" << path << "': " << llvm::toString(std::move(error))
+                  << '\n';
+        return false;
+    }
+    return true;
+}
+
+TimeTrace::ThreadScope::ThreadScope() {
+    if (active_ && !llvm::getTimeTraceProfilerInstance()) {
+        llvm::timeTraceProfilerInitialize(granularity_, "tcc");
+        owner_ = true;
+    }
+}
+
+TimeTrace::ThreadScope::~ThreadScope() {
+    if (owner_) {
+        llvm::timeTraceProfilerFinishThread();
+    }
+}
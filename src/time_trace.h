@@ -0,0 +1,42 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#ifndef TINY_C_COMPILER_TIME_TRACE_H
+#define TINY_C_COMPILER_TIME_TRACE_H
+
+#include <atomic>
+#include <string>
+
+// -ftime-trace: 用LLVM的time trace profiler生成Chrome trace event格式的JSON, 可以用Perfetto或者chrome://tracing查看
+// LLVM的profiler是线程局部的, 线程池中的任务开始时在所在的线程上开始记录, 结束时交给LLVM保存,
+// 最后由开始记录的线程把所有线程的记录一起写出; LLVM的pass和代码生成在开始记录的线程上自动产生区间
+class TimeTrace {
+public:
+    // 在当前线程开始记录, 短于granularity微秒的区间不记录
+    explicit TimeTrace(unsigned granularity);
+    ~TimeTrace();
+
+    TimeTrace(const TimeTrace &) = delete;
+    TimeTrace &operator=(const TimeTrace &) = delete;
+
+    // 必须在所有任务都结束之后, 在开始记录的线程上调用
+    bool Write(const std::string &path);
+
+    // 线程池中的任务使用, 没有在记录, 或者当前线程已经在记录(例如在Wait中执行的任务)时什么也不做
+    class ThreadScope {
+    public:
+        ThreadScope();
+        ~ThreadScope();
+
+        ThreadScope(const ThreadScope &) = delete;
+        ThreadScope &operator=(const ThreadScope &) = delete;
+    private:
+        bool owner_{false};
+    };
+private:
+    static std::atomic<unsigned> granularity_;
+    static std::atomic<bool> active_;
+};
+
+#endif //TINY_C_COMPILER_TIME_TRACE_H
@@ -3,133 +3,109 @@
 //
 
 #include "token.h"
-#include <iostream>
-
-Token::Token(TokenType type, TokenValue value, const std::string &name) :
-        type_{type}, value_{value}, name_{name} {}
 
 Token::Token(TokenType type,
              TokenValue value,
              std::int32_t symbol_precedence,
-             const std::string &name) : Token{type, value, name} {
-    symbol_precedence_ = symbol_precedence;
-}
+             std::uint32_t offset,
+             std::uint32_t length) :
+        type_{type}, value_{value}, symbol_precedence_{static_cast<std::int16_t>(symbol_precedence)},
+        offset_{offset}, length_{length} {}
 
 Token::Token(TokenType type,
              TokenValue value,
-             const std::string &name,
-             bool bool_value) : Token{type, value, name} {
-    bool_value_ = bool_value;
+             std::int32_t symbol_precedence,
+             std::uint32_t offset,
+             std::uint32_t length,
+             SymbolId symbol) : Token{type, value, symbol_precedence, offset, length} {
+    symbol_ = symbol;
 }
 
 Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             char char_value) : Token{type, value, name} {
-    char_value_ = char_value;
+             std::uint32_t offset,
+             std::uint32_t length,
+             std::int64_t signed_value) : Token{type, TokenValue::kUnreserved, 0, offset, length} {
+    signed_value_ = signed_value;
 }
 
 Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             unsigned char unsigned_char_value) : Token{type, value, name} {
-    unsigned_char_value_ = unsigned_char_value;
+             std::uint32_t offset,
+             std::uint32_t length,
+             std::uint64_t unsigned_value) : Token{type, TokenValue::kUnreserved, 0, offset, length} {
+    unsigned_value_ = unsigned_value;
 }
 
 Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             signed char signed_char_value) : Token{type, value, name} {
-    signed_char_value_ = signed_char_value;
+             std::uint32_t offset,
+             std::uint32_t length,
+             double floating_value) : Token{type, TokenValue::kUnreserved, 0, offset, length} {
+    floating_value_ = floating_value;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             short short_value) : Token{type, value, name} {
-    short_value_ = short_value;
+TokenType Token::GetTokenType() const {
+    return type_;
 }
 
-Token::Token(TokenType type, TokenValue value,
-             const std::string &name, int int_value) : Token{type, value, name} {
-    int_value_ = int_value;
+TokenValue Token::GetTokenValue() const {
+    return value_;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             long long_value) : Token{type, value, name} {
-    long_value_ = long_value;
+std::int32_t Token::GetTokPrecedence() const {
+    return symbol_precedence_;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             long long long_long_value) : Token{type, value, name} {
-    long_long_value_ = long_long_value;
+std::uint32_t Token::GetOffset() const {
+    return offset_;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             unsigned short unsigned_short_value) : Token{type, value, name} {
-    unsigned_short_value_ = unsigned_short_value;
+std::uint32_t Token::GetLength() const {
+    return length_;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             unsigned int unsigned_int_value) : Token{type, value, name} {
-    unsigned_int_value_ = unsigned_int_value;
-}
-
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             unsigned long unsigned_long_value) : Token{type, value, name} {
-    unsigned_long_value_ = unsigned_long_value;
+bool Token::IsSigned() const {
+    switch (type_) {
+        case TokenType::kBoolean:
+        case TokenType::kCharacter:
+        case TokenType::KSignedCharacter:
+        case TokenType::kShortInterger:
+        case TokenType::kInterger:
+        case TokenType::kLongInterger:
+        case TokenType::kLongLongInterger:return true;
+        default:return false;
+    }
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             unsigned long long unsigned_long_long_value) : Token{type, value, name} {
-    unsigned_long_long_value_ = unsigned_long_long_value;
+bool Token::IsUnsigned() const {
+    switch (type_) {
+        case TokenType::KUnsignedCharacter:
+        case TokenType::kUnsignedShortInterger:
+        case TokenType::kUnsignedInterger:
+        case TokenType::kUnsignedLongInterger:
+        case TokenType::kUnsignedLongLongInterger:return true;
+        default:return false;
+    }
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             float float_value) : Token{type, value, name} {
-    float_value_ = float_value;
+bool Token::IsFloating() const {
+    return type_ == TokenType::kFolat || type_ == TokenType::kDouble;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             double double_value) : Token{type, value, name} {
-    double_value_ = double_value;
+bool Token::HasSymbol() const {
+    return type_ == TokenType::kIdentifier || type_ == TokenType::kString;
 }
 
-Token::Token(TokenType type,
-             TokenValue value,
-             const std::string &name,
-             const std::string &string_value) : Token{type, value, name} {
-    string_value_ = string_value;
+std::int64_t Token::GetSignedValue() const {
+    return IsSigned() ? signed_value_ : 0;
 }
 
-TokenType Token::GetTokenType() const {
-    return type_;
+std::uint64_t Token::GetUnsignedValue() const {
+    return IsUnsigned() ? unsigned_value_ : 0;
 }
 
-TokenValue Token::GetTokenValue() const {
-    return value_;
+double Token::GetFloatingValue() const {
+    return IsFloating() ? floating_value_ : 0.0;
 }
 
-std::string Token::GetTokenName() const {
-    return name_;
+SymbolId Token::GetSymbol() const {
+    return HasSymbol() ? symbol_ : kEmptySymbol;
 }
-
-std::int32_t Token::GetTokPrecedence() const {
-    return symbol_precedence_;
-}
\ No newline at end of file
@@ -5,12 +5,11 @@
 #ifndef TINY_C_COMPILER_TOKEN_H
 #define TINY_C_COMPILER_TOKEN_H
 
-#include <string>
+#include "interner.h"
+
 #include <cstdint>
-#include <vector>
-#include <iostream>
 
-enum class TokenType {
+enum class TokenType : std::uint8_t {
     kBoolean,
     kCharacter,
     KUnsignedCharacter,
@@ -40,7 +39,7 @@ enum class TokenType {
     kUnknown
 };
 
-enum class TokenValue {
+enum class TokenValue : std::uint8_t {
     kAutoKey,
     kBreakKey,
     kCaseKey,
@@ -80,6 +79,16 @@ enum class TokenValue {
     kImaginaryKey,
 
     kAssign,           // =
+    kPlusAssign,       // +=
+    kMinusAssign,      // -=
+    kMultiplyAssign,   // *=
+    kDivideAssign,     // /=
+    kModAssign,        // %=
+    kAndAssign,        // &=
+    kOrAssign,         // |=
+    kXorAssign,        // ^=
+    kShlAssign,        // <<=
+    kShrAssign,        // >>=
 
     kPlusPlus,         // ++
     kMinusMinus,       // --
@@ -111,6 +120,9 @@ enum class TokenValue {
     kPeriod,           // .
 
     kComma,            // ,
+    kQuestion,         // ?
+    kColon,            // :
+    kEllipsis,         // ...
 
     kLeftParen,        // (
     kRightParen,       // )
@@ -124,90 +136,54 @@ enum class TokenValue {
     kUnreserved
 };
 
+// 紧凑的记号表示, 可以平凡拷贝, 不持有任何堆内存
+// 记号的拼写通过offset_和length_指向输入缓冲区, 字面量的值存放在同一个带标签的联合中
+// 联合中哪个成员有效由type_决定, 标识符和字符串字面量保存的是驻留之后的编号
 class Token {
 public:
     Token() = default;
-    Token(TokenType type, TokenValue value, const std::string &name);
-    Token(TokenType type,
-          TokenValue value,
-          std::int32_t symbol_precedence,
-          const std::string &name);
-
-    Token(TokenType type, TokenValue value, const std::string &name, bool bool_value);
-    Token(TokenType type, TokenValue value, const std::string &name, char char_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          unsigned char unsigned_char_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          signed char signed_char_value);
-
-    Token(TokenType type, TokenValue value, const std::string &name, short short_value);
-    Token(TokenType type, TokenValue value, const std::string &name, int int_value);
-    Token(TokenType type, TokenValue value, const std::string &name, long long_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          long long long_long_value);
-
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          unsigned short unsigned_short_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          unsigned int unsigned_int_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          unsigned long unsigned_long_value);
-    Token(TokenType type, TokenValue value,
-          const std::string &name,
-          unsigned long long unsigned_long_long_value);
-
-    Token(TokenType type, TokenValue value, const std::string &name, float float_value);
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          double double_value);
-
-    Token(TokenType type,
-          TokenValue value,
-          const std::string &name,
-          const std::string &string_value);
+    Token(TokenType type, TokenValue value, std::int32_t symbol_precedence,
+          std::uint32_t offset, std::uint32_t length);
+    Token(TokenType type, TokenValue value, std::int32_t symbol_precedence,
+          std::uint32_t offset, std::uint32_t length, SymbolId symbol);
+
+    Token(TokenType type, std::uint32_t offset, std::uint32_t length,
+          std::int64_t signed_value);
+    Token(TokenType type, std::uint32_t offset, std::uint32_t length,
+          std::uint64_t unsigned_value);
+    Token(TokenType type, std::uint32_t offset, std::uint32_t length,
+          double floating_value);
 
     TokenType GetTokenType() const;
     TokenValue GetTokenValue() const;
-    std::string GetTokenName() const;
     std::int32_t GetTokPrecedence() const;
+    std::uint32_t GetOffset() const;
+    std::uint32_t GetLength() const;
+
+    bool IsSigned() const;
+    bool IsUnsigned() const;
+    bool IsFloating() const;
+    bool HasSymbol() const;
+
+    std::int64_t GetSignedValue() const;
+    std::uint64_t GetUnsignedValue() const;
+    double GetFloatingValue() const;
+    SymbolId GetSymbol() const;
 private:
     TokenType type_{TokenType::kUnknown};
     TokenValue value_{TokenValue::kUnreserved};
-    std::string name_;
-    std::int32_t symbol_precedence_{};
-
-    bool bool_value_{};
-    char char_value_{};
-    unsigned char unsigned_char_value_{};
-    signed char signed_char_value_{};
-
-    short short_value_{};
-    int int_value_{};
-    long long_value_{};
-    long long long_long_value_{};
-
-    unsigned short unsigned_short_value_{};
-    unsigned int unsigned_int_value_{};
-    unsigned long unsigned_long_value_{};
-    unsigned long long unsigned_long_long_value_{};
-
-    float float_value_{};
-    double double_value_{};
-
-    std::string string_value_;
+    std::int16_t symbol_precedence_{};
+    std::uint32_t offset_{};
+    std::uint32_t length_{};
+
+    union {
+        std::int64_t signed_value_{};
+        std::uint64_t unsigned_value_;
+        double floating_value_;
+        SymbolId symbol_;
+    };
 };
 
+static_assert(sizeof(Token) <= 24);
+
 #endif //TINY_C_COMPILER_TOKEN_H
\ No newline at end of file
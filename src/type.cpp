@@ -3,3 +3,236 @@
 //
 
 #include "type.h"
+
+#include <algorithm>
+
+namespace {
+
+std::uint64_t AlignTo(std::uint64_t value, std::uint64_t align) {
+    return (value + align - 1) / align * align;
+}
+
+// x86-64 System V ABI中基本类型的大小
+std::uint64_t GetBasicSize(TypeKind kind) {
+    switch (kind) {
+        case TypeKind::kVoid:
+        case TypeKind::kBool:
+        case TypeKind::kChar:return 1;
+        case TypeKind::kShort:return 2;
+        case TypeKind::kInt:
+        case TypeKind::kFloat:
+        case TypeKind::kEnum:return 4;
+        case TypeKind::kLong:
+        case TypeKind::kLongLong:
+        case TypeKind::kDouble:
+        case TypeKind::kPointer:return 8;
+        case TypeKind::kLongDouble:return 16;
+        default:return 1;
+    }
+}
+
+}
+
+bool Type::IsVoid() const {
+    return kind_ == TypeKind::kVoid;
+}
+
+bool Type::IsInteger() const {
+    return (kind_ >= TypeKind::kBool && kind_ <= TypeKind::kLongLong) || kind_ == TypeKind::kEnum;
+}
+
+bool Type::IsFloating() const {
+    return kind_ >= TypeKind::kFloat && kind_ <= TypeKind::kLongDouble;
+}
+
+bool Type::IsArithmetic() const {
+    return IsInteger() || IsFloating();
+}
+
+bool Type::IsPointer() const {
+    return kind_ == TypeKind::kPointer;
+}
+
+bool Type::IsScalar() const {
+    return IsArithmetic() || IsPointer();
+}
+
+bool Type::IsArray() const {
+    return kind_ == TypeKind::kArray;
+}
+
+bool Type::IsFunction() const {
+    return kind_ == TypeKind::kFunction;
+}
+
+bool Type::IsRecord() const {
+    return kind_ == TypeKind::kStruct || kind_ == TypeKind::kUnion;
+}
+
+bool Type::IsComplete() const {
+    switch (kind_) {
+        case TypeKind::kVoid:
+        case TypeKind::kFunction:return false;
+        case TypeKind::kArray:return length_ >= 0 && base_->IsComplete();
+        case TypeKind::kStruct:
+        case TypeKind::kUnion:return complete_;
+        default:return true;
+    }
+}
+
+std::uint64_t Type::GetSize() const {
+    switch (kind_) {
+        case TypeKind::kArray:return length_ < 0 ? 0 : static_cast<std::uint64_t>(length_) * base_->GetSize();
+        case TypeKind::kStruct:
+        case TypeKind::kUnion:return size_;
+        default:return GetBasicSize(kind_);
+    }
+}
+
+std::uint64_t Type::GetAlign() const {
+    switch (kind_) {
+        case TypeKind::kArray:return base_->GetAlign();
+        case TypeKind::kStruct:
+        case TypeKind::kUnion:return align_;
+        default:return GetBasicSize(kind_);
+    }
+}
+
+const Member *Type::FindMember(SymbolId name, std::uint64_t &offset) const {
+    for (const auto &member:members_) {
+        if (member.name_ == name) {
+            offset = member.offset_;
+            return &member;
+        }
+        if (member.name_ == kEmptySymbol && !member.bit_field_ && member.type_->IsRecord()) {
+            std::uint64_t inner_offset{};
+            if (auto inner{member.type_->FindMember(name, inner_offset)}) {
+                offset = member.offset_ + inner_offset;
+                return inner;
+            }
+        }
+    }
+    return nullptr;
+}
+
+TypeTable::TypeTable() {
+    for (auto kind{static_cast<std::size_t>(TypeKind::kVoid)}; kind < std::size(basic_); ++kind) {
+        for (std::size_t is_unsigned{}; is_unsigned < 2; ++is_unsigned) {
+            auto type{NewType(static_cast<TypeKind>(kind))};
+            type->unsigned_ = is_unsigned;
+            basic_[kind][is_unsigned] = type;
+        }
+    }
+}
+
+const Type *TypeTable::GetBasic(TypeKind kind, bool is_unsigned) const {
+    return basic_[static_cast<std::size_t>(kind)][is_unsigned];
+}
+
+const Type *TypeTable::GetVoid() const {
+    return GetBasic(TypeKind::kVoid);
+}
+
+const Type *TypeTable::GetInt() const {
+    return GetBasic(TypeKind::kInt);
+}
+
+const Type *TypeTable::GetPointer(const Type *base) {
+    std::lock_guard lock{mutex_};
+    auto &pointer{pointers_[base]};
+    if (!pointer) {
+        auto type{NewType(TypeKind::kPointer)};
+        type->unsigned_ = true;
+        type->base_ = base;
+        pointer = type;
+    }
+    return pointer;
+}
+
+const Type *TypeTable::GetArray(const Type *base, std::int64_t length) {
+    std::lock_guard lock{mutex_};
+    auto type{NewType(TypeKind::kArray)};
+    type->base_ = base;
+    type->length_ = length;
+    return type;
+}
+
+const Type *TypeTable::GetFunction(const Type *return_type, std::vector<Parameter> params,
+                                   bool variadic, bool has_prototype) {
+    std::lock_guard lock{mutex_};
+    auto type{NewType(TypeKind::kFunction)};
+    type->base_ = return_type;
+    type->params_ = std::move(params);
+    type->variadic_ = variadic;
+    type->has_prototype_ = has_prototype;
+    return type;
+}
+
+Type *TypeTable::NewRecord(TypeKind kind, SymbolId tag) {
+    std::lock_guard lock{mutex_};
+    auto type{NewType(kind)};
+    type->tag_ = tag;
+    type->complete_ = false;
+    type->align_ = 1;
+    return type;
+}
+
+// 按照System V ABI布局, 位域不跨越与其类型对齐的存储单元, 无名位域不影响整体的对齐
+void TypeTable::CompleteRecord(Type *record, std::vector<Member> members) {
+    std::uint64_t bits{};
+    std::uint64_t size{};
+    std::uint64_t align{1};
+
+    for (auto &member:members) {
+        auto member_align{member.type_->GetAlign()};
+        auto member_size{member.type_->GetSize()};
+
+        if (record->kind_ == TypeKind::kUnion) {
+            member.offset_ = 0;
+            size = std::max(size, member.bit_field_ ? AlignTo(member.bit_width_, 8) / 8 : member_size);
+        } else if (member.bit_field_) {
+            auto unit{member_align * 8};
+            if (member.bit_width_ == 0 || bits / unit != (bits + member.bit_width_ - 1) / unit) {
+                bits = AlignTo(bits, unit);
+            }
+            member.offset_ = bits / unit * member_align;
+            member.bit_offset_ = static_cast<std::uint32_t>(bits - member.offset_ * 8);
+            bits += member.bit_width_;
+        } else {
+            bits = AlignTo(bits, member_align * 8);
+            member.offset_ = bits / 8;
+            bits += member_size * 8;
+        }
+
+        if (!member.bit_field_ || member.name_ != kEmptySymbol) {
+            align = std::max(align, member_align);
+        }
+    }
+
+    if (record->kind_ == TypeKind::kStruct) {
+        size = AlignTo(bits, 8) / 8;
+    }
+
+    // 宽度为0的位域只用于布局
+    members.erase(std::remove_if(std::begin(members), std::end(members),
+                                 [](const Member &member) { return member.bit_field_ && member.bit_width_ == 0; }),
+                  std::end(members));
+
+    record->members_ = std::move(members);
+    record->size_ = AlignTo(size, align);
+    record->align_ = align;
+    record->complete_ = true;
+}
+
+Type *TypeTable::NewEnum(SymbolId tag) {
+    std::lock_guard lock{mutex_};
+    auto type{NewType(TypeKind::kEnum)};
+    type->tag_ = tag;
+    return type;
+}
+
+Type *TypeTable::NewType(TypeKind kind) {
+    types_.push_back(std::make_unique<Type>());
+    types_.back()->kind_ = kind;
+    return types_.back().get();
+}
@@ -5,13 +5,123 @@
 #ifndef TINY_C_COMPILER_TYPE_H
 #define TINY_C_COMPILER_TYPE_H
 
-#include <llvm/IR/LLVMContext.h>
+#include "interner.h"
 
-class TypeSystem {
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+enum class TypeKind : std::uint8_t {
+    kVoid,
+    kBool,
+    kChar,
+    kShort,
+    kInt,
+    kLong,
+    kLongLong,
+    kFloat,
+    kDouble,
+    kLongDouble,
+    kEnum,
+
+    kPointer,
+    kArray,
+    kFunction,
+    kStruct,
+    kUnion
+};
+
+class Type;
+
+// 原型中的形参可以没有名字
+class Parameter {
+public:
+    const Type *type_;
+    SymbolId name_{kEmptySymbol};
+};
+
+class Member {
+public:
+    const Type *type_;
+    SymbolId name_{kEmptySymbol};
+    std::uint64_t offset_{};
+    // 位域所在的存储单元从offset_开始
+    bool bit_field_{false};
+    std::uint32_t bit_width_{};
+    std::uint32_t bit_offset_{};
+};
+
+// C的类型, 由TypeTable创建和拥有
+// 同一个基本类型和指向同一类型的指针只有一个对象, 可以直接比较指针
+// 类型限定符只做语法检查, 不记录在类型中
+class Type {
+public:
+    bool IsVoid() const;
+    bool IsInteger() const;
+    bool IsFloating() const;
+    bool IsArithmetic() const;
+    bool IsPointer() const;
+    bool IsScalar() const;
+    bool IsArray() const;
+    bool IsFunction() const;
+    bool IsRecord() const;
+    bool IsComplete() const;
+
+    std::uint64_t GetSize() const;
+    std::uint64_t GetAlign() const;
+    // 匿名的结构体/联合成员中的成员也可以直接找到, offset是相对于整个对象的偏移
+    const Member *FindMember(SymbolId name, std::uint64_t &offset) const;
+
+    TypeKind kind_;
+    bool unsigned_{false};
+    // 指针指向的类型, 数组的元素类型或者函数的返回类型
+    const Type *base_{nullptr};
+    // 数组的长度, 未指定长度时为-1
+    std::int64_t length_{-1};
+
+    std::vector<Parameter> params_;
+    bool variadic_{false};
+    // 用()声明的函数没有原型, 不检查实参
+    bool has_prototype_{true};
+
+    SymbolId tag_{kEmptySymbol};
+    std::vector<Member> members_;
+    bool complete_{true};
+    std::uint64_t size_{};
+    std::uint64_t align_{};
+};
+
+// 一个翻译单元中的所有类型
+// 代码生成的多个线程会同时创建指针类型, 创建类型的操作都加锁, 已经创建的类型只读
+class TypeTable {
 public:
+    TypeTable();
+    TypeTable(const TypeTable &) = delete;
+    TypeTable &operator=(const TypeTable &) = delete;
+
+    const Type *GetBasic(TypeKind kind, bool is_unsigned = false) const;
+    const Type *GetVoid() const;
+    const Type *GetInt() const;
+    const Type *GetPointer(const Type *base);
+    const Type *GetArray(const Type *base, std::int64_t length);
+    const Type *GetFunction(const Type *return_type, std::vector<Parameter> params,
+                            bool variadic, bool has_prototype);
+
+    // 结构体和联合先创建为不完整类型, 读到成员列表之后再完成
+    Type *NewRecord(TypeKind kind, SymbolId tag);
+    void CompleteRecord(Type *record, std::vector<Member> members);
+    Type *NewEnum(SymbolId tag);
 private:
-    llvm::LLVMContext &the_context_;
+    Type *NewType(TypeKind kind);
 
+    std::vector<std::unique_ptr<Type>> types_;
+    // 下标为基本类型的TypeKind, 有无符号各一个
+    std::array<std::array<const Type *, 2>, static_cast<std::size_t>(TypeKind::kEnum)> basic_{};
+    std::unordered_map<const Type *, const Type *> pointers_;
+    std::mutex mutex_;
 };
 
-#endif //TINY_C_COMPILER_TYPE_H
\ No newline at end of file
+#endif //TINY_C_COMPILER_TYPE_H
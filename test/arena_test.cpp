@@ -0,0 +1,36 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "arena.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+
+BOOST_AUTO_TEST_SUITE(ArenaTest)
+
+BOOST_AUTO_TEST_CASE(AllocationsAreAlignedAndStable) {
+    Arena arena;
+    auto c{arena.New<char>('a')};
+    auto d{arena.New<double>(1.5)};
+    BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(d) % alignof(double), 0);
+
+    // 大块单独分配, 之后的小对象仍然放在原来的块中
+    auto big{arena.NewList<std::uint64_t>(8192)};
+    auto next{arena.New<std::uint32_t>(7u)};
+    BOOST_CHECK_EQUAL(std::size(big), 8192);
+    BOOST_CHECK_EQUAL(big.back(), 0);
+    BOOST_CHECK_EQUAL(reinterpret_cast<char *>(next) - reinterpret_cast<char *>(d), 8);
+
+    for (int i{}; i < 100000; ++i) {
+        arena.New<std::uint64_t>(static_cast<std::uint64_t>(i));
+    }
+    BOOST_CHECK_EQUAL(*c, 'a');
+    BOOST_CHECK_EQUAL(*d, 1.5);
+    BOOST_CHECK_EQUAL(*next, 7u);
+    BOOST_CHECK(arena.GetBytesReserved() >= arena.GetBytesUsed());
+    BOOST_CHECK(std::empty(arena.NewList<int>(0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
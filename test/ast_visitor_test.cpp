@@ -0,0 +1,131 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "ast_statistics.h"
+#include "ast_visitor.h"
+#include "flat_ast.h"
+#include "parser.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Parsed {
+    explicit Parsed(std::string source) :
+            input{std::move(source)}, scanner{input, "visitor.c"}, parser{scanner, types, arena},
+            program{parser.Parse()} {}
+
+    std::string input;
+    TypeTable types;
+    Arena arena;
+    Scanner scanner;
+    Parser parser;
+    Block *program;
+};
+
+// 记录访问顺序, 可以在第一个标识符处停止, 或者跳过嵌套的块
+class OrderRecorder : public ASTVisitor<OrderRecorder> {
+public:
+    bool VisitNode(const ASTNode *node) {
+        kinds_.push_back(node->kind_);
+        return true;
+    }
+
+    bool VisitIdentifierOrType(const IdentifierOrType *) {
+        return !stop_at_identifier_;
+    }
+
+    bool VisitBinaryOpExpression(const BinaryOpExpression *) {
+        ++binary_;
+        return true;
+    }
+
+    bool TraverseBlock(const Block *node) {
+        return skip_nested_blocks_ && node != root_ ? true : ASTVisitor::TraverseBlock(node);
+    }
+
+    std::vector<NodeKind> kinds_;
+    int binary_{};
+    bool stop_at_identifier_{false};
+    bool skip_nested_blocks_{false};
+    const Block *root_{nullptr};
+};
+
+const char *const kSource{"int g = 1 + 2;\n"
+                          "int f(int a) {\n"
+                          "    a = a * 3;\n"
+                          "    if (a) return a; else for (;;) break;\n"
+                          "    do a--; while (a > 0);\n"
+                          "    return sizeof(int);\n"
+                          "}\n"};
+
+}
+
+BOOST_AUTO_TEST_SUITE(ASTVisitorTest)
+
+BOOST_AUTO_TEST_CASE(PreOrderAndEarlyExit) {
+    Parsed parsed{kSource};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    OrderRecorder recorder;
+    BOOST_CHECK(recorder.Traverse(parsed.program));
+    BOOST_CHECK((std::vector<NodeKind>{std::begin(recorder.kinds_), std::begin(recorder.kinds_) + 6} ==
+                 std::vector<NodeKind>{NodeKind::kBlock, NodeKind::kVariableDeclaration, NodeKind::kBinaryOp,
+                                       NodeKind::kInteger, NodeKind::kInteger, NodeKind::kFunctionDeclaration}));
+    // Assignment也会调用VisitBinaryOpExpression
+    BOOST_CHECK_EQUAL(recorder.binary_, 4);
+
+    OrderRecorder stopped;
+    stopped.stop_at_identifier_ = true;
+    BOOST_CHECK(!stopped.Traverse(parsed.program));
+    BOOST_CHECK(stopped.kinds_.back() == NodeKind::kIdentifier);
+    BOOST_CHECK(std::size(stopped.kinds_) < std::size(recorder.kinds_));
+
+    OrderRecorder skipped;
+    skipped.skip_nested_blocks_ = true;
+    skipped.root_ = parsed.program;
+    BOOST_CHECK(skipped.Traverse(parsed.program));
+    BOOST_CHECK((skipped.kinds_.back() == NodeKind::kVariableDeclaration));
+}
+
+BOOST_AUTO_TEST_CASE(Statistics) {
+    Parsed parsed{kSource};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    ASTStatistics statistics;
+    BOOST_CHECK(statistics.Traverse(parsed.program));
+    BOOST_CHECK_EQUAL(statistics.GetCount(NodeKind::kReturn), 2);
+    BOOST_CHECK_EQUAL(statistics.GetCount(NodeKind::kAssignment), 1);
+    BOOST_CHECK_EQUAL(statistics.GetCount(NodeKind::kBreak), 1);
+    BOOST_CHECK_EQUAL(statistics.GetCount(NodeKind::kSizeof), 1);
+    // Block, FunctionDeclaration, Block, ExpressionStatement, Assignment, BinaryOp, Identifier
+    BOOST_CHECK_EQUAL(statistics.GetMaxDepth(), 7);
+
+    // 与FlatAST中除了空节点之外的节点一一对应
+    FlatAST flat{*parsed.program};
+    BOOST_CHECK_EQUAL(statistics.GetTotal() + 1, flat.GetNodeCount());
+
+    std::ostringstream os;
+    statistics.Print(os);
+    BOOST_CHECK(os.str().find("Identifier") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(NodeCastChecksKind) {
+    Parsed parsed{"int x = 1, y = x = 2;\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    auto y{NodeCast<VariableDeclaration>(parsed.program->statements_[1])};
+    BOOST_REQUIRE(y != nullptr);
+    BOOST_CHECK(NodeCast<Assignment>(y->initialization_expression_) != nullptr);
+    // 只匹配类本身
+    BOOST_CHECK(NodeCast<BinaryOpExpression>(y->initialization_expression_) == nullptr);
+    BOOST_CHECK(NodeCast<Block>(y) == nullptr);
+    BOOST_CHECK(NodeCast<Integer>(nullptr) == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "code_gen.h"
+#include "parser.h"
+
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+struct Parsed {
+    explicit Parsed(std::string source) :
+            input{std::move(source)}, scanner{input, "code_gen.c"}, parser{scanner, types, arena},
+            program{parser.Parse()} {}
+
+    std::string input;
+    TypeTable types;
+    Arena arena;
+    Scanner scanner;
+    Parser parser;
+    Block *program;
+};
+
+bool IsValid(const llvm::Module &module) {
+    std::string error;
+    llvm::raw_string_ostream os{error};
+    auto broken{llvm::verifyModule(module, &os)};
+    BOOST_TEST_MESSAGE(os.str());
+    return !broken;
+}
+
+bool HasDiagnostic(const CodeGenContext &context, const std::string &message, bool warning) {
+    for (const auto &diagnostic:context.GetDiagnostics()) {
+        if (diagnostic.warning_ == warning && diagnostic.message_.find(message) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *const kSource{"struct point { int x, y; char name[4]; };\n"
+                          "static int counter = 2;\n"
+                          "int table[] = {1, 2, 3};\n"
+                          "struct point origin = {1, 2, \"o\"};\n"
+                          "static int square(int x) { return x * x; }\n"
+                          "struct point make(int x) { struct point p = {x, x}; return p; }\n"
+                          "int sum(struct point p) { return p.x + p.y; }\n"
+                          "int main(void) {\n"
+                          "    int i, total = 0;\n"
+                          "    for (i = 0; i < 3; ++i) total += table[i] ? square(i) : counter;\n"
+                          "    return total + sum(make(1)) + origin.name[0];\n"
+                          "}\n"};
+
+}
+
+BOOST_AUTO_TEST_SUITE(CodeGenTest)
+
+BOOST_AUTO_TEST_CASE(Module) {
+    Parsed parsed{kSource};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    CodeGenContext context{parsed.scanner, parsed.types, "code_gen.c"};
+    context.GenerateCode(*parsed.program);
+    BOOST_REQUIRE(!context.HasErrors());
+    BOOST_CHECK(IsValid(*context.the_module_));
+
+    auto &module{*context.the_module_};
+    BOOST_CHECK(module.getFunction("square")->hasInternalLinkage());
+    BOOST_CHECK(module.getFunction("make")->hasStructRetAttr());
+    BOOST_CHECK(module.getGlobalVariable("counter", true)->hasInternalLinkage());
+}
+
+BOOST_AUTO_TEST_CASE(Partitions) {
+    Parsed parsed{kSource};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    ThreadPool pool{2};
+    auto contexts{GenerateCodeParallel(*parsed.program, parsed.scanner, parsed.types, pool, 3)};
+    BOOST_REQUIRE_EQUAL(std::size(contexts), 3);
+
+    // 每个函数只在一个模块中定义, 变量都在第一个模块中
+    std::unordered_map<std::string, int> definitions;
+    for (const auto &context:contexts) {
+        BOOST_REQUIRE(!context->HasErrors());
+        BOOST_CHECK(IsValid(*context->the_module_));
+        for (const auto &function:*context->the_module_) {
+            if (!function.isDeclaration()) {
+                ++definitions[function.getName().str()];
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(std::size(definitions), 4);
+    for (const auto &[name, count]:definitions) {
+        BOOST_CHECK_MESSAGE(count == 1, name);
+    }
+    BOOST_CHECK(contexts[0]->the_module_->getGlobalVariable("table") != nullptr);
+
+    // static的符号改名后只在链接单元内可见
+    for (const auto &context:contexts) {
+        for (const auto &global:context->the_module_->global_values()) {
+            if (global.getName().startswith("square") || global.getName().startswith("counter")) {
+                BOOST_CHECK(global.getName().contains("."));
+                BOOST_CHECK(global.hasHiddenVisibility());
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Diagnostics) {
+    Parsed parsed{"int g = 1;\n"
+                  "int h = g;\n"
+                  "int f(int x) { return x; }\n"
+                  "int main(void) {\n"
+                  "    f();\n"
+                  "    undeclared = 1;\n"
+                  "    foo();\n"
+                  "    switch (g) { case 1: case 1: ; }\n"
+                  "    return;\n"
+                  "}\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    CodeGenContext context{parsed.scanner, parsed.types, "code_gen.c"};
+    context.GenerateCode(*parsed.program);
+    BOOST_CHECK(context.HasErrors());
+    BOOST_CHECK(HasDiagnostic(context, "not a compile-time constant", false));
+    BOOST_CHECK(HasDiagnostic(context, "too few arguments", false));
+    BOOST_CHECK(HasDiagnostic(context, "undeclared identifier 'undeclared'", false));
+    BOOST_CHECK(HasDiagnostic(context, "duplicate case value", false));
+    BOOST_CHECK(HasDiagnostic(context, "implicit declaration of function 'foo'", true));
+    BOOST_CHECK(HasDiagnostic(context, "should return a value", true));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
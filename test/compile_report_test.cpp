@@ -0,0 +1,103 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "compile_report.h"
+#include "time_trace.h"
+
+#include <llvm/Support/TimeProfiler.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(CompileReportTest)
+
+BOOST_AUTO_TEST_CASE(Allocations) {
+    // 没有CompileReport时不统计
+    auto allocations{CompileReport::GetAllocations()};
+    auto unused{std::make_unique<char[]>(1000)};
+    BOOST_CHECK_EQUAL(CompileReport::GetAllocations(), allocations);
+
+    auto report{std::make_unique<CompileReport>()};
+    allocations = CompileReport::GetAllocations();
+    auto bytes{CompileReport::GetAllocatedBytes()};
+    auto pointer{std::make_unique<char[]>(1000)};
+    BOOST_CHECK_EQUAL(CompileReport::GetAllocations(), allocations + 1);
+    BOOST_CHECK_EQUAL(CompileReport::GetAllocatedBytes(), bytes + 1000);
+    BOOST_CHECK(CompileReport::GetPeakRss() > 0);
+    BOOST_CHECK(CompileReport::GetPeakRss() >= CompileReport::GetCurrentRss());
+}
+
+// 嵌套的作用域从外层扣除
+BOOST_AUTO_TEST_CASE(NestedScopes) {
+    CompileReport report;
+    {
+        CompileReport::Scope codegen{&report, Phase::kCodeGen};
+        {
+            CompileReport::Scope preprocess{&report, Phase::kPreprocess};
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            auto pointer{std::make_unique<std::string>(100, 'x')};
+        }
+        CompileReport::Scope disabled{nullptr, Phase::kLink};
+    }
+    report.AddFile();
+    report.AddTokens(10);
+
+    std::ostringstream json;
+    report.PrintJson(json);
+    auto text{json.str()};
+    BOOST_TEST_MESSAGE(text);
+    BOOST_CHECK(text.find("\"files\": 1, \"tokens\": 10") != std::string::npos);
+    BOOST_CHECK(text.find("{\"name\": \"link\", \"calls\": 0") != std::string::npos);
+    BOOST_CHECK(text.find("{\"name\": \"codegen\", \"calls\": 1") != std::string::npos);
+
+    std::string prefix{"{\"name\": \"preprocess\", \"calls\": 1, \"wall_ms\": "};
+    auto preprocess{text.find(prefix)};
+    BOOST_REQUIRE(preprocess != std::string::npos);
+    BOOST_CHECK(std::stod(text.substr(preprocess + std::size(prefix))) >= 20.0);
+    auto codegen{text.find("\"codegen\"")};
+    BOOST_CHECK(std::stod(text.substr(text.find("\"wall_ms\": ", codegen) + 11)) < 20.0);
+    BOOST_CHECK(text.find("\"allocations\": 2", preprocess) < text.find("codegen"));
+
+    std::ostringstream table;
+    report.Print(table, true, true);
+    BOOST_CHECK(table.str().find("peak RSS") != std::string::npos);
+}
+
+// 其他线程上的区间在线程结束记录后一起写出
+BOOST_AUTO_TEST_CASE(Trace) {
+    auto path{(std::filesystem::temp_directory_path() / "tcc_time_trace_test.json").string()};
+    {
+        TimeTrace trace{0};
+        {
+            llvm::TimeTraceScope scope{"Main", "main.c"};
+            std::thread worker{[] {
+                TimeTrace::ThreadScope thread_scope;
+                TimeTrace::ThreadScope nested;
+                llvm::TimeTraceScope scope{"Worker", "worker.c"};
+            }};
+            worker.join();
+        }
+        BOOST_REQUIRE(trace.Write(path));
+    }
+    BOOST_CHECK(llvm::getTimeTraceProfilerInstance() == nullptr);
+    TimeTrace::ThreadScope inactive;
+    BOOST_CHECK(llvm::getTimeTraceProfilerInstance() == nullptr);
+
+    std::ifstream ifs{path};
+    std::string text{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+    BOOST_CHECK(text.find("\"traceEvents\"") != std::string::npos);
+    BOOST_CHECK(text.find("\"name\":\"Main\"") != std::string::npos);
+    BOOST_CHECK(text.find("\"name\":\"Worker\"") != std::string::npos);
+    BOOST_CHECK(text.find("worker.c") != std::string::npos);
+    std::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
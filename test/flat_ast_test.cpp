@@ -0,0 +1,148 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "flat_ast.h"
+#include "parser.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+struct Flattened {
+    explicit Flattened(std::string source) :
+            input{std::move(source)}, scanner{input, "flat.c"}, parser{scanner, types, arena},
+            ast{*parser.Parse()} {}
+
+    std::string input;
+    TypeTable types;
+    Arena arena;
+    Scanner scanner;
+    Parser parser;
+    FlatAST ast;
+};
+
+std::string Dump(const FlatAST &ast) {
+    std::ostringstream os;
+    ast.Dump(os);
+    return os.str();
+}
+
+const char *const kSource{"struct list { struct list *next; int value : 4; unsigned flag : 1; };\n"
+                          "static int sum(struct list *head, ...) {\n"
+                          "    int total = 0;\n"
+                          "    for (; head; head = head->next) total += head->value * 2;\n"
+                          "    if (total > 10) return total; else goto done;\n"
+                          "done:\n"
+                          "    return (long)sizeof(struct list) + \"s\"[0] - 1.5;\n"
+                          "}\n"};
+
+}
+
+BOOST_AUTO_TEST_SUITE(FlatASTTest)
+
+BOOST_AUTO_TEST_CASE(FlattenMatchesPointerTree) {
+    Flattened flattened{"int x = 1 + 2 * 3;\nvoid f(int a) { while (a) a--; }\n"};
+    BOOST_REQUIRE(!flattened.parser.HasErrors());
+
+    BOOST_CHECK_EQUAL(Dump(flattened.ast), "Block\n"
+                                           "  VariableDeclaration x : int\n"
+                                           "    BinaryOp +\n"
+                                           "      Integer 1 : int\n"
+                                           "      BinaryOp *\n"
+                                           "        Integer 2 : int\n"
+                                           "        Integer 3 : int\n"
+                                           "  FunctionDeclaration f : void(int)\n"
+                                           "    VariableDeclaration a : int\n"
+                                           "      Null\n"
+                                           "    Block\n"
+                                           "      While\n"
+                                           "        Identifier a\n"
+                                           "        ExpressionStatement\n"
+                                           "          UnaryOp -- postfix\n"
+                                           "            Identifier a\n");
+
+    const auto &ast{flattened.ast};
+    BOOST_CHECK_EQUAL(ast.GetNodeCount(), 16);
+    auto root{ast.GetRoot()};
+    BOOST_REQUIRE(ast.GetKind(root) == NodeKind::kBlock);
+    BOOST_REQUIRE_EQUAL(ast.ListEnd(root, 0) - ast.ListBegin(root, 0), 2);
+
+    // 父节点在子节点之前
+    auto function{ast.ListBegin(root, 0)[1]};
+    BOOST_CHECK(ast.GetKind(function) == NodeKind::kFunctionDeclaration);
+    BOOST_CHECK(ast.GetType(function)->IsFunction());
+    BOOST_CHECK_EQUAL(Interner::Global().GetSpelling(ast.GetSymbol(function, 0)), "f");
+    BOOST_CHECK(ast.GetOperand(function, 2) > function);
+    BOOST_CHECK(ast.GetBytes() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(WriteAndLoad) {
+    Flattened flattened{kSource};
+    BOOST_REQUIRE(!flattened.parser.HasErrors());
+    auto expected{Dump(flattened.ast)};
+
+    std::string file_name{"flat_ast_test.ast"};
+    BOOST_REQUIRE(flattened.ast.Write(file_name));
+
+    // 读入到新的类型表中, 类型和布局都重新创建
+    TypeTable types;
+    FlatAST loaded;
+    BOOST_REQUIRE(loaded.Load(file_name, types));
+    std::remove(file_name.c_str());
+    BOOST_CHECK_EQUAL(Dump(loaded), expected);
+    BOOST_CHECK_EQUAL(loaded.GetNodeCount(), flattened.ast.GetNodeCount());
+
+    auto function{loaded.ListBegin(loaded.GetRoot(), 0)[0]};
+    auto head{loaded.GetType(*loaded.ListBegin(function, 1))};
+    BOOST_REQUIRE(head->IsPointer() && head->base_->IsRecord());
+    auto list{head->base_};
+    BOOST_CHECK_EQUAL(list->GetSize(), 16);
+    BOOST_REQUIRE_EQUAL(std::size(list->members_), 3);
+    BOOST_CHECK(list->members_[0].type_ == head);
+    BOOST_CHECK_EQUAL(list->members_[2].bit_offset_, 4);
+    BOOST_CHECK(loaded.GetType(function)->variadic_);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsCorruptFiles) {
+    Flattened flattened{kSource};
+    std::string file_name{"flat_ast_test_corrupt.ast"};
+    BOOST_REQUIRE(flattened.ast.Write(file_name));
+
+    std::string contents;
+    {
+        std::ifstream ifs{file_name, std::ios::binary};
+        contents.assign(std::istreambuf_iterator<char>{ifs}, {});
+    }
+    auto rewrite{[&file_name](const std::string &data) {
+        std::ofstream ofs{file_name, std::ios::binary};
+        ofs << data;
+    }};
+
+    TypeTable types;
+    FlatAST ast;
+    rewrite(contents.substr(0, std::size(contents) / 2));
+    BOOST_CHECK(!ast.Load(file_name, types));
+    BOOST_CHECK_EQUAL(ast.GetNodeCount(), 1);
+
+    // 根节点的下标越界
+    auto corrupt{contents};
+    corrupt[31] = '\x7f';
+    rewrite(corrupt);
+    BOOST_CHECK(!ast.Load(file_name, types));
+
+    rewrite("TCC-AST");
+    BOOST_CHECK(!ast.Load(file_name, types));
+    BOOST_CHECK(!ast.Load("flat_ast_test_missing.ast", types));
+
+    rewrite(contents);
+    BOOST_CHECK(ast.Load(file_name, types));
+    std::remove(file_name.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,291 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "jit.h"
+#include "obj_gen.h"
+#include "parser.h"
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/Object/ObjectFile.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 分成两个分区生成目标文件, 再用ld -r合并为output
+bool CompilePartitioned(const std::string &input, const std::string &file_name, const std::string &output,
+                        unsigned opt_level = 0) {
+    TypeTable types;
+    Arena arena;
+    Scanner scanner{input, file_name};
+    Parser parser{scanner, types, arena};
+    auto program{parser.Parse()};
+    if (parser.HasErrors()) {
+        return false;
+    }
+
+    CodeGenOptions options;
+    options.opt_level_ = opt_level;
+    CodeGenSession session{options};
+    ThreadPool pool{2};
+    auto contexts{GenerateCodeParallel(*program, scanner, types, pool, 2)};
+    std::vector<ObjectFile> objects(std::size(contexts));
+    std::vector<const ObjectFile *> inputs;
+    std::string error;
+    for (std::size_t i{}; i < std::size(contexts); ++i) {
+        if (!ObjGen(session, *contexts[i], objects[i], error)) {
+            return false;
+        }
+        inputs.push_back(&objects[i]);
+    }
+    return std::size(inputs) == 2 && CombineObjects(inputs, output, std::cerr);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ObjGenTest)
+
+BOOST_AUTO_TEST_CASE(Session) {
+    CodeGenSession session;
+    BOOST_REQUIRE(session.IsValid());
+    BOOST_CHECK(!std::empty(session.GetTriple()));
+    BOOST_CHECK_EQUAL(session.GetDataLayout().getPointerSize(), 8);
+
+    CodeGenOptions options;
+    options.triple_ = "no-such-arch-unknown-linux";
+    CodeGenSession unknown{options};
+    BOOST_CHECK(!unknown.IsValid());
+    BOOST_CHECK(!std::empty(unknown.GetError()));
+    llvm::LLVMContext context;
+    llvm::Module module{"unknown", context};
+    llvm::SmallVector<char, 0> buffer;
+    std::string error;
+    BOOST_CHECK(!unknown.EmitObject(module, buffer, error));
+    BOOST_CHECK_EQUAL(error, unknown.GetError());
+    CodeGenOptions cpu;
+    cpu.cpu_ = "no-such-cpu";
+    BOOST_CHECK(!CodeGenSession{cpu}.IsValid());
+
+    // native替换为本机的处理器和特性
+    CodeGenOptions native;
+    native.cpu_ = "native";
+    native.features_ = "-avx2";
+    CodeGenSession host{native};
+    BOOST_REQUIRE(host.IsValid());
+    BOOST_CHECK_NE(host.GetOptions().cpu_, "native");
+    const auto &features{host.GetOptions().features_};
+    BOOST_CHECK_EQUAL(features.substr(features.rfind(',') + 1), "-avx2");
+}
+
+// 多个线程共享同一个session生成目标文件
+BOOST_AUTO_TEST_CASE(EmitInParallel) {
+    std::string input{"static int f(int x) { return x + 1; }\n"
+                      "int g(int x) { return f(x) * 2; }\n"
+                      "int h(int x) { return g(x) - 3; }\n"};
+    TypeTable types;
+    Arena arena;
+    Scanner scanner{input, "obj_gen.c"};
+    Parser parser{scanner, types, arena};
+    auto program{parser.Parse()};
+    BOOST_REQUIRE(!parser.HasErrors());
+
+    CodeGenSession session;
+    ThreadPool pool{3};
+    auto contexts{GenerateCodeParallel(*program, scanner, types, pool, 3)};
+    BOOST_REQUIRE_EQUAL(std::size(contexts), 3);
+
+    std::vector<ObjectFile> objects(std::size(contexts));
+    std::vector<std::string> errors(std::size(contexts));
+    std::vector<std::future<bool>> results;
+    for (std::size_t i{}; i < std::size(contexts); ++i) {
+        results.push_back(pool.Submit([&, i] { return ObjGen(session, *contexts[i], objects[i], errors[i]); }));
+    }
+    for (std::size_t i{}; i < std::size(results); ++i) {
+        BOOST_CHECK(pool.Wait(results[i]));
+        BOOST_REQUIRE(std::size(objects[i].data_) > 4);
+        BOOST_CHECK_EQUAL(std::string(std::data(objects[i].data_) + 1, 3), "ELF");
+        BOOST_CHECK_EQUAL(contexts[i]->the_module_->getTargetTriple(), session.GetTriple());
+    }
+
+    // 各个分区的目标文件在内存中交给链接器
+    std::string main_input{"int g(int x);\n"
+                           "int h(int x);\n"
+                           "int main(void) { return h(1) == 1 && g(2) == 6 ? 0 : 1; }\n"};
+    Scanner main_scanner{main_input, "main.c"};
+    Parser main_parser{main_scanner, types, arena};
+    auto main_program{main_parser.Parse()};
+    BOOST_REQUIRE(!main_parser.HasErrors());
+    CodeGenContext main_context{main_scanner, types, "main.c"};
+    main_context.GenerateCode(*main_program);
+    objects.emplace_back();
+    std::string error;
+    BOOST_REQUIRE(ObjGen(session, main_context, objects.back(), error));
+
+    std::vector<const ObjectFile *> inputs;
+    for (const auto &object:objects) {
+        inputs.push_back(&object);
+    }
+    auto directory{std::filesystem::temp_directory_path()};
+    auto program_file{(directory / "tcc_obj_gen_test").string()};
+    auto combined_file{(directory / "tcc_obj_gen_test.o").string()};
+    BOOST_REQUIRE(LinkObjects(inputs, program_file, std::cerr));
+    BOOST_CHECK_EQUAL(std::system(program_file.c_str()), 0);
+    BOOST_CHECK(CombineObjects(inputs, combined_file, std::cerr));
+    BOOST_CHECK(std::filesystem::file_size(combined_file) > 0);
+
+    // 错误信息写入调用者给出的流, 不直接写到标准错误
+    std::ostringstream diagnostics;
+    BOOST_CHECK(!WriteObject(objects.front(), (directory / "no" / "such" / "dir.o").string(), diagnostics));
+    BOOST_CHECK(diagnostics.str().find("unable to open output file") != std::string::npos);
+    std::filesystem::remove(program_file);
+    std::filesystem::remove(combined_file);
+}
+
+// 两个不同的util.c都有static的helper, 分区之后改名的符号合并时重新变为局部符号, 链接时不冲突
+BOOST_AUTO_TEST_CASE(PartitionedStatics) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_obj_gen_statics_test"};
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    auto one{(directory / "one.o").string()};
+    auto two{(directory / "two.o").string()};
+    auto main_object{(directory / "main.o").string()};
+    auto program_file{(directory / "program").string()};
+
+    BOOST_REQUIRE(CompilePartitioned("static int helper(void) { return 1; }\n"
+                                     "int one(void) { return helper(); }\n", "util.c", one));
+    BOOST_REQUIRE(CompilePartitioned("static int helper(void) { return 2; }\n"
+                                     "int two(void) { return helper() * 10; }\n", "util.c", two));
+    BOOST_REQUIRE(CompilePartitioned("int one(void);\nint two(void);\n"
+                                     "static int check(int x) { return x == 21 ? 0 : 1; }\n"
+                                     "int main(void) { return check(one() + two()); }\n", "main.c", main_object));
+
+    for (const auto &path:{one, two}) {
+        auto binary{llvm::object::ObjectFile::createObjectFile(path)};
+        BOOST_REQUIRE(static_cast<bool>(binary));
+        auto found{false};
+        for (const auto &symbol:binary->getBinary()->symbols()) {
+            auto name{symbol.getName()};
+            auto flags{symbol.getFlags()};
+            if (name && flags && name->startswith("helper.")) {
+                found = true;
+                BOOST_CHECK(!(*flags & llvm::object::SymbolRef::SF_Global));
+            } else if (!name || !flags) {
+                llvm::consumeError(name.takeError());
+                llvm::consumeError(flags.takeError());
+            }
+        }
+        BOOST_CHECK(found);
+    }
+
+    std::vector<ObjectFile> objects(3);
+    std::vector<const ObjectFile *> inputs;
+    for (std::size_t i{}; i < std::size(objects); ++i) {
+        auto path{i == 0 ? one : i == 1 ? two : main_object};
+        auto buffer{llvm::MemoryBuffer::getFile(path)};
+        BOOST_REQUIRE(static_cast<bool>(buffer));
+        objects[i].name_ = path;
+        objects[i].data_.assign((*buffer)->getBufferStart(), (*buffer)->getBufferEnd());
+        inputs.push_back(&objects[i]);
+    }
+    BOOST_REQUIRE(LinkObjects(inputs, program_file, std::cerr));
+    BOOST_CHECK_EQUAL(std::system(program_file.c_str()), 0);
+    std::filesystem::remove_all(directory);
+}
+
+// inline函数只在一个分区中定义, 其他分区中的调用在优化之后仍然能链接
+BOOST_AUTO_TEST_CASE(PartitionedInline) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_obj_gen_inline_test"};
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    auto object_file{(directory / "inline.o").string()};
+    auto program_file{(directory / "program").string()};
+
+    BOOST_REQUIRE(CompilePartitioned("inline int add1(int x) { return x + 1; }\n"
+                                     "int f1(int x) { return add1(x) * 2; }\n"
+                                     "int main(void) { return f1(1) == 4 && add1(2) == 3 ? 0 : 1; }\n",
+                                     "inline.c", object_file, 2));
+
+    auto buffer{llvm::MemoryBuffer::getFile(object_file)};
+    BOOST_REQUIRE(static_cast<bool>(buffer));
+    ObjectFile object;
+    object.name_ = object_file;
+    object.data_.assign((*buffer)->getBufferStart(), (*buffer)->getBufferEnd());
+    BOOST_REQUIRE(LinkObjects({&object}, program_file, std::cerr));
+    BOOST_CHECK_EQUAL(std::system(program_file.c_str()), 0);
+    std::filesystem::remove_all(directory);
+}
+
+// 优化之后局部变量提升为寄存器, 常量参数的调用被内联和折叠
+BOOST_AUTO_TEST_CASE(Optimize) {
+    std::string input{"static int add(int a, int b) { int c = a + b; return c; }\n"
+                      "int sum(void) { int i, s = 0; for (i = 0; i < 10; ++i) s = add(s, i); return s; }\n"};
+    TypeTable types;
+    Arena arena;
+    Scanner scanner{input, "obj_gen.c"};
+    Parser parser{scanner, types, arena};
+    auto program{parser.Parse()};
+    BOOST_REQUIRE(!parser.HasErrors());
+
+    for (auto level:{0U, 2U}) {
+        CodeGenContext context{scanner, types, "obj_gen.c"};
+        context.GenerateCode(*program);
+        BOOST_REQUIRE(!context.HasErrors());
+
+        CodeGenOptions options;
+        options.opt_level_ = level;
+        CodeGenSession session{options};
+        ObjectFile object;
+        std::string error;
+        BOOST_REQUIRE(ObjGen(session, context, object, error));
+
+        auto &sum{context.the_module_->getFunction("sum")->getEntryBlock()};
+        if (level == 0) {
+            BOOST_CHECK(llvm::isa<llvm::AllocaInst>(sum.front()));
+        } else {
+            auto ret{llvm::dyn_cast<llvm::ReturnInst>(sum.getTerminator())};
+            BOOST_REQUIRE(ret != nullptr);
+            auto value{llvm::dyn_cast<llvm::ConstantInt>(ret->getReturnValue())};
+            BOOST_REQUIRE(value != nullptr);
+            BOOST_CHECK_EQUAL(value->getSExtValue(), 45);
+        }
+    }
+}
+
+// 在本进程中加载目标文件并调用main, C库的函数从本进程中查找
+BOOST_AUTO_TEST_CASE(Run) {
+    std::string input{"int strcmp(const char *lhs, const char *rhs);\n"
+                      "static int add(int a, int b) { return a + b; }\n"
+                      "int main(int argc, char **argv) { return strcmp(argv[1], \"tcc\") == 0 ? add(argc, 40) : 1; }\n"};
+    TypeTable types;
+    Arena arena;
+    Scanner scanner{input, "run.c"};
+    Parser parser{scanner, types, arena};
+    auto program{parser.Parse()};
+    BOOST_REQUIRE(!parser.HasErrors());
+
+    CodeGenSession session;
+    ThreadPool pool{2};
+    auto contexts{GenerateCodeParallel(*program, scanner, types, pool, 2)};
+    std::vector<ObjectFile> objects(std::size(contexts));
+    std::vector<const ObjectFile *> inputs;
+    std::string error;
+    for (std::size_t i{}; i < std::size(contexts); ++i) {
+        BOOST_REQUIRE(ObjGen(session, *contexts[i], objects[i], error));
+        inputs.push_back(&objects[i]);
+    }
+
+    int exit_code{};
+    BOOST_REQUIRE(RunObjects(inputs, {"run.c", "tcc"}, exit_code));
+    BOOST_CHECK_EQUAL(exit_code, 42);
+    BOOST_CHECK(!RunObjects({}, {"run.c"}, exit_code));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "object_cache.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+ObjectFile MakeObject(const std::string &name, std::size_t size, char fill) {
+    ObjectFile object;
+    object.name_ = name;
+    object.data_.assign(size, fill);
+    return object;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ObjectCacheTest)
+
+BOOST_AUTO_TEST_CASE(MakeKey) {
+    auto key{ObjectCache::MakeKey({"ab", "c"})};
+    BOOST_CHECK_EQUAL(std::size(key), 64);
+    BOOST_CHECK_EQUAL(key, ObjectCache::MakeKey({"ab", "c"}));
+    BOOST_CHECK_NE(key, ObjectCache::MakeKey({"a", "bc"}));
+    BOOST_CHECK_NE(key, ObjectCache::MakeKey({"abc"}));
+}
+
+BOOST_AUTO_TEST_CASE(StoreAndLoad) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_object_cache_test"};
+    std::filesystem::remove_all(directory);
+
+    ObjectCache cache{directory.string(), 1 << 20};
+    ObjectCache::Entry entry;
+    BOOST_CHECK(!cache.Load(ObjectCache::MakeKey({"a.c"}), entry));
+
+    ObjectCache::Entry stored;
+    stored.diagnostics_ = "a.c:1:1: warning: unused\n";
+    stored.objects_.push_back(MakeObject("a.c.0", 100, 'x'));
+    stored.objects_.push_back(MakeObject("a.c.1", 0, 'y'));
+    cache.Store(ObjectCache::MakeKey({"a.c"}), stored);
+
+    BOOST_REQUIRE(cache.Load(ObjectCache::MakeKey({"a.c"}), entry));
+    BOOST_CHECK_EQUAL(entry.diagnostics_, stored.diagnostics_);
+    BOOST_REQUIRE_EQUAL(std::size(entry.objects_), 2);
+    BOOST_CHECK(entry.objects_[0].data_ == stored.objects_[0].data_);
+    BOOST_CHECK(std::empty(entry.objects_[1].data_));
+
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1);
+    BOOST_CHECK_EQUAL(cache.GetStores(), 1);
+    std::filesystem::remove_all(directory);
+}
+
+// 被截断或者损坏的项当作没有命中, 并被删除
+BOOST_AUTO_TEST_CASE(CorruptedEntry) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_object_cache_corrupted_test"};
+    std::filesystem::remove_all(directory);
+
+    ObjectCache cache{directory.string(), 1 << 20};
+    ObjectCache::Entry stored;
+    stored.diagnostics_ = "warning";
+    stored.objects_.push_back(MakeObject("a.c.0", 100, 'x'));
+
+    auto key{ObjectCache::MakeKey({"a.c"})};
+    auto path{directory / (key + ".tcc")};
+    auto corrupt{[&](auto &&modify) {
+        cache.Store(key, stored);
+        std::string data;
+        {
+            std::ifstream ifs{path, std::ios::binary};
+            data.assign(std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+        }
+        modify(data);
+        std::ofstream ofs{path, std::ios::binary | std::ios::trunc};
+        ofs << data;
+    }};
+
+    // 截断
+    corrupt([](std::string &data) { data.resize(std::size(data) - 10); });
+    ObjectCache::Entry entry;
+    BOOST_CHECK(!cache.Load(key, entry));
+    BOOST_CHECK(!std::filesystem::exists(path));
+    BOOST_CHECK(std::empty(entry.objects_));
+
+    // 诊断信息的长度被改成一个极大的值
+    corrupt([](std::string &data) { std::fill_n(std::begin(data) + 80, 8, '\xff'); });
+    BOOST_CHECK(!cache.Load(key, entry));
+    BOOST_CHECK(!std::filesystem::exists(path));
+
+    // 目标文件的内容被修改
+    corrupt([](std::string &data) { data.back() ^= 1; });
+    BOOST_CHECK(!cache.Load(key, entry));
+
+    // 文件放在了其他键的位置上
+    cache.Store(key, stored);
+    std::filesystem::rename(path, directory / (ObjectCache::MakeKey({"b.c"}) + ".tcc"));
+    BOOST_CHECK(!cache.Load(ObjectCache::MakeKey({"b.c"}), entry));
+
+    cache.Store(key, stored);
+    BOOST_REQUIRE(cache.Load(key, entry));
+    BOOST_CHECK(entry.objects_[0].data_ == stored.objects_[0].data_);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 4);
+    std::filesystem::remove_all(directory);
+}
+
+// 超过上限时先删除最久没有使用的项
+BOOST_AUTO_TEST_CASE(Trim) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_object_cache_trim_test"};
+    std::filesystem::remove_all(directory);
+
+    ObjectCache cache{directory.string(), 2500};
+    for (auto name:{"a", "b", "c"}) {
+        ObjectCache::Entry entry;
+        entry.objects_.push_back(MakeObject(name, 1000, 'z'));
+        cache.Store(ObjectCache::MakeKey({name}), entry);
+    }
+    // 修改时间的精度可能不够, 直接设置
+    auto now{std::filesystem::file_time_type::clock::now()};
+    auto index{0};
+    for (auto name:{"b", "a", "c"}) {
+        auto path{directory / (ObjectCache::MakeKey({name}) + ".tcc")};
+        BOOST_REQUIRE(std::filesystem::exists(path));
+        std::filesystem::last_write_time(path, now - std::chrono::hours{3 - index++});
+    }
+
+    cache.Trim();
+    BOOST_CHECK_EQUAL(cache.GetEvictions(), 1);
+    // 没有新写入的项时不再扫描目录
+    {
+        std::ofstream ofs{directory / "other.tcc", std::ios::binary};
+        ofs << std::string(3000, 'o');
+    }
+    std::filesystem::last_write_time(directory / "other.tcc", now - std::chrono::hours{5});
+    cache.Trim();
+    BOOST_CHECK_EQUAL(cache.GetEvictions(), 1);
+    BOOST_CHECK(std::filesystem::exists(directory / "other.tcc"));
+    ObjectCache::Entry entry;
+    BOOST_CHECK(!cache.Load(ObjectCache::MakeKey({"b"}), entry));
+    BOOST_CHECK(cache.Load(ObjectCache::MakeKey({"a"}), entry));
+    BOOST_CHECK(cache.Load(ObjectCache::MakeKey({"c"}), entry));
+    std::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
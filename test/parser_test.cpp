@@ -0,0 +1,275 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "parser.h"
+#include "preprocessor.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <string>
+
+namespace {
+
+// Scanner借用input, 语法树引用types, 所以放在一起保持生命周期
+struct Parsed {
+    explicit Parsed(std::string source) :
+            input{std::move(source)}, scanner{input, "parser.c"}, parser{scanner, types, arena},
+            program{parser.Parse()} {}
+
+    std::string input;
+    TypeTable types;
+    Arena arena;
+    Scanner scanner;
+    Parser parser;
+    Block *program;
+};
+
+template<typename T>
+T *As(ASTNode *node) {
+    auto result{NodeCast<T>(node)};
+    BOOST_REQUIRE(result != nullptr);
+    return result;
+}
+
+// 函数体中第index条表达式语句的表达式
+Expression *BodyExpression(const Parsed &parsed, std::size_t function, std::size_t index) {
+    auto declaration{As<FunctionDeclaration>(parsed.program->statements_[function])};
+    BOOST_REQUIRE(declaration->body_ != nullptr);
+    return As<ExpressionStatement>(declaration->body_->statements_[index])->expression_;
+}
+
+std::string_view Spelling(SymbolId symbol) {
+    return Interner::Global().GetSpelling(symbol);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ParserTest)
+
+BOOST_AUTO_TEST_CASE(PrecedenceAndAssociativity) {
+    Parsed parsed{"int a, b, c;\n"
+                  "void f(void) { a = b = c; a - b - c; a + b * c; a ? b : c ? a : b; a = b, c; a += b << 1; }"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    // 赋值是右结合的
+    auto assign{As<Assignment>(BodyExpression(parsed, 3, 0))};
+    BOOST_CHECK(As<Assignment>(assign->rhs_)->op_ == TokenValue::kAssign);
+
+    // 减法是左结合的
+    auto minus{As<BinaryOpExpression>(BodyExpression(parsed, 3, 1))};
+    BOOST_CHECK(As<BinaryOpExpression>(minus->lhs_)->op_ == TokenValue::kMinus);
+    BOOST_CHECK(NodeCast<IdentifierOrType>(minus->rhs_) != nullptr);
+
+    auto plus{As<BinaryOpExpression>(BodyExpression(parsed, 3, 2))};
+    BOOST_CHECK(plus->op_ == TokenValue::kPlus);
+    BOOST_CHECK(As<BinaryOpExpression>(plus->rhs_)->op_ == TokenValue::kMultiply);
+
+    auto conditional{As<ConditionalExpression>(BodyExpression(parsed, 3, 3))};
+    As<ConditionalExpression>(conditional->false_expression_);
+
+    // 逗号的优先级最低
+    auto comma{As<BinaryOpExpression>(BodyExpression(parsed, 3, 4))};
+    BOOST_CHECK(comma->op_ == TokenValue::kComma);
+    As<Assignment>(comma->lhs_);
+
+    auto compound{As<Assignment>(BodyExpression(parsed, 3, 5))};
+    BOOST_CHECK(compound->op_ == TokenValue::kPlusAssign);
+    BOOST_CHECK(As<BinaryOpExpression>(compound->rhs_)->op_ == TokenValue::kShl);
+}
+
+BOOST_AUTO_TEST_CASE(CastNeedsTypedefName) {
+    Parsed parsed{"typedef int T; int x;\n"
+                  "void f(void) { (T)x; (x) + 1; sizeof(T); sizeof x; -(T)x++; }"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    auto cast{As<CastExpression>(BodyExpression(parsed, 1, 0))};
+    BOOST_CHECK(cast->type_ == parsed.types.GetInt());
+    As<BinaryOpExpression>(BodyExpression(parsed, 1, 1));
+    BOOST_CHECK(As<SizeofExpression>(BodyExpression(parsed, 1, 2))->type_ == parsed.types.GetInt());
+    BOOST_CHECK(As<SizeofExpression>(BodyExpression(parsed, 1, 3))->expression_ != nullptr);
+
+    auto negate{As<UnaryOpExpression>(BodyExpression(parsed, 1, 4))};
+    auto inner{As<CastExpression>(negate->operand_)};
+    BOOST_CHECK(As<UnaryOpExpression>(inner->expression_)->postfix_);
+}
+
+BOOST_AUTO_TEST_CASE(DeclaratorTypes) {
+    Parsed parsed{"int *(*p)[3];\n"
+                  "int (*fp)(int, char *, ...);\n"
+                  "struct S { char c; int i : 3; int j : 5; long l; } s;\n"
+                  "enum E { A, B = 5, C };\n"
+                  "int arr[C * 2];\n"
+                  "union U { int i; double d; struct { char x, y; }; } u;\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+    const auto &statements{parsed.program->statements_};
+    BOOST_REQUIRE_EQUAL(std::size(statements), 5);
+
+    // p是指向三个int*的数组的指针
+    auto p{As<VariableDeclaration>(statements[0])->type_};
+    BOOST_REQUIRE(p->IsPointer() && p->base_->IsArray());
+    BOOST_CHECK_EQUAL(p->base_->length_, 3);
+    BOOST_CHECK(p->base_->base_ == parsed.types.GetPointer(parsed.types.GetInt()));
+
+    auto fp{As<VariableDeclaration>(statements[1])->type_};
+    BOOST_REQUIRE(fp->IsPointer() && fp->base_->IsFunction());
+    BOOST_CHECK_EQUAL(std::size(fp->base_->params_), 2);
+    BOOST_CHECK(fp->base_->variadic_);
+    BOOST_CHECK(fp->base_->base_ == parsed.types.GetInt());
+
+    auto s{As<VariableDeclaration>(statements[2])->type_};
+    BOOST_REQUIRE(s->IsRecord() && s->IsComplete());
+    BOOST_CHECK_EQUAL(s->GetSize(), 16);
+    BOOST_CHECK_EQUAL(s->GetAlign(), 8);
+    std::uint64_t offset{};
+    auto j{s->FindMember(Interner::Global().Intern("j"), offset)};
+    BOOST_REQUIRE(j != nullptr);
+    BOOST_CHECK(j->bit_field_);
+    // c之后的空间足够放下i和j, 它们与c共用第一个int
+    BOOST_CHECK_EQUAL(offset, 0);
+    BOOST_CHECK_EQUAL(j->bit_offset_, 11);
+    BOOST_CHECK_EQUAL(s->FindMember(Interner::Global().Intern("l"), offset)->offset_, 8);
+
+    // 枚举常量在之后的常量表达式中可用
+    auto arr{As<VariableDeclaration>(statements[3])->type_};
+    BOOST_CHECK_EQUAL(arr->length_, 12);
+
+    auto u{As<VariableDeclaration>(statements[4])->type_};
+    BOOST_CHECK_EQUAL(u->GetSize(), 8);
+    BOOST_CHECK(u->FindMember(Interner::Global().Intern("y"), offset) != nullptr);
+    BOOST_CHECK_EQUAL(offset, 1);
+}
+
+// 未指定长度的数组由初始化器决定长度, 内层省略花括号时按标量的个数计算
+BOOST_AUTO_TEST_CASE(InferredArrayLength) {
+    Parsed parsed{"int a[] = {1, 2, 3};\n"
+                  "int b[][2] = {1, 2, 3};\n"
+                  "int c[][2] = {{1}, 2, 3, {4, 5}};\n"
+                  "char s[] = \"abc\";\n"
+                  "char t[] = {\"ab\"};\n"
+                  "char u[] = {'x', 'y'};\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    std::int64_t expected[]{3, 2, 3, 4, 3, 2};
+    const auto &statements{parsed.program->statements_};
+    BOOST_REQUIRE_EQUAL(std::size(statements), std::size(expected));
+    for (std::size_t i{}; i < std::size(expected); ++i) {
+        auto type{As<VariableDeclaration>(statements[i])->type_};
+        BOOST_REQUIRE(type->IsArray());
+        BOOST_CHECK_EQUAL(type->length_, expected[i]);
+    }
+}
+
+// __builtin_va_arg的第二个实参是类型名, 保存为sizeof(类型名)
+BOOST_AUTO_TEST_CASE(BuiltinVaArg) {
+    Parsed parsed{"typedef __builtin_va_list va_list;\n"
+                  "void f(va_list ap) { __builtin_va_arg(ap, char *); }\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    auto call{As<FunctionCall>(BodyExpression(parsed, 0, 0))};
+    BOOST_CHECK_EQUAL(Spelling(As<IdentifierOrType>(call->function_)->name_), "__builtin_va_arg");
+    BOOST_REQUIRE_EQUAL(std::size(call->args_), 2);
+    As<IdentifierOrType>(call->args_[0]);
+    auto type{As<SizeofExpression>(call->args_[1])->type_};
+    BOOST_REQUIRE(type != nullptr);
+    BOOST_CHECK(type->IsPointer());
+}
+
+BOOST_AUTO_TEST_CASE(Statements) {
+    Parsed parsed{"int f(int n) {\n"
+                  "    int sum = 0;\n"
+                  "    for (int i = 0; i < n; ++i) { if (i % 2) continue; else sum += i; }\n"
+                  "    while (n--) ;\n"
+                  "    do { sum--; } while (sum > 100);\n"
+                  "    switch (n) { case 1: case 2 + 1: break; default: goto out; }\n"
+                  "out:\n"
+                  "    return sum;\n"
+                  "}\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    auto function{As<FunctionDeclaration>(parsed.program->statements_.front())};
+    BOOST_CHECK_EQUAL(Spelling(function->function_name_), "f");
+    BOOST_REQUIRE_EQUAL(std::size(function->args_), 1);
+    BOOST_CHECK_EQUAL(Spelling(function->args_.front()->variable_name_), "n");
+
+    const auto &body{function->body_->statements_};
+    BOOST_REQUIRE_EQUAL(std::size(body), 6);
+    As<VariableDeclaration>(body[0]);
+    auto loop{As<ForStatenment>(body[1])};
+    BOOST_REQUIRE_EQUAL(std::size(loop->initial_), 1);
+    As<VariableDeclaration>(loop->initial_.front());
+    As<WhileStatement>(body[2]);
+    As<DoWhileStatement>(body[3]);
+    As<SwitchStatement>(body[4]);
+    auto label{As<LabelStatement>(body[5])};
+    As<ReturnStatenment>(label->statement_);
+}
+
+// 用到__func__的函数体开头多了一个静态的字符数组
+BOOST_AUTO_TEST_CASE(FuncName) {
+    Parsed parsed{"const char *f(void) { return __func__; }\n"
+                  "int g(void) { return 0; }\n"};
+    BOOST_REQUIRE(!parsed.parser.HasErrors());
+
+    auto f{As<FunctionDeclaration>(parsed.program->statements_[0])};
+    BOOST_REQUIRE_EQUAL(std::size(f->body_->statements_), 2);
+    auto func{As<VariableDeclaration>(f->body_->statements_[0])};
+    BOOST_CHECK_EQUAL(Spelling(func->variable_name_), "__func__");
+    BOOST_CHECK(func->storage_ == StorageClass::kStatic);
+    BOOST_CHECK(func->type_->IsArray());
+    BOOST_CHECK_EQUAL(func->type_->length_, 2);
+    BOOST_CHECK_EQUAL(Spelling(As<String>(func->initialization_expression_)->value_), "f");
+
+    auto g{As<FunctionDeclaration>(parsed.program->statements_[1])};
+    BOOST_CHECK_EQUAL(std::size(g->body_->statements_), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ErrorRecovery) {
+    Parsed parsed{"# 10 \"source.c\"\n"
+                  "int a = ;\n"
+                  "int b;\n"
+                  "void f(void) { a = ; b = 1; }\n"
+                  "int c"};
+    BOOST_CHECK(parsed.parser.HasErrors());
+    const auto &diagnostics{parsed.parser.GetDiagnostics()};
+    BOOST_REQUIRE_EQUAL(std::size(diagnostics), 3);
+    BOOST_CHECK_EQUAL(diagnostics[0].file_name_, "source.c");
+    BOOST_CHECK_EQUAL(diagnostics[0].line_, 10);
+    BOOST_CHECK_EQUAL(diagnostics[0].column_, 9);
+    BOOST_CHECK_EQUAL(diagnostics[1].line_, 12);
+
+    // 出错之后的声明和语句仍然被分析
+    const auto &statements{parsed.program->statements_};
+    BOOST_REQUIRE_EQUAL(std::size(statements), 3);
+    auto function{As<FunctionDeclaration>(statements[1])};
+    BOOST_CHECK_EQUAL(std::size(function->body_->statements_), 1);
+}
+
+BOOST_AUTO_TEST_CASE(ParsesSystemHeaders) {
+    Preprocessor preprocessor;
+    auto output{preprocessor.PreprocessBuffer("#include <stdio.h>\n"
+                                              "#include <stdlib.h>\n"
+                                              "#include <string.h>\n"
+                                              "int main(void) {\n"
+                                              "    char *buffer = malloc(16);\n"
+                                              "    strcpy(buffer, \"tcc\");\n"
+                                              "    printf(\"%s %d\\n\", buffer, (int)sizeof(FILE) << 1);\n"
+                                              "    free(buffer);\n"
+                                              "    return EXIT_SUCCESS;\n"
+                                              "}\n", "main.c")};
+    BOOST_REQUIRE(!preprocessor.HasErrors());
+
+    Parsed parsed{output};
+    for (const auto &diagnostic:parsed.parser.GetDiagnostics()) {
+        BOOST_TEST_MESSAGE(diagnostic);
+    }
+    BOOST_CHECK(!parsed.scanner.HasErrors());
+    BOOST_CHECK(!parsed.parser.HasErrors());
+
+    auto main{As<FunctionDeclaration>(parsed.program->statements_.back())};
+    BOOST_CHECK_EQUAL(Spelling(main->function_name_), "main");
+    BOOST_CHECK_EQUAL(std::size(main->body_->statements_), 5);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,242 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "preprocessor.h"
+#include "scanner.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 只比较记号的拼写, 忽略空白和行标记
+std::vector<std::string> Spellings(const std::string &output) {
+    Scanner scanner{output, "output"};
+    std::vector<std::string> result;
+    for (const auto &token:scanner.GetTokenSequence()) {
+        result.emplace_back(scanner.GetTokenName(token));
+    }
+    return result;
+}
+
+std::vector<std::string> Preprocess(const std::string &input) {
+    Preprocessor preprocessor;
+    auto output{preprocessor.PreprocessBuffer(input, "buffer.c")};
+    BOOST_CHECK(!preprocessor.HasErrors());
+    return Spellings(output);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(PreprocessorTest)
+
+BOOST_AUTO_TEST_CASE(ObjectAndFunctionLikeMacros) {
+    auto tokens{Preprocess("#define N 10\n"
+                           "#define MAX(a, b) ((a) > (b) ? (a) : (b))\n"
+                           "int x = MAX(N, 2);\n")};
+    std::vector<std::string> expected{"int", "x", "=", "(", "(", "10", ")", ">", "(", "2", ")",
+                                      "?", "(", "10", ")", ":", "(", "2", ")", ")", ";"};
+    BOOST_CHECK(tokens == expected);
+}
+
+BOOST_AUTO_TEST_CASE(StringizeAndPaste) {
+    auto tokens{Preprocess("#define STR(x) #x\n"
+                           "#define CAT(a, b) a ## b\n"
+                           "#define LOG(fmt, ...) printf(fmt, ## __VA_ARGS__)\n"
+                           "char *s = STR(a  +  \"b\");\n"
+                           "int CAT(var, 1);\n"
+                           "LOG(\"x\"); LOG(\"y\", 1, 2);\n")};
+    std::vector<std::string> expected{"char", "*", "s", "=", R"("a + \"b\"")", ";",
+                                      "int", "var1", ";",
+                                      "printf", "(", "\"x\"", ")", ";",
+                                      "printf", "(", "\"y\"", ",", "1", ",", "2", ")", ";"};
+    BOOST_CHECK(tokens == expected);
+}
+
+BOOST_AUTO_TEST_CASE(RecursionIsBlocked) {
+    // 标准中的例子, 展开过程中的宏名不会再次展开
+    auto tokens{Preprocess("#define f(a) a*g\n"
+                           "#define g(a) f(a)\n"
+                           "f(2)(9)\n"
+                           "#define foo foo + 1\n"
+                           "foo\n")};
+    std::vector<std::string> expected{"2", "*", "9", "*", "g", "foo", "+", "1"};
+    BOOST_CHECK(tokens == expected);
+}
+
+BOOST_AUTO_TEST_CASE(Conditionals) {
+    auto tokens{Preprocess("#define A 2\n"
+                           "#if defined(A) && A * 2 == 4 && !defined B\n"
+                           "one\n"
+                           "#elif 1\n"
+                           "two\n"
+                           "#else\n"
+                           "three\n"
+                           "#endif\n"
+                           "#ifdef B\n"
+                           "#if garbage (\n"
+                           "#endif\n"
+                           "#elif (-1 < 0u) || (1 ? 0 : 1 / 0)\n"
+                           "four\n"
+                           "#else\n"
+                           "five\n"
+                           "#endif\n")};
+    std::vector<std::string> expected{"one", "five"};
+    BOOST_CHECK(tokens == expected);
+}
+
+BOOST_AUTO_TEST_CASE(LineSplicesAndLineDirective) {
+    Preprocessor preprocessor;
+    auto output{preprocessor.PreprocessBuffer("#define LONG 1 + \\\n  2\n"
+                                              "int x = LONG;\n"
+                                              "#line 100 \"other.c\"\n"
+                                              "int y = __LINE__;\n", "buffer.c")};
+    BOOST_CHECK(!preprocessor.HasErrors());
+    BOOST_CHECK(output.find("int x = 1 + 2;") != std::string::npos);
+    BOOST_CHECK(output.find("# 100 \"other.c\"\nint y = 100;") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(IncludeFiles) {
+    std::string header{"preprocessor_test_header.h"};
+    {
+        std::ofstream ofs{header};
+        ofs << "#ifndef HEADER_H\n#define HEADER_H\nint from_header;\n#endif\n";
+    }
+
+    auto tokens{Preprocess("#include \"preprocessor_test_header.h\"\n"
+                           "#include \"preprocessor_test_header.h\"\n"
+                           "#define __need_size_t\n"
+                           "#include <stddef.h>\n"
+                           "size_t n = sizeof(int);\n")};
+    std::remove(header.c_str());
+
+    std::vector<std::string> expected{"int", "from_header", ";",
+                                      "typedef", "unsigned", "long", "size_t", ";",
+                                      "size_t", "n", "=", "sizeof", "(", "int", ")", ";"};
+    BOOST_CHECK(tokens == expected);
+}
+
+BOOST_AUTO_TEST_CASE(IncludeGuardDetection) {
+    auto &interner{Interner::Global()};
+    auto guard{interner.Intern("GUARD_H")};
+
+    BOOST_CHECK(SourceFile("a.h", "#ifndef GUARD_H\n#define GUARD_H\nint x;\n#endif // GUARD_H\n", interner)
+                        .guard_ == guard);
+    BOOST_CHECK(SourceFile("b.h", "#if !defined(GUARD_H)\n#if 1\n#endif\n#endif\n", interner).guard_ == guard);
+    // 保护宏之外还有内容, 或者有#else, 都不能跳过
+    BOOST_CHECK(SourceFile("c.h", "#ifndef GUARD_H\n#endif\nint y;\n", interner).guard_ == kEmptySymbol);
+    BOOST_CHECK(SourceFile("d.h", "#ifndef GUARD_H\n#else\n#endif\n", interner).guard_ == kEmptySymbol);
+    BOOST_CHECK(SourceFile("e.h", "int z;\n#ifndef GUARD_H\n#endif\n", interner).guard_ == kEmptySymbol);
+}
+
+BOOST_AUTO_TEST_CASE(IncludeCacheReusesFiles) {
+    std::string header{"preprocessor_test_cached.h"};
+    {
+        std::ofstream ofs{header};
+        ofs << "#pragma once\nint cached;\n";
+    }
+
+    IncludeCache cache;
+    std::string input{"#include \"preprocessor_test_cached.h\"\n#include \"preprocessor_test_cached.h\"\n"};
+    for (auto i{0}; i < 3; ++i) {
+        Preprocessor preprocessor{{}, cache};
+        auto tokens{Spellings(preprocessor.PreprocessBuffer(input, "buffer.c"))};
+        BOOST_CHECK(!preprocessor.HasErrors());
+        BOOST_CHECK((tokens == std::vector<std::string>{"int", "cached", ";"}));
+    }
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1);
+    BOOST_CHECK_EQUAL(cache.GetHits(), 2);
+
+    // 文件改变之后重新读取
+    {
+        std::ofstream ofs{header};
+        ofs << "#pragma once\nlong changed;\n";
+    }
+    Preprocessor preprocessor{{}, cache};
+    auto tokens{Spellings(preprocessor.PreprocessBuffer(input, "buffer.c"))};
+    std::remove(header.c_str());
+
+    BOOST_CHECK((tokens == std::vector<std::string>{"long", "changed", ";"}));
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(PrecompiledHeaders) {
+    std::string header{"preprocessor_test_pch.h"};
+    std::string pch_file{header + ".pch"};
+    {
+        std::ofstream ofs{header};
+        ofs << "#ifndef PCH_H\n#define PCH_H\n#define SQUARE(x) ((x) * (x))\n"
+               "typedef long pch_long;\nconst char *pch_name = \"pch\";\ndouble pch_value = 1.5;\n#endif\n";
+    }
+    std::string input{"#include \"preprocessor_test_pch.h\"\n"
+                      "#include \"preprocessor_test_pch.h\"\n"
+                      "pch_long x = SQUARE(3);\n"};
+
+    PreprocessorOptions options;
+    options.use_precompiled_headers_ = false;
+    Preprocessor plain{options};
+    auto expected{plain.PreprocessBuffer(input, "buffer.c")};
+    BOOST_CHECK(plain.GetPrecompiledHeader() == nullptr);
+
+    BOOST_REQUIRE(Preprocessor{}.EmitPrecompiledHeader(header, pch_file));
+
+    Preprocessor preprocessor;
+    auto output{preprocessor.PreprocessBuffer(input, "buffer.c")};
+    BOOST_CHECK(!preprocessor.HasErrors());
+    BOOST_REQUIRE(preprocessor.GetPrecompiledHeader() != nullptr);
+    BOOST_CHECK(Spellings(output) == Spellings(expected));
+
+    // 预编译的记号和重新扫描得到的记号相同
+    auto precompiled_header{preprocessor.GetPrecompiledHeader()};
+    Scanner full{output, "output"};
+    Scanner partial{output, "output"};
+    partial.UsePrecompiled(precompiled_header->GetTokens(),
+                           static_cast<std::uint32_t>(std::size(precompiled_header->GetText())));
+    auto full_tokens{full.GetTokenSequence()};
+    auto partial_tokens{partial.GetTokenSequence()};
+    BOOST_REQUIRE_EQUAL(std::size(full_tokens), std::size(partial_tokens));
+    for (std::size_t i{}; i < std::size(full_tokens); ++i) {
+        BOOST_CHECK(full_tokens[i].GetOffset() == partial_tokens[i].GetOffset());
+        BOOST_CHECK(full.GetTokenName(full_tokens[i]) == partial.GetTokenName(partial_tokens[i]));
+    }
+
+    // 不是第一条指令时不使用
+    Preprocessor late;
+    late.PreprocessBuffer("int y;\n" + input, "buffer.c");
+    BOOST_CHECK(late.GetPrecompiledHeader() == nullptr);
+
+    // 头文件改变之后预编译头文件失效
+    {
+        std::ofstream ofs{header};
+        ofs << "#define SQUARE(x) ((x) + (x))\ntypedef int pch_long;\n";
+    }
+    Preprocessor stale;
+    auto tokens{Spellings(stale.PreprocessBuffer(input, "buffer.c"))};
+    BOOST_CHECK(stale.GetPrecompiledHeader() == nullptr);
+    BOOST_CHECK((tokens == std::vector<std::string>{"typedef", "int", "pch_long", ";",
+                                                    "typedef", "int", "pch_long", ";",
+                                                    "pch_long", "x", "=", "(", "(", "3", ")", "+",
+                                                    "(", "3", ")", ")", ";"}));
+
+    std::remove(header.c_str());
+    std::remove(pch_file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(ErrorsAreCollected) {
+    Preprocessor preprocessor;
+    preprocessor.PreprocessBuffer("#if 1\n#error stop here\n#define f(a\n#include <no_such_header.h>\nint x;\n",
+                                  "buffer.c");
+    const auto &diagnostics{preprocessor.GetDiagnostics()};
+    BOOST_REQUIRE_EQUAL(std::size(diagnostics), 3);
+    BOOST_CHECK_EQUAL(diagnostics[0].line_, 2);
+    BOOST_CHECK_EQUAL(diagnostics[0].message_, "#error stop here");
+    BOOST_CHECK_EQUAL(diagnostics[1].line_, 3);
+    BOOST_CHECK_EQUAL(diagnostics[2].message_, "no_such_header.h: No such file or directory");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,191 @@
 // Created by kaiser on 18-12-8.
 //
 
+#include "scanner.h"
+#include "char_scan.h"
+
 #include <boost/test/unit_test.hpp>
 
-BOOST_AUTO_TEST_SUITE()
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <fstream>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ScannerTest)
+
+BOOST_AUTO_TEST_CASE(BorrowedBuffer) {
+    std::string input{"int main(void) {\n    return a->b;\n}"};
+    Scanner scanner{input, "buffer"};
+    auto tokens{scanner.GetTokenSequence()};
+
+    std::vector<TokenValue> expected{TokenValue::kIntKey, TokenValue::kIdentifier,
+                                     TokenValue::kLeftParen, TokenValue::kVoidKey,
+                                     TokenValue::kRightParen, TokenValue::kLeftCurly,
+                                     TokenValue::kReturnKey, TokenValue::kIdentifier,
+                                     TokenValue::kArrow, TokenValue::kIdentifier,
+                                     TokenValue::kSemicolon, TokenValue::kRightCurly};
+    BOOST_REQUIRE_EQUAL(std::size(tokens), std::size(expected));
+    for (std::size_t i{}; i < std::size(tokens); ++i) {
+        BOOST_CHECK(tokens[i].GetTokenValue() == expected[i]);
+    }
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[1]), "main");
+}
+
+BOOST_AUTO_TEST_CASE(MappedFileMatchesBuffer) {
+    std::string input{"# 1 \"test.c\"\nint x = y + z;"};
+    std::string file_name{"scanner_test_mapped.i"};
+    {
+        std::ofstream ofs{file_name, std::ios::binary};
+        ofs << input;
+    }
+
+    Scanner from_file{file_name};
+    auto file_tokens{from_file.GetTokenSequence()};
+    Scanner from_buffer{input, file_name};
+    auto buffer_tokens{from_buffer.GetTokenSequence()};
+    std::remove(file_name.c_str());
+
+    BOOST_REQUIRE_EQUAL(std::size(file_tokens), 7);
+    BOOST_REQUIRE_EQUAL(std::size(file_tokens), std::size(buffer_tokens));
+    for (std::size_t i{}; i < std::size(file_tokens); ++i) {
+        BOOST_CHECK_EQUAL(from_file.GetTokenName(file_tokens[i]),
+                          from_buffer.GetTokenName(buffer_tokens[i]));
+    }
+    BOOST_CHECK_EQUAL(from_file.GetTokenName(file_tokens.back()), ";");
+}
+
+BOOST_AUTO_TEST_CASE(LiteralPayload) {
+    std::string input{"x = 42; y = 0x17; z = 1.5f; s = \"a\\tb\"; c = 'q';"};
+    Scanner scanner{input, "buffer"};
+    auto tokens{scanner.GetTokenSequence()};
+
+    BOOST_REQUIRE_EQUAL(std::size(tokens), 20);
+    BOOST_CHECK(tokens[2].GetTokenType() == TokenType::kInterger);
+    BOOST_CHECK_EQUAL(tokens[2].GetSignedValue(), 42);
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[2]), "42");
+    BOOST_CHECK_EQUAL(tokens[6].GetSignedValue(), 23);
+    BOOST_CHECK(tokens[10].GetTokenType() == TokenType::kFolat);
+    BOOST_CHECK_EQUAL(tokens[10].GetFloatingValue(), 1.5);
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[10]), "1.5f");
+    BOOST_CHECK(tokens[14].GetTokenType() == TokenType::kString);
+    BOOST_CHECK_EQUAL(scanner.GetStringValue(tokens[14]), "a\tb");
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[14]), "\"a\\tb\"");
+    BOOST_CHECK_EQUAL(tokens[18].GetSignedValue(), 'q');
+    BOOST_CHECK(tokens[19].GetTokenValue() == TokenValue::kSemicolon);
+}
+
+BOOST_AUTO_TEST_CASE(CommentsAndAdjacentStrings) {
+    std::string input{"// line\nint /* block * / */ x; # 3 \"a.c\"\n"
+                      "char *s = \"ab\" \n  \"c\\x41\";"};
+    Scanner scanner{input, "buffer"};
+    auto tokens{scanner.GetTokenSequence()};
+
+    BOOST_REQUIRE_EQUAL(std::size(tokens), 9);
+    BOOST_CHECK(tokens[0].GetTokenValue() == TokenValue::kIntKey);
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[1]), "x");
+    BOOST_CHECK(tokens[3].GetTokenValue() == TokenValue::kCharKey);
+    BOOST_CHECK_EQUAL(scanner.GetStringValue(tokens[7]), "abcA");
+}
+
+BOOST_AUTO_TEST_CASE(InternedSymbols) {
+    Interner interner;
+    std::string input{"foo = bar + foo; s = \"foo\";"};
+    Scanner scanner{input, "buffer", interner};
+    auto tokens{scanner.GetTokenSequence()};
+
+    BOOST_REQUIRE_EQUAL(std::size(tokens), 10);
+    BOOST_CHECK(tokens[0].HasSymbol());
+    BOOST_CHECK_EQUAL(tokens[0].GetSymbol(), tokens[4].GetSymbol());
+    BOOST_CHECK_NE(tokens[0].GetSymbol(), tokens[2].GetSymbol());
+    BOOST_CHECK_EQUAL(tokens[0].GetSymbol(), tokens[8].GetSymbol());
+    BOOST_CHECK_EQUAL(interner.GetSpelling(tokens[2].GetSymbol()), "bar");
+    BOOST_CHECK_EQUAL(interner.Intern(""), kEmptySymbol);
+
+    SymbolId id{};
+    BOOST_CHECK(interner.Find("s", id));
+    BOOST_CHECK(!interner.Find("baz", id));
+}
+
+// 在同一地址上重新创建的Interner不能使用旧的线程局部缓存
+BOOST_AUTO_TEST_CASE(RecreatedInterner) {
+    std::optional<Interner> interner;
+    interner.emplace(true);
+    interner->Intern("a");
+    BOOST_CHECK_EQUAL(interner->Intern("reused"), 2);
+
+    interner.emplace(true);
+    BOOST_CHECK_EQUAL(interner->Intern("reused"), 1);
+    BOOST_CHECK_EQUAL(interner->GetSpelling(1), "reused");
+}
+
+BOOST_AUTO_TEST_CASE(StreamingLookahead) {
+    std::string input{"a = b * (c + 1); return a;"};
+    auto expected{Scanner{input, "buffer"}.GetTokenSequence()};
+
+    Scanner scanner{input, "buffer"};
+    BOOST_CHECK(scanner.Peek(3).GetTokenValue() == TokenValue::kMultiply);
+    BOOST_CHECK(scanner.Peek(Scanner::kMaxLookahead - 1).GetTokenType() == TokenType::kInterger);
+
+    for (const auto &token:expected) {
+        BOOST_CHECK(scanner.Peek().GetTokenValue() == token.GetTokenValue());
+        auto next{scanner.Next()};
+        BOOST_CHECK_EQUAL(next.GetOffset(), token.GetOffset());
+        BOOST_CHECK_EQUAL(next.GetLength(), token.GetLength());
+    }
+    BOOST_CHECK(scanner.Next().GetTokenType() == TokenType::kEof);
+    BOOST_CHECK(scanner.Peek(2).GetTokenType() == TokenType::kEof);
+}
+
+BOOST_AUTO_TEST_CASE(ErrorsAreCollected) {
+    std::string input{"int x = 12ab;\nchar *s = \"abc\nint y = 1e+;\nint z;"};
+    Scanner scanner{input, "bad.c"};
+    auto tokens{scanner.GetTokenSequence()};
+
+    BOOST_REQUIRE_EQUAL(std::size(scanner.GetDiagnostics()), 3);
+    const auto &diagnostic{scanner.GetDiagnostics().front()};
+    BOOST_CHECK_EQUAL(diagnostic.line_, 1);
+    BOOST_CHECK_EQUAL(diagnostic.column_, 11);
+    BOOST_CHECK(tokens[3].GetTokenType() == TokenType::kUnknown);
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[3]), "12ab");
+    BOOST_CHECK_EQUAL(scanner.GetDiagnostics()[1].line_, 2);
+    BOOST_CHECK_EQUAL(scanner.GetTokenName(tokens[std::size(tokens) - 2]), "z");
+
+    Scanner missing{"no/such/file.i"};
+    BOOST_CHECK(missing.HasErrors());
+    BOOST_CHECK(missing.GetNextToken().GetTokenType() == TokenType::kEof);
+}
+
+BOOST_AUTO_TEST_CASE(VectorizedScanMatchesScalar) {
+    std::mt19937 engine{42};
+    std::string alphabet{" \t\n\r\vaZ_09\"\\*/#+;\x80\xff"};
+    std::string input(4096, ' ');
+    for (auto &c:input) {
+        c = alphabet[engine() % std::size(alphabet)];
+    }
+
+    auto begin{std::data(input)};
+    auto end{begin + std::size(input)};
+    auto supported{GetSupportedCharScanLevel()};
 
+    for (std::size_t offset{}; offset < std::size(input); offset += 7) {
+        SetCharScanLevel(CharScanLevel::kScalar);
+        auto whitespace{SkipWhitespace(begin + offset, end)};
+        auto identifier{SkipIdentifier(begin + offset, end)};
+        auto special{FindStringSpecial(begin + offset, end)};
 
+        for (auto level:{CharScanLevel::kSse42, CharScanLevel::kAvx2}) {
+            if (static_cast<int>(level) > static_cast<int>(supported)) {
+                continue;
+            }
+            SetCharScanLevel(level);
+            BOOST_CHECK(SkipWhitespace(begin + offset, end) == whitespace);
+            BOOST_CHECK(SkipIdentifier(begin + offset, end) == identifier);
+            BOOST_CHECK(FindStringSpecial(begin + offset, end) == special);
+        }
+    }
+    SetCharScanLevel(supported);
+}
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END()
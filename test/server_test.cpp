@@ -0,0 +1,84 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "server.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE(ServerTest)
+
+// 客户端在另一个进程中, 工作目录, 环境变量和标准错误都与服务不同
+BOOST_AUTO_TEST_CASE(ForwardRequest) {
+    auto directory{std::filesystem::temp_directory_path() / "tcc_server_test"};
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    auto socket_path{(directory / "tcc.sock").string()};
+    auto stderr_path{(directory / "stderr.txt").string()};
+
+    bool served{};
+    std::thread server{[&] {
+        served = RunServer(socket_path, [](const std::vector<std::string> &args) {
+            auto variable{std::getenv("TCC_SERVER_TEST")};
+            std::cerr << "args: " << std::size(args) << ' ' << args.back() << '\n'
+                      << "cwd: " << std::filesystem::current_path().filename().string() << '\n'
+                      << "env: " << (variable ? variable : "unset") << '\n';
+            return 7;
+        });
+    }};
+
+    auto client{fork()};
+    BOOST_REQUIRE(client >= 0);
+    if (client == 0) {
+        auto fd{open(stderr_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600)};
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+        setenv("TCC_SERVER_TEST", "forwarded", 1);
+        if (chdir(directory.c_str()) != 0) {
+            _exit(100);
+        }
+        // 等待服务开始监听
+        for (int i{}; i < 500; ++i) {
+            if (int exit_code; ForwardToServer(socket_path, {"tcc", "a.c"}, exit_code)) {
+                _exit(exit_code);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+        _exit(101);
+    }
+
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(client, &status, 0), client);
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(WEXITSTATUS(status), 7);
+
+    std::ifstream ifs{stderr_path};
+    std::string output{std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{}};
+    BOOST_CHECK_EQUAL(output, "args: 2 a.c\ncwd: tcc_server_test\nenv: forwarded\n");
+    // 处理完之后服务恢复自己的环境变量和工作目录
+    BOOST_CHECK(std::getenv("TCC_SERVER_TEST") == nullptr);
+    BOOST_CHECK(std::filesystem::current_path().filename() != "tcc_server_test");
+
+    pthread_kill(server.native_handle(), SIGTERM);
+    server.join();
+    BOOST_CHECK(served);
+    BOOST_CHECK(!std::filesystem::exists(socket_path));
+    std::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,69 @@
+//
+// Created by kaiser on 18-12-9.
+//
+
+#include "thread_pool.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTest)
+
+BOOST_AUTO_TEST_CASE(ResultsAndExceptions) {
+    ThreadPool pool{4};
+    BOOST_CHECK_EQUAL(pool.GetSize(), 4);
+
+    std::vector<std::future<int>> futures;
+    for (int i{}; i < 100; ++i) {
+        futures.push_back(pool.Submit([i] { return i * i; }));
+    }
+    for (int i{}; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(pool.Wait(futures[i]), i * i);
+    }
+
+    auto failed{pool.Submit([]() -> int { throw std::runtime_error{"failed"}; })};
+    BOOST_CHECK_THROW(pool.Wait(failed), std::runtime_error);
+}
+
+// 只有一个线程时, 任务等待自己提交的子任务也不会死锁
+BOOST_AUTO_TEST_CASE(NestedWait) {
+    ThreadPool pool{1};
+    std::atomic<int> count{};
+
+    auto outer{pool.Submit([&] {
+        std::vector<std::future<int>> inner;
+        for (int i{}; i < 8; ++i) {
+            inner.push_back(pool.Submit([&, i] {
+                auto leaf{pool.Submit([&] { return ++count; })};
+                pool.Wait(leaf);
+                return i;
+            }));
+        }
+        int sum{};
+        for (auto &future:inner) {
+            sum += pool.Wait(future);
+        }
+        return sum;
+    })};
+
+    BOOST_CHECK_EQUAL(pool.Wait(outer), 28);
+    BOOST_CHECK_EQUAL(count, 8);
+}
+
+// 析构时执行完剩余的任务
+BOOST_AUTO_TEST_CASE(DrainOnDestruction) {
+    std::atomic<int> count{};
+    {
+        ThreadPool pool{2};
+        for (int i{}; i < 50; ++i) {
+            pool.Submit([&] { ++count; });
+        }
+    }
+    BOOST_CHECK_EQUAL(count, 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()